@@ -0,0 +1,460 @@
+#include "SVGBlend.h"
+#include <algorithm>
+#include <cstring>
+#ifdef SVG_X86
+#include <immintrin.h>
+#endif
+
+//x / 255 rounded, exact for every x up to 255 * 255
+static inline uint32_t div255(uint32_t x) {
+	x += 128;
+
+	return (x + (x >> 8)) >> 8;
+}
+
+//Every kernel works out, per channel:
+//over:  dst = src + dst * (255 - src alpha) / 255
+//solid: dst = color + dst * (255 - alpha) / 255
+//mask:  dst = color * c / 255 + dst * (255 - alpha * c / 255) / 255
+//with each division rounded by div255 and the sum clamped to 255. A fully
+//covered pixel of mask gives the same bytes as solid, so the SIMD versions
+//take that path for runs of them.
+//
+//The wide versions finish the tail with the next narrower one. They clear the
+//upper halves of the registers first: the SSE2 code is not VEX encoded, and
+//running it with them dirty costs a state transition per call, which made
+//AVX2 slower than SSE2 on short spans.
+
+static void over_scalar(uint8_t* dst, const uint8_t* src, int count) {
+	for (int i = 0; i < count; ++i, dst += 4, src += 4) {
+		uint32_t inverse = 255 - src[3];
+
+		for (int k = 0; k < 4; ++k) {
+			dst[k] = static_cast<uint8_t>(std::min<uint32_t>(src[k] + div255(dst[k] * inverse), 255));
+		}
+	}
+}
+
+static void solid_scalar(uint8_t* dst, int count, const uint8_t color[4]) {
+	uint32_t inverse = 255 - color[3];
+
+	if (inverse == 0) {
+		for (int i = 0; i < count; ++i) {
+			std::memcpy(dst + i * 4, color, 4);
+		}
+
+		return;
+	}
+
+	for (int i = 0; i < count; ++i, dst += 4) {
+		for (int k = 0; k < 4; ++k) {
+			dst[k] = static_cast<uint8_t>(std::min<uint32_t>(color[k] + div255(dst[k] * inverse), 255));
+		}
+	}
+}
+
+static void mask_scalar(uint8_t* dst, const uint8_t* coverage, int count, const uint8_t color[4]) {
+	for (int i = 0; i < count; ++i, dst += 4) {
+		uint32_t c = coverage[i];
+
+		if (c == 0) {
+			continue;
+		}
+
+		uint32_t inverse = 255 - div255(color[3] * c);
+
+		for (int k = 0; k < 4; ++k) {
+			dst[k] = static_cast<uint8_t>(std::min<uint32_t>(div255(color[k] * c) + div255(dst[k] * inverse), 255));
+		}
+	}
+}
+
+#ifdef SVG_X86
+
+SVG_TARGET_SSE2
+static inline __m128i div255_sse2(__m128i x) {
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+//div255(pixels * factors) for 4 pixels, with one 8 bit factor per channel
+SVG_TARGET_SSE2
+static inline __m128i scale_sse2(__m128i pixels, __m128i factors) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo = div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(factors, zero)));
+	__m128i hi = div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(factors, zero)));
+
+	return _mm_packus_epi16(lo, hi);
+}
+
+//Alpha byte of each of 4 pixels repeated in all four channels
+SVG_TARGET_SSE2
+static inline __m128i alpha_sse2(__m128i pixels) {
+	__m128i a = _mm_srli_epi32(pixels, 24);
+
+	a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+
+	return _mm_or_si128(a, _mm_slli_epi32(a, 16));
+}
+
+SVG_TARGET_SSE2
+static void over_sse2(uint8_t* dst, const uint8_t* src, int count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi32(-1);
+	int i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+		__m128i* p = reinterpret_cast<__m128i*>(dst + i * 4);
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(s, zero)) == 0xFFFF) {
+			continue;
+		}
+
+		__m128i alpha = alpha_sse2(s);
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(alpha, ones)) == 0xFFFF) {
+			_mm_storeu_si128(p, s);
+			continue;
+		}
+
+		_mm_storeu_si128(p, _mm_adds_epu8(s, scale_sse2(_mm_loadu_si128(p), _mm_xor_si128(alpha, ones))));
+	}
+
+	over_scalar(dst + i * 4, src + i * 4, count - i);
+}
+
+SVG_TARGET_SSE2
+static void solid_sse2(uint8_t* dst, int count, const uint8_t color[4]) {
+	uint32_t packed;
+
+	std::memcpy(&packed, color, 4);
+
+	const __m128i solid = _mm_set1_epi32(static_cast<int>(packed));
+	const __m128i inverse = _mm_set1_epi8(static_cast<char>(255 - color[3]));
+	bool opaque = color[3] == 255;
+	int i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128i* p = reinterpret_cast<__m128i*>(dst + i * 4);
+
+		if (opaque) {
+			_mm_storeu_si128(p, solid);
+		}
+		else {
+			_mm_storeu_si128(p, _mm_adds_epu8(solid, scale_sse2(_mm_loadu_si128(p), inverse)));
+		}
+	}
+
+	solid_scalar(dst + i * 4, count - i, color);
+}
+
+SVG_TARGET_SSE2
+static void mask_sse2(uint8_t* dst, const uint8_t* coverage, int count, const uint8_t color[4]) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi32(-1);
+	uint32_t packed;
+
+	std::memcpy(&packed, color, 4);
+
+	const __m128i solid = _mm_set1_epi32(static_cast<int>(packed));
+	int i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		uint32_t c4;
+
+		std::memcpy(&c4, coverage + i, 4);
+
+		if (c4 == 0) {
+			continue;
+		}
+
+		if (c4 == 0xFFFFFFFFu) {
+			solid_sse2(dst + i * 4, 4, color);
+			continue;
+		}
+
+		//Coverage byte of each pixel repeated in all four channels
+		__m128i c = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(c4)), zero), zero);
+
+		c = _mm_or_si128(c, _mm_slli_epi32(c, 8));
+		c = _mm_or_si128(c, _mm_slli_epi32(c, 16));
+
+		//The alpha of the scaled color is div255(alpha * c)
+		__m128i* p = reinterpret_cast<__m128i*>(dst + i * 4);
+		__m128i source = scale_sse2(solid, c);
+
+		_mm_storeu_si128(p, _mm_adds_epu8(source, scale_sse2(_mm_loadu_si128(p), _mm_xor_si128(alpha_sse2(source), ones))));
+	}
+
+	mask_scalar(dst + i * 4, coverage + i, count - i, color);
+}
+
+SVG_TARGET_AVX2
+static inline __m256i div255_avx2(__m256i x) {
+	x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+
+	return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+//Unpacking and packing both work within each 128 bit half, so pixels keep their order
+SVG_TARGET_AVX2
+static inline __m256i scale_avx2(__m256i pixels, __m256i factors) {
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo = div255_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(pixels, zero), _mm256_unpacklo_epi8(factors, zero)));
+	__m256i hi = div255_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(pixels, zero), _mm256_unpackhi_epi8(factors, zero)));
+
+	return _mm256_packus_epi16(lo, hi);
+}
+
+SVG_TARGET_AVX2
+static inline __m256i alpha_avx2(__m256i pixels) {
+	const __m256i pick = _mm256_setr_epi8(
+		3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15,
+		3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+
+	return _mm256_shuffle_epi8(pixels, pick);
+}
+
+SVG_TARGET_AVX2
+static void over_avx2(uint8_t* dst, const uint8_t* src, int count) {
+	const __m256i ones = _mm256_set1_epi32(-1);
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+		__m256i* p = reinterpret_cast<__m256i*>(dst + i * 4);
+
+		if (_mm256_testz_si256(s, s)) {
+			continue;
+		}
+
+		__m256i alpha = alpha_avx2(s);
+
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(alpha, ones)) == -1) {
+			_mm256_storeu_si256(p, s);
+			continue;
+		}
+
+		_mm256_storeu_si256(p, _mm256_adds_epu8(s, scale_avx2(_mm256_loadu_si256(p), _mm256_xor_si256(alpha, ones))));
+	}
+
+	_mm256_zeroupper();
+	over_sse2(dst + i * 4, src + i * 4, count - i);
+}
+
+SVG_TARGET_AVX2
+static void solid_avx2(uint8_t* dst, int count, const uint8_t color[4]) {
+	uint32_t packed;
+
+	std::memcpy(&packed, color, 4);
+
+	const __m256i solid = _mm256_set1_epi32(static_cast<int>(packed));
+	const __m256i inverse = _mm256_set1_epi8(static_cast<char>(255 - color[3]));
+	bool opaque = color[3] == 255;
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256i* p = reinterpret_cast<__m256i*>(dst + i * 4);
+
+		if (opaque) {
+			_mm256_storeu_si256(p, solid);
+		}
+		else {
+			_mm256_storeu_si256(p, _mm256_adds_epu8(solid, scale_avx2(_mm256_loadu_si256(p), inverse)));
+		}
+	}
+
+	_mm256_zeroupper();
+	solid_sse2(dst + i * 4, count - i, color);
+}
+
+SVG_TARGET_AVX2
+static void mask_avx2(uint8_t* dst, const uint8_t* coverage, int count, const uint8_t color[4]) {
+	const __m256i ones = _mm256_set1_epi32(-1);
+	//Picks the coverage of pixels 0 to 3 into the low half and 4 to 7 into the high half
+	const __m256i repeat = _mm256_setr_epi8(
+		0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+		4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+	uint32_t packed;
+
+	std::memcpy(&packed, color, 4);
+
+	const __m256i solid = _mm256_set1_epi32(static_cast<int>(packed));
+	int i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		uint64_t c8;
+
+		std::memcpy(&c8, coverage + i, 8);
+
+		if (c8 == 0) {
+			continue;
+		}
+
+		if (c8 == ~0ull) {
+			solid_avx2(dst + i * 4, 8, color);
+			continue;
+		}
+
+		__m256i* p = reinterpret_cast<__m256i*>(dst + i * 4);
+		__m256i c = _mm256_shuffle_epi8(_mm256_set1_epi64x(static_cast<long long>(c8)), repeat);
+		__m256i source = scale_avx2(solid, c);
+
+		_mm256_storeu_si256(p, _mm256_adds_epu8(source, scale_avx2(_mm256_loadu_si256(p), _mm256_xor_si256(alpha_avx2(source), ones))));
+	}
+
+	_mm256_zeroupper();
+	mask_sse2(dst + i * 4, coverage + i, count - i, color);
+}
+
+SVG_TARGET_AVX512
+static inline __m512i div255_avx512(__m512i x) {
+	x = _mm512_add_epi16(x, _mm512_set1_epi16(128));
+
+	return _mm512_srli_epi16(_mm512_add_epi16(x, _mm512_srli_epi16(x, 8)), 8);
+}
+
+//Works within each 128 bit lane, like the AVX2 version
+SVG_TARGET_AVX512
+static inline __m512i scale_avx512(__m512i pixels, __m512i factors) {
+	const __m512i zero = _mm512_setzero_si512();
+	__m512i lo = div255_avx512(_mm512_mullo_epi16(_mm512_unpacklo_epi8(pixels, zero), _mm512_unpacklo_epi8(factors, zero)));
+	__m512i hi = div255_avx512(_mm512_mullo_epi16(_mm512_unpackhi_epi8(pixels, zero), _mm512_unpackhi_epi8(factors, zero)));
+
+	return _mm512_packus_epi16(lo, hi);
+}
+
+SVG_TARGET_AVX512
+static inline __m512i alpha_avx512(__m512i pixels) {
+	//Byte 3 of each pixel into all four, the same in every lane
+	const __m512i pick = _mm512_set4_epi32(0x0F0F0F0F, 0x0B0B0B0B, 0x07070707, 0x03030303);
+
+	return _mm512_shuffle_epi8(pixels, pick);
+}
+
+SVG_TARGET_AVX512
+static void over_avx512(uint8_t* dst, const uint8_t* src, int count) {
+	const __m512i ones = _mm512_set1_epi32(-1);
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m512i s = _mm512_loadu_si512(src + i * 4);
+		uint8_t* p = dst + i * 4;
+
+		if (_mm512_test_epi64_mask(s, s) == 0) {
+			continue;
+		}
+
+		__m512i alpha = alpha_avx512(s);
+
+		if (_mm512_cmpeq_epi8_mask(alpha, ones) == ~0ull) {
+			_mm512_storeu_si512(p, s);
+			continue;
+		}
+
+		_mm512_storeu_si512(p, _mm512_adds_epu8(s, scale_avx512(_mm512_loadu_si512(p), _mm512_xor_si512(alpha, ones))));
+	}
+
+	_mm256_zeroupper();
+	over_avx2(dst + i * 4, src + i * 4, count - i);
+}
+
+SVG_TARGET_AVX512
+static void solid_avx512(uint8_t* dst, int count, const uint8_t color[4]) {
+	uint32_t packed;
+
+	std::memcpy(&packed, color, 4);
+
+	const __m512i solid = _mm512_set1_epi32(static_cast<int>(packed));
+	const __m512i inverse = _mm512_set1_epi8(static_cast<char>(255 - color[3]));
+	bool opaque = color[3] == 255;
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		uint8_t* p = dst + i * 4;
+
+		if (opaque) {
+			_mm512_storeu_si512(p, solid);
+		}
+		else {
+			_mm512_storeu_si512(p, _mm512_adds_epu8(solid, scale_avx512(_mm512_loadu_si512(p), inverse)));
+		}
+	}
+
+	_mm256_zeroupper();
+	solid_avx2(dst + i * 4, count - i, color);
+}
+
+SVG_TARGET_AVX512
+static void mask_avx512(uint8_t* dst, const uint8_t* coverage, int count, const uint8_t color[4]) {
+	const __m512i ones = _mm512_set1_epi32(-1);
+	//Lane k picks the coverage of pixels 4k to 4k + 3, each repeated four times
+	const __m512i repeat = _mm512_setr_epi32(
+		0x00000000, 0x01010101, 0x02020202, 0x03030303, 0x04040404, 0x05050505, 0x06060606, 0x07070707,
+		0x08080808, 0x09090909, 0x0A0A0A0A, 0x0B0B0B0B, 0x0C0C0C0C, 0x0D0D0D0D, 0x0E0E0E0E, 0x0F0F0F0F);
+	uint32_t packed;
+
+	std::memcpy(&packed, color, 4);
+
+	const __m512i solid = _mm512_set1_epi32(static_cast<int>(packed));
+	int i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i c16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(coverage + i));
+		int zero_bytes = _mm_movemask_epi8(_mm_cmpeq_epi8(c16, _mm_setzero_si128()));
+
+		if (zero_bytes == 0xFFFF) {
+			continue;
+		}
+
+		if (zero_bytes == 0 && _mm_movemask_epi8(_mm_cmpeq_epi8(c16, _mm_set1_epi32(-1))) == 0xFFFF) {
+			solid_avx512(dst + i * 4, 16, color);
+			continue;
+		}
+
+		uint8_t* p = dst + i * 4;
+		//The zero masked broadcast with every lane kept is the plain one. GCC builds
+		//the plain one on an undefined register and warns under -Wall -Wextra.
+		__m512i c = _mm512_shuffle_epi8(_mm512_maskz_broadcast_i32x4(0xFFFF, c16), repeat);
+		__m512i source = scale_avx512(solid, c);
+
+		_mm512_storeu_si512(p, _mm512_adds_epu8(source, scale_avx512(_mm512_loadu_si512(p), _mm512_xor_si512(alpha_avx512(source), ones))));
+	}
+
+	_mm256_zeroupper();
+	mask_avx2(dst + i * 4, coverage + i, count - i, color);
+}
+
+#endif
+
+const SVGBlendKernels& svg_blend_kernels(SVGKernel kernel) {
+	static const SVGBlendKernels scalar{ over_scalar, solid_scalar, mask_scalar };
+#ifdef SVG_X86
+	static const SVGBlendKernels sse2{ over_sse2, solid_sse2, mask_sse2 };
+	static const SVGBlendKernels avx2{ over_avx2, solid_avx2, mask_avx2 };
+	static const SVGBlendKernels avx512{ over_avx512, solid_avx512, mask_avx512 };
+
+	switch (svg_supported_kernel(kernel)) {
+	case SVGKernel::AVX512:
+		return avx512;
+	case SVGKernel::AVX2:
+		return avx2;
+	case SVGKernel::SSE2:
+		return sse2;
+	default:
+		break;
+	}
+#else
+	(void)kernel;
+#endif
+
+	return scalar;
+}
+
+const SVGBlendKernels& svg_blend_kernels() {
+	static const SVGBlendKernels& best = svg_blend_kernels(svg_best_kernel());
+
+	return best;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include "SVGCpu.h"
+
+//Compositing of premultiplied RGBA8 pixels, R first in memory.
+//
+//Products are divided by 255 with exact rounding and sums saturate, in every
+//version. So the SIMD kernels give the same bytes as the scalar ones and a
+//bitmap doesn't change with the CPU it was drawn on.
+struct SVGBlendKernels {
+	//Source over: dst = src + dst * (1 - src alpha), pixel by pixel
+	void (*over)(uint8_t* dst, const uint8_t* src, int count);
+	//One color over count pixels
+	void (*solid)(uint8_t* dst, int count, const uint8_t color[4]);
+	//One color times the coverage byte of each pixel, over count pixels
+	void (*mask)(uint8_t* dst, const uint8_t* coverage, int count, const uint8_t color[4]);
+};
+
+//Kernels written for one instruction set. One the CPU lacks gives the best it has.
+const SVGBlendKernels& svg_blend_kernels(SVGKernel kernel);
+
+//The best kernels the CPU supports
+const SVGBlendKernels& svg_blend_kernels();
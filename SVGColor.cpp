@@ -0,0 +1,350 @@
+#include "SVGColor.h"
+#include "SVGPathLexer.h"
+#include "SVGPerfectHash.h"
+#include <cmath>
+
+//CSS Color 3 extended color keywords, as 0xRRGGBB
+static constexpr std::string_view named_color_names[] = {
+	"aliceblue", "antiquewhite", "aqua", "aquamarine", "azure", "beige",
+	"bisque", "black", "blanchedalmond", "blue", "blueviolet", "brown",
+	"burlywood", "cadetblue", "chartreuse", "chocolate", "coral", "cornflowerblue",
+	"cornsilk", "crimson", "cyan", "darkblue", "darkcyan", "darkgoldenrod",
+	"darkgray", "darkgreen", "darkgrey", "darkkhaki", "darkmagenta", "darkolivegreen",
+	"darkorange", "darkorchid", "darkred", "darksalmon", "darkseagreen", "darkslateblue",
+	"darkslategray", "darkslategrey", "darkturquoise", "darkviolet", "deeppink", "deepskyblue",
+	"dimgray", "dimgrey", "dodgerblue", "firebrick", "floralwhite", "forestgreen",
+	"fuchsia", "gainsboro", "ghostwhite", "gold", "goldenrod", "gray",
+	"grey", "green", "greenyellow", "honeydew", "hotpink", "indianred",
+	"indigo", "ivory", "khaki", "lavender", "lavenderblush", "lawngreen",
+	"lemonchiffon", "lightblue", "lightcoral", "lightcyan", "lightgoldenrodyellow", "lightgray",
+	"lightgreen", "lightgrey", "lightpink", "lightsalmon", "lightseagreen", "lightskyblue",
+	"lightslategray", "lightslategrey", "lightsteelblue", "lightyellow", "lime", "limegreen",
+	"linen", "magenta", "maroon", "mediumaquamarine", "mediumblue", "mediumorchid",
+	"mediumpurple", "mediumseagreen", "mediumslateblue", "mediumspringgreen", "mediumturquoise", "mediumvioletred",
+	"midnightblue", "mintcream", "mistyrose", "moccasin", "navajowhite", "navy",
+	"oldlace", "olive", "olivedrab", "orange", "orangered", "orchid",
+	"palegoldenrod", "palegreen", "paleturquoise", "palevioletred", "papayawhip", "peachpuff",
+	"peru", "pink", "plum", "powderblue", "purple", "red",
+	"rosybrown", "royalblue", "saddlebrown", "salmon", "sandybrown", "seagreen",
+	"seashell", "sienna", "silver", "skyblue", "slateblue", "slategray",
+	"slategrey", "snow", "springgreen", "steelblue", "tan", "teal",
+	"thistle", "tomato", "turquoise", "violet", "wheat", "white",
+	"whitesmoke", "yellow", "yellowgreen"
+};
+
+static constexpr uint32_t named_color_values[] = {
+	0xF0F8FF, 0xFAEBD7, 0x00FFFF, 0x7FFFD4, 0xF0FFFF, 0xF5F5DC, 0xFFE4C4, 0x000000,
+	0xFFEBCD, 0x0000FF, 0x8A2BE2, 0xA52A2A, 0xDEB887, 0x5F9EA0, 0x7FFF00, 0xD2691E,
+	0xFF7F50, 0x6495ED, 0xFFF8DC, 0xDC143C, 0x00FFFF, 0x00008B, 0x008B8B, 0xB8860B,
+	0xA9A9A9, 0x006400, 0xA9A9A9, 0xBDB76B, 0x8B008B, 0x556B2F, 0xFF8C00, 0x9932CC,
+	0x8B0000, 0xE9967A, 0x8FBC8F, 0x483D8B, 0x2F4F4F, 0x2F4F4F, 0x00CED1, 0x9400D3,
+	0xFF1493, 0x00BFFF, 0x696969, 0x696969, 0x1E90FF, 0xB22222, 0xFFFAF0, 0x228B22,
+	0xFF00FF, 0xDCDCDC, 0xF8F8FF, 0xFFD700, 0xDAA520, 0x808080, 0x808080, 0x008000,
+	0xADFF2F, 0xF0FFF0, 0xFF69B4, 0xCD5C5C, 0x4B0082, 0xFFFFF0, 0xF0E68C, 0xE6E6FA,
+	0xFFF0F5, 0x7CFC00, 0xFFFACD, 0xADD8E6, 0xF08080, 0xE0FFFF, 0xFAFAD2, 0xD3D3D3,
+	0x90EE90, 0xD3D3D3, 0xFFB6C1, 0xFFA07A, 0x20B2AA, 0x87CEFA, 0x778899, 0x778899,
+	0xB0C4DE, 0xFFFFE0, 0x00FF00, 0x32CD32, 0xFAF0E6, 0xFF00FF, 0x800000, 0x66CDAA,
+	0x0000CD, 0xBA55D3, 0x9370DB, 0x3CB371, 0x7B68EE, 0x00FA9A, 0x48D1CC, 0xC71585,
+	0x191970, 0xF5FFFA, 0xFFE4E1, 0xFFE4B5, 0xFFDEAD, 0x000080, 0xFDF5E6, 0x808000,
+	0x6B8E23, 0xFFA500, 0xFF4500, 0xDA70D6, 0xEEE8AA, 0x98FB98, 0xAFEEEE, 0xDB7093,
+	0xFFEFD5, 0xFFDAB9, 0xCD853F, 0xFFC0CB, 0xDDA0DD, 0xB0E0E6, 0x800080, 0xFF0000,
+	0xBC8F8F, 0x4169E1, 0x8B4513, 0xFA8072, 0xF4A460, 0x2E8B57, 0xFFF5EE, 0xA0522D,
+	0xC0C0C0, 0x87CEEB, 0x6A5ACD, 0x708090, 0x708090, 0xFFFAFA, 0x00FF7F, 0x4682B4,
+	0xD2B48C, 0x008080, 0xD8BFD8, 0xFF6347, 0x40E0D0, 0xEE82EE, 0xF5DEB3, 0xFFFFFF,
+	0xF5F5F5, 0xFFFF00, 0x9ACD32
+};
+
+static constexpr size_t named_color_count = sizeof(named_color_names) / sizeof(named_color_names[0]);
+
+static_assert(named_color_count == 147, "CSS defines 147 named colors");
+static_assert(sizeof(named_color_values) / sizeof(named_color_values[0]) == named_color_count, "Every name needs a value");
+
+static constexpr SVGPerfectHashTable<named_color_count, 10> named_color_table(named_color_names, 7329);
+
+static_assert(named_color_table.is_perfect(), "Named color seed no longer gives a perfect hash");
+
+//Longest name is "lightgoldenrodyellow"
+static const size_t max_named_color_length = 20;
+
+//Value of each hex digit, 0x10 for any other byte
+struct HexDigitTable {
+	uint8_t values[256] = {};
+
+	constexpr HexDigitTable() {
+		for (int i = 0; i < 256; ++i) {
+			values[i] = 0x10;
+		}
+
+		for (int i = 0; i < 10; ++i) {
+			values['0' + i] = static_cast<uint8_t>(i);
+		}
+
+		for (int i = 0; i < 6; ++i) {
+			values['a' + i] = static_cast<uint8_t>(10 + i);
+			values['A' + i] = static_cast<uint8_t>(10 + i);
+		}
+	}
+};
+
+static constexpr HexDigitTable hex_digits;
+
+static bool is_color_space(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+static std::string_view trim_color(std::string_view source) {
+	while (!source.empty() && is_color_space(source.front())) {
+		source.remove_prefix(1);
+	}
+
+	while (!source.empty() && is_color_space(source.back())) {
+		source.remove_suffix(1);
+	}
+
+	return source;
+}
+
+//Decodes the digits after '#'. All digits are decoded before a single validity check.
+static bool parse_hex_color(std::string_view digits, uint32_t& rgba) {
+	size_t count = digits.size();
+
+	if (count != 3 && count != 4 && count != 6 && count != 8) {
+		return false;
+	}
+
+	uint32_t value = 0, invalid = 0;
+
+	for (char ch : digits) {
+		uint32_t d = hex_digits.values[static_cast<uint8_t>(ch)];
+
+		invalid |= d;
+		value = (value << 4) | (d & 0xF);
+	}
+
+	if (invalid & 0x10) {
+		return false;
+	}
+
+	if (count <= 4) {
+		//Spread the nibbles to one per byte and repeat them: 0xRGBA -> 0xRRGGBBAA
+		value = (value | (value << 8)) & 0x00FF00FF;
+		value = (value | (value << 4)) & 0x0F0F0F0F;
+		value *= 0x11;
+	}
+
+	if (count == 3 || count == 6) {
+		value = (value << 8) | 0xFF;
+	}
+
+	rgba = value;
+
+	return true;
+}
+
+enum class ColorUnit : uint8_t {
+	Number,
+	Percent,
+	Degrees
+};
+
+//Reads the arguments of rgb(), hsl() etc. up to the closing parenthesis.
+//Arguments are separated by commas, spaces or a slash before the alpha.
+//Returns the number of arguments or -1 on a syntax error.
+static int read_color_arguments(std::string_view args, float* values, ColorUnit* units, int max_count) {
+	size_t pos = 0;
+	int count = 0;
+
+	while (true) {
+		while (pos < args.size() && (is_color_space(args[pos]) || args[pos] == ',' || args[pos] == '/')) {
+			++pos;
+		}
+
+		if (pos >= args.size()) {
+			return -1;
+		}
+
+		if (args[pos] == ')') {
+			++pos;
+
+			break;
+		}
+
+		if (count == max_count) {
+			return -1;
+		}
+
+		size_t consumed = svg_parse_number(args.substr(pos), values[count]);
+
+		if (consumed == 0) {
+			return -1;
+		}
+
+		pos += consumed;
+		units[count] = ColorUnit::Number;
+
+		if (pos < args.size() && args[pos] == '%') {
+			units[count] = ColorUnit::Percent;
+			++pos;
+		}
+		else if (svg_equals_ignore_case(args.substr(pos, 3), "deg")) {
+			units[count] = ColorUnit::Degrees;
+			pos += 3;
+		}
+
+		++count;
+	}
+
+	//Nothing but spaces may follow the closing parenthesis
+	if (!trim_color(args.substr(pos)).empty()) {
+		return -1;
+	}
+
+	return count;
+}
+
+static uint32_t unit_to_byte(float v) {
+	if (!(v > 0.0f)) {
+		return 0;
+	}
+
+	if (v >= 1.0f) {
+		return 255;
+	}
+
+	return static_cast<uint32_t>(v * 255.0f + 0.5f);
+}
+
+static float hue_to_rgb(float m1, float m2, float h) {
+	if (h < 0.0f) {
+		h += 1.0f;
+	}
+
+	if (h > 1.0f) {
+		h -= 1.0f;
+	}
+
+	if (h * 6.0f < 1.0f) {
+		return m1 + (m2 - m1) * h * 6.0f;
+	}
+
+	if (h * 2.0f < 1.0f) {
+		return m2;
+	}
+
+	if (h * 3.0f < 2.0f) {
+		return m1 + (m2 - m1) * (2.0f / 3.0f - h) * 6.0f;
+	}
+
+	return m1;
+}
+
+static bool parse_color_function(std::string_view name, std::string_view args, uint32_t& rgba) {
+	bool is_rgb = svg_equals_ignore_case(name, "rgb") || svg_equals_ignore_case(name, "rgba");
+	bool is_hsl = svg_equals_ignore_case(name, "hsl") || svg_equals_ignore_case(name, "hsla");
+
+	if (!is_rgb && !is_hsl) {
+		return false;
+	}
+
+	float v[4];
+	ColorUnit units[4];
+	int count = read_color_arguments(args, v, units, 4);
+
+	//Both the short and the "a" names take an optional alpha
+	if (count != 3 && count != 4) {
+		return false;
+	}
+
+	float alpha = 1.0f;
+
+	if (count == 4) {
+		if (units[3] == ColorUnit::Degrees) {
+			return false;
+		}
+
+		alpha = units[3] == ColorUnit::Percent ? v[3] / 100.0f : v[3];
+	}
+
+	float r, g, b;
+
+	if (is_rgb) {
+		for (int i = 0; i < 3; ++i) {
+			if (units[i] == ColorUnit::Degrees) {
+				return false;
+			}
+		}
+
+		r = units[0] == ColorUnit::Percent ? v[0] / 100.0f : v[0] / 255.0f;
+		g = units[1] == ColorUnit::Percent ? v[1] / 100.0f : v[1] / 255.0f;
+		b = units[2] == ColorUnit::Percent ? v[2] / 100.0f : v[2] / 255.0f;
+	}
+	else {
+		if (units[0] == ColorUnit::Percent || units[1] != ColorUnit::Percent || units[2] != ColorUnit::Percent) {
+			return false;
+		}
+
+		float h = std::fmod(v[0], 360.0f) / 360.0f;
+		float s = std::fmin(std::fmax(v[1] / 100.0f, 0.0f), 1.0f);
+		float l = std::fmin(std::fmax(v[2] / 100.0f, 0.0f), 1.0f);
+
+		if (h < 0.0f) {
+			h += 1.0f;
+		}
+
+		float m2 = l <= 0.5f ? l * (s + 1.0f) : l + s - l * s;
+		float m1 = l * 2.0f - m2;
+
+		r = hue_to_rgb(m1, m2, h + 1.0f / 3.0f);
+		g = hue_to_rgb(m1, m2, h);
+		b = hue_to_rgb(m1, m2, h - 1.0f / 3.0f);
+	}
+
+	rgba = (unit_to_byte(r) << 24) | (unit_to_byte(g) << 16) | (unit_to_byte(b) << 8) | unit_to_byte(alpha);
+
+	return true;
+}
+
+SVGColorType svg_parse_color(std::string_view source, uint32_t& rgba) {
+	source = trim_color(source);
+
+	if (source.empty()) {
+		return SVGColorType::Invalid;
+	}
+
+	if (source[0] == '#') {
+		return parse_hex_color(source.substr(1), rgba) ? SVGColorType::Color : SVGColorType::Invalid;
+	}
+
+	size_t paren = source.find('(');
+
+	if (paren != std::string_view::npos) {
+		return parse_color_function(trim_color(source.substr(0, paren)), source.substr(paren + 1), rgba) ?
+			SVGColorType::Color : SVGColorType::Invalid;
+	}
+
+	if (source.size() <= max_named_color_length) {
+		int index = named_color_table.candidate(source);
+
+		if (index >= 0 && svg_equals_ignore_case(source, named_color_names[index])) {
+			rgba = (named_color_values[index] << 8) | 0xFF;
+
+			return SVGColorType::Color;
+		}
+	}
+
+	if (svg_equals_ignore_case(source, "none")) {
+		return SVGColorType::None;
+	}
+
+	if (svg_equals_ignore_case(source, "currentColor")) {
+		return SVGColorType::CurrentColor;
+	}
+
+	if (svg_equals_ignore_case(source, "transparent")) {
+		rgba = 0;
+
+		return SVGColorType::Color;
+	}
+
+	return SVGColorType::Invalid;
+}
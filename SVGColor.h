@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+//Colors are packed as 0xRRGGBBAA
+enum class SVGColorType : uint8_t {
+	Invalid,
+	None,			//The "none" keyword
+	Color,
+	CurrentColor	//Use the value of the color property
+};
+
+//Parses a CSS Color 3 value: named colors, transparent, #rgb, #rgba, #rrggbb, #rrggbbaa,
+//rgb(), rgba(), hsl(), hsla(), currentColor and none. Keywords are case insensitive.
+//Does not allocate. rgba is only written when SVGColorType::Color is returned.
+SVGColorType svg_parse_color(std::string_view source, uint32_t& rgba);
+
+inline float svg_color_red(uint32_t rgba) {
+	return ((rgba >> 24) & 0xFF) / 255.0f;
+}
+
+inline float svg_color_green(uint32_t rgba) {
+	return ((rgba >> 16) & 0xFF) / 255.0f;
+}
+
+inline float svg_color_blue(uint32_t rgba) {
+	return ((rgba >> 8) & 0xFF) / 255.0f;
+}
+
+inline float svg_color_alpha(uint32_t rgba) {
+	return (rgba & 0xFF) / 255.0f;
+}
@@ -0,0 +1,66 @@
+#include "SVGCpu.h"
+#if defined(_MSC_VER) && defined(SVG_X86)
+#include <intrin.h>
+#endif
+
+static SVGCpuFeatures detect_cpu_features() {
+	SVGCpuFeatures features;
+
+#if defined(_MSC_VER) && defined(SVG_X86)
+	int info[4];
+
+	__cpuid(info, 0);
+
+	int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	features.sse2 = (info[3] & (1 << 26)) != 0;
+
+	//AVX2 also needs the OS to save the YMM registers, AVX-512 the ZMM and mask ones
+	bool os_saves_xsave = (info[2] & (1 << 27)) != 0;
+	unsigned long long saved = os_saves_xsave ? _xgetbv(0) : 0;
+	bool os_saves_ymm = (saved & 0x6) == 0x6;
+	bool os_saves_zmm = (saved & 0xE6) == 0xE6;
+
+	if (max_leaf >= 7 && os_saves_ymm) {
+		__cpuidex(info, 7, 0);
+		features.avx2 = (info[1] & (1 << 5)) != 0;
+		features.avx512 = os_saves_zmm && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0;
+	}
+#elif defined(__GNUC__) && defined(SVG_X86)
+	__builtin_cpu_init();
+	features.sse2 = __builtin_cpu_supports("sse2");
+	features.avx2 = __builtin_cpu_supports("avx2");
+	features.avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+
+	return features;
+}
+
+const SVGCpuFeatures& svg_cpu_features() {
+	static const SVGCpuFeatures features = detect_cpu_features();
+
+	return features;
+}
+
+SVGKernel svg_best_kernel() {
+	const SVGCpuFeatures& cpu = svg_cpu_features();
+
+	if (cpu.avx512) {
+		return SVGKernel::AVX512;
+	}
+	if (cpu.avx2) {
+		return SVGKernel::AVX2;
+	}
+	if (cpu.sse2) {
+		return SVGKernel::SSE2;
+	}
+
+	return SVGKernel::Scalar;
+}
+
+SVGKernel svg_supported_kernel(SVGKernel kernel) {
+	SVGKernel best = svg_best_kernel();
+
+	return kernel < best ? kernel : best;
+}
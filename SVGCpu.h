@@ -0,0 +1,44 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SVG_X86 1
+#endif
+
+//GCC and Clang only emit vector instructions inside functions that ask for them.
+//MSVC allows the intrinsics anywhere.
+#if defined(__GNUC__)
+#define SVG_TARGET_SSE2 __attribute__((target("sse2")))
+#define SVG_TARGET_AVX2 __attribute__((target("avx2")))
+#define SVG_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define SVG_TARGET_SSE2
+#define SVG_TARGET_AVX2
+#define SVG_TARGET_AVX512
+#endif
+
+#include <cstdint>
+
+//Instruction sets of the CPU we run on, checked once. The SIMD code paths pick
+//their kernel from this at runtime, so one build runs everywhere.
+struct SVGCpuFeatures {
+	bool sse2 = false;
+	bool avx2 = false;
+	//AVX-512 F and BW, the byte and word instructions included
+	bool avx512 = false;
+};
+
+const SVGCpuFeatures& svg_cpu_features();
+
+//Versions of the SIMD code paths. Each needs the instruction sets of the ones before it.
+enum class SVGKernel : uint8_t {
+	Scalar,
+	SSE2,
+	AVX2,
+	AVX512
+};
+
+//Best kernel the CPU supports
+SVGKernel svg_best_kernel();
+
+//kernel, or the best one the CPU supports when it is newer than that
+SVGKernel svg_supported_kernel(SVGKernel kernel);
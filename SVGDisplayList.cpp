@@ -0,0 +1,602 @@
+#include "SVGDisplayList.h"
+#include <algorithm>
+#include <cmath>
+
+//How far a stroke reaches outside the geometry. Miter joins can reach out
+//miterlimit half widths, square caps sqrt(2).
+static float stroke_padding(const SVGNode& node) {
+	float reach = 1.4143f;
+
+	if (node.style->stroke_linejoin == SVGLineJoin::Miter && node.style->stroke_miterlimit > reach) {
+		reach = node.style->stroke_miterlimit;
+	}
+
+	return node.stroke_width * 0.5f * reach;
+}
+
+static SVGRect inflate_rect(const SVGRect& r, float amount) {
+	return SVGRect{ r.left - amount, r.top - amount, r.right + amount, r.bottom + amount };
+}
+
+static bool rects_intersect(const SVGRect& a, const SVGRect& b) {
+	return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+static SVGRect union_rect(const SVGRect& a, const SVGRect& b) {
+	return SVGRect{ std::fmin(a.left, b.left), std::fmin(a.top, b.top), std::fmax(a.right, b.right), std::fmax(a.bottom, b.bottom) };
+}
+
+//Ops that batch_outline can turn into figures, grouped by what they may merge with.
+//Paths keep their own fill rule and text has no outline, so they are never merged.
+static int batch_group(SVGDrawOp op) {
+	switch (op) {
+	case SVGDrawOp::FillRect:
+	case SVGDrawOp::FillEllipse:
+		return 1;
+	case SVGDrawOp::StrokeRect:
+	case SVGDrawOp::StrokeLine:
+		return 2;
+	case SVGDrawOp::StrokeEllipse:
+		//Ellipses are stroked without a stroke style
+		return 3;
+	default:
+		return 0;
+	}
+}
+
+static uint32_t paint_rgba(const SVGStyle* style, const SVGPaint& paint) {
+	return paint.type == SVGPaintType::CurrentColor ? style->color : paint.rgba;
+}
+
+//True when both entries would create the same brush and stroke
+static bool same_paint(int group, const SVGStyle* a, const SVGStyle* b) {
+	if (a == b) {
+		return true;
+	}
+
+	if (group == 1) {
+		return paint_rgba(a, a->fill) == paint_rgba(b, b->fill) && a->fill_opacity == b->fill_opacity;
+	}
+
+	if (paint_rgba(a, a->stroke) != paint_rgba(b, b->stroke) || a->stroke_opacity != b->stroke_opacity) {
+		return false;
+	}
+
+	return group == 3 || (a->stroke_linecap == b->stroke_linecap &&
+		a->stroke_linejoin == b->stroke_linejoin &&
+		a->stroke_miterlimit == b->stroke_miterlimit);
+}
+
+static bool is_opaque(int group, const SVGStyle* style) {
+	if (group == 1) {
+		return (paint_rgba(style, style->fill) & 0xFF) == 0xFF && style->fill_opacity >= 1.0f;
+	}
+
+	return (paint_rgba(style, style->stroke) & 0xFF) == 0xFF && style->stroke_opacity >= 1.0f;
+}
+
+//Entries share a coordinate space when the matrices are equal, or when both only
+//translate and the difference can be added to the coordinates
+static bool same_space(const SVGDisplayItem& a, const SVGDisplayItem& b) {
+	if (a.transform_class <= SVGTransformClass::Translate && b.transform_class <= SVGTransformClass::Translate) {
+		return true;
+	}
+
+	return svg_matrix_equals(a.transform, b.transform);
+}
+
+void SVGDisplayList::clear() {
+	items.clear();
+	batches.clear();
+	subtrees.clear();
+	node_offsets.clear();
+	node_items.clear();
+	stale_items.clear();
+	stale_batches.clear();
+}
+
+void SVGDisplayList::compile(const SVGDocument& document) {
+	clear();
+
+	if (document.empty()) {
+		return;
+	}
+
+	compile_node(document, document.root, SVGMatrix::identity(), 0);
+	build_batches(document);
+	build_node_index(document);
+}
+
+void SVGDisplayList::build_node_index(const SVGDocument& document) {
+	node_offsets.assign(document.nodes.size() + 1, 0);
+	node_items.resize(items.size());
+
+	for (const SVGDisplayItem& item : items) {
+		++node_offsets[item.resource + 1];
+	}
+
+	for (size_t n = 1; n < node_offsets.size(); ++n) {
+		node_offsets[n] += node_offsets[n - 1];
+	}
+
+	//Placing advances each start to the end, which is the start of the next node
+	for (size_t i = 0; i < items.size(); ++i) {
+		node_items[node_offsets[items[i].resource]++] = static_cast<uint32_t>(i);
+	}
+
+	for (size_t n = node_offsets.size() - 1; n > 0; --n) {
+		node_offsets[n] = node_offsets[n - 1];
+	}
+
+	node_offsets[0] = 0;
+}
+
+void SVGDisplayList::build_batches(const SVGDocument& document) {
+	batches.clear();
+
+	size_t i = 0;
+
+	while (i < items.size()) {
+		const SVGDisplayItem& first = items[i];
+		const SVGStyle* first_style = document.nodes[first.resource].style;
+		int group = batching ? batch_group(first.op) : 0;
+		//Overlapping shapes would be painted once instead of twice,
+		//which only looks the same when nothing shows through
+		bool opaque = group != 0 && is_opaque(group, first_style);
+		SVGRect covered = first.bounds;
+		size_t end = i + 1;
+
+		while (group != 0 && end < items.size()) {
+			const SVGDisplayItem& next = items[end];
+			const SVGStyle* next_style = document.nodes[next.resource].style;
+
+			if (batch_group(next.op) != group ||
+				next.stroke_width != first.stroke_width ||
+				!same_space(first, next) ||
+				!same_paint(group, first_style, next_style)) {
+				break;
+			}
+
+			if (!opaque) {
+				if (rects_intersect(covered, next.bounds)) {
+					break;
+				}
+
+				covered = union_rect(covered, next.bounds);
+			}
+
+			++end;
+		}
+
+		for (size_t k = i; k < end; ++k) {
+			items[k].batch = static_cast<uint32_t>(batches.size());
+		}
+
+		batches.push_back({ static_cast<uint32_t>(i), static_cast<uint32_t>(end - i) });
+		i = end;
+	}
+}
+
+void SVGDisplayList::cull(const SVGRect& view, std::vector<uint32_t>& visible) const {
+	size_t subtree = 0;
+
+	visible.clear();
+
+	for (size_t i = 0; i < items.size();) {
+		//Enter the subtrees that start here, or jump past one out of view
+		if (subtree < subtrees.size() && subtrees[subtree].first_item <= i) {
+			const SVGDisplaySubtree& s = subtrees[subtree];
+
+			if (rects_intersect(s.bounds, view)) {
+				++subtree;
+			}
+			else {
+				i = s.end_item;
+				subtree = s.end_subtree;
+			}
+
+			continue;
+		}
+
+		if (rects_intersect(items[i].bounds, view) && (visible.empty() || visible.back() != items[i].batch)) {
+			visible.push_back(items[i].batch);
+		}
+
+		++i;
+	}
+}
+
+void SVGDisplayList::batch_outline(const SVGDisplayBatch& batch, SVGPathData& path) const {
+	const SVGDisplayItem& first = items[batch.first];
+
+	path.clear();
+
+	for (uint32_t k = batch.first; k < batch.first + batch.count; ++k) {
+		const SVGDisplayItem& item = items[k];
+		//Zero unless both entries only translate
+		float dx = item.transform.dx - first.transform.dx;
+		float dy = item.transform.dy - first.transform.dy;
+		const float* g = item.geometry;
+
+		switch (item.op) {
+		case SVGDrawOp::FillRect:
+		case SVGDrawOp::StrokeRect: {
+			//Clockwise whatever the sign of width and height
+			float x0 = std::fmin(g[0], g[0] + g[2]) + dx, x1 = std::fmax(g[0], g[0] + g[2]) + dx;
+			float y0 = std::fmin(g[1], g[1] + g[3]) + dy, y1 = std::fmax(g[1], g[1] + g[3]) + dy;
+
+			path.move_to(x0, y0);
+			path.line_to(x1, y0);
+			path.line_to(x1, y1);
+			path.line_to(x0, y1);
+			path.close();
+
+			break;
+		}
+		case SVGDrawOp::FillEllipse:
+		case SVGDrawOp::StrokeEllipse: {
+			float cx = g[0] + dx, cy = g[1] + dy;
+			float rx = std::fabs(g[2]), ry = std::fabs(g[3]);
+
+			if (rx == 0.0f || ry == 0.0f) {
+				break;
+			}
+
+			//Two clockwise half arcs
+			path.move_to(cx + rx, cy);
+			path.arc_to(rx, ry, 0.0f, false, true, cx - rx, cy);
+			path.arc_to(rx, ry, 0.0f, false, true, cx + rx, cy);
+			path.close();
+
+			break;
+		}
+		case SVGDrawOp::StrokeLine:
+			path.move_to(g[0] + dx, g[1] + dy);
+			path.line_to(g[2] + dx, g[3] + dy);
+
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void SVGDisplayList::add_item(SVGDrawOp op, SVGNodeId id, const SVGNode& node, const SVGMatrix& transform, SVGTransformClass transform_class, const SVGRect& local_bounds) {
+	items.emplace_back();
+
+	SVGDisplayItem& item = items.back();
+
+	item.op = op;
+	item.transform_class = transform_class;
+	item.resource = id;
+	item.payload = node.payload;
+	item.transform = transform;
+	item.stroke_width = node.stroke_width;
+
+	for (int i = 0; i < 4; ++i) {
+		item.geometry[i] = node.geometry[i];
+	}
+
+	item.bounds = svg_transform_rect(transform, transform_class, local_bounds);
+}
+
+void SVGDisplayList::compile_node(const SVGDocument& document, SVGNodeId id, const SVGMatrix& parent_transform, int use_depth) {
+	const SVGNode& node = document.nodes[id];
+
+	//Defs tree doesn't render
+	if (node.tag == SVGTag::Defs) {
+		return;
+	}
+
+	SVGMatrix transform = parent_transform;
+
+	if (node.transform_class != SVGTransformClass::Identity) {
+		//Same multiply as a tree walk does against the device transform,
+		//so replay produces bit identical matrices
+		transform = svg_multiply(node.transform, node.transform_class, parent_transform);
+	}
+
+	SVGTransformClass transform_class = svg_classify_transform(transform);
+	bool is_subtree = node.first_child != svg_no_node || node.tag == SVGTag::Use;
+	size_t subtree = subtrees.size();
+	size_t first_item = items.size();
+
+	if (is_subtree) {
+		subtrees.emplace_back();
+	}
+
+	if (node.tag == SVGTag::Use) {
+		//The referenced element is drawn in place, even if it lives in <defs>
+		if (node.payload != svg_no_node && use_depth < svg_max_use_depth) {
+			compile_node(document, node.payload, transform, use_depth + 1);
+		}
+	}
+	else {
+		add_node_items(document, id, transform, transform_class);
+	}
+
+	//Render all child elements
+	for (SVGNodeId child = node.first_child; child != svg_no_node; child = document.nodes[child].next_sibling) {
+		compile_node(document, child, transform, use_depth);
+	}
+
+	if (!is_subtree) {
+		return;
+	}
+
+	if (items.size() == first_item) {
+		//Nothing below it draws, so neither did any subtree inside it
+		subtrees.resize(subtree);
+		return;
+	}
+
+	SVGDisplaySubtree& s = subtrees[subtree];
+
+	s.first_item = static_cast<uint32_t>(first_item);
+	s.end_item = static_cast<uint32_t>(items.size());
+	s.end_subtree = static_cast<uint32_t>(subtrees.size());
+	fit_subtree(subtree);
+}
+
+//The bounds of the entries of a subtree and of the subtrees directly inside it,
+//which must be up to date
+void SVGDisplayList::fit_subtree(size_t subtree) {
+	SVGDisplaySubtree& s = subtrees[subtree];
+	size_t inner = subtree + 1;
+	size_t i = s.first_item;
+
+	s.bounds = items[i].bounds;
+
+	while (i < s.end_item) {
+		if (inner < subtrees.size() && subtrees[inner].first_item == i) {
+			s.bounds = union_rect(s.bounds, subtrees[inner].bounds);
+			i = subtrees[inner].end_item;
+			inner = subtrees[inner].end_subtree;
+		}
+		else {
+			s.bounds = union_rect(s.bounds, items[i].bounds);
+			++i;
+		}
+	}
+}
+
+//Appends the entries an element draws itself
+void SVGDisplayList::add_node_items(const SVGDocument& document, SVGNodeId id, const SVGMatrix& transform, SVGTransformClass transform_class) {
+	const SVGNode& node = document.nodes[id];
+	const float* g = node.geometry;
+	bool has_fill = node.style && node.style->fill.type != SVGPaintType::None;
+	bool has_stroke = node.style && node.style->stroke.type != SVGPaintType::None;
+
+	switch (node.tag) {
+	case SVGTag::Rect: {
+		SVGRect r{ g[0], g[1], g[0] + g[2], g[1] + g[3] };
+
+		if (has_fill) {
+			add_item(SVGDrawOp::FillRect, id, node, transform, transform_class, r);
+		}
+		if (has_stroke) {
+			add_item(SVGDrawOp::StrokeRect, id, node, transform, transform_class, inflate_rect(r, stroke_padding(node)));
+		}
+
+		break;
+	}
+	case SVGTag::Circle:
+	case SVGTag::Ellipse: {
+		//A circle keeps its radius in g[2] only
+		float ry = node.tag == SVGTag::Circle ? g[2] : g[3];
+		SVGRect r{ g[0] - g[2], g[1] - ry, g[0] + g[2], g[1] + ry };
+
+		if (has_fill) {
+			add_item(SVGDrawOp::FillEllipse, id, node, transform, transform_class, r);
+			items.back().geometry[3] = ry;
+		}
+		if (has_stroke) {
+			add_item(SVGDrawOp::StrokeEllipse, id, node, transform, transform_class, inflate_rect(r, node.stroke_width * 0.5f));
+			items.back().geometry[3] = ry;
+		}
+
+		break;
+	}
+	case SVGTag::Line:
+		if (has_stroke) {
+			SVGRect r{ std::fmin(g[0], g[2]), std::fmin(g[1], g[3]), std::fmax(g[0], g[2]), std::fmax(g[1], g[3]) };
+
+			add_item(SVGDrawOp::StrokeLine, id, node, transform, transform_class, inflate_rect(r, stroke_padding(node)));
+		}
+
+		break;
+	case SVGTag::Path: {
+		SVGRect r;
+
+		if (!svg_path_bounds(document.path(node.payload), r)) {
+			break;
+		}
+
+		if (has_fill) {
+			add_item(SVGDrawOp::FillPath, id, node, transform, transform_class, r);
+		}
+		if (has_stroke) {
+			add_item(SVGDrawOp::StrokePath, id, node, transform, transform_class, inflate_rect(r, stroke_padding(node)));
+		}
+
+		break;
+	}
+	case SVGTag::Text:
+		if (has_fill) {
+			//Layout metrics belong to the renderer. Assume no glyph is wider than
+			//1em per UTF-8 byte and allow for ascent above and descent below the baseline.
+			float size = node.style->font_size.value;
+			float width = size * static_cast<float>(document.text(node.payload).size());
+			SVGRect r{ g[0], g[1] - size * 1.5f, g[0] + width, g[1] + size * 0.5f };
+
+			add_item(SVGDrawOp::FillText, id, node, transform, transform_class, r);
+		}
+
+		break;
+	default:
+		break;
+	}
+}
+
+void SVGDisplayList::add_node_bounds(const SVGDocument& document, SVGNodeId id, int use_depth, SVGRect& bounds, bool& found) const {
+	const SVGNode& node = document.nodes[id];
+
+	//Nodes inserted since compile() draw nothing yet
+	if (id + 1 < node_offsets.size()) {
+		for (uint32_t k = node_offsets[id]; k < node_offsets[id + 1]; ++k) {
+			bounds = found ? union_rect(bounds, items[node_items[k]].bounds) : items[node_items[k]].bounds;
+			found = true;
+		}
+	}
+
+	if (node.tag == SVGTag::Use && node.payload != svg_no_node && use_depth < svg_max_use_depth) {
+		add_node_bounds(document, node.payload, use_depth + 1, bounds, found);
+	}
+
+	for (SVGNodeId child = node.first_child; child != svg_no_node; child = document.nodes[child].next_sibling) {
+		add_node_bounds(document, child, use_depth, bounds, found);
+	}
+}
+
+bool SVGDisplayList::node_bounds(const SVGDocument& document, SVGNodeId id, SVGRect& bounds) const {
+	bool found = false;
+
+	add_node_bounds(document, id, 0, bounds, found);
+
+	return found;
+}
+
+bool SVGDisplayList::update_node(const SVGDocument& document, SVGNodeId id) {
+	const SVGNode& node = document.nodes[id];
+
+	if (node.first_child != svg_no_node || node.tag == SVGTag::Use || id + 1 >= node_offsets.size()) {
+		return false;
+	}
+
+	//Ancestors up to the root, which must be reached without passing <defs>
+	std::vector<SVGNodeId> path;
+
+	for (SVGNodeId n = id; n != svg_no_node; n = document.nodes[n].parent) {
+		if (document.nodes[n].tag == SVGTag::Defs) {
+			return false;
+		}
+
+		path.push_back(n);
+	}
+
+	if (path.back() != document.root) {
+		return false;
+	}
+
+	//Same multiplies in the same order as compile_node()
+	SVGMatrix transform = SVGMatrix::identity();
+
+	for (size_t k = path.size(); k-- > 0;) {
+		const SVGNode& n = document.nodes[path[k]];
+
+		if (n.transform_class != SVGTransformClass::Identity) {
+			transform = svg_multiply(n.transform, n.transform_class, transform);
+		}
+	}
+
+	//Built at the end of the list and copied over the old entries when they match
+	size_t end = items.size();
+	uint32_t first = node_offsets[id];
+	uint32_t count = node_offsets[id + 1] - first;
+
+	add_node_items(document, id, transform, svg_classify_transform(transform));
+
+	bool same = items.size() - end == count;
+
+	for (uint32_t k = 0; same && k < count; ++k) {
+		same = items[end + k].op == items[node_items[first + k]].op;
+	}
+
+	for (uint32_t k = 0; same && k < count; ++k) {
+		SVGDisplayItem& item = items[node_items[first + k]];
+		const SVGDisplayItem& updated = items[end + k];
+		uint32_t batch = item.batch;
+		const SVGRect& a = item.bounds;
+		const SVGRect& b = updated.bounds;
+
+		if (a.left != b.left || a.top != b.top || a.right != b.right || a.bottom != b.bottom) {
+			stale_items.push_back(node_items[first + k]);
+		}
+
+		//A merged batch may no longer paint the same way or may now overlap, and an
+		//entry drawn alone may now merge with its neighbours
+		if (batches[batch].count > 1 || (batching && batch_group(updated.op) != 0)) {
+			stale_batches.push_back(batch);
+		}
+
+		item = updated;
+		item.batch = batch;
+	}
+
+	items.resize(end);
+
+	return same;
+}
+
+bool SVGDisplayList::refresh(const SVGDocument& document, std::vector<uint32_t>& kept) {
+	kept.clear();
+
+	//The subtrees around the entries that moved
+	std::vector<uint32_t> around;
+
+	for (uint32_t item : stale_items) {
+		size_t s = 0;
+
+		while (s < subtrees.size() && subtrees[s].first_item <= item) {
+			if (item < subtrees[s].end_item) {
+				around.push_back(static_cast<uint32_t>(s));
+				++s;
+			}
+			else {
+				s = subtrees[s].end_subtree;
+			}
+		}
+	}
+
+	//Inner subtrees come after their parent, and are fitted first
+	std::sort(around.begin(), around.end());
+	around.erase(std::unique(around.begin(), around.end()), around.end());
+
+	for (size_t k = around.size(); k-- > 0;) {
+		fit_subtree(around[k]);
+	}
+
+	stale_items.clear();
+
+	if (stale_batches.empty()) {
+		return false;
+	}
+
+	std::vector<SVGDisplayBatch> old_batches;
+
+	std::sort(stale_batches.begin(), stale_batches.end());
+	old_batches.swap(batches);
+	build_batches(document);
+
+	//Both lists are in item order
+	size_t j = 0, stale = 0;
+
+	for (const SVGDisplayBatch& batch : batches) {
+		while (j < old_batches.size() && old_batches[j].first < batch.first) {
+			++j;
+		}
+
+		while (stale < stale_batches.size() && stale_batches[stale] < j) {
+			++stale;
+		}
+
+		bool same = j < old_batches.size() && old_batches[j].first == batch.first && old_batches[j].count == batch.count &&
+			(stale == stale_batches.size() || stale_batches[stale] != j);
+
+		kept.push_back(same ? static_cast<uint32_t>(j) : 0xFFFFFFFFu);
+	}
+
+	stale_batches.clear();
+
+	return true;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SVGDocument.h"
+#include "SVGPathData.h"
+#include "SVGTransform.h"
+
+//What one display list entry draws
+enum class SVGDrawOp : uint8_t {
+	FillRect,		//geometry: x y width height
+	StrokeRect,
+	FillEllipse,	//geometry: cx cy rx ry
+	StrokeEllipse,
+	StrokeLine,		//geometry: x1 y1 x2 y2
+	FillPath,		//payload: path index
+	StrokePath,
+	FillText		//geometry: x y, payload: text index
+};
+
+//One draw call with everything needed to issue it. The fill and the stroke of an
+//element are separate entries, fill first, in document order.
+struct SVGDisplayItem {
+	SVGDrawOp op = SVGDrawOp::FillRect;
+	SVGTransformClass transform_class = SVGTransformClass::Identity;
+	//The node whose brushes and stroke style the renderer uses
+	SVGNodeId resource = svg_no_node;
+	uint32_t payload = 0;
+	//Local to world, including every ancestor and <use>
+	SVGMatrix transform;
+	float geometry[4] = {};
+	float stroke_width = 1.0f;
+	//Conservative bounds in world space, including the stroke
+	SVGRect bounds;
+	//Index of the batch that draws it
+	uint32_t batch = 0;
+};
+
+//Adjacent entries that are drawn with one call. A batch of one is drawn as is,
+//a longer one as a single geometry built by SVGDisplayList::batch_outline.
+struct SVGDisplayBatch {
+	uint32_t first = 0;
+	uint32_t count = 0;
+};
+
+//A node with children or a <use>. Its entries and those of everything below it
+//are one run of the list, so the run can be skipped whole when its bounds are
+//out of view. Subtrees are stored in document order, parents first.
+struct SVGDisplaySubtree {
+	uint32_t first_item = 0;
+	uint32_t end_item = 0;
+	//The next subtree that is not inside this one
+	uint32_t end_subtree = 0;
+	//Union of the bounds of the entries, in world space
+	SVGRect bounds;
+};
+
+//The document flattened into the order it paints in. Compiled once after parsing so
+//that a repaint is a loop over an array, with no tree walk and no matrix math.
+class SVGDisplayList {
+public:
+	std::vector<SVGDisplayItem> items;
+	std::vector<SVGDisplayBatch> batches;
+	//Only the ones with entries
+	std::vector<SVGDisplaySubtree> subtrees;
+	//Entries drawn for each node, <use> copies included, in paint order. Node n has
+	//node_items[node_offsets[n]] up to node_offsets[n + 1].
+	std::vector<uint32_t> node_offsets;
+	std::vector<uint32_t> node_items;
+	//Merge runs of rects, ellipses and lines that paint the same way
+	bool batching = true;
+
+	void clear();
+
+	//Flattens the tree under document.root. <defs> are skipped and <use> is expanded in place.
+	void compile(const SVGDocument& document);
+
+	size_t size() const {
+		return items.size();
+	}
+
+	//Draw calls needed to replay the list
+	size_t draw_calls() const {
+		return batches.size();
+	}
+
+	//Writes the batches with an entry whose bounds meet view, in paint order. view is
+	//in world space. Subtrees out of view are skipped without looking at their entries.
+	void cull(const SVGRect& view, std::vector<uint32_t>& visible) const;
+
+	//Union of the bounds of the entries drawn for a node and everything below it,
+	//and of what its <use> elements draw. Returns false when there are none.
+	bool node_bounds(const SVGDocument& document, SVGNodeId id, SVGRect& bounds) const;
+
+	//Builds the entries of a node again from the document, in place, after its style,
+	//geometry or own transform changed. Only elements that draw and have no children
+	//can be updated, and only when they are drawn once, not by a <use>. Returns false
+	//when the node can't be updated or it would now draw a different set of entries,
+	//then the list has to be compiled again.
+	bool update_node(const SVGDocument& document, SVGNodeId id);
+
+	//Brings subtree bounds and batches up to date after update_node() calls.
+	//Returns true when the batches were built again. Then kept has, for each batch,
+	//the batch before the call with the same unchanged entries, or 0xFFFFFFFF.
+	bool refresh(const SVGDocument& document, std::vector<uint32_t>& kept);
+
+	//Outlines of every entry of a batch as one path, in the coordinate space of the first entry.
+	//Every figure winds the same way, so the non-zero rule fills their union.
+	void batch_outline(const SVGDisplayBatch& batch, SVGPathData& path) const;
+
+private:
+	//Left by update_node() for refresh(): entries whose bounds changed and batches whose entries did
+	std::vector<uint32_t> stale_items;
+	std::vector<uint32_t> stale_batches;
+
+	void compile_node(const SVGDocument& document, SVGNodeId id, const SVGMatrix& parent_transform, int use_depth);
+	void add_node_items(const SVGDocument& document, SVGNodeId id, const SVGMatrix& transform, SVGTransformClass transform_class);
+	void build_batches(const SVGDocument& document);
+	void build_node_index(const SVGDocument& document);
+	void fit_subtree(size_t subtree);
+	void add_node_bounds(const SVGDocument& document, SVGNodeId id, int use_depth, SVGRect& bounds, bool& found) const;
+	void add_item(SVGDrawOp op, SVGNodeId id, const SVGNode& node, const SVGMatrix& transform, SVGTransformClass transform_class, const SVGRect& local_bounds);
+};
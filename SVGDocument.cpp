@@ -0,0 +1,978 @@
+#include "SVGDocument.h"
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include "SVGTokenizer.h"
+
+static void ltrim_str(std::string_view& source) {
+	size_t pos = source.find_first_not_of(" \t\r\n");
+
+	if (pos == std::string_view::npos) {
+		source.remove_prefix(source.length());
+	}
+	else {
+		source.remove_prefix(pos);
+	}
+}
+
+static void rtrim_str(std::string_view& source) {
+	size_t pos = source.find_last_not_of(" \t\r\n");
+
+	if (pos == std::string_view::npos) {
+		//Empty out the string
+		source.remove_suffix(source.length());
+	}
+	else {
+		source.remove_suffix(source.length() - pos - 1);
+	}
+}
+
+//Collapse white spaces as per CSS and HTML spec
+static void collapse_whitespace(std::string_view& source, std::string& result) {
+	result.clear();
+
+	ltrim_str(source);
+
+	char last_ch = 0;
+	std::string_view white_spaces(" \t\r\n");
+
+	for (char ch : source) {
+		if (white_spaces.find(ch) != std::string_view::npos) {
+			//Normalize all white spaces
+			ch = ' ';
+		}
+
+		if (ch == last_ch) {
+			//Skip consecutive what spaces
+			continue;
+		}
+
+		result.push_back(ch);
+		last_ch = ch;
+	}
+}
+
+//Gets the id reference from the value of an href or xlink:href attribute.
+//Only reference by ID values like href="#someId" or href="url(#someId)"
+//are supported
+static bool parse_href_id(std::string_view source, std::string_view& ref_id) {
+	if (source.find("url") != std::string_view::npos) {
+		size_t start = source.find("(");
+		size_t end = source.rfind(")");
+
+		if (start == std::string_view::npos || end == std::string_view::npos) {
+			return false;
+		}
+
+		source = source.substr(start + 1, end - start - 1);
+	}
+
+	ltrim_str(source);
+	rtrim_str(source);
+
+	if (source.empty()) {
+		return false;
+	}
+
+	if (source[0] == '#') {
+		source = source.substr(1);
+
+		if (source.empty()) {
+			return false;
+		}
+
+		ref_id = source;
+
+		return true;
+	}
+
+
+	return false;
+}
+
+//Gets the id reference from the href or xlink:href attribute
+static bool get_href_id(const SVGAttributeSet& attrs, std::string_view& ref_id) {
+	std::string_view source;
+
+	if (!attrs.get(SVGAttr::Href, source) && !attrs.get(SVGAttr::XlinkHref, source)) {
+		return false;
+	}
+
+	return parse_href_id(source, ref_id);
+}
+
+static bool get_size_attribute(const SVGAttributeSet& attrs, const SVGLengthContext& context, SVGAttr attr, SVGLengthAxis axis, float& size) {
+	std::string_view attr_value;
+
+	if (!attrs.get(attr, attr_value)) {
+		return false;
+	}
+
+	return context.resolve(attr_value, axis, size);
+}
+
+//Inherits the parent's length context and takes the font size from the computed style
+static void compute_length_context(const SVGLengthContext& parent, const SVGStyle* style, SVGLengthContext& context) {
+	context = parent;
+	context.font_size = style->font_size.value;
+}
+
+//Parses the presentation attributes and the "style" attribute into typed values and
+//resolves them against the parent's computed style. Returns the computed style.
+static const SVGStyle* collect_styles(const SVGAttributeSet& attrs, SVGStyleCache& cache, const SVGStyle* parent_style, const SVGStyle*& declared_style) {
+	SVGStyle declared;
+	std::string_view style_str;
+
+	//Only visits the presentation attributes that are actually on the element
+	attrs.for_each_presentation([&cache, &declared](SVGAttr attr, std::string_view attr_value) {
+		cache.parse_property(attr, attr_value, declared);
+	});
+
+	//The style attribute takes precedence over presentation attributes
+	if (attrs.get(SVGAttr::Style, style_str)) {
+		cache.parse_style_attribute(style_str, declared);
+	}
+
+	declared_style = declared.specified != 0 ? cache.intern(declared) : nullptr;
+
+	return cache.resolve(parent_style, declared_style);
+}
+
+//Sets up the viewport of an <svg> element. On entry context holds the parent viewport,
+//on return it holds the viewport that the children resolve percentages against.
+static bool apply_viewbox(SVGNode& e, const SVGAttributeSet& attrs, SVGLengthContext& context) {
+	//Default viewport width and height
+	float width = 300.0f, height = 150.0f;
+	float vb_x = 0.0f, vb_y = 0.0f, vb_width = width, vb_height = height;
+
+	//Read width and height attributes
+	get_size_attribute(attrs, context, SVGAttr::Width, SVGLengthAxis::Horizontal, width);
+	get_size_attribute(attrs, context, SVGAttr::Height, SVGLengthAxis::Vertical, height);
+
+	context.viewport_width = width;
+	context.viewport_height = height;
+
+	std::string_view viewBoxStr;
+	std::stringstream ws;
+
+	if (attrs.get(SVGAttr::ViewBox, viewBoxStr)) {
+		//Replace comma with spaces
+		for (char ch : viewBoxStr) {
+			if (ch == ',') {
+				ch = ' ';
+			}
+
+			ws << ch;
+		}
+
+		//Parse viewBox attribute.
+		//For now expect all four values to be present.
+		if (!(ws >> vb_x >> vb_y >> vb_width >> vb_height)) {
+			return false;
+		}
+
+		if (vb_width <= 0.0f || vb_height <= 0.0f) {
+			return false;
+		}
+
+		context.viewport_width = vb_width;
+		context.viewport_height = vb_height;
+
+		//Calculate scale factors
+		float scale_x = width / vb_width;
+		float scale_y = height / vb_height;
+		float scale = scale_x < scale_y ? scale_x : scale_y;
+
+		//Create transform matrix
+		SVGMatrix viewboxTransform = svg_multiply(SVGMatrix::translation(-vb_x, -vb_y), SVGMatrix::scale(scale, scale));
+
+		e.set_transform(viewboxTransform);
+
+		return true;
+	}
+	else {
+		return false;
+	}
+}
+
+//Where a geometry attribute of an element is kept in SVGNode::geometry, or -1
+//Number of coordinates the verbs take
+static size_t path_coord_count(const SVGPathVerb* verbs, size_t verb_count) {
+	size_t count = 0;
+
+	for (size_t i = 0; i < verb_count; ++i) {
+		count += svg_path_coord_count(verbs[i]);
+	}
+
+	return count;
+}
+
+static int geometry_slot(SVGTag tag, SVGAttr attr, SVGLengthAxis& axis) {
+	static const SVGAttr box[4] = { SVGAttr::X, SVGAttr::Y, SVGAttr::Width, SVGAttr::Height };
+	static const SVGAttr circle[4] = { SVGAttr::Cx, SVGAttr::Cy, SVGAttr::R, SVGAttr::Unknown };
+	static const SVGAttr ellipse[4] = { SVGAttr::Cx, SVGAttr::Cy, SVGAttr::Rx, SVGAttr::Ry };
+	static const SVGAttr line[4] = { SVGAttr::X1, SVGAttr::Y1, SVGAttr::X2, SVGAttr::Y2 };
+	static const SVGAttr text[4] = { SVGAttr::X, SVGAttr::Y, SVGAttr::Unknown, SVGAttr::Unknown };
+	const SVGAttr* slots = nullptr;
+
+	switch (tag) {
+	case SVGTag::Rect:
+		slots = box;
+
+		break;
+	case SVGTag::Circle:
+		slots = circle;
+
+		break;
+	case SVGTag::Ellipse:
+		slots = ellipse;
+
+		break;
+	case SVGTag::Line:
+		slots = line;
+
+		break;
+	case SVGTag::Text:
+		slots = text;
+
+		break;
+	default:
+		return -1;
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		if (slots[i] == attr) {
+			//The same axes parse() resolves them on
+			axis = attr == SVGAttr::R ? SVGLengthAxis::Diagonal : (i % 2 == 0 ? SVGLengthAxis::Horizontal : SVGLengthAxis::Vertical);
+
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+//An open element during the tree walk
+struct ParseFrame {
+	//svg_no_node when the element was not supported. Its children are dropped.
+	SVGNodeId node;
+	//Last child added so far, to append the next one without walking the sibling list
+	SVGNodeId last_child;
+	//What the children inherit
+	SVGLengthContext length_context;
+	const SVGStyle* style;
+};
+
+//Path data recorded during the tree walk, to be parsed after it
+struct PendingPaths {
+	struct Entry {
+		uint32_t path;
+		std::string_view data;
+	};
+
+	std::vector<Entry> entries;
+	//Copies of attribute values that were entity decoded and don't live in the file
+	std::deque<std::string> owned_data;
+
+	void record(uint32_t path, std::string_view data, const SVGTokenizer& tokenizer) {
+		if (!tokenizer.is_source_slice(data)) {
+			owned_data.emplace_back(data);
+			data = owned_data.back();
+		}
+
+		entries.push_back({ path, data });
+	}
+
+	//Parses every path and packs the results into the document's path arrays
+	void parse_all(SVGDocument& doc, SVGThreadPool* pool) {
+		std::vector<SVGPathData> parsed(entries.size());
+
+		if (pool) {
+			//Each path is parsed independently, so the result is the same as parsing serially
+			pool->parallel_for(entries.size(), 256, [this, &parsed](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					parsed[i].parse(entries[i].data);
+				}
+			});
+		}
+		else {
+			for (size_t i = 0; i < entries.size(); ++i) {
+				parsed[i].parse(entries[i].data);
+			}
+		}
+
+		size_t verb_count = 0, coord_count = 0;
+
+		for (const SVGPathData& data : parsed) {
+			verb_count += data.verbs.size();
+			coord_count += data.coords.size();
+		}
+
+		doc.path_verbs.reserve(verb_count);
+		doc.path_coords.reserve(coord_count);
+
+		for (size_t i = 0; i < entries.size(); ++i) {
+			SVGPathRange& range = doc.paths[entries[i].path];
+			SVGPathData& data = parsed[i];
+
+			range.first_verb = static_cast<uint32_t>(doc.path_verbs.size());
+			range.verb_count = static_cast<uint32_t>(data.verbs.size());
+			range.first_coord = static_cast<uint32_t>(doc.path_coords.size());
+
+			doc.path_verbs.insert(doc.path_verbs.end(), data.verbs.begin(), data.verbs.end());
+			doc.path_coords.insert(doc.path_coords.end(), data.coords.begin(), data.coords.end());
+
+			//Give the memory back as we go so the peak stays near one copy
+			SVGPathData().verbs.swap(data.verbs);
+			SVGPathData().coords.swap(data.coords);
+		}
+	}
+};
+
+void SVGDocument::clear() {
+	//swap releases the memory, clear() would keep the capacity
+	std::vector<SVGNode>().swap(nodes);
+	std::vector<SVGPathRange>().swap(paths);
+	std::vector<SVGPathVerb>().swap(path_verbs);
+	std::vector<float>().swap(path_coords);
+	std::vector<SVGTextRange>().swap(texts);
+	std::string().swap(text_pool);
+	std::unordered_map<std::string, SVGNodeId>().swap(id_map);
+	style_cache.clear();
+	root = svg_no_node;
+	std::vector<SVGNodeChange>().swap(changes);
+	root_length_context = SVGLengthContext();
+	unused_verbs = 0;
+	unused_coords = 0;
+	unused_text = 0;
+}
+
+SVGNodeId SVGDocument::find(std::string_view id) const {
+	auto it = id_map.find(std::string(id));
+
+	if (it == id_map.end()) {
+		return svg_no_node;
+	}
+
+	return it->second;
+}
+
+bool SVGDocument::attached(SVGNodeId id) const {
+	if (id >= nodes.size()) {
+		return false;
+	}
+
+	//A removed node has no parent, and its children still link to it
+	while (nodes[id].parent != svg_no_node) {
+		id = nodes[id].parent;
+	}
+
+	return id == root;
+}
+
+size_t SVGDocument::memory_usage() const {
+	return nodes.capacity() * sizeof(SVGNode) +
+		paths.capacity() * sizeof(SVGPathRange) +
+		path_verbs.capacity() * sizeof(SVGPathVerb) +
+		path_coords.capacity() * sizeof(float) +
+		texts.capacity() * sizeof(SVGTextRange) +
+		text_pool.capacity();
+}
+
+SVGNodeId SVGDocument::add_node(SVGTag tag, SVGNodeId parent, SVGNodeId& last_child) {
+	SVGNodeId id = static_cast<SVGNodeId>(nodes.size());
+
+	nodes.emplace_back();
+	nodes.back().tag = tag;
+
+	if (parent != svg_no_node) {
+		nodes[id].parent = parent;
+
+		if (last_child == svg_no_node) {
+			nodes[parent].first_child = id;
+		}
+		else {
+			nodes[last_child].next_sibling = id;
+		}
+
+		last_child = id;
+	}
+
+	return id;
+}
+
+//Replaced data is written over when the new data fits in its place, and appended
+//otherwise. The arrays are compacted once more than half of them is unused, so
+//editing the same element again and again doesn't grow them without bound.
+void SVGDocument::set_text(SVGNodeId id, std::string_view content) {
+	SVGTextRange& range = texts[nodes[id].payload];
+
+	//A later text run replaces the earlier one
+	if (content.size() <= range.length) {
+		content.copy(&text_pool[range.offset], content.size());
+		unused_text += range.length - content.size();
+	}
+	else {
+		unused_text += range.length;
+		range.offset = static_cast<uint32_t>(text_pool.size());
+		text_pool.append(content.data(), content.size());
+	}
+
+	range.length = static_cast<uint32_t>(content.size());
+
+	if (unused_text > text_pool.size() / 2) {
+		compact_texts();
+	}
+}
+
+void SVGDocument::set_path(SVGNodeId id, const SVGPathData& data) {
+	SVGPathRange& range = paths[nodes[id].payload];
+	size_t coord_count = path_coord_count(path_verbs.data() + range.first_verb, range.verb_count);
+
+	if (data.verbs.size() <= range.verb_count && data.coords.size() <= coord_count) {
+		std::copy(data.verbs.begin(), data.verbs.end(), path_verbs.begin() + range.first_verb);
+		std::copy(data.coords.begin(), data.coords.end(), path_coords.begin() + range.first_coord);
+		unused_verbs += range.verb_count - data.verbs.size();
+		unused_coords += coord_count - data.coords.size();
+	}
+	else {
+		unused_verbs += range.verb_count;
+		unused_coords += coord_count;
+		range.first_verb = static_cast<uint32_t>(path_verbs.size());
+		range.first_coord = static_cast<uint32_t>(path_coords.size());
+		path_verbs.insert(path_verbs.end(), data.verbs.begin(), data.verbs.end());
+		path_coords.insert(path_coords.end(), data.coords.begin(), data.coords.end());
+	}
+
+	range.verb_count = static_cast<uint32_t>(data.verbs.size());
+
+	if (unused_verbs > path_verbs.size() / 2 || unused_coords > path_coords.size() / 2) {
+		compact_paths();
+	}
+}
+
+void SVGDocument::compact_paths() {
+	std::vector<SVGPathVerb> verbs;
+	std::vector<float> coords;
+
+	verbs.reserve(path_verbs.size() - unused_verbs);
+	coords.reserve(path_coords.size() - unused_coords);
+
+	for (SVGPathRange& range : paths) {
+		const SVGPathVerb* first_verb = path_verbs.data() + range.first_verb;
+		const float* first_coord = path_coords.data() + range.first_coord;
+
+		range.first_verb = static_cast<uint32_t>(verbs.size());
+		range.first_coord = static_cast<uint32_t>(coords.size());
+		verbs.insert(verbs.end(), first_verb, first_verb + range.verb_count);
+		coords.insert(coords.end(), first_coord, first_coord + path_coord_count(first_verb, range.verb_count));
+	}
+
+	path_verbs.swap(verbs);
+	path_coords.swap(coords);
+	unused_verbs = 0;
+	unused_coords = 0;
+}
+
+void SVGDocument::compact_texts() {
+	std::string pool;
+
+	pool.reserve(text_pool.size() - unused_text);
+
+	for (SVGTextRange& range : texts) {
+		size_t offset = range.offset;
+
+		range.offset = static_cast<uint32_t>(pool.size());
+		pool.append(text_pool, offset, range.length);
+	}
+
+	text_pool.swap(pool);
+	unused_text = 0;
+}
+
+bool SVGDocument::parse(std::string_view source, const SVGLengthContext& root_context, SVGThreadPool* pool) {
+	SVGTokenizer tokenizer(source);
+	SVGAttributeSet attrs;
+	PendingPaths pending_paths;
+	//<use> references are resolved at the end so that they can point forward
+	std::vector<std::pair<SVGNodeId, std::string>> pending_uses;
+	std::vector<ParseFrame> parent_stack;
+	std::string collapsed;
+
+	//Styles of the previous document go away with its elements
+	clear();
+	style_cache.dpi = root_context.dpi;
+	root_length_context = root_context;
+
+	ParseFrame root_frame{ svg_no_node, svg_no_node, root_context, style_cache.initial() };
+
+	while (true) {
+		SVGTokenType tokenType = tokenizer.next();
+
+		if (tokenType == SVGTokenType::EndOfFile) {
+			break; //End of file
+		}
+
+		if (tokenType == SVGTokenType::Error) {
+			return false;
+		}
+
+		if (tokenType == SVGTokenType::StartElement) {
+			bool is_self_closing = tokenizer.is_self_closing();
+
+			std::string_view attr_value;
+			SVGTag tag = svg_lookup_tag(tokenizer.name());
+
+			//One pass over the attributes, every lookup after this is an array access
+			attrs.collect(tokenizer.attributes());
+
+			ParseFrame* parent = parent_stack.empty() ? nullptr : &parent_stack.back();
+			const ParseFrame& parent_state = parent ? *parent : root_frame;
+			const SVGStyle* declared_style = nullptr;
+			const SVGStyle* style = collect_styles(attrs, style_cache, parent_state.style, declared_style);
+			SVGLengthContext length_context;
+			float geometry[4] = {};
+			bool supported = true;
+
+			compute_length_context(parent_state.length_context, style, length_context);
+
+			//Check the required attributes before the node is created
+			switch (tag) {
+			case SVGTag::Rect:
+				supported = get_size_attribute(attrs, length_context, SVGAttr::X, SVGLengthAxis::Horizontal, geometry[0]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Y, SVGLengthAxis::Vertical, geometry[1]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Width, SVGLengthAxis::Horizontal, geometry[2]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Height, SVGLengthAxis::Vertical, geometry[3]);
+
+				break;
+			case SVGTag::Circle:
+				supported = get_size_attribute(attrs, length_context, SVGAttr::Cx, SVGLengthAxis::Horizontal, geometry[0]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Cy, SVGLengthAxis::Vertical, geometry[1]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::R, SVGLengthAxis::Diagonal, geometry[2]);
+
+				break;
+			case SVGTag::Ellipse:
+				supported = get_size_attribute(attrs, length_context, SVGAttr::Cx, SVGLengthAxis::Horizontal, geometry[0]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Cy, SVGLengthAxis::Vertical, geometry[1]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Rx, SVGLengthAxis::Horizontal, geometry[2]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Ry, SVGLengthAxis::Vertical, geometry[3]);
+
+				break;
+			case SVGTag::Line:
+				supported = get_size_attribute(attrs, length_context, SVGAttr::X1, SVGLengthAxis::Horizontal, geometry[0]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Y1, SVGLengthAxis::Vertical, geometry[1]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::X2, SVGLengthAxis::Horizontal, geometry[2]) &&
+					get_size_attribute(attrs, length_context, SVGAttr::Y2, SVGLengthAxis::Vertical, geometry[3]);
+
+				break;
+			case SVGTag::Text:
+				get_size_attribute(attrs, length_context, SVGAttr::X, SVGLengthAxis::Horizontal, geometry[0]);
+				get_size_attribute(attrs, length_context, SVGAttr::Y, SVGLengthAxis::Vertical, geometry[1]);
+
+				break;
+			case SVGTag::Path:
+				supported = attrs.get(SVGAttr::D, attr_value);
+
+				break;
+			case SVGTag::Use:
+				supported = get_href_id(attrs, attr_value);
+
+				break;
+			default:
+				break;
+			}
+
+			SVGNodeId id = svg_no_node;
+
+			//Children of an unsupported element have no parent to attach to
+			if (parent && parent->node == svg_no_node) {
+				supported = false;
+			}
+
+			if (supported) {
+				if (parent) {
+					id = add_node(tag, parent->node, parent->last_child);
+				}
+				else {
+					SVGNodeId no_sibling = svg_no_node;
+
+					id = add_node(tag, svg_no_node, no_sibling);
+				}
+
+				SVGNode& node = nodes[id];
+
+				node.style = style;
+				node.declared_style = declared_style;
+
+				for (int i = 0; i < 4; ++i) {
+					node.geometry[i] = geometry[i];
+				}
+
+				//Stroke width may be relative to the viewport or the font size
+				node.stroke_width = length_context.to_user_units(style->stroke_width, SVGLengthAxis::Diagonal);
+
+				switch (tag) {
+				case SVGTag::Svg:
+					if (root == svg_no_node) {
+						//This is the root <svg> element
+						root = id;
+					}
+					else {
+						//Inner svg elements have some special treatment
+						float x = 0.0f, y = 0.0f;
+
+						if (get_size_attribute(attrs, length_context, SVGAttr::X, SVGLengthAxis::Horizontal, x) &&
+							get_size_attribute(attrs, length_context, SVGAttr::Y, SVGLengthAxis::Vertical, y)) {
+							//Position the inner SVG element
+							node.set_transform(SVGMatrix::translation(x, y));
+						}
+					}
+
+					apply_viewbox(node, attrs, length_context);
+
+					//Kept so that attributes set later resolve like the parsed ones
+					node.geometry[2] = length_context.viewport_width;
+					node.geometry[3] = length_context.viewport_height;
+
+					break;
+				case SVGTag::Path:
+					node.payload = static_cast<uint32_t>(paths.size());
+					paths.emplace_back();
+
+					//Parsed in bulk after the tree walk
+					pending_paths.record(node.payload, attr_value, tokenizer);
+
+					break;
+				case SVGTag::Text:
+					node.payload = static_cast<uint32_t>(texts.size());
+					texts.emplace_back();
+
+					break;
+				case SVGTag::Use:
+					node.payload = svg_no_node;
+					pending_uses.emplace_back(id, std::string(attr_value));
+
+					break;
+				default:
+					break;
+				}
+
+				if (attrs.get(SVGAttr::Id, attr_value)) {
+					id_map[std::string(attr_value)] = id;
+				}
+
+				//Transform is not inherited
+				if (attrs.get(SVGAttr::Transform, attr_value)) {
+					//If the element already has a transform (like inner <svg>), combine them
+					SVGMatrix trans = node.transform;
+
+					if (svg_parse_transform(attr_value, trans)) {
+						node.set_transform(trans);
+					}
+				}
+			}
+
+			//Do not add self closing elements like <circle .../> to the parent stack
+			if (!is_self_closing)
+			{
+				//This may be svg_no_node if the element is not supported
+				parent_stack.push_back({ id, svg_no_node, length_context, style });
+			}
+		}
+		else if (tokenType == SVGTokenType::Text) {
+			if (parent_stack.empty()) {
+				return false;
+			}
+
+			SVGNodeId parent = parent_stack.back().node;
+
+			if (parent == svg_no_node || nodes[parent].tag != SVGTag::Text) {
+				continue; //Text nodes are only valid inside <text> elements
+			}
+
+			//Collapse white space if needed.
+			SVGWhiteSpace white_space = nodes[parent].style->white_space;
+
+			if (white_space == SVGWhiteSpace::Normal || white_space == SVGWhiteSpace::NoWrap) {
+				std::string_view text = tokenizer.text();
+
+				collapse_whitespace(text, collapsed);
+				set_text(parent, collapsed);
+			}
+			else {
+				set_text(parent, tokenizer.text());
+			}
+		}
+		else if (tokenType == SVGTokenType::EndElement) {
+			if (!parent_stack.empty()) {
+				parent_stack.pop_back();
+			}
+		}
+	}
+
+	for (const auto& use : pending_uses) {
+		nodes[use.first].payload = find(use.second);
+	}
+
+	//The path data may point into the source, so this must finish before we return
+	pending_paths.parse_all(*this, pool);
+
+	return true;
+}
+
+void SVGDocument::length_context(SVGNodeId id, SVGLengthContext& context) const {
+	context = root_length_context;
+
+	//The nearest <svg> above the node sets the viewport
+	for (SVGNodeId p = nodes[id].parent; p != svg_no_node; p = nodes[p].parent) {
+		if (nodes[p].tag == SVGTag::Svg) {
+			context.viewport_width = nodes[p].geometry[2];
+			context.viewport_height = nodes[p].geometry[3];
+
+			break;
+		}
+	}
+
+	context.font_size = nodes[id].style->font_size.value;
+}
+
+bool SVGDocument::set_attribute(SVGNodeId id, std::string_view name, std::string_view value) {
+	SVGAttr attr = svg_lookup_attribute(name);
+
+	if (attr == SVGAttr::Unknown || !attached(id)) {
+		return false;
+	}
+
+	SVGNode& node = nodes[id];
+
+	if (attr >= svg_first_presentation_attribute) {
+		return set_style(id, name, value);
+	}
+
+	switch (attr) {
+	case SVGAttr::Href:
+	case SVGAttr::XlinkHref: {
+		std::string_view ref_id;
+
+		if (node.tag != SVGTag::Use || !parse_href_id(value, ref_id)) {
+			return false;
+		}
+
+		//The bounds of the old target cover the copy this drew, so that area is
+		//repainted too. The whole list is compiled again either way.
+		if (node.payload != svg_no_node) {
+			changes.push_back({ node.payload, SVGChange::Structure });
+		}
+
+		//An id that isn't in the document draws nothing, as when parsed
+		node.payload = find(ref_id);
+		changes.push_back({ id, SVGChange::Structure });
+
+		return true;
+	}
+	case SVGAttr::Style: {
+		SVGStyle declared = node.declared_style ? *node.declared_style : SVGStyle();
+
+		style_cache.parse_style_attribute(value, declared);
+		set_declared(id, declared);
+
+		return true;
+	}
+	case SVGAttr::Transform: {
+		SVGMatrix trans = SVGMatrix::identity();
+
+		//The transform of an <svg> holds its viewBox
+		if (node.tag == SVGTag::Svg || !svg_parse_transform(value, trans)) {
+			return false;
+		}
+
+		node.set_transform(trans);
+
+		break;
+	}
+	case SVGAttr::D: {
+		if (node.tag != SVGTag::Path) {
+			return false;
+		}
+
+		SVGPathData data;
+
+		//Everything up to the first error is kept, as when parsed
+		data.parse(value);
+		set_path(id, data);
+
+		break;
+	}
+	default: {
+		SVGLengthAxis axis;
+		SVGLengthContext context;
+		int slot = geometry_slot(node.tag, attr, axis);
+
+		if (slot < 0) {
+			return false;
+		}
+
+		length_context(id, context);
+
+		if (!context.resolve(value, axis, node.geometry[slot])) {
+			return false;
+		}
+
+		break;
+	}
+	}
+
+	changes.push_back({ id, SVGChange::Geometry });
+
+	return true;
+}
+
+bool SVGDocument::set_style(SVGNodeId id, std::string_view property, std::string_view value) {
+	SVGAttr attr = svg_lookup_attribute(property);
+
+	if (attr < svg_first_presentation_attribute || attr >= SVGAttr::Count || !attached(id)) {
+		return false;
+	}
+
+	const SVGNode& node = nodes[id];
+	SVGStyle declared = node.declared_style ? *node.declared_style : SVGStyle();
+
+	if (!style_cache.parse_property(attr, value, declared)) {
+		return false;
+	}
+
+	set_declared(id, declared);
+
+	return true;
+}
+
+void SVGDocument::set_declared(SVGNodeId id, const SVGStyle& declared) {
+	nodes[id].declared_style = declared.specified != 0 ? style_cache.intern(declared) : nullptr;
+
+	restyle(id);
+}
+
+//Computed styles are shared blocks, so below a node whose block didn't change
+//every node resolves to the block it has and the walk stops there
+void SVGDocument::restyle(SVGNodeId id) {
+	SVGNode& node = nodes[id];
+	const SVGStyle* parent_style = node.parent != svg_no_node ? nodes[node.parent].style : style_cache.initial();
+	const SVGStyle* style = style_cache.resolve(parent_style, node.declared_style);
+
+	if (style == node.style) {
+		return;
+	}
+
+	SVGLengthContext context;
+
+	node.style = style;
+	length_context(id, context);
+	node.stroke_width = context.to_user_units(style->stroke_width, SVGLengthAxis::Diagonal);
+	changes.push_back({ id, SVGChange::Style });
+
+	for (SVGNodeId child = node.first_child; child != svg_no_node; child = nodes[child].next_sibling) {
+		restyle(child);
+	}
+}
+
+SVGNodeId SVGDocument::insert(SVGNodeId parent, SVGNodeId before, std::string_view tag_name) {
+	SVGTag tag = svg_lookup_tag(tag_name);
+
+	if (tag == SVGTag::Unknown || !attached(parent) || (before != svg_no_node && (before >= nodes.size() || nodes[before].parent != parent))) {
+		return svg_no_node;
+	}
+
+	//Only containers draw their children
+	SVGTag parent_tag = nodes[parent].tag;
+
+	if (parent_tag != SVGTag::Svg && parent_tag != SVGTag::G && parent_tag != SVGTag::Defs) {
+		return svg_no_node;
+	}
+
+	SVGNodeId id = static_cast<SVGNodeId>(nodes.size());
+
+	nodes.emplace_back();
+
+	SVGNode& node = nodes[id];
+	SVGLengthContext context;
+
+	node.tag = tag;
+	node.parent = parent;
+	node.next_sibling = before;
+	node.style = style_cache.resolve(nodes[parent].style, nullptr);
+	length_context(id, context);
+	node.stroke_width = context.to_user_units(node.style->stroke_width, SVGLengthAxis::Diagonal);
+
+	switch (tag) {
+	case SVGTag::Svg:
+		//The default viewport when width and height are not set
+		node.geometry[2] = 300.0f;
+		node.geometry[3] = 150.0f;
+
+		break;
+	case SVGTag::Path:
+		node.payload = static_cast<uint32_t>(paths.size());
+		paths.emplace_back();
+
+		break;
+	case SVGTag::Text:
+		node.payload = static_cast<uint32_t>(texts.size());
+		texts.emplace_back();
+
+		break;
+	case SVGTag::Use:
+		node.payload = svg_no_node;
+
+		break;
+	default:
+		break;
+	}
+
+	if (nodes[parent].first_child == before) {
+		nodes[parent].first_child = id;
+	}
+	else {
+		SVGNodeId previous = nodes[parent].first_child;
+
+		while (nodes[previous].next_sibling != before) {
+			previous = nodes[previous].next_sibling;
+		}
+
+		nodes[previous].next_sibling = id;
+	}
+
+	changes.push_back({ id, SVGChange::Structure });
+
+	return id;
+}
+
+bool SVGDocument::remove(SVGNodeId id) {
+	//Also false for a node that was already removed, or is below one that was
+	if (id == root || !attached(id)) {
+		return false;
+	}
+
+	SVGNode& node = nodes[id];
+
+	SVGNode& parent = nodes[node.parent];
+
+	if (parent.first_child == id) {
+		parent.first_child = node.next_sibling;
+	}
+	else {
+		SVGNodeId previous = parent.first_child;
+
+		while (nodes[previous].next_sibling != id) {
+			previous = nodes[previous].next_sibling;
+		}
+
+		nodes[previous].next_sibling = node.next_sibling;
+	}
+
+	//Its children still link to it, so the removed subtree can be walked
+	node.parent = svg_no_node;
+	node.next_sibling = svg_no_node;
+	changes.push_back({ id, SVGChange::Structure });
+
+	return true;
+}
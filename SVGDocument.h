@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "SVGLength.h"
+#include "SVGNames.h"
+#include "SVGPathData.h"
+#include "SVGStyle.h"
+#include "SVGThreadPool.h"
+#include "SVGTransform.h"
+
+//Nodes are addressed by their index in SVGDocument::nodes
+typedef uint32_t SVGNodeId;
+
+const SVGNodeId svg_no_node = 0xFFFFFFFFu;
+
+//How deep <use> elements may nest. This also stops reference cycles.
+const int svg_max_use_depth = 16;
+
+//One element of the document. Nodes are plain values in one array and link to
+//each other by index, so a tree walk touches contiguous memory and never chases
+//a heap pointer per element.
+struct SVGNode {
+	SVGTag tag = SVGTag::Unknown;
+	SVGTransformClass transform_class = SVGTransformClass::Identity;
+	SVGNodeId parent = svg_no_node;
+	SVGNodeId first_child = svg_no_node;
+	SVGNodeId next_sibling = svg_no_node;
+	//Path: index into SVGDocument::paths. Text: index into SVGDocument::texts.
+	//Use: the referenced node, or svg_no_node when the reference is broken.
+	uint32_t payload = 0;
+	SVGMatrix transform;
+	//Geometry in user units.
+	//rect: x y width height, circle: cx cy r, ellipse: cx cy rx ry, line: x1 y1 x2 y2, text: x y
+	//svg: 0 0 and the width and height of the viewport its children resolve percentages against
+	float geometry[4] = {};
+	float stroke_width = 1.0f;
+	//Interned in SVGDocument::style_cache. declared_style is null when the element sets no style.
+	const SVGStyle* style = nullptr;
+	const SVGStyle* declared_style = nullptr;
+
+	void set_transform(const SVGMatrix& m) {
+		transform = m;
+		transform_class = svg_classify_transform(m);
+	}
+};
+
+//Where the path data of one path node lives in SVGDocument::path_verbs and path_coords
+struct SVGPathRange {
+	uint32_t first_verb = 0;
+	uint32_t verb_count = 0;
+	uint32_t first_coord = 0;
+};
+
+//Where the content of one text node lives in SVGDocument::text_pool. UTF-8.
+struct SVGTextRange {
+	uint32_t offset = 0;
+	uint32_t length = 0;
+};
+
+//What a mutation did to a node, so that renderers can update what they built from it
+enum class SVGChange : uint8_t {
+	//The computed style changed
+	Style,
+	//Geometry, path data or transform changed
+	Geometry,
+	//The node was inserted or removed
+	Structure
+};
+
+struct SVGNodeChange {
+	SVGNodeId node = svg_no_node;
+	SVGChange change = SVGChange::Style;
+};
+
+//A parsed SVG file. Owns every node, path, string and style block of the document
+//in a handful of flat arrays, so freeing a document frees a few blocks of memory
+//no matter how many elements it has.
+//
+//Has no dependency on the graphics backend. Renderers keep their own resources
+//in side tables indexed by node, path or text.
+class SVGDocument {
+public:
+	std::vector<SVGNode> nodes;
+	std::vector<SVGPathRange> paths;
+	std::vector<SVGPathVerb> path_verbs;
+	std::vector<float> path_coords;
+	std::vector<SVGTextRange> texts;
+	std::string text_pool;
+	std::unordered_map<std::string, SVGNodeId> id_map;
+	SVGStyleCache style_cache;
+	//The outermost <svg> element
+	SVGNodeId root = svg_no_node;
+	//Appended to by the mutation methods below, in call order. A node may appear more
+	//than once. Whoever renders the document reads and clears it.
+	std::vector<SVGNodeChange> changes;
+
+	SVGDocument() = default;
+
+	SVGDocument(const SVGDocument&) = delete;
+	SVGDocument& operator=(const SVGDocument&) = delete;
+
+	//Frees the whole document
+	void clear();
+
+	bool empty() const {
+		return root == svg_no_node;
+	}
+
+	//Builds the document from UTF-8 SVG source. root_context has the DPI and the viewport
+	//that the outermost <svg> resolves percentages against.
+	//Path data is parsed on pool after the tree is built, or serially when pool is null.
+	bool parse(std::string_view source, const SVGLengthContext& root_context, SVGThreadPool* pool);
+
+	SVGPathView path(uint32_t index) const {
+		const SVGPathRange& range = paths[index];
+
+		return SVGPathView{ path_verbs.data() + range.first_verb, range.verb_count, path_coords.data() + range.first_coord };
+	}
+
+	std::string_view text(uint32_t index) const {
+		const SVGTextRange& range = texts[index];
+
+		return std::string_view(text_pool.data() + range.offset, range.length);
+	}
+
+	//Finds an element by its id attribute
+	SVGNodeId find(std::string_view id) const;
+
+	//Whether id is a node of the tree under root, and not one that was removed or
+	//is below one that was
+	bool attached(SVGNodeId id) const;
+
+	//Changes one attribute of an element as if the source had it with this value.
+	//Geometry, d, transform, style, href on a <use> and the presentation attributes
+	//are supported.
+	//Lengths resolve against the element's viewport and font size as they did when
+	//parsed. A presentation attribute or style overrides what the element declared
+	//before, whichever way it was declared. Returns false and changes nothing when
+	//the attribute is not supported on the element, the value is invalid or id is
+	//not an attached node, like the svg_no_node of a failed find() or a removed node.
+	bool set_attribute(SVGNodeId id, std::string_view name, std::string_view value);
+
+	//Sets one presentation property, like fill, and resolves the computed style of
+	//the element and everything that inherits from it again. "inherit" drops the
+	//property. Returns false when the property is unknown, the value invalid or id
+	//is not an attached node.
+	bool set_style(SVGNodeId id, std::string_view property, std::string_view value);
+
+	//Creates an element with no attributes as a child of parent, before the child
+	//before or last when before is svg_no_node. It inherits the parent's style.
+	//Returns the new node, or svg_no_node when the tag is unknown, parent is not an
+	//attached <svg>, <g> or <defs> or before is not a child of parent.
+	SVGNodeId insert(SVGNodeId parent, SVGNodeId before, std::string_view tag);
+
+	//Unlinks an element and everything below it from the tree. The nodes keep their
+	//slots until the document is parsed again, so no other id changes. find() may
+	//still return them and a <use> of them still draws them. The root can't be removed.
+	bool remove(SVGNodeId id);
+
+	size_t memory_usage() const;
+
+private:
+	//What the outermost <svg> resolved against
+	SVGLengthContext root_length_context;
+	//Entries of path_verbs, path_coords and text_pool that no range points to any
+	//more since set_attribute or set_text replaced them
+	size_t unused_verbs = 0;
+	size_t unused_coords = 0;
+	size_t unused_text = 0;
+
+	SVGNodeId add_node(SVGTag tag, SVGNodeId parent, SVGNodeId& last_child);
+	void set_text(SVGNodeId id, std::string_view content);
+	void set_path(SVGNodeId id, const SVGPathData& data);
+	//Copies what the ranges point to into new arrays, without the unused entries
+	void compact_paths();
+	void compact_texts();
+	//Context the attributes of a node resolve against
+	void length_context(SVGNodeId id, SVGLengthContext& context) const;
+	//Makes declared the node's declared style and resolves the styles below it again
+	void set_declared(SVGNodeId id, const SVGStyle& declared);
+	void restyle(SVGNodeId id);
+};
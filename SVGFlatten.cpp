@@ -0,0 +1,260 @@
+#include "SVGFlatten.h"
+#include <algorithm>
+#include <cmath>
+
+static const double svg_pi = 3.14159265358979323846;
+
+//Curves are never split into more lines than this
+static const int max_segments = 1024;
+
+static float distance(float x, float y) {
+	return std::sqrt(x * x + y * y);
+}
+
+float svg_max_scale(const SVGMatrix& m) {
+	float e = m.m11 * m.m11 + m.m12 * m.m12 + m.m21 * m.m21 + m.m22 * m.m22;
+	float det = m.m11 * m.m22 - m.m12 * m.m21;
+	float root = std::sqrt(std::fmax(e * e - 4.0f * det * det, 0.0f));
+
+	return std::sqrt((e + root) * 0.5f);
+}
+
+float svg_flatten_tolerance(const SVGMatrix& m, float device_tolerance) {
+	float scale = svg_max_scale(m);
+
+	return scale > 0.0f ? device_tolerance / scale : device_tolerance;
+}
+
+SVGPoint SVGArcCenter::point_at(double angle) const {
+	double ex = rx * std::cos(angle), ey = ry * std::sin(angle);
+
+	return SVGPoint{ static_cast<float>(cos_phi * ex - sin_phi * ey + cx), static_cast<float>(sin_phi * ex + cos_phi * ey + cy) };
+}
+
+bool svg_arc_center(SVGPoint from, const float* arc, SVGArcCenter& center) {
+	SVGPoint to{ arc[5], arc[6] };
+	double rx = std::fabs(arc[0]), ry = std::fabs(arc[1]);
+
+	if ((from.x == to.x && from.y == to.y) || !(rx > 0.0) || !(ry > 0.0) || !std::isfinite(rx + ry + arc[2])) {
+		return false;
+	}
+
+	double phi = std::fmod(static_cast<double>(arc[2]), 360.0) * svg_pi / 180.0;
+	double cos_phi = std::cos(phi), sin_phi = std::sin(phi);
+	bool large_arc = arc[3] != 0.0f, sweep = arc[4] != 0.0f;
+	//Start point in a frame centered between the end points, with the ellipse axes unrotated
+	double hx = (static_cast<double>(from.x) - to.x) * 0.5, hy = (static_cast<double>(from.y) - to.y) * 0.5;
+	double x1 = cos_phi * hx + sin_phi * hy;
+	double y1 = -sin_phi * hx + cos_phi * hy;
+	double lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+
+	if (lambda > 1.0) {
+		//The end points are too far apart for the radii. Scale them up until the
+		//ellipse just reaches, which puts the center halfway between the end points.
+		rx *= std::sqrt(lambda);
+		ry *= std::sqrt(lambda);
+	}
+
+	double num = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+	double den = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+	double coef = std::sqrt(std::fmax(num, 0.0) / den) * (large_arc == sweep ? -1.0 : 1.0);
+	double cx1 = coef * rx * y1 / ry;
+	double cy1 = -coef * ry * x1 / rx;
+	double start_angle = std::atan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+	double delta = std::atan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - start_angle;
+
+	if (!sweep && delta > 0.0) {
+		delta -= 2.0 * svg_pi;
+	}
+	else if (sweep && delta < 0.0) {
+		delta += 2.0 * svg_pi;
+	}
+
+	center.cx = cos_phi * cx1 - sin_phi * cy1 + (static_cast<double>(from.x) + to.x) * 0.5;
+	center.cy = sin_phi * cx1 + cos_phi * cy1 + (static_cast<double>(from.y) + to.y) * 0.5;
+	center.rx = rx;
+	center.ry = ry;
+	center.cos_phi = cos_phi;
+	center.sin_phi = sin_phi;
+	center.start_angle = start_angle;
+	center.sweep = delta;
+
+	return std::isfinite(center.cx + center.cy);
+}
+
+int svg_arc_to_cubics(const SVGArcCenter& arc, SVGPoint points[12]) {
+	int n = static_cast<int>(std::ceil(std::fabs(arc.sweep) / (svg_pi * 0.5) - 1e-9));
+
+	n = std::min(std::max(n, 1), 4);
+
+	double step = arc.sweep / n;
+	//Length of the tangents that makes a cubic match a circular arc of this step at its middle
+	double k = 4.0 / 3.0 * std::tan(step * 0.25);
+
+	for (int i = 0; i < n; ++i) {
+		double a0 = arc.start_angle + step * i, a1 = a0 + step;
+		double cos0 = std::cos(a0), sin0 = std::sin(a0), cos1 = std::cos(a1), sin1 = std::sin(a1);
+		//Tangents on the unrotated ellipse, scaled by k
+		double t0x = -arc.rx * sin0 * k, t0y = arc.ry * cos0 * k;
+		double t1x = -arc.rx * sin1 * k, t1y = arc.ry * cos1 * k;
+		SVGPoint p0 = arc.point_at(a0), p1 = arc.point_at(a1);
+
+		points[i * 3] = SVGPoint{
+			p0.x + static_cast<float>(arc.cos_phi * t0x - arc.sin_phi * t0y),
+			p0.y + static_cast<float>(arc.sin_phi * t0x + arc.cos_phi * t0y) };
+		points[i * 3 + 1] = SVGPoint{
+			p1.x - static_cast<float>(arc.cos_phi * t1x - arc.sin_phi * t1y),
+			p1.y - static_cast<float>(arc.sin_phi * t1x + arc.cos_phi * t1y) };
+		points[i * 3 + 2] = p1;
+	}
+
+	return n;
+}
+
+int svg_arc_segments(float radius, double sweep, float tolerance) {
+	if (!(radius > tolerance)) {
+		return std::max(1, static_cast<int>(std::ceil(std::fabs(sweep) / (svg_pi * 0.5))));
+	}
+
+	double step = 2.0 * std::acos(1.0 - tolerance / radius);
+	double n = std::ceil(std::fabs(sweep) / step);
+
+	return static_cast<int>(std::fmin(std::fmax(n, 1.0), static_cast<double>(max_segments)));
+}
+
+//Curves are split evenly into as many lines as the deviation of their control
+//polygon needs to stay within tolerance (Wang's formula). A chord over a parameter
+//step h is at most |B''| h^2 / 8 from the curve.
+static void flatten_quad(SVGPoint p0, SVGPoint p1, SVGPoint p2, float tolerance, SVGPolyline& polyline) {
+	float dd = distance(p0.x - 2.0f * p1.x + p2.x, p0.y - 2.0f * p1.y + p2.y);
+	int n = static_cast<int>(std::ceil(std::sqrt(dd / (4.0f * tolerance))));
+
+	n = std::min(std::max(n, 1), max_segments);
+
+	for (int i = 1; i < n; ++i) {
+		float t = static_cast<float>(i) / n, u = 1.0f - t;
+
+		polyline.line_to(SVGPoint{
+			u * u * p0.x + 2.0f * u * t * p1.x + t * t * p2.x,
+			u * u * p0.y + 2.0f * u * t * p1.y + t * t * p2.y
+		});
+	}
+
+	polyline.line_to(p2);
+}
+
+static void flatten_cubic(SVGPoint p0, SVGPoint p1, SVGPoint p2, SVGPoint p3, float tolerance, SVGPolyline& polyline) {
+	float dd = std::fmax(
+		distance(p0.x - 2.0f * p1.x + p2.x, p0.y - 2.0f * p1.y + p2.y),
+		distance(p1.x - 2.0f * p2.x + p3.x, p1.y - 2.0f * p2.y + p3.y));
+	int n = static_cast<int>(std::ceil(std::sqrt(0.75f * dd / tolerance)));
+
+	n = std::min(std::max(n, 1), max_segments);
+
+	for (int i = 1; i < n; ++i) {
+		float t = static_cast<float>(i) / n, u = 1.0f - t;
+		float a = u * u * u, b = 3.0f * u * u * t, c = 3.0f * u * t * t, d = t * t * t;
+
+		polyline.line_to(SVGPoint{
+			a * p0.x + b * p1.x + c * p2.x + d * p3.x,
+			a * p0.y + b * p1.y + c * p2.y + d * p3.y
+		});
+	}
+
+	polyline.line_to(p3);
+}
+
+//Arcs are flattened in user space, where they are elliptical, and the points transformed after
+static void flatten_arc(SVGPoint from, const float* c, const SVGMatrix& m, float tolerance, SVGPolyline& polyline) {
+	SVGPoint to{ c[5], c[6] };
+	SVGArcCenter arc;
+
+	if (!svg_arc_center(from, c, arc)) {
+		polyline.line_to(svg_transform_point(m, to));
+		return;
+	}
+
+	int n = svg_arc_segments(static_cast<float>(std::fmax(arc.rx, arc.ry)) * svg_max_scale(m), arc.sweep, tolerance);
+
+	for (int i = 1; i < n; ++i) {
+		polyline.line_to(svg_transform_point(m, arc.point_at(arc.start_angle + arc.sweep * i / n)));
+	}
+
+	//Exactly where the next command starts
+	polyline.line_to(svg_transform_point(m, to));
+}
+
+void svg_flatten_path(const SVGPathView& path, const SVGMatrix& m, float tolerance, SVGPolyline& polyline) {
+	//Arcs are flattened in user space, so keep the user space pen position too
+	SVGPoint pen, start;
+	bool in_figure = false;
+
+	path.for_each([&](SVGPathVerb verb, const float* c) {
+		if (verb != SVGPathVerb::Move && !in_figure) {
+			//Drawing after a close starts a new figure at the same point
+			polyline.move_to(svg_transform_point(m, start));
+			in_figure = true;
+		}
+
+		switch (verb) {
+		case SVGPathVerb::Move:
+			pen = start = SVGPoint{ c[0], c[1] };
+			polyline.move_to(svg_transform_point(m, pen));
+			in_figure = true;
+
+			break;
+		case SVGPathVerb::Line:
+			pen = SVGPoint{ c[0], c[1] };
+			polyline.line_to(svg_transform_point(m, pen));
+
+			break;
+		case SVGPathVerb::Quad:
+			flatten_quad(polyline.points.back(), svg_transform_point(m, SVGPoint{ c[0], c[1] }),
+				svg_transform_point(m, SVGPoint{ c[2], c[3] }), tolerance, polyline);
+			pen = SVGPoint{ c[2], c[3] };
+
+			break;
+		case SVGPathVerb::Cubic:
+			flatten_cubic(polyline.points.back(), svg_transform_point(m, SVGPoint{ c[0], c[1] }),
+				svg_transform_point(m, SVGPoint{ c[2], c[3] }), svg_transform_point(m, SVGPoint{ c[4], c[5] }), tolerance, polyline);
+			pen = SVGPoint{ c[4], c[5] };
+
+			break;
+		case SVGPathVerb::Arc:
+			flatten_arc(pen, c, m, tolerance, polyline);
+			pen = SVGPoint{ c[5], c[6] };
+
+			break;
+		case SVGPathVerb::Close:
+			polyline.close();
+			pen = start;
+			in_figure = false;
+
+			break;
+		}
+	});
+}
+
+void svg_flatten_ellipse(float cx, float cy, float rx, float ry, const SVGMatrix& m, float tolerance, SVGPolyline& polyline) {
+	rx = std::fabs(rx);
+	ry = std::fabs(ry);
+
+	if (rx == 0.0f || ry == 0.0f) {
+		return;
+	}
+
+	int n = std::max(svg_arc_segments(std::fmax(rx, ry) * svg_max_scale(m), 2.0 * svg_pi, tolerance), 4);
+
+	polyline.move_to(svg_transform_point(m, SVGPoint{ cx + rx, cy }));
+
+	for (int i = 1; i < n; ++i) {
+		double angle = 2.0 * svg_pi * i / n;
+
+		polyline.line_to(svg_transform_point(m, SVGPoint{
+			cx + static_cast<float>(rx * std::cos(angle)),
+			cy + static_cast<float>(ry * std::sin(angle))
+		}));
+	}
+
+	polyline.close();
+}
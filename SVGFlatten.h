@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SVGPathData.h"
+#include "SVGTransform.h"
+
+//One figure of an SVGPolyline
+struct SVGPolylineFigure {
+	uint32_t first = 0;
+	uint32_t count = 0;
+	//A closed figure has a line from its last point back to its first
+	bool closed = false;
+};
+
+//Figures made of straight lines only. The points of every figure live in one array.
+struct SVGPolyline {
+	std::vector<SVGPoint> points;
+	std::vector<SVGPolylineFigure> figures;
+
+	bool empty() const {
+		return figures.empty();
+	}
+
+	void clear() {
+		points.clear();
+		figures.clear();
+	}
+
+	//Starts a new figure
+	void move_to(SVGPoint p) {
+		figures.push_back(SVGPolylineFigure{ static_cast<uint32_t>(points.size()), 1, false });
+		points.push_back(p);
+	}
+
+	//Adds to the current figure. Needs a move_to first.
+	void line_to(SVGPoint p) {
+		points.push_back(p);
+		++figures.back().count;
+	}
+
+	void close() {
+		figures.back().closed = true;
+	}
+};
+
+//Largest factor by which m stretches a length
+float svg_max_scale(const SVGMatrix& m);
+
+//Tolerance in the space before m that stays within device_tolerance after it.
+//Flattening in user space with it gives fewer lines when zoomed out and enough when zoomed in.
+float svg_flatten_tolerance(const SVGMatrix& m, float device_tolerance);
+
+//An endpoint arc in center form. The ellipse point at angle a is
+//(rx cos a, ry sin a), rotated by phi and moved to (cx, cy).
+struct SVGArcCenter {
+	double cx = 0.0, cy = 0.0;
+	double rx = 0.0, ry = 0.0;
+	double cos_phi = 1.0, sin_phi = 0.0;
+	double start_angle = 0.0;
+	//Signed, at most a full turn
+	double sweep = 0.0;
+
+	SVGPoint point_at(double angle) const;
+};
+
+//Converts the arc from the point from, with the 7 coordinates of SVGPathVerb::Arc,
+//to center form (SVG appendix F.6.5). Radii too small to reach the end point are
+//scaled up and negative radii are made positive, as the spec requires.
+//Returns false when the arc is drawn as a straight line to its end point instead:
+//a zero radius, equal end points or a non-finite value.
+bool svg_arc_center(SVGPoint from, const float* arc, SVGArcCenter& center);
+
+//Approximates the arc with one cubic Bezier per quarter turn or less, at most 4.
+//Writes 3 points per curve, control points then end point. Returns the number of curves.
+int svg_arc_to_cubics(const SVGArcCenter& arc, SVGPoint points[12]);
+
+//Number of lines that keep every chord of a circular arc within tolerance of it
+int svg_arc_segments(float radius, double sweep, float tolerance);
+
+//Appends the figures of path to polyline with curves and arcs replaced by lines.
+//Points are transformed by m and stay within tolerance of the true curve, measured after m.
+void svg_flatten_path(const SVGPathView& path, const SVGMatrix& m, float tolerance, SVGPolyline& polyline);
+
+//Appends an ellipse as one closed figure
+void svg_flatten_ellipse(float cx, float cy, float rx, float ry, const SVGMatrix& m, float tolerance, SVGPolyline& polyline);
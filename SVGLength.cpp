@@ -0,0 +1,150 @@
+#include "SVGLength.h"
+#include "SVGPathLexer.h"
+#include "SVGPerfectHash.h"
+#include <cmath>
+
+static bool is_length_space(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+static bool parse_length_unit(std::string_view unit, SVGLengthUnit& result) {
+	if (unit.empty()) {
+		result = SVGLengthUnit::None;
+
+		return true;
+	}
+
+	if (unit == "%") {
+		result = SVGLengthUnit::Percent;
+
+		return true;
+	}
+
+	if (unit.size() != 2) {
+		return false;
+	}
+
+	//CSS units are case insensitive
+	static const struct {
+		std::string_view name;
+		SVGLengthUnit unit;
+	} units[] = {
+		{ "px", SVGLengthUnit::Px },
+		{ "em", SVGLengthUnit::Em },
+		{ "ex", SVGLengthUnit::Ex },
+		{ "in", SVGLengthUnit::In },
+		{ "cm", SVGLengthUnit::Cm },
+		{ "mm", SVGLengthUnit::Mm },
+		{ "pt", SVGLengthUnit::Pt },
+		{ "pc", SVGLengthUnit::Pc }
+	};
+
+	for (const auto& u : units) {
+		if (svg_equals_ignore_case(unit, u.name)) {
+			result = u.unit;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool svg_parse_length(std::string_view source, SVGLength& length) {
+	while (!source.empty() && is_length_space(source.front())) {
+		source.remove_prefix(1);
+	}
+
+	while (!source.empty() && is_length_space(source.back())) {
+		source.remove_suffix(1);
+	}
+
+	float value;
+	size_t consumed = svg_parse_number(source, value);
+
+	if (consumed == 0) {
+		return false;
+	}
+
+	SVGLengthUnit unit;
+
+	if (!parse_length_unit(source.substr(consumed), unit)) {
+		return false;
+	}
+
+	length.value = value;
+	length.unit = unit;
+
+	return true;
+}
+
+float SVGLengthContext::to_user_units(const SVGLength& length, SVGLengthAxis axis) const {
+	switch (length.unit) {
+	case SVGLengthUnit::None:
+	case SVGLengthUnit::Px:
+		return length.value;
+	case SVGLengthUnit::Em:
+		return length.value * font_size;
+	case SVGLengthUnit::Ex:
+		//Without font metrics the x-height is taken as half the em, as browsers do
+		return length.value * font_size * 0.5f;
+	case SVGLengthUnit::In:
+		return length.value * dpi;
+	case SVGLengthUnit::Cm:
+		return length.value * dpi / 2.54f;
+	case SVGLengthUnit::Mm:
+		return length.value * dpi / 25.4f;
+	case SVGLengthUnit::Pt:
+		return length.value * dpi / 72.0f;
+	case SVGLengthUnit::Pc:
+		return length.value * dpi / 6.0f;
+	case SVGLengthUnit::Percent:
+		break;
+	}
+
+	float reference;
+
+	if (axis == SVGLengthAxis::Horizontal) {
+		reference = viewport_width;
+	}
+	else if (axis == SVGLengthAxis::Vertical) {
+		reference = viewport_height;
+	}
+	else {
+		reference = std::sqrt((viewport_width * viewport_width + viewport_height * viewport_height) / 2.0f);
+	}
+
+	return length.value * reference / 100.0f;
+}
+
+bool SVGLengthContext::resolve(std::string_view source, SVGLengthAxis axis, float& size) const {
+	SVGLength length;
+
+	if (!svg_parse_length(source, length)) {
+		return false;
+	}
+
+	size = to_user_units(length, axis);
+
+	return true;
+}
+
+bool SVGLengthContext::resolve_font_size(std::string_view source, float& size) const {
+	SVGLength length;
+
+	if (!svg_parse_length(source, length)) {
+		return false;
+	}
+
+	size = font_size_to_user_units(length);
+
+	return true;
+}
+
+float SVGLengthContext::font_size_to_user_units(const SVGLength& length) const {
+	if (length.unit == SVGLengthUnit::Percent) {
+		return length.value * font_size / 100.0f;
+	}
+
+	return to_user_units(length, SVGLengthAxis::Diagonal);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+enum class SVGLengthUnit : uint8_t {
+	None,		//Plain number, same as px
+	Px,
+	Em,
+	Ex,
+	In,
+	Cm,
+	Mm,
+	Pt,
+	Pc,
+	Percent
+};
+
+struct SVGLength {
+	float value = 0.0f;
+	SVGLengthUnit unit = SVGLengthUnit::None;
+};
+
+//Parses a number followed by an optional unit, with optional spaces around it.
+//Does not allocate or throw. Returns false for malformed input and unknown units.
+bool svg_parse_length(std::string_view source, SVGLength& length);
+
+//What a percentage is relative to
+enum class SVGLengthAxis : uint8_t {
+	Horizontal,		//Viewport width: x, width, cx, rx
+	Vertical,		//Viewport height: y, height, cy, ry
+	Diagonal		//Normalized diagonal: r, stroke-width
+};
+
+//Everything needed to turn a length into user units.
+//Computed once per element while parsing, so that resolving a length
+//never goes back to the device context.
+struct SVGLengthContext {
+	float dpi = 96.0f;
+	float viewport_width = 300.0f;
+	float viewport_height = 150.0f;
+	float font_size = 12.0f;	//Computed font size of the element, used for em and ex
+
+	float to_user_units(const SVGLength& length, SVGLengthAxis axis) const;
+
+	//Parses and resolves a length. size is left unchanged on failure.
+	bool resolve(std::string_view source, SVGLengthAxis axis, float& size) const;
+
+	//Resolves a font-size value. Here em and % are relative to this context's font size,
+	//so call it on the parent context.
+	bool resolve_font_size(std::string_view source, float& size) const;
+	float font_size_to_user_units(const SVGLength& length) const;
+};
@@ -0,0 +1,150 @@
+#include "SVGMappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <string>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SVGMappedFile::~SVGMappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+
+bool SVGMappedFile::open(const wchar_t* fileName) {
+	close();
+
+	HANDLE hFile = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	file_handle = hFile;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(hFile, &fileSize)) {
+		close();
+
+		return false;
+	}
+
+	if (fileSize.QuadPart == 0) {
+		//Empty files can not be mapped
+		return true;
+	}
+
+	HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (hMapping == NULL) {
+		close();
+
+		return false;
+	}
+
+	mapping_handle = hMapping;
+
+	void* view = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (view == NULL) {
+		close();
+
+		return false;
+	}
+
+	bytes = static_cast<const char*>(view);
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	return true;
+}
+
+bool SVGMappedFile::open(const char* fileName) {
+	int len = MultiByteToWideChar(CP_UTF8, 0, fileName, -1, nullptr, 0);
+
+	if (len <= 0) {
+		return false;
+	}
+
+	std::wstring wideName(len, L'\0');
+
+	MultiByteToWideChar(CP_UTF8, 0, fileName, -1, &wideName[0], len);
+
+	return open(wideName.c_str());
+}
+
+void SVGMappedFile::close() {
+	if (bytes != nullptr) {
+		UnmapViewOfFile(bytes);
+	}
+
+	if (mapping_handle != nullptr) {
+		CloseHandle(mapping_handle);
+	}
+
+	if (file_handle != nullptr) {
+		CloseHandle(file_handle);
+	}
+
+	bytes = nullptr;
+	size = 0;
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+}
+
+#else
+
+bool SVGMappedFile::open(const char* fileName) {
+	close();
+
+	int fd = ::open(fileName, O_RDONLY);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+
+		return false;
+	}
+
+	if (st.st_size == 0) {
+		//Empty files can not be mapped
+		::close(fd);
+
+		return true;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+	//The mapping keeps its own reference to the file
+	::close(fd);
+
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	bytes = static_cast<const char*>(view);
+	size = static_cast<size_t>(st.st_size);
+
+	return true;
+}
+
+void SVGMappedFile::close() {
+	if (bytes != nullptr) {
+		munmap(const_cast<char*>(bytes), size);
+	}
+
+	bytes = nullptr;
+	size = 0;
+}
+
+#endif
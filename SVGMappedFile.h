@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+//Read only memory mapping of an entire file.
+//The mapped bytes stay valid until close() is called or the object is destroyed.
+struct SVGMappedFile {
+	SVGMappedFile() = default;
+	~SVGMappedFile();
+
+	SVGMappedFile(const SVGMappedFile&) = delete;
+	SVGMappedFile& operator=(const SVGMappedFile&) = delete;
+
+#ifdef _WIN32
+	bool open(const wchar_t* fileName);
+#endif
+	bool open(const char* fileName);
+	void close();
+
+	std::string_view data() const {
+		return std::string_view(bytes, size);
+	}
+
+private:
+	const char* bytes = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+#endif
+};
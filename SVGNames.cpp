@@ -0,0 +1,82 @@
+#include "SVGNames.h"
+#include "SVGPerfectHash.h"
+
+//Indexed by SVGTag
+static const char* const tag_names[] = {
+	"unknown", "svg", "g", "rect", "circle", "ellipse", "line", "path", "text", "defs", "use"
+};
+
+static constexpr std::string_view tag_keys[] = {
+	"svg", "g", "rect", "circle", "ellipse", "line", "path", "text", "defs", "use",
+	"group"
+};
+
+static constexpr SVGTag tag_values[] = {
+	SVGTag::Svg, SVGTag::G, SVGTag::Rect, SVGTag::Circle, SVGTag::Ellipse, SVGTag::Line, SVGTag::Path, SVGTag::Text, SVGTag::Defs, SVGTag::Use,
+	SVGTag::G	//Accepted as an alias of g
+};
+
+static_assert(sizeof(tag_keys) / sizeof(tag_keys[0]) == sizeof(tag_values) / sizeof(tag_values[0]), "Every tag key needs a value");
+
+static constexpr SVGPerfectHashTable<sizeof(tag_keys) / sizeof(tag_keys[0]), 5> tag_table(tag_keys, 1);
+
+static_assert(tag_table.is_perfect(), "Tag seed no longer gives a perfect hash");
+
+//Indexed by SVGAttr
+static constexpr std::string_view attribute_keys[] = {
+	"unknown",
+	"id", "style", "transform", "href", "xlink:href", "viewBox", "d",
+	"x", "y", "width", "height", "cx", "cy", "r", "rx", "ry", "x1", "y1", "x2", "y2",
+	"color", "fill", "fill-opacity", "stroke-opacity", "stroke-linecap", "stroke-linejoin",
+	"stroke-miterlimit", "stroke", "stroke-width", "font-family", "font-size", "font-weight", "font-style",
+	"white-space", "fill-rule"
+};
+
+static_assert(sizeof(attribute_keys) / sizeof(attribute_keys[0]) == static_cast<size_t>(SVGAttr::Count), "Every attribute needs a name");
+
+static constexpr SVGPerfectHashTable<static_cast<size_t>(SVGAttr::Count), 7> attribute_table(attribute_keys, 259);
+
+static_assert(attribute_table.is_perfect(), "Attribute seed no longer gives a perfect hash");
+
+SVGTag svg_lookup_tag(std::string_view name) {
+	int index = tag_table.candidate(name);
+
+	if (index >= 0 && tag_keys[index] == name) {
+		return tag_values[index];
+	}
+
+	return SVGTag::Unknown;
+}
+
+SVGAttr svg_lookup_attribute(std::string_view name) {
+	int index = attribute_table.candidate(name);
+
+	//Index 0 is the "unknown" placeholder, which is not a real attribute
+	if (index > 0 && attribute_keys[index] == name) {
+		return static_cast<SVGAttr>(index);
+	}
+
+	return SVGAttr::Unknown;
+}
+
+const char* svg_tag_name(SVGTag tag) {
+	return tag_names[static_cast<size_t>(tag)];
+}
+
+const char* svg_attribute_name(SVGAttr attr) {
+	//The keys are string literals, so they are null terminated
+	return attribute_keys[static_cast<size_t>(attr)].data();
+}
+
+void SVGAttributeSet::collect(const std::vector<SVGXmlAttribute>& attributes) {
+	present = 0;
+
+	for (const auto& attr : attributes) {
+		size_t index = static_cast<size_t>(svg_lookup_attribute(attr.name));
+
+		if (index != 0) {
+			values[index] = attr.value;
+			present |= uint64_t(1) << index;
+		}
+	}
+}
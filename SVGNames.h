@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "SVGTokenizer.h"
+
+//Elements the parser knows about
+enum class SVGTag : uint8_t {
+	Unknown,
+	Svg,
+	G,
+	Rect,
+	Circle,
+	Ellipse,
+	Line,
+	Path,
+	Text,
+	Defs,
+	Use
+};
+
+//Attributes the parser knows about.
+//Presentation attributes come last, from Color to FillRule, so they form one range of bits.
+enum class SVGAttr : uint8_t {
+	Unknown,
+	Id,
+	Style,
+	Transform,
+	Href,
+	XlinkHref,
+	ViewBox,
+	D,
+	X,
+	Y,
+	Width,
+	Height,
+	Cx,
+	Cy,
+	R,
+	Rx,
+	Ry,
+	X1,
+	Y1,
+	X2,
+	Y2,
+	Color,
+	Fill,
+	FillOpacity,
+	StrokeOpacity,
+	StrokeLinecap,
+	StrokeLinejoin,
+	StrokeMiterlimit,
+	Stroke,
+	StrokeWidth,
+	FontFamily,
+	FontSize,
+	FontWeight,
+	FontStyle,
+	WhiteSpace,
+	FillRule,
+	Count
+};
+
+const SVGAttr svg_first_presentation_attribute = SVGAttr::Color;
+
+//Name lookups go through compile time perfect hash tables. Names are case sensitive.
+SVGTag svg_lookup_tag(std::string_view name);
+SVGAttr svg_lookup_attribute(std::string_view name);
+
+//Names for debug output and style keys
+const char* svg_tag_name(SVGTag tag);
+const char* svg_attribute_name(SVGAttr attr);
+
+//Values of the known attributes of the current element.
+//collect() walks the attribute list once. After that every lookup is an array access,
+//so the cost of an element does not depend on how many attributes we support.
+class SVGAttributeSet {
+public:
+	void collect(const std::vector<SVGXmlAttribute>& attributes);
+
+	bool get(SVGAttr attr, std::string_view& value) const {
+		size_t index = static_cast<size_t>(attr);
+
+		if (!(present & (uint64_t(1) << index))) {
+			return false;
+		}
+
+		value = values[index];
+
+		return true;
+	}
+
+	//Calls fn(attr, value) for each presentation attribute on the element
+	template <typename Fn>
+	void for_each_presentation(Fn fn) const {
+		uint64_t bits = present & presentation_mask;
+
+		while (bits != 0) {
+			size_t index = lowest_bit(bits);
+
+			bits &= bits - 1;
+			fn(static_cast<SVGAttr>(index), values[index]);
+		}
+	}
+
+private:
+	static_assert(static_cast<size_t>(SVGAttr::Count) <= 64, "Attribute bits must fit in a uint64_t");
+
+	static constexpr uint64_t presentation_mask =
+		~((uint64_t(1) << static_cast<size_t>(svg_first_presentation_attribute)) - 1) &
+		((uint64_t(1) << static_cast<size_t>(SVGAttr::Count)) - 1);
+
+	std::string_view values[static_cast<size_t>(SVGAttr::Count)];
+	uint64_t present = 0;
+
+	static size_t lowest_bit(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+
+		_BitScanForward64(&index, bits);
+
+		return index;
+#elif defined(__GNUC__)
+		return static_cast<size_t>(__builtin_ctzll(bits));
+#else
+		size_t index = 0;
+
+		while (!(bits & 1)) {
+			bits >>= 1;
+			++index;
+		}
+
+		return index;
+#endif
+	}
+};
@@ -0,0 +1,402 @@
+#include "SVGPathData.h"
+#include "SVGFlatten.h"
+#include "SVGPathLexer.h"
+#include <cmath>
+
+void SVGPathData::move_to(float x, float y) {
+	verbs.push_back(SVGPathVerb::Move);
+	coords.push_back(x);
+	coords.push_back(y);
+}
+
+void SVGPathData::line_to(float x, float y) {
+	verbs.push_back(SVGPathVerb::Line);
+	coords.push_back(x);
+	coords.push_back(y);
+}
+
+void SVGPathData::quad_to(float x1, float y1, float x, float y) {
+	verbs.push_back(SVGPathVerb::Quad);
+	coords.insert(coords.end(), { x1, y1, x, y });
+}
+
+void SVGPathData::cubic_to(float x1, float y1, float x2, float y2, float x, float y) {
+	verbs.push_back(SVGPathVerb::Cubic);
+	coords.insert(coords.end(), { x1, y1, x2, y2, x, y });
+}
+
+void SVGPathData::arc_to(float rx, float ry, float x_axis_rotation, bool large_arc, bool sweep, float x, float y) {
+	verbs.push_back(SVGPathVerb::Arc);
+	coords.insert(coords.end(), { rx, ry, x_axis_rotation, large_arc ? 1.0f : 0.0f, sweep ? 1.0f : 0.0f, x, y });
+}
+
+void SVGPathData::close() {
+	verbs.push_back(SVGPathVerb::Close);
+}
+
+bool SVGPathData::parse(std::string_view pathData) {
+	clear();
+
+	//SVG spec is very leinent on path syntax. White spaces are
+	//entirely optional. Numbers can either be separated by comma or spaces.
+	//The lexer takes care of all that.
+	SVGPathLexer lexer(pathData);
+	char cmd = 0, last_cmd = 0;
+	bool is_in_figure = false;
+	float current_x = 0.0, current_y = 0.0;
+	float start_x = 0.0, start_y = 0.0;
+	float last_ctrl_x = 0.0, last_ctrl_y = 0.0;
+
+	while (!lexer.at_end()) {
+		//Read command letter
+		if (!lexer.read_command(cmd)) {
+			//As per the SVG spec deduce the command from the last command
+			if (last_cmd == 0 || last_cmd == 'Z' || last_cmd == 'z') {
+				//Numbers without a command
+				return false;
+			}
+			else if (last_cmd == 'M') {
+				//Subsequent moveto pairs are treated as lineto commands
+				cmd = 'L';
+			}
+			else if (last_cmd == 'm') {
+				//Subsequent moveto pairs are treated as lineto commands
+				cmd = 'l';
+			}
+			else {
+				//Continue with the last command
+				cmd = last_cmd;
+			}
+		}
+
+		if (last_cmd == 0 && cmd != 'M' && cmd != 'm') {
+			//Path data must begin with a moveto
+			return false;
+		}
+
+		bool relative = cmd >= 'a' && cmd <= 'z';
+		float base_x = relative ? current_x : 0.0f;
+		float base_y = relative ? current_y : 0.0f;
+
+		if (cmd != 'M' && cmd != 'm' && cmd != 'Z' && cmd != 'z' && !is_in_figure) {
+			//Drawing after a closepath starts a new subpath at the current point
+			move_to(current_x, current_y);
+			is_in_figure = true;
+		}
+
+		switch (cmd) {
+		case 'M':
+		case 'm': {
+			float x, y;
+
+			if (!lexer.read_number(x) || !lexer.read_number(y)) {
+				return false;
+			}
+
+			current_x = start_x = base_x + x;
+			current_y = start_y = base_y + y;
+
+			move_to(current_x, current_y);
+			is_in_figure = true;
+
+			break;
+		}
+		case 'L':
+		case 'l': {
+			float x, y;
+
+			if (!lexer.read_number(x) || !lexer.read_number(y)) {
+				return false;
+			}
+
+			current_x = base_x + x;
+			current_y = base_y + y;
+
+			line_to(current_x, current_y);
+
+			break;
+		}
+		case 'H':
+		case 'h': {
+			float x;
+
+			if (!lexer.read_number(x)) {
+				return false;
+			}
+
+			current_x = base_x + x;
+
+			line_to(current_x, current_y);
+
+			break;
+		}
+		case 'V':
+		case 'v': {
+			float y;
+
+			if (!lexer.read_number(y)) {
+				return false;
+			}
+
+			current_y = base_y + y;
+
+			line_to(current_x, current_y);
+
+			break;
+		}
+		case 'Q':
+		case 'q':
+		case 'T':
+		case 't': {
+			float x1, y1, x, y;
+
+			if (cmd == 'Q' || cmd == 'q') {
+				if (!lexer.read_number(x1) || !lexer.read_number(y1)) {
+					return false;
+				}
+
+				x1 += base_x;
+				y1 += base_y;
+			}
+			else if (last_cmd == 'Q' || last_cmd == 'T' || last_cmd == 'q' || last_cmd == 't') {
+				//Calculate the control point by reflecting the last control point
+				x1 = 2 * current_x - last_ctrl_x;
+				y1 = 2 * current_y - last_ctrl_y;
+			}
+			else {
+				x1 = current_x;
+				y1 = current_y;
+			}
+
+			if (!lexer.read_number(x) || !lexer.read_number(y)) {
+				return false;
+			}
+
+			current_x = base_x + x;
+			current_y = base_y + y;
+			last_ctrl_x = x1;
+			last_ctrl_y = y1;
+
+			quad_to(x1, y1, current_x, current_y);
+
+			break;
+		}
+		case 'C':
+		case 'c':
+		case 'S':
+		case 's': {
+			float x1, y1, x2, y2, x, y;
+
+			if (cmd == 'C' || cmd == 'c') {
+				if (!lexer.read_number(x1) || !lexer.read_number(y1)) {
+					return false;
+				}
+
+				x1 += base_x;
+				y1 += base_y;
+			}
+			else if (last_cmd == 'C' || last_cmd == 'S' || last_cmd == 'c' || last_cmd == 's') {
+				//Calculate the first control point by reflecting the last control point
+				x1 = 2 * current_x - last_ctrl_x;
+				y1 = 2 * current_y - last_ctrl_y;
+			}
+			else {
+				x1 = current_x;
+				y1 = current_y;
+			}
+
+			if (!lexer.read_number(x2) || !lexer.read_number(y2) ||
+				!lexer.read_number(x) || !lexer.read_number(y)) {
+				return false;
+			}
+
+			x2 += base_x;
+			y2 += base_y;
+			current_x = base_x + x;
+			current_y = base_y + y;
+			last_ctrl_x = x2;
+			last_ctrl_y = y2;
+
+			cubic_to(x1, y1, x2, y2, current_x, current_y);
+
+			break;
+		}
+		case 'A':
+		case 'a': {
+			float rx, ry, x_axis_rotation, x, y;
+			bool large_arc_flag, sweep_flag;
+
+			//Flags are single digits and may be written without separators
+			if (!lexer.read_number(rx) || !lexer.read_number(ry) || !lexer.read_number(x_axis_rotation) ||
+				!lexer.read_flag(large_arc_flag) || !lexer.read_flag(sweep_flag) ||
+				!lexer.read_number(x) || !lexer.read_number(y)) {
+				return false;
+			}
+
+			current_x = base_x + x;
+			current_y = base_y + y;
+
+			arc_to(rx, ry, x_axis_rotation, large_arc_flag, sweep_flag, current_x, current_y);
+
+			break;
+		}
+		case 'Z':
+		case 'z':
+			//Close the current figure. The current point goes back to the start of the subpath.
+			if (is_in_figure) {
+				close();
+				is_in_figure = false;
+			}
+
+			current_x = start_x;
+			current_y = start_y;
+
+			break;
+		}
+
+		last_cmd = cmd;
+	}
+
+	return true;
+}
+
+//Parameters in (0, 1) where a cubic with these coordinates on one axis turns.
+//Returns how many were written.
+static int cubic_extrema(float p0, float p1, float p2, float p3, float t[2]) {
+	//The derivative over 3 is a t^2 + b t + c
+	double a = -static_cast<double>(p0) + 3.0 * p1 - 3.0 * p2 + p3;
+	double b = 2.0 * (static_cast<double>(p0) - 2.0 * p1 + p2);
+	double c = static_cast<double>(p1) - p0;
+	double roots[2];
+	int count = 0;
+
+	if (std::fabs(a) < 1e-12) {
+		if (b != 0.0) {
+			roots[count++] = -c / b;
+		}
+	}
+	else {
+		double d = b * b - 4.0 * a * c;
+
+		if (d >= 0.0) {
+			double q = std::sqrt(d);
+
+			roots[count++] = (-b + q) / (2.0 * a);
+			roots[count++] = (-b - q) / (2.0 * a);
+		}
+	}
+
+	int found = 0;
+
+	for (int i = 0; i < count; ++i) {
+		if (roots[i] > 0.0 && roots[i] < 1.0) {
+			t[found++] = static_cast<float>(roots[i]);
+		}
+	}
+
+	return found;
+}
+
+static float cubic_at(float p0, float p1, float p2, float p3, float t) {
+	float u = 1.0f - t;
+
+	return u * u * u * p0 + 3.0f * u * u * t * p1 + 3.0f * u * t * t * p2 + t * t * t * p3;
+}
+
+bool svg_path_bounds(const SVGPathView& path, SVGRect& bounds) {
+	bool found = false;
+	SVGPoint last, start;
+
+	auto add_point = [&bounds, &found](float x, float y) {
+		if (!found) {
+			bounds = SVGRect{ x, y, x, y };
+			found = true;
+
+			return;
+		}
+
+		bounds.left = std::fmin(bounds.left, x);
+		bounds.top = std::fmin(bounds.top, y);
+		bounds.right = std::fmax(bounds.right, x);
+		bounds.bottom = std::fmax(bounds.bottom, y);
+	};
+
+	//The end point and every point where the curve turns on either axis
+	auto add_cubic = [&add_point](SVGPoint p0, SVGPoint p1, SVGPoint p2, SVGPoint p3) {
+		float t[2];
+		int count = cubic_extrema(p0.x, p1.x, p2.x, p3.x, t);
+
+		for (int i = 0; i < count; ++i) {
+			add_point(cubic_at(p0.x, p1.x, p2.x, p3.x, t[i]), cubic_at(p0.y, p1.y, p2.y, p3.y, t[i]));
+		}
+
+		count = cubic_extrema(p0.y, p1.y, p2.y, p3.y, t);
+
+		for (int i = 0; i < count; ++i) {
+			add_point(cubic_at(p0.x, p1.x, p2.x, p3.x, t[i]), cubic_at(p0.y, p1.y, p2.y, p3.y, t[i]));
+		}
+
+		add_point(p3.x, p3.y);
+	};
+
+	path.for_each([&](SVGPathVerb verb, const float* c) {
+		switch (verb) {
+		case SVGPathVerb::Move:
+			add_point(c[0], c[1]);
+			last = start = SVGPoint{ c[0], c[1] };
+
+			break;
+		case SVGPathVerb::Line:
+			add_point(c[0], c[1]);
+			last = SVGPoint{ c[0], c[1] };
+
+			break;
+		case SVGPathVerb::Quad: {
+			//Raised to the cubic it is
+			SVGPoint q{ c[0], c[1] }, end{ c[2], c[3] };
+
+			add_cubic(last,
+				SVGPoint{ last.x + (q.x - last.x) * (2.0f / 3.0f), last.y + (q.y - last.y) * (2.0f / 3.0f) },
+				SVGPoint{ end.x + (q.x - end.x) * (2.0f / 3.0f), end.y + (q.y - end.y) * (2.0f / 3.0f) },
+				end);
+			last = end;
+
+			break;
+		}
+		case SVGPathVerb::Cubic:
+			add_cubic(last, SVGPoint{ c[0], c[1] }, SVGPoint{ c[2], c[3] }, SVGPoint{ c[4], c[5] });
+			last = SVGPoint{ c[4], c[5] };
+
+			break;
+		case SVGPathVerb::Arc: {
+			//The cubics every renderer draws the arc with
+			SVGArcCenter arc;
+			SVGPoint end{ c[5], c[6] };
+
+			if (svg_arc_center(last, c, arc)) {
+				SVGPoint p[12];
+				int count = svg_arc_to_cubics(arc, p);
+				SVGPoint from = last;
+
+				p[count * 3 - 1] = end;
+
+				for (int i = 0; i < count; ++i) {
+					add_cubic(from, p[i * 3], p[i * 3 + 1], p[i * 3 + 2]);
+					from = p[i * 3 + 2];
+				}
+			}
+
+			add_point(end.x, end.y);
+			last = end;
+
+			break;
+		}
+		case SVGPathVerb::Close:
+			last = start;
+
+			break;
+		}
+	});
+
+	return found;
+}
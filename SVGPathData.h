@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "SVGTransform.h"
+
+//Path commands after normalization. Relative commands, H/V lines and
+//smooth curve reflections are all resolved to absolute coordinates.
+enum class SVGPathVerb : uint8_t {
+	Move,	//x y
+	Line,	//x y
+	Quad,	//x1 y1 x y
+	Cubic,	//x1 y1 x2 y2 x y
+	Arc,	//rx ry x_axis_rotation large_arc_flag sweep_flag x y
+	Close
+};
+
+//Number of coordinates that follow a verb
+inline size_t svg_path_coord_count(SVGPathVerb verb) {
+	static const uint8_t counts[] = { 2, 2, 4, 6, 7, 0 };
+
+	return counts[static_cast<size_t>(verb)];
+}
+
+//Read only path data that lives in someone else's storage, like an SVGDocument
+struct SVGPathView {
+	const SVGPathVerb* verbs = nullptr;
+	size_t verb_count = 0;
+	const float* coords = nullptr;
+
+	bool empty() const {
+		return verb_count == 0;
+	}
+
+	//Calls visitor(verb, const float* coords) for each command in order
+	template <typename Visitor>
+	void for_each(Visitor&& visitor) const {
+		const float* c = coords;
+
+		for (size_t i = 0; i < verb_count; ++i) {
+			visitor(verbs[i], c);
+			c += svg_path_coord_count(verbs[i]);
+		}
+	}
+};
+
+//Bounding box of a path, with curves bounded where they turn rather than by their
+//control points. Arcs are bounded as the cubics they are drawn with. Returns false
+//for an empty path.
+bool svg_path_bounds(const SVGPathView& path, SVGRect& bounds);
+
+//Compact, backend independent representation of a path.
+//Verbs are stored as a byte array and all coordinates in one contiguous float array.
+struct SVGPathData {
+	std::vector<SVGPathVerb> verbs;
+	std::vector<float> coords;
+
+	static size_t coord_count(SVGPathVerb verb) {
+		return svg_path_coord_count(verb);
+	}
+
+	bool empty() const {
+		return verbs.empty();
+	}
+
+	void clear() {
+		verbs.clear();
+		coords.clear();
+	}
+
+	void move_to(float x, float y);
+	void line_to(float x, float y);
+	void quad_to(float x1, float y1, float x, float y);
+	void cubic_to(float x1, float y1, float x2, float y2, float x, float y);
+	void arc_to(float rx, float ry, float x_axis_rotation, bool large_arc, bool sweep, float x, float y);
+	void close();
+
+	//Parses SVG path data. As per the spec, everything up to the first error is kept.
+	//Returns false if an error was found.
+	bool parse(std::string_view pathData);
+
+	SVGPathView view() const {
+		return SVGPathView{ verbs.data(), verbs.size(), coords.data() };
+	}
+
+	//Calls visitor(verb, const float* coords) for each command in order
+	template <typename Visitor>
+	void for_each(Visitor&& visitor) const {
+		const float* c = coords.data();
+
+		for (SVGPathVerb verb : verbs) {
+			visitor(verb, c);
+			c += coord_count(verb);
+		}
+	}
+};
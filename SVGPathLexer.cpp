@@ -0,0 +1,330 @@
+#include "SVGPathLexer.h"
+#include <charconv>
+#include <cfloat>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SVG_PATH_LEXER_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+enum : uint8_t {
+	CHAR_OTHER = 0,
+	CHAR_SEPARATOR = 1,
+	CHAR_DIGIT = 2,
+	CHAR_SIGN = 4,
+	CHAR_DOT = 8,
+	CHAR_EXPONENT = 16,
+	CHAR_COMMAND = 32
+};
+
+struct CharClassTable {
+	uint8_t classes[256] = {};
+
+	constexpr CharClassTable() {
+		classes[static_cast<uint8_t>(' ')] = CHAR_SEPARATOR;
+		classes[static_cast<uint8_t>('\t')] = CHAR_SEPARATOR;
+		classes[static_cast<uint8_t>('\r')] = CHAR_SEPARATOR;
+		classes[static_cast<uint8_t>('\n')] = CHAR_SEPARATOR;
+		classes[static_cast<uint8_t>('\f')] = CHAR_SEPARATOR;
+		classes[static_cast<uint8_t>(',')] = CHAR_SEPARATOR;
+
+		for (char ch = '0'; ch <= '9'; ++ch) {
+			classes[static_cast<uint8_t>(ch)] = CHAR_DIGIT;
+		}
+
+		classes[static_cast<uint8_t>('+')] = CHAR_SIGN;
+		classes[static_cast<uint8_t>('-')] = CHAR_SIGN;
+		classes[static_cast<uint8_t>('.')] = CHAR_DOT;
+		classes[static_cast<uint8_t>('e')] = CHAR_EXPONENT;
+		classes[static_cast<uint8_t>('E')] = CHAR_EXPONENT;
+
+		const char commands[] = "MmLlHhVvQqTtCcSsAaZz";
+
+		for (size_t i = 0; commands[i] != 0; ++i) {
+			classes[static_cast<uint8_t>(commands[i])] = CHAR_COMMAND;
+		}
+	}
+};
+
+static constexpr CharClassTable char_table;
+
+static inline uint8_t char_class(char ch) {
+	return char_table.classes[static_cast<uint8_t>(ch)];
+}
+
+#ifdef SVG_PATH_LEXER_SSE2
+
+static inline unsigned int first_set_bit(unsigned int mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+
+	_BitScanForward(&index, mask);
+
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+//Bit i is set if byte i of the block is a separator
+static inline unsigned int separator_mask(__m128i block) {
+	__m128i sep = _mm_or_si128(
+		_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8(','))),
+		_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+
+	sep = _mm_or_si128(sep, _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\f'))));
+
+	return static_cast<unsigned int>(_mm_movemask_epi8(sep));
+}
+
+//Bit i is set if byte i of the block is an ASCII digit
+static inline unsigned int digit_mask(__m128i block) {
+	//Shift the range '0'..'9' down to -128..-119 so that a single signed compare works
+	__m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('0' - 128));
+	__m128i is_digit = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 10));
+
+	return static_cast<unsigned int>(_mm_movemask_epi8(is_digit));
+}
+
+#endif
+
+void SVGPathLexer::skip_separators() {
+	if (pos >= source.size() || char_class(source[pos]) != CHAR_SEPARATOR) {
+		//Common case, most tokens are separated by a single character or none
+		return;
+	}
+
+	++pos;
+
+#ifdef SVG_PATH_LEXER_SSE2
+	while (pos + 16 <= source.size()) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.data() + pos));
+		unsigned int non_separators = ~separator_mask(block) & 0xFFFF;
+
+		if (non_separators != 0) {
+			pos += first_set_bit(non_separators);
+
+			return;
+		}
+
+		pos += 16;
+	}
+#endif
+
+	while (pos < source.size() && char_class(source[pos]) == CHAR_SEPARATOR) {
+		++pos;
+	}
+}
+
+//Returns the position of the first non digit at or after from
+static size_t skip_digits(std::string_view source, size_t from) {
+#ifdef SVG_PATH_LEXER_SSE2
+	while (from + 16 <= source.size()) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.data() + from));
+		unsigned int non_digits = ~digit_mask(block) & 0xFFFF;
+
+		if (non_digits != 0) {
+			return from + first_set_bit(non_digits);
+		}
+
+		from += 16;
+	}
+#endif
+
+	while (from < source.size() && char_class(source[from]) == CHAR_DIGIT) {
+		++from;
+	}
+
+	return from;
+}
+
+//Accumulates the digits in source[from, to) into the mantissa.
+//Digits that do not fit are dropped and accounted for in the returned exponent adjustment.
+static int accumulate_digits(std::string_view source, size_t from, size_t to, uint64_t& mantissa, int& mantissa_digits, bool is_fraction) {
+	int exponent_adjust = 0;
+
+	for (size_t i = from; i < to; ++i) {
+		if (mantissa_digits < 19) {
+			//Leading zeros are not significant
+			if (mantissa != 0 || source[i] != '0') {
+				mantissa = mantissa * 10 + (source[i] - '0');
+				++mantissa_digits;
+			}
+
+			if (is_fraction) {
+				--exponent_adjust;
+			}
+		}
+		else {
+			mantissa_digits = 20;
+
+			if (!is_fraction) {
+				++exponent_adjust;
+			}
+		}
+	}
+
+	return exponent_adjust;
+}
+
+bool SVGPathLexer::at_end() {
+	skip_separators();
+
+	return pos >= source.size();
+}
+
+bool SVGPathLexer::read_command(char& cmd) {
+	skip_separators();
+
+	if (pos >= source.size() || char_class(source[pos]) != CHAR_COMMAND) {
+		return false;
+	}
+
+	cmd = source[pos++];
+
+	return true;
+}
+
+bool SVGPathLexer::read_flag(bool& value) {
+	skip_separators();
+
+	if (pos >= source.size() || (source[pos] != '0' && source[pos] != '1')) {
+		return false;
+	}
+
+	value = source[pos++] == '1';
+
+	return true;
+}
+
+static const float float_powers_of_10[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+//Numbers scanned from the path are converted here. Small mantissas with small
+//exponents are computed exactly with a single rounding (Clinger's fast path),
+//everything else goes through std::from_chars. Either way the result is the
+//correctly rounded float, same as from_chars would give.
+static bool convert_number(const char* start, const char* end, bool negative,
+	uint64_t mantissa, int mantissa_digits, int exponent, float& value) {
+	if (mantissa_digits <= 19 && mantissa <= (uint64_t(1) << 24) && exponent >= -10 && exponent <= 10) {
+		float f = static_cast<float>(mantissa);
+
+		if (exponent < 0) {
+			f /= float_powers_of_10[-exponent];
+		}
+		else {
+			f *= float_powers_of_10[exponent];
+		}
+
+		value = negative ? -f : f;
+
+		return true;
+	}
+
+	if (*start == '+') {
+		//from_chars does not accept a leading plus sign
+		++start;
+	}
+
+	auto result = std::from_chars(start, end, value);
+
+	if (result.ec == std::errc::result_out_of_range) {
+		//Too small becomes zero, too large becomes the largest float
+		value = exponent < 0 ? 0.0f : FLT_MAX;
+		value = negative ? -value : value;
+
+		return true;
+	}
+
+	return result.ec == std::errc() && result.ptr == end;
+}
+
+bool SVGPathLexer::read_number(float& value) {
+	skip_separators();
+
+	size_t consumed = svg_parse_number(source.substr(pos), value);
+
+	if (consumed == 0) {
+		return false;
+	}
+
+	pos += consumed;
+
+	return true;
+}
+
+size_t svg_parse_number(std::string_view source, float& value) {
+	size_t i = 0;
+	size_t size = source.size();
+	bool negative = false;
+
+	if (i < size && char_class(source[i]) == CHAR_SIGN) {
+		negative = source[i] == '-';
+		++i;
+	}
+
+	uint64_t mantissa = 0;
+	int mantissa_digits = 0;
+	int exponent = 0;
+	bool has_digits = false;
+
+	//Integer part
+	size_t integer_end = skip_digits(source, i);
+
+	exponent += accumulate_digits(source, i, integer_end, mantissa, mantissa_digits, false);
+	has_digits = integer_end > i;
+	i = integer_end;
+
+	//Fraction part. A second '.' ends the number, so "1.5.5" is two numbers.
+	if (i < size && source[i] == '.') {
+		++i;
+
+		size_t fraction_end = skip_digits(source, i);
+
+		exponent += accumulate_digits(source, i, fraction_end, mantissa, mantissa_digits, true);
+		has_digits = has_digits || fraction_end > i;
+		i = fraction_end;
+	}
+
+	if (!has_digits) {
+		return 0;
+	}
+
+	//Exponent. Only consumed if followed by digits, so a stray 'e' is left alone.
+	if (i < size && char_class(source[i]) == CHAR_EXPONENT) {
+		size_t j = i + 1;
+		bool exp_negative = false;
+
+		if (j < size && char_class(source[j]) == CHAR_SIGN) {
+			exp_negative = source[j] == '-';
+			++j;
+		}
+
+		if (j < size && char_class(source[j]) == CHAR_DIGIT) {
+			int exp_value = 0;
+
+			while (j < size && char_class(source[j]) == CHAR_DIGIT) {
+				if (exp_value < 10000) {
+					exp_value = exp_value * 10 + (source[j] - '0');
+				}
+
+				++j;
+			}
+
+			exponent += exp_negative ? -exp_value : exp_value;
+			i = j;
+		}
+	}
+
+	if (!convert_number(source.data(), source.data() + i, negative, mantissa, mantissa_digits, exponent, value)) {
+		return 0;
+	}
+
+	return i;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+//Allocation free lexer for SVG path data (the "d" attribute).
+//
+//Implements the number grammar from the SVG spec, including the
+//short forms that trip up stream based parsing:
+//  - Numbers may start with a sign or a decimal point: "-.5"
+//  - Separators are optional when unambiguous: "1.5.5" is 1.5 and .5,
+//    "10-20" is 10 and -20
+//  - Arc flags are a single digit and need no separator: "a1 1 0 00 1 1"
+//
+//Runs of separators and digits are classified 16 bytes at a time with SSE2 where available.
+class SVGPathLexer {
+public:
+	explicit SVGPathLexer(std::string_view source) : source(source) {}
+
+	//Skips separators and returns true if there is nothing left to read
+	bool at_end();
+
+	//Reads a command letter at the current position. Returns false, without
+	//consuming anything, if the next token is not a command.
+	bool read_command(char& cmd);
+
+	//Reads a number. Returns false if there is no valid number at the current position.
+	bool read_number(float& value);
+
+	//Reads an arc flag, which must be a single '0' or '1'
+	bool read_flag(bool& value);
+
+	size_t offset() const {
+		return pos;
+	}
+
+private:
+	std::string_view source;
+	size_t pos = 0;
+
+	void skip_separators();
+};
+
+//Parses a number using the SVG grammar from the start of source.
+//On success returns the number of bytes consumed, otherwise 0.
+size_t svg_parse_number(std::string_view source, float& value);
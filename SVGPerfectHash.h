@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//Hash used by the compile time lookup tables for keywords, attribute and tag names.
+//Bytes are ASCII lower cased (c | 0x20) before hashing so that tables can serve
+//case insensitive lookups. Case sensitive tables simply compare exactly afterwards.
+constexpr uint32_t svg_name_hash(std::string_view s, uint32_t seed) {
+	uint32_t h = 2166136261u ^ seed;
+
+	for (char ch : s) {
+		h ^= static_cast<uint8_t>(ch) | 0x20u;
+		h *= 16777619u;
+	}
+
+	//Final mix so that the top bits, which are used as the slot index, depend on every byte
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+
+	return h;
+}
+
+//Perfect hash table built at compile time. Every key maps to its own slot, so a
+//lookup is one hash, one table read and one string compare.
+//
+//The seed is found offline. If the static_assert on is_perfect() fires after the
+//key list changes, try other seeds until it passes.
+template <size_t N, unsigned TableBits>
+struct SVGPerfectHashTable {
+	static constexpr size_t table_size = size_t(1) << TableBits;
+
+	uint16_t slots[table_size] = {};	//Key index + 1, 0 means empty
+	uint32_t seed = 0;
+	bool perfect = true;
+
+	constexpr SVGPerfectHashTable(const std::string_view (&keys)[N], uint32_t _seed) : seed(_seed) {
+		for (size_t i = 0; i < N; ++i) {
+			size_t slot = slot_of(keys[i]);
+
+			if (slots[slot] != 0) {
+				perfect = false;
+			}
+
+			slots[slot] = static_cast<uint16_t>(i + 1);
+		}
+	}
+
+	constexpr size_t slot_of(std::string_view s) const {
+		return svg_name_hash(s, seed) >> (32 - TableBits);
+	}
+
+	constexpr bool is_perfect() const {
+		return perfect;
+	}
+
+	//Returns the index of the only key that can match s, or -1.
+	//The caller must still compare s with that key.
+	constexpr int candidate(std::string_view s) const {
+		return static_cast<int>(slots[slot_of(s)]) - 1;
+	}
+};
+
+constexpr bool svg_equals_ignore_case(std::string_view a, std::string_view b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < a.size(); ++i) {
+		char ca = a[i], cb = b[i];
+
+		if (ca >= 'A' && ca <= 'Z') {
+			ca = static_cast<char>(ca + ('a' - 'A'));
+		}
+
+		if (cb >= 'A' && cb <= 'Z') {
+			cb = static_cast<char>(cb + ('a' - 'A'));
+		}
+
+		if (ca != cb) {
+			return false;
+		}
+	}
+
+	return true;
+}
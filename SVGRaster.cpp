@@ -0,0 +1,607 @@
+#include "SVGRaster.h"
+#include "SVGBlend.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#ifdef SVG_X86
+#include <immintrin.h>
+#endif
+
+//x / 255 rounded, exact for every x up to 255 * 255
+static inline uint32_t div255(uint32_t x) {
+	x += 128;
+
+	return (x + (x >> 8)) >> 8;
+}
+
+//Device coordinates are clipped to +-2^24 pixels. Every pixel index, and the
+//difference of two, then fits an int, and the band is far wider than any bitmap.
+static const float guard_band = 16777216.0f;
+
+//Unpremultiplied 0xRRGGBBAA times opacity to premultiplied bytes in memory order
+static void premultiply(uint32_t rgba, float opacity, uint8_t out[4]) {
+	float alpha = static_cast<float>(rgba & 0xFF) * std::fmin(std::fmax(opacity, 0.0f), 1.0f);
+	uint32_t a = static_cast<uint32_t>(alpha + 0.5f);
+
+	out[0] = static_cast<uint8_t>(div255((rgba >> 24) * a));
+	out[1] = static_cast<uint8_t>(div255(((rgba >> 16) & 0xFF) * a));
+	out[2] = static_cast<uint8_t>(div255(((rgba >> 8) & 0xFF) * a));
+	out[3] = static_cast<uint8_t>(a);
+}
+
+float svg_quality_tolerance(SVGRenderQuality quality) {
+	switch (quality) {
+	case SVGRenderQuality::Aliased:
+		return 0.5f;
+	case SVGRenderQuality::High:
+		return 0.05f;
+	default:
+		return 0.1f;
+	}
+}
+
+void SVGBitmap::resize(int w, int h) {
+	width = std::max(w, 0);
+	height = std::max(h, 0);
+	pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+}
+
+void SVGBitmap::clear(uint32_t rgba) {
+	uint8_t color[4];
+
+	premultiply(rgba, 1.0f, color);
+
+	for (size_t i = 0; i < pixels.size(); i += 4) {
+		std::memcpy(pixels.data() + i, color, 4);
+	}
+}
+
+//Coverage kernels. Each turns count cells (a multiple of 8) into coverage bytes,
+//starting from carry, the sum of the cells before them.
+//
+//The prefix sum runs in blocks of 4: within a block x += x shifted by one, then
+//by two, then the running total is added. The scalar and AVX2 versions add in
+//exactly that order too, so every kernel rounds the same way.
+
+static inline float fold_scalar(float sum, SVGFillRule rule) {
+	float a = std::fabs(sum);
+
+	if (rule == SVGFillRule::EvenOdd) {
+		float t = a - static_cast<float>(static_cast<int>(a * 0.5f)) * 2.0f;
+
+		a = 1.0f - std::fabs(t - 1.0f);
+	}
+
+	return a < 1.0f ? a : 1.0f;
+}
+
+//Running total after count cells, added in the same order as the kernels
+static float prefix_carry(const float* cells, int count) {
+	float carry = 0.0f;
+
+	for (int i = 0; i < count; i += 4) {
+		const float* a = cells + i;
+
+		carry = ((a[3] + a[2]) + (a[1] + a[0])) + carry;
+	}
+
+	return carry;
+}
+
+static void coverage_scalar(const float* cells, uint8_t* coverage, int count, SVGFillRule rule, float carry) {
+	for (int i = 0; i < count; i += 4) {
+		const float* a = cells + i;
+		float b0 = a[0], b1 = a[1] + a[0], b2 = a[2] + a[1], b3 = a[3] + a[2];
+		float s[4] = { b0 + carry, b1 + carry, (b2 + b0) + carry, (b3 + b1) + carry };
+
+		carry = s[3];
+
+		for (int k = 0; k < 4; ++k) {
+			coverage[i + k] = static_cast<uint8_t>(static_cast<int>(fold_scalar(s[k], rule) * 255.0f + 0.5f));
+		}
+	}
+}
+
+#ifdef SVG_X86
+
+SVG_TARGET_SSE2
+static inline __m128 fold_sse2(__m128 sum, SVGFillRule rule) {
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 a = _mm_andnot_ps(sign, sum);
+
+	if (rule == SVGFillRule::EvenOdd) {
+		__m128 whole = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(a, _mm_set1_ps(0.5f))));
+		__m128 t = _mm_sub_ps(a, _mm_mul_ps(whole, _mm_set1_ps(2.0f)));
+
+		a = _mm_sub_ps(one, _mm_andnot_ps(sign, _mm_sub_ps(t, one)));
+	}
+
+	return _mm_min_ps(a, one);
+}
+
+SVG_TARGET_SSE2
+static inline __m128i quantize_sse2(__m128 c) {
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+SVG_TARGET_SSE2
+static inline __m128 prefix_sse2(__m128 x) {
+	x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+
+	return _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+}
+
+SVG_TARGET_SSE2
+static void coverage_sse2(const float* cells, uint8_t* coverage, int count, SVGFillRule rule, float total) {
+	__m128 carry = _mm_set1_ps(total);
+
+	for (int i = 0; i < count; i += 8) {
+		__m128 lo = _mm_add_ps(prefix_sse2(_mm_loadu_ps(cells + i)), carry);
+		__m128 hi = _mm_add_ps(prefix_sse2(_mm_loadu_ps(cells + i + 4)), _mm_shuffle_ps(lo, lo, 0xFF));
+
+		carry = _mm_shuffle_ps(hi, hi, 0xFF);
+
+		__m128i words = _mm_packs_epi32(quantize_sse2(fold_sse2(lo, rule)), quantize_sse2(fold_sse2(hi, rule)));
+
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(coverage + i), _mm_packus_epi16(words, words));
+	}
+}
+
+SVG_TARGET_AVX2
+static inline __m256 fold_avx2(__m256 sum, SVGFillRule rule) {
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256 a = _mm256_andnot_ps(sign, sum);
+
+	if (rule == SVGFillRule::EvenOdd) {
+		__m256 whole = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(a, _mm256_set1_ps(0.5f))));
+		__m256 t = _mm256_sub_ps(a, _mm256_mul_ps(whole, _mm256_set1_ps(2.0f)));
+
+		a = _mm256_sub_ps(one, _mm256_andnot_ps(sign, _mm256_sub_ps(t, one)));
+	}
+
+	return _mm256_min_ps(a, one);
+}
+
+SVG_TARGET_AVX2
+static void coverage_avx2(const float* cells, uint8_t* coverage, int count, SVGFillRule rule, float total) {
+	__m128 carry = _mm_set1_ps(total);
+
+	for (int i = 0; i < count; i += 8) {
+		//The shifts work within each 128 bit half, which gives the two blocks of 4
+		__m256 x = _mm256_loadu_ps(cells + i);
+
+		x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+		x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 8)));
+
+		__m128 lo = _mm_add_ps(_mm256_castps256_ps128(x), carry);
+		__m128 hi = _mm_add_ps(_mm256_extractf128_ps(x, 1), _mm_shuffle_ps(lo, lo, 0xFF));
+
+		carry = _mm_shuffle_ps(hi, hi, 0xFF);
+
+		__m256 c = fold_avx2(_mm256_set_m128(hi, lo), rule);
+		__m256i q = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(c, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+		__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(coverage + i), _mm_packus_epi16(words, words));
+	}
+}
+
+#endif
+
+void SVGRasterizer::clear() {
+	edges.clear();
+	in_figure = false;
+}
+
+SVGPixelRect SVGRasterizer::bounds() const {
+	if (edges.empty()) {
+		return SVGPixelRect();
+	}
+
+	return SVGPixelRect{
+		static_cast<int>(std::floor(min_x)),
+		static_cast<int>(std::floor(min_y)),
+		static_cast<int>(std::ceil(max_x)),
+		static_cast<int>(std::ceil(max_y))
+	};
+}
+
+void SVGRasterizer::move_to(SVGPoint p) {
+	close_figure();
+
+	figure_start = p;
+	current = p;
+	in_figure = true;
+}
+
+void SVGRasterizer::line_to(SVGPoint p) {
+	SVGPoint from = current;
+
+	current = p;
+
+	if (from.y == p.y || !std::isfinite(from.x + from.y + p.x + p.y)) {
+		//Flat edges add no area
+		return;
+	}
+
+	if (std::fmax(std::fabs(from.x), std::fabs(p.x)) <= guard_band && std::fmax(std::fabs(from.y), std::fabs(p.y)) <= guard_band) {
+		add_edge(from, p);
+	}
+	else {
+		add_clipped_edge(from, p);
+	}
+}
+
+//Clips an edge to the guard band, so that pixel indices fit an int. Parts above or
+//below it cover no row of any bitmap. Parts left or right of it wind the rows they
+//span like a vertical edge on its border would, so they are replaced by one, which
+//keeps the coverage of every pixel inside.
+void SVGRasterizer::add_clipped_edge(SVGPoint from, SVGPoint to) {
+	const double band = guard_band;
+	double x0 = from.x, y0 = from.y, x1 = to.x, y1 = to.y;
+
+	if ((y0 < -band && y1 < -band) || (y0 > band && y1 > band)) {
+		return;
+	}
+
+	//Ends moved along the edge onto the top and bottom of the band. Interpolated
+	//from the coordinates, not a parameter, which would lose the band next to 1e30.
+	double slope = (x1 - x0) / (y1 - y0);
+	double ya = std::fmin(std::fmax(y0, -band), band), yb = std::fmin(std::fmax(y1, -band), band);
+	double xa = ya != y0 ? x0 + (ya - y0) * slope : x0, xb = yb != y1 ? x1 + (yb - y1) * slope : x1;
+	//The edge split where it crosses the sides, in order from a to b
+	double xs[4] = { xa }, ys[4] = { ya };
+	int count = 1;
+	double sides[2] = { -band, band };
+
+	if (xb < xa) {
+		std::swap(sides[0], sides[1]);
+	}
+
+	for (double side : sides) {
+		if ((xa < side && side < xb) || (xb < side && side < xa)) {
+			xs[count] = side;
+			ys[count++] = ya + (side - xa) * (yb - ya) / (xb - xa);
+		}
+	}
+
+	xs[count] = xb;
+	ys[count++] = yb;
+
+	for (int i = 0; i + 1 < count; ++i) {
+		double middle = 0.5 * (xs[i] + xs[i + 1]);
+		SVGPoint a{ static_cast<float>(xs[i]), static_cast<float>(ys[i]) };
+		SVGPoint b{ static_cast<float>(xs[i + 1]), static_cast<float>(ys[i + 1]) };
+
+		if (middle < -band || middle > band) {
+			a.x = b.x = middle < 0.0 ? -guard_band : guard_band;
+		}
+
+		//Rounding to float may land a hair outside
+		a.x = std::fmin(std::fmax(a.x, -guard_band), guard_band);
+		b.x = std::fmin(std::fmax(b.x, -guard_band), guard_band);
+		a.y = std::fmin(std::fmax(a.y, -guard_band), guard_band);
+		b.y = std::fmin(std::fmax(b.y, -guard_band), guard_band);
+
+		if (a.y != b.y) {
+			add_edge(a, b);
+		}
+	}
+}
+
+void SVGRasterizer::add_edge(SVGPoint from, SVGPoint to) {
+	SVGEdge edge;
+
+	if (from.y < to.y) {
+		edge = SVGEdge{ from.x, from.y, to.x, to.y, 0.0f, 1.0f };
+	}
+	else {
+		edge = SVGEdge{ to.x, to.y, from.x, from.y, 0.0f, -1.0f };
+	}
+
+	edge.dxdy = (edge.x1 - edge.x0) / (edge.y1 - edge.y0);
+
+	if (edges.empty()) {
+		min_x = max_x = edge.x0;
+		min_y = edge.y0;
+		max_y = edge.y1;
+	}
+
+	min_x = std::fmin(min_x, std::fmin(edge.x0, edge.x1));
+	max_x = std::fmax(max_x, std::fmax(edge.x0, edge.x1));
+	min_y = std::fmin(min_y, edge.y0);
+	max_y = std::fmax(max_y, edge.y1);
+
+	edges.push_back(edge);
+}
+
+void SVGRasterizer::close_figure() {
+	if (in_figure) {
+		line_to(figure_start);
+		in_figure = false;
+	}
+}
+
+void SVGRasterizer::add_polyline(const SVGPolyline& polyline, const SVGMatrix& m) {
+	for (const SVGPolylineFigure& figure : polyline.figures) {
+		const SVGPoint* p = polyline.points.data() + figure.first;
+
+		move_to(svg_transform_point(m, p[0]));
+
+		for (uint32_t i = 1; i < figure.count; ++i) {
+			line_to(svg_transform_point(m, p[i]));
+		}
+	}
+
+	close_figure();
+}
+
+void SVGRasterizer::add_path(const SVGPathView& path, const SVGMatrix& m) {
+	//Flattened straight to device space, where the tolerance is measured
+	flattened.clear();
+	svg_flatten_path(path, m, tolerance, flattened);
+	add_polyline(flattened, SVGMatrix::identity());
+}
+
+void SVGRasterizer::add_rect(float x, float y, float width, float height, const SVGMatrix& m) {
+	move_to(svg_transform_point(m, SVGPoint{ x, y }));
+	line_to(svg_transform_point(m, SVGPoint{ x + width, y }));
+	line_to(svg_transform_point(m, SVGPoint{ x + width, y + height }));
+	line_to(svg_transform_point(m, SVGPoint{ x, y + height }));
+	close_figure();
+}
+
+void SVGRasterizer::add_ellipse(float cx, float cy, float rx, float ry, const SVGMatrix& m) {
+	flattened.clear();
+	svg_flatten_ellipse(cx, cy, rx, ry, m, tolerance, flattened);
+	add_polyline(flattened, SVGMatrix::identity());
+}
+
+//Adds the area of a segment that crosses one row, from x0 to x1 relative to the
+//first cell, with signed height d. Only cells below limit are written, but the
+//values are worked out from the whole segment so they don't depend on limit.
+void SVGRasterizer::add_row_segment(float x0, float x1, float d, int limit) {
+	float* acc = cells.data();
+
+	if (x1 < x0) {
+		std::swap(x0, x1);
+	}
+
+	if (x0 >= static_cast<float>(limit)) {
+		return;
+	}
+
+	if (x1 <= 0.0f) {
+		//Entirely left of the first cell, which winds every pixel of the row
+		acc[0] += d;
+		return;
+	}
+
+	if (x0 < 0.0f) {
+		//Part left of the first cell goes into it in full
+		float t = -x0 / (x1 - x0);
+
+		acc[0] += d * t;
+		d -= d * t;
+		x0 = 0.0f;
+	}
+
+	int x0i = static_cast<int>(x0);
+	int x1i = static_cast<int>(std::ceil(x1));
+
+	if (x1i <= x0i + 1) {
+		//Within one cell
+		float xm = 0.5f * (x0 + x1) - static_cast<float>(x0i);
+
+		acc[x0i] += d - d * xm;
+
+		if (x0i + 1 < limit) {
+			acc[x0i + 1] += d * xm;
+		}
+
+		return;
+	}
+
+	float s = 1.0f / (x1 - x0);
+	float x0f = x0 - static_cast<float>(x0i);
+	float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+	float x1f = x1 - static_cast<float>(x1i) + 1.0f;
+	float am = 0.5f * s * x1f * x1f;
+
+	acc[x0i] += d * a0;
+
+	if (x1i == x0i + 2) {
+		if (x0i + 1 < limit) {
+			acc[x0i + 1] += d * (1.0f - a0 - am);
+		}
+	}
+	else {
+		float a1 = s * (1.5f - x0f);
+
+		if (x0i + 1 < limit) {
+			acc[x0i + 1] += d * (a1 - a0);
+		}
+
+		int end = std::min(x1i - 1, limit);
+
+		for (int xi = x0i + 2; xi < end; ++xi) {
+			acc[xi] += d * s;
+		}
+
+		if (x1i - 1 < limit) {
+			float a2 = a1 + static_cast<float>(x1i - x0i - 3) * s;
+
+			acc[x1i - 1] += d * (1.0f - a2 - am);
+		}
+	}
+
+	if (x1i < limit) {
+		acc[x1i] += d * am;
+	}
+}
+
+void SVGRasterizer::fill(SVGBitmap& target, uint32_t rgba, float opacity, SVGFillRule rule) {
+	fill(target, rgba, opacity, rule, SVGPixelRect{ 0, 0, target.width, target.height });
+}
+
+void SVGRasterizer::fill(SVGBitmap& target, uint32_t rgba, float opacity, SVGFillRule rule, const SVGPixelRect& clip) {
+	SVGPixelRect area = bounds();
+
+	sort_edges();
+	fill(edges.data(), edges.size(), area, target, rgba, opacity, rule, clip);
+}
+
+SVGPixelRect SVGRasterizer::take_edges(std::vector<SVGEdge>& out) {
+	SVGPixelRect area = bounds();
+
+	sort_edges();
+	out.insert(out.end(), edges.begin(), edges.end());
+	clear();
+
+	return area;
+}
+
+//Closes the last figure and puts the edges in the order they start, ties in the
+//order they were added, which is the order fill() walks them in
+void SVGRasterizer::sort_edges() {
+	close_figure();
+
+	std::stable_sort(edges.begin(), edges.end(), [](const SVGEdge& a, const SVGEdge& b) {
+		return a.y0 < b.y0;
+	});
+}
+
+void SVGRasterizer::fill(const SVGEdge* edge_list, size_t edge_count, const SVGPixelRect& area, SVGBitmap& target, uint32_t rgba, float opacity, SVGFillRule rule, const SVGPixelRect& clip) {
+	if (edge_count == 0) {
+		return;
+	}
+
+	uint8_t color[4];
+
+	premultiply(rgba, opacity, color);
+
+	if (color[3] == 0) {
+		return;
+	}
+
+	//Cells start at the left of the geometry whatever the clip, so that
+	//the prefix sum of a pixel always adds the same values in the same order
+	int first = std::max(area.left, 0);
+	int right = std::min({ area.right, clip.right, target.width });
+	int left = std::max(first, clip.left);
+	int top = std::max({ area.top, clip.top, 0 });
+	int bottom = std::min({ area.bottom, clip.bottom, target.height });
+
+	if (left >= right || top >= bottom) {
+		return;
+	}
+
+	int limit = right - first;
+	SVGKernel active_kernel = svg_supported_kernel(kernel);
+	const SVGBlendKernels& blend = svg_blend_kernels(active_kernel);
+	//Room for whole blocks of 8
+	int count = (limit + 7) & ~7;
+	//Whole blocks left of the clip, whose coverage isn't needed
+	int skip = (left - first) & ~7;
+
+	cells.assign(static_cast<size_t>(count), 0.0f);
+	coverage.resize(static_cast<size_t>(count));
+
+	//Edges that cross the rows to draw and start left of the clip's right side,
+	//still in sorted order. The rest never add to a cell that is drawn.
+	float last_row = static_cast<float>(bottom), first_row = static_cast<float>(top);
+	float last_column = static_cast<float>(right);
+
+	order.clear();
+
+	for (uint32_t i = 0; i < edge_count && edge_list[i].y0 < last_row; ++i) {
+		if (edge_list[i].y1 > first_row && std::fmin(edge_list[i].x0, edge_list[i].x1) < last_column) {
+			order.push_back(i);
+		}
+	}
+
+	active.clear();
+
+	size_t next = 0;
+	float origin = static_cast<float>(first);
+
+	for (int y = top; y < bottom; ++y) {
+		float row_top = static_cast<float>(y), row_bottom = row_top + 1.0f;
+
+		while (next < order.size() && edge_list[order[next]].y0 < row_bottom) {
+			active.push_back(order[next++]);
+		}
+
+		//Drop edges that ended, keeping the order
+		size_t kept = 0;
+
+		for (uint32_t index : active) {
+			if (edge_list[index].y1 > row_top) {
+				active[kept++] = index;
+			}
+		}
+
+		active.resize(kept);
+
+		if (active.empty()) {
+			if (next == order.size()) {
+				break;
+			}
+
+			continue;
+		}
+
+		for (uint32_t index : active) {
+			const SVGEdge& e = edge_list[index];
+			float y0 = std::fmax(e.y0, row_top);
+			float y1 = std::fmin(e.y1, row_bottom);
+
+			if (y1 <= y0) {
+				continue;
+			}
+
+			float x0 = e.x0 + (y0 - e.y0) * e.dxdy - origin;
+			float x1 = e.x0 + (y1 - e.y0) * e.dxdy - origin;
+
+			add_row_segment(x0, x1, (y1 - y0) * e.dir, limit);
+		}
+
+		uint8_t* dst = target.row(y) + static_cast<size_t>(left) * 4;
+		const uint8_t* span = coverage.data() + (left - first);
+		//Cells left of the clip only add to the running total
+		float carry = prefix_carry(cells.data(), skip);
+
+		switch (active_kernel) {
+#ifdef SVG_X86
+		case SVGKernel::AVX512:
+		case SVGKernel::AVX2:
+			coverage_avx2(cells.data() + skip, coverage.data() + skip, count - skip, rule, carry);
+
+			break;
+		case SVGKernel::SSE2:
+			coverage_sse2(cells.data() + skip, coverage.data() + skip, count - skip, rule, carry);
+
+			break;
+#endif
+		default:
+			coverage_scalar(cells.data() + skip, coverage.data() + skip, count - skip, rule, carry);
+
+			break;
+		}
+
+		if (aliased) {
+			//Half covered or more is in. The runs of 0 and 255 blend fastest too.
+			uint8_t* c = coverage.data() + (left - first);
+
+			for (int x = 0; x < right - left; ++x) {
+				c[x] = c[x] >= 128 ? 255 : 0;
+			}
+		}
+
+		blend.mask(dst, span, right - left, color);
+
+		std::fill(cells.begin(), cells.end(), 0.0f);
+	}
+}
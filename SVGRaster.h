@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SVGCpu.h"
+#include "SVGFlatten.h"
+#include "SVGPathData.h"
+#include "SVGStyle.h"
+#include "SVGTransform.h"
+
+//Premultiplied RGBA with 8 bits per channel, R first in memory. Rows are packed.
+struct SVGBitmap {
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> pixels;
+
+	void resize(int w, int h);
+
+	//Fills every pixel with an unpremultiplied 0xRRGGBBAA color
+	void clear(uint32_t rgba);
+
+	uint8_t* row(int y) {
+		return pixels.data() + static_cast<size_t>(y) * width * 4;
+	}
+
+	const uint8_t* row(int y) const {
+		return pixels.data() + static_cast<size_t>(y) * width * 4;
+	}
+};
+
+//Pixel area with right and bottom exclusive
+struct SVGPixelRect {
+	int left = 0, top = 0, right = 0, bottom = 0;
+};
+
+//How finely the edges of shapes are drawn, chosen per render call
+enum class SVGRenderQuality : uint8_t {
+	//Each pixel is in or out, with coarse curves. For drafts and dragging.
+	Aliased,
+	//Exact area coverage
+	Standard,
+	//Area coverage on a finer grid, averaged down. Seams where two shapes share
+	//an edge fade out, and curves are flattened finer. For exports.
+	High
+};
+
+//Max distance in pixels between a curve and its flattened lines at a quality
+float svg_quality_tolerance(SVGRenderQuality quality);
+
+//Line of an outline in device space. Always points down, dir is +1 when the
+//original line pointed down and -1 when up.
+struct SVGEdge {
+	float x0, y0, x1, y1;
+	float dxdy;
+	float dir;
+};
+
+//Scanline rasterizer with exact area coverage.
+//
+//Geometry is flattened into edges in device space. fill() then walks the rows the
+//edges span. Each edge adds the signed area it covers to a row of cells, and a
+//prefix sum over the row turns that into the winding number of every pixel,
+//which the fill rule folds into coverage. Coverage runs with SSE2 or AVX2 and
+//the color is blended with the kernels of SVGBlend.h, all bit identical.
+//
+//A pixel's coverage depends only on the edges and the bitmap, not on the clip, so
+//drawing an area in pieces gives the same pixels as drawing it at once.
+class SVGRasterizer {
+public:
+	//Max distance in pixels between a curve and the lines that replace it
+	float tolerance = 0.1f;
+	//Instruction set of the per row loops
+	SVGKernel kernel = svg_best_kernel();
+	//Rounds the coverage of every pixel to none or full
+	bool aliased = false;
+
+	//Drops all edges
+	void clear();
+
+	bool empty() const {
+		return edges.empty();
+	}
+
+	//Adds the figures of a path. Open figures are closed as a fill requires.
+	void add_path(const SVGPathView& path, const SVGMatrix& m);
+	void add_rect(float x, float y, float width, float height, const SVGMatrix& m);
+	void add_ellipse(float cx, float cy, float rx, float ry, const SVGMatrix& m);
+	//Adds already flattened figures, all of them closed
+	void add_polyline(const SVGPolyline& polyline, const SVGMatrix& m);
+
+	//Pixels the edges touch, not clipped to any bitmap. Empty when there are no edges.
+	SVGPixelRect bounds() const;
+
+	//Blends an unpremultiplied 0xRRGGBBAA color over the area enclosed by the edges.
+	//Only pixels inside clip are written.
+	void fill(SVGBitmap& target, uint32_t rgba, float opacity, SVGFillRule rule, const SVGPixelRect& clip);
+
+	//Same as above with the whole bitmap as the clip
+	void fill(SVGBitmap& target, uint32_t rgba, float opacity, SVGFillRule rule);
+
+	//Appends the edges to out in the order fill() needs them and drops them.
+	//Returns their bounds. They can then be filled any number of times, from any
+	//rasterizer, with the overload below.
+	SVGPixelRect take_edges(std::vector<SVGEdge>& out);
+
+	//Fills edges from take_edges() instead of the ones added. area is what it returned.
+	void fill(const SVGEdge* edge_list, size_t edge_count, const SVGPixelRect& area, SVGBitmap& target, uint32_t rgba, float opacity, SVGFillRule rule, const SVGPixelRect& clip);
+
+private:
+	std::vector<SVGEdge> edges;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> active;
+	std::vector<float> cells;
+	std::vector<uint8_t> coverage;
+	SVGPolyline flattened;
+	float min_x = 0.0f, min_y = 0.0f, max_x = 0.0f, max_y = 0.0f;
+	SVGPoint figure_start, current;
+	bool in_figure = false;
+
+	void move_to(SVGPoint p);
+	void line_to(SVGPoint p);
+	void add_clipped_edge(SVGPoint from, SVGPoint to);
+	void add_edge(SVGPoint from, SVGPoint to);
+	void close_figure();
+	void sort_edges();
+	void add_row_segment(float x0, float x1, float d, int limit);
+};
@@ -0,0 +1,331 @@
+#include "SVGResourceCache.h"
+#include <cstring>
+#include <string_view>
+#include "SVGColor.h"
+
+static void ltrim_str(std::string_view& source) {
+	size_t pos = source.find_first_not_of(" \t\r\n");
+
+	if (pos == std::string_view::npos) {
+		source.remove_prefix(source.length());
+	}
+	else {
+		source.remove_prefix(pos);
+	}
+}
+
+std::vector<std::string_view>
+static split_string(std::string_view source, std::string_view separator) {
+	std::vector<std::string_view> list;
+	size_t pos, start = 0;
+
+	while ((pos = source.find(separator, start)) != std::string_view::npos) {
+		list.push_back(source.substr(start, (pos - start)));
+
+		start = pos + separator.length();
+	}
+
+	list.push_back(source.substr(start));
+
+	return list;
+}
+
+//DirectWrite works with UTF-16 strings
+static void utf8_to_wide(std::string_view source, std::wstring& result) {
+	result.clear();
+
+	if (source.empty()) {
+		return;
+	}
+
+	int len = MultiByteToWideChar(CP_UTF8, 0, source.data(), static_cast<int>(source.length()), nullptr, 0);
+
+	if (len <= 0) {
+		return;
+	}
+
+	result.resize(len);
+
+	MultiByteToWideChar(CP_UTF8, 0, source.data(), static_cast<int>(source.length()), &result[0], len);
+}
+
+static uint32_t float_bits(float f) {
+	uint32_t bits;
+
+	std::memcpy(&bits, &f, sizeof(bits));
+
+	return bits;
+}
+
+static CComPtr<IDWriteTextFormat> create_text_format(IDWriteFactory* pDWriteFactory, const std::wstring& family, uint16_t weight, SVGFontStyle style, float size) {
+	CComPtr<IDWriteTextFormat> tfmt;
+	DWRITE_FONT_WEIGHT fontWeight = static_cast<DWRITE_FONT_WEIGHT>(weight);
+	DWRITE_FONT_STYLE fontStyle = DWRITE_FONT_STYLE_NORMAL;
+
+	if (style == SVGFontStyle::Italic) {
+		fontStyle = DWRITE_FONT_STYLE_ITALIC;
+	} else if (style == SVGFontStyle::Oblique) {
+		fontStyle = DWRITE_FONT_STYLE_OBLIQUE;
+	}
+
+	HRESULT hr = pDWriteFactory->CreateTextFormat(
+			family.c_str(),
+			nullptr,
+			fontWeight,
+			fontStyle,
+			DWRITE_FONT_STRETCH_NORMAL,
+			size,
+			L"",
+			&tfmt);
+
+	if (!SUCCEEDED(hr)) {
+		return nullptr;
+	}
+
+	return tfmt;
+}
+
+CComPtr<IDWriteTextFormat> build_text_format(IDWriteFactory* pDWriteFactory, std::string_view family, uint16_t weight, SVGFontStyle style, float size, std::wstring* resolved_family) {
+	//Split the family string by commas and try to find the first installed font
+	auto families = split_string(family, ",");
+
+	for (auto& fam : families) {
+		ltrim_str(fam);
+
+		std::wstring trimmedFamily;
+
+		utf8_to_wide(fam, trimmedFamily);
+
+		CComPtr<IDWriteTextFormat> tfmt = create_text_format(pDWriteFactory, trimmedFamily, weight, style, size);
+
+		if (tfmt) {
+			if (resolved_family) {
+				*resolved_family = trimmedFamily;
+			}
+
+			return tfmt;
+		}
+	}
+
+	return nullptr;
+}
+
+void SVGResourceCache::clear() {
+	brushes.clear();
+	stroke_styles.clear();
+	//Layouts hold references to formats, release them first
+	text_layout_map.clear();
+	text_layouts.clear();
+	text_formats.clear();
+	resolved_families.clear();
+	counters = SVGResourceStats();
+}
+
+ID2D1SolidColorBrush* SVGResourceCache::brush(ID2D1DeviceContext* pDeviceContext, uint32_t rgba, float opacity) {
+	uint64_t key = (uint64_t(rgba) << 32) | float_bits(opacity);
+	auto it = brushes.find(key);
+
+	if (it != brushes.end()) {
+		++counters.brush_hits;
+
+		return it->second;
+	}
+
+	++counters.brush_misses;
+
+	CComPtr<ID2D1SolidColorBrush> brush;
+	HRESULT hr = pDeviceContext->CreateSolidColorBrush(
+		D2D1::ColorF(svg_color_red(rgba), svg_color_green(rgba), svg_color_blue(rgba), svg_color_alpha(rgba) * opacity),
+		&brush
+	);
+
+	//Failures are cached too, so that a bad color is only tried once
+	if (!SUCCEEDED(hr)) {
+		brush = nullptr;
+	}
+
+	return brushes[key] = brush;
+}
+
+ID2D1StrokeStyle* SVGResourceCache::stroke_style(ID2D1Factory* pD2DFactory, SVGLineCap cap, SVGLineJoin join, float miterlimit) {
+	uint64_t key = (uint64_t(float_bits(miterlimit)) << 32) | (uint64_t(cap) << 8) | uint64_t(join);
+	auto it = stroke_styles.find(key);
+
+	if (it != stroke_styles.end()) {
+		++counters.stroke_style_hits;
+
+		return it->second;
+	}
+
+	++counters.stroke_style_misses;
+
+	D2D1_CAP_STYLE cap_style = D2D1_CAP_STYLE_FLAT;
+
+	if (cap == SVGLineCap::Round) {
+		cap_style = D2D1_CAP_STYLE_ROUND;
+	}
+	else if (cap == SVGLineCap::Square) {
+		cap_style = D2D1_CAP_STYLE_SQUARE;
+	}
+
+	D2D1_LINE_JOIN line_join = D2D1_LINE_JOIN_MITER;
+
+	if (join == SVGLineJoin::Bevel) {
+		line_join = D2D1_LINE_JOIN_BEVEL;
+	}
+	else if (join == SVGLineJoin::Round) {
+		line_join = D2D1_LINE_JOIN_ROUND;
+	}
+
+	D2D1_STROKE_STYLE_PROPERTIES stroke_properties = D2D1::StrokeStyleProperties(
+		cap_style,     // Start cap
+		cap_style,     // End cap
+		D2D1_CAP_STYLE_ROUND,    // Dash cap
+		line_join,    // Line join
+		miterlimit//,                   // Miter limit
+		//D2D1_DASH_STYLE_CUSTOM,  // Dash style
+		//0.0f                     // Dash offset
+	);
+
+	CComPtr<ID2D1StrokeStyle> ss;
+
+	HRESULT hr = pD2DFactory->CreateStrokeStyle(
+		&stroke_properties,
+		nullptr,
+		0,
+		&ss
+	);
+
+	if (!SUCCEEDED(hr)) {
+		ss = nullptr;
+	}
+
+	return stroke_styles[key] = ss;
+}
+
+IDWriteTextFormat* SVGResourceCache::text_format(IDWriteFactory* pDWriteFactory, const std::string* family, uint16_t weight, SVGFontStyle style, float size) {
+	TextFormatKey key{ family, weight, style, size };
+	auto it = text_formats.find(key);
+
+	if (it != text_formats.end()) {
+		++counters.text_format_hits;
+
+		return it->second;
+	}
+
+	++counters.text_format_misses;
+
+	CComPtr<IDWriteTextFormat> tfmt;
+	auto resolved = resolved_families.find(family);
+
+	if (resolved != resolved_families.end()) {
+		//We already know which family of the list works, skip the ones before it
+		++counters.family_hits;
+
+		tfmt = create_text_format(pDWriteFactory, resolved->second, weight, style, size);
+	}
+	else {
+		std::wstring resolved_family;
+
+		++counters.family_misses;
+
+		tfmt = build_text_format(pDWriteFactory, *family, weight, style, size, &resolved_family);
+
+		if (tfmt) {
+			resolved_families[family] = resolved_family;
+		}
+	}
+
+	return text_formats[key] = tfmt;
+}
+
+SVGTextLayout* SVGResourceCache::text_layout(IDWriteFactory* pDWriteFactory, IDWriteTextFormat* format, std::string_view content, float max_width, float max_height) {
+	TextLayoutKey key{ format, std::string(content) };
+	auto it = text_layout_map.find(key);
+
+	if (it != text_layout_map.end()) {
+		++counters.text_layout_hits;
+
+		return it->second;
+	}
+
+	++counters.text_layout_misses;
+
+	std::wstring text_content;
+	CComPtr<IDWriteTextLayout> layout;
+
+	utf8_to_wide(content, text_content);
+
+	HRESULT hr = pDWriteFactory->CreateTextLayout(
+		text_content.c_str(),           // The string to be laid out
+		static_cast<UINT32>(text_content.size()),     // The length of the string
+		format,    // The initial format (font, size, etc.)
+		max_width,       // Maximum width of the layout box
+		max_height,      // Maximum height of the layout box
+		&layout    // Output: the resulting IDWriteTextLayout
+	);
+
+	SVGTextLayout* entry = nullptr;
+
+	if (SUCCEEDED(hr)) {
+		// To prevent wrapping and force it to stay on one line:
+		layout->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP);
+
+		text_layouts.emplace_back();
+		entry = &text_layouts.back();
+		entry->layout = layout;
+		entry->max_width = max_width;
+		entry->max_height = max_height;
+	}
+
+	//Failures are cached too, so that a bad layout is only tried once
+	text_layout_map.emplace(std::move(key), entry);
+
+	return entry;
+}
+
+void SVGResourceCache::resize_text_layouts(float max_width, float max_height) {
+	for (SVGTextLayout& entry : text_layouts) {
+		if (entry.max_width == max_width && entry.max_height == max_height) {
+			continue;
+		}
+
+		//Changing the box keeps the layout object, DirectWrite only redoes the line breaking
+		entry.layout->SetMaxWidth(max_width);
+		entry.layout->SetMaxHeight(max_height);
+		entry.max_width = max_width;
+		entry.max_height = max_height;
+		entry.has_metrics = false;
+	}
+}
+
+bool SVGTextLayout::update_metrics() {
+	if (has_metrics) {
+		return true;
+	}
+
+	//Most text is one line, so one call with a small buffer is enough
+	DWRITE_LINE_METRICS lines[4];
+	UINT32 lineCount = 0;
+	HRESULT hr = layout->GetLineMetrics(lines, 4, &lineCount);
+
+	if (hr == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER)) {
+		std::vector<DWRITE_LINE_METRICS> lineMetrics(lineCount);
+
+		hr = layout->GetLineMetrics(lineMetrics.data(), lineCount, &lineCount);
+
+		if (SUCCEEDED(hr) && lineCount > 0) {
+			lines[0] = lineMetrics[0];
+		}
+	}
+
+	if (!SUCCEEDED(hr) || lineCount == 0) {
+		//Nothing there
+		return false;
+	}
+
+	baseline = lines[0].baseline;
+	has_metrics = true;
+
+	return true;
+}
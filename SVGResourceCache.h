@@ -0,0 +1,128 @@
+#pragma once
+
+#include <d2d1_2.h>
+#include <atlbase.h>
+#include <dwrite.h>
+#include <cstddef>
+#include <deque>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "SVGStyle.h"
+
+struct SVGResourceStats {
+	size_t brush_hits = 0;
+	size_t brush_misses = 0;
+	size_t stroke_style_hits = 0;
+	size_t stroke_style_misses = 0;
+	size_t text_format_hits = 0;
+	size_t text_format_misses = 0;
+	//Misses that still found the resolved family of their font-family list
+	size_t family_hits = 0;
+	size_t family_misses = 0;
+	size_t text_layout_hits = 0;
+	size_t text_layout_misses = 0;
+};
+
+//A text layout shared by every text element with the same content and format
+struct SVGTextLayout {
+	CComPtr<IDWriteTextLayout> layout;
+	//The box it was laid out in
+	float max_width = 0.0f;
+	float max_height = 0.0f;
+	//Distance from the top of the layout to the first baseline. Valid when has_metrics.
+	float baseline = 0.0f;
+	bool has_metrics = false;
+
+	//Reads the baseline if the layout changed since it was last read
+	bool update_metrics();
+};
+
+//Creates a text format with the first family in a comma separated list that DirectWrite accepts.
+//resolved_family, when not null, receives the family that was used.
+CComPtr<IDWriteTextFormat> build_text_format(IDWriteFactory* pDWriteFactory, std::string_view family, uint16_t weight, SVGFontStyle style, float size, std::wstring* resolved_family = nullptr);
+
+//Direct2D and DirectWrite resources of one document, shared by every element that paints the same way.
+//Elements hold plain pointers to them, which stay valid until clear().
+class SVGResourceCache {
+public:
+	SVGResourceCache() = default;
+
+	SVGResourceCache(const SVGResourceCache&) = delete;
+	SVGResourceCache& operator=(const SVGResourceCache&) = delete;
+
+	void clear();
+
+	//Brush of a 0xRRGGBBAA color with opacity applied to the alpha. Null if it can't be created.
+	ID2D1SolidColorBrush* brush(ID2D1DeviceContext* pDeviceContext, uint32_t rgba, float opacity);
+
+	//There is no stroke-dasharray support yet, so all stroke styles are solid
+	ID2D1StrokeStyle* stroke_style(ID2D1Factory* pD2DFactory, SVGLineCap cap, SVGLineJoin join, float miterlimit);
+
+	//family must be interned in the document's SVGStyleCache, so that equal lists are the same pointer
+	IDWriteTextFormat* text_format(IDWriteFactory* pDWriteFactory, const std::string* family, uint16_t weight, SVGFontStyle style, float size);
+
+	//Single line layout of UTF-8 content. Null if it can't be created.
+	SVGTextLayout* text_layout(IDWriteFactory* pDWriteFactory, IDWriteTextFormat* format, std::string_view content, float max_width, float max_height);
+
+	//Gives every layout a new box. Layouts already laid out in that box are left alone.
+	void resize_text_layouts(float max_width, float max_height);
+
+	const SVGResourceStats& stats() const {
+		return counters;
+	}
+
+	size_t brush_count() const {
+		return brushes.size();
+	}
+
+	size_t stroke_style_count() const {
+		return stroke_styles.size();
+	}
+
+private:
+	struct TextFormatKey {
+		const std::string* family;
+		uint16_t weight;
+		SVGFontStyle style;
+		float size;
+
+		bool operator==(const TextFormatKey& other) const {
+			return family == other.family && weight == other.weight && style == other.style && size == other.size;
+		}
+	};
+
+	struct TextFormatKeyHash {
+		size_t operator()(const TextFormatKey& k) const {
+			return std::hash<const void*>()(k.family) * 31 + std::hash<float>()(k.size) * 7 + k.weight * 3 + static_cast<size_t>(k.style);
+		}
+	};
+
+	struct TextLayoutKey {
+		IDWriteTextFormat* format;
+		std::string content;
+
+		bool operator==(const TextLayoutKey& other) const {
+			return format == other.format && content == other.content;
+		}
+	};
+
+	struct TextLayoutKeyHash {
+		size_t operator()(const TextLayoutKey& k) const {
+			return std::hash<const void*>()(k.format) * 31 + std::hash<std::string>()(k.content);
+		}
+	};
+
+	std::unordered_map<uint64_t, CComPtr<ID2D1SolidColorBrush>> brushes;
+	std::unordered_map<uint64_t, CComPtr<ID2D1StrokeStyle>> stroke_styles;
+	std::unordered_map<TextFormatKey, CComPtr<IDWriteTextFormat>, TextFormatKeyHash> text_formats;
+	//Which family of a font-family list DirectWrite accepted
+	std::unordered_map<const std::string*, std::wstring> resolved_families;
+	//A deque so that layout addresses never change
+	std::deque<SVGTextLayout> text_layouts;
+	std::unordered_map<TextLayoutKey, SVGTextLayout*, TextLayoutKeyHash> text_layout_map;
+	SVGResourceStats counters;
+};
@@ -0,0 +1,444 @@
+#include "SVGSoftwareRenderer.h"
+#include "SVGBlend.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static bool get_paint_color(const SVGStyle* style, const SVGPaint& paint, uint32_t& rgba) {
+	if (paint.type == SVGPaintType::Color) {
+		rgba = paint.rgba;
+	}
+	else if (paint.type == SVGPaintType::CurrentColor) {
+		rgba = style->color;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+static bool is_fill(SVGDrawOp op) {
+	return op == SVGDrawOp::FillRect || op == SVGDrawOp::FillEllipse || op == SVGDrawOp::FillPath;
+}
+
+//Averages each block of scale by scale pixels of from, rows top to bottom of rect
+//in pixels of to, and blends the result over to. The sum of a block is divided
+//with rounding, so a block of one color gives that color back.
+static void resolve(const SVGBitmap& from, SVGBitmap& to, int scale, const SVGPixelRect& rect, int top, int bottom, const SVGBlendKernels& blend) {
+	uint32_t samples = static_cast<uint32_t>(scale * scale);
+	//Sums stay below 2^17 and samples at most 256, so multiplying by the rounded up
+	//reciprocal divides exactly
+	uint64_t reciprocal = ((1ull << 32) + samples - 1) / samples;
+	size_t row_bytes = static_cast<size_t>(rect.right - rect.left) * scale * 4;
+	std::vector<uint32_t> columns(row_bytes);
+	std::vector<uint8_t> mean(static_cast<size_t>(rect.right - rect.left) * 4);
+
+	for (int y = top; y < bottom; ++y) {
+		//Down the rows of the blocks first, byte by byte, then across
+		std::fill(columns.begin(), columns.end(), 0);
+
+		for (int sy = 0; sy < scale; ++sy) {
+			const uint8_t* src = from.row(y * scale + sy) + static_cast<size_t>(rect.left) * scale * 4;
+
+			for (size_t i = 0; i < row_bytes; ++i) {
+				columns[i] += src[i];
+			}
+		}
+
+		const uint32_t* column = columns.data();
+		uint8_t* dst = mean.data();
+
+		for (int x = rect.left; x < rect.right; ++x, dst += 4) {
+			uint32_t sum[4] = { samples / 2, samples / 2, samples / 2, samples / 2 };
+
+			for (int sx = 0; sx < scale; ++sx, column += 4) {
+				for (int k = 0; k < 4; ++k) {
+					sum[k] += column[k];
+				}
+			}
+
+			for (int k = 0; k < 4; ++k) {
+				dst[k] = static_cast<uint8_t>((sum[k] * reciprocal) >> 32);
+			}
+		}
+
+		blend.over(to.row(y) + static_cast<size_t>(rect.left) * 4, mean.data(), rect.right - rect.left);
+	}
+}
+
+void SVGSoftwareRenderer::render(const SVGDocument& document, const SVGDisplayList& list, SVGBitmap& target, const SVGMatrix& device, SVGRenderQuality quality) {
+	render(document, list, target, device, SVGPixelRect{ 0, 0, target.width, target.height }, quality);
+}
+
+void SVGSoftwareRenderer::render(const SVGDocument& document, const SVGDisplayList& list, SVGBitmap& target, const SVGMatrix& device, const SVGPixelRect& clip, SVGRenderQuality quality) {
+	if (quality == SVGRenderQuality::High && supersampling > 1) {
+		render_fine(document, list, target, device, clip, nullptr);
+		return;
+	}
+
+	set_quality(quality, 1);
+	prepare(document, list, device, clip);
+
+	for (const Command& command : commands) {
+		draw(rasterizer, command, target, clip);
+	}
+}
+
+void SVGSoftwareRenderer::render_tiled(const SVGDocument& document, const SVGDisplayList& list, SVGBitmap& target, const SVGMatrix& device, SVGThreadPool& pool, SVGRenderQuality quality) {
+	SVGPixelRect whole{ 0, 0, target.width, target.height };
+
+	if (quality == SVGRenderQuality::High && supersampling > 1) {
+		render_fine(document, list, target, device, whole, &pool);
+		return;
+	}
+
+	set_quality(quality, 1);
+	prepare(document, list, device, whole);
+	draw_tiles(target, pool);
+}
+
+//Draws the commands into the tiles of target on pool
+void SVGSoftwareRenderer::draw_tiles(SVGBitmap& target, SVGThreadPool& pool) {
+	int step_x = tile_width > 0 ? std::max(tile_width, 8) : std::max(target.width, 1);
+	int step_y = std::max(tile_height, 1);
+	int columns = (target.width + step_x - 1) / step_x;
+	int rows = (target.height + step_y - 1) / step_y;
+	size_t tile_count = static_cast<size_t>(columns) * rows;
+
+	//Bin the commands into the tiles their bounds touch. Counted first, then
+	//filled in paint order, so every tile's list is one slice of a single array.
+	tile_offsets.assign(tile_count + 1, 0);
+
+	for (int pass = 0; pass < 2; ++pass) {
+		for (uint32_t i = 0; i < commands.size(); ++i) {
+			const SVGPixelRect& b = commands[i].bounds;
+
+			if (b.right <= 0 || b.bottom <= 0 || b.left >= target.width || b.top >= target.height) {
+				continue;
+			}
+
+			int left = std::max(b.left, 0) / step_x, right = (std::min(b.right, target.width) - 1) / step_x;
+			int top = std::max(b.top, 0) / step_y, bottom = (std::min(b.bottom, target.height) - 1) / step_y;
+
+			for (int ty = top; ty <= bottom; ++ty) {
+				for (int tx = left; tx <= right; ++tx) {
+					size_t tile = static_cast<size_t>(ty) * columns + tx;
+
+					if (pass == 0) {
+						++tile_offsets[tile + 1];
+					}
+					else {
+						tile_commands[tile_offsets[tile]++] = i;
+					}
+				}
+			}
+		}
+
+		if (pass == 0) {
+			for (size_t t = 0; t < tile_count; ++t) {
+				tile_offsets[t + 1] += tile_offsets[t];
+			}
+
+			tile_commands.resize(tile_offsets[tile_count]);
+		}
+		else {
+			//Filling moved each offset to the start of the next tile
+			for (size_t t = tile_count; t > 0; --t) {
+				tile_offsets[t] = tile_offsets[t - 1];
+			}
+
+			tile_offsets[0] = 0;
+		}
+	}
+
+	pool.parallel_for(tile_count, 1, [&](size_t begin, size_t end) {
+		std::unique_ptr<SVGRasterizer> raster = acquire_rasterizer();
+
+		for (size_t tile = begin; tile < end; ++tile) {
+			int tx = static_cast<int>(tile % columns) * step_x;
+			int ty = static_cast<int>(tile / columns) * step_y;
+			SVGPixelRect clip{ tx, ty, std::min(tx + step_x, target.width), std::min(ty + step_y, target.height) };
+
+			for (uint32_t k = tile_offsets[tile]; k < tile_offsets[tile + 1]; ++k) {
+				draw(*raster, commands[tile_commands[k]], target, clip);
+			}
+		}
+
+		release_rasterizer(std::move(raster));
+	});
+}
+
+//Shapes are drawn on transparent samples and the averages blended over target,
+//so only the area they cover is cleared and resolved. fine always has the size
+//of the whole target times scale, so the geometry lands on the same samples
+//whatever the clip and tiled or not.
+void SVGSoftwareRenderer::render_fine(const SVGDocument& document, const SVGDisplayList& list, SVGBitmap& target, const SVGMatrix& device, const SVGPixelRect& clip, SVGThreadPool* pool) {
+	int scale = std::min(supersampling, 16);
+	SVGPixelRect area{ std::max(clip.left, 0), std::max(clip.top, 0), std::min(clip.right, target.width), std::min(clip.bottom, target.height) };
+
+	if (area.left >= area.right || area.top >= area.bottom) {
+		return;
+	}
+
+	if (fine.width != target.width * scale || fine.height != target.height * scale) {
+		fine.resize(target.width * scale, target.height * scale);
+	}
+
+	SVGPixelRect fine_clip{ area.left * scale, area.top * scale, area.right * scale, area.bottom * scale };
+
+	set_quality(SVGRenderQuality::High, scale);
+	prepare(document, list, svg_multiply(device, SVGMatrix::scale(static_cast<float>(scale), static_cast<float>(scale))), fine_clip);
+
+	//Pixels of target the commands touch
+	SVGPixelRect drawn{ area.right, area.bottom, area.left, area.top };
+
+	for (const Command& command : commands) {
+		drawn.left = std::min(drawn.left, std::max(command.bounds.left, fine_clip.left) / scale);
+		drawn.top = std::min(drawn.top, std::max(command.bounds.top, fine_clip.top) / scale);
+		drawn.right = std::max(drawn.right, (std::min(command.bounds.right, fine_clip.right) + scale - 1) / scale);
+		drawn.bottom = std::max(drawn.bottom, (std::min(command.bounds.bottom, fine_clip.bottom) + scale - 1) / scale);
+	}
+
+	if (drawn.left >= drawn.right || drawn.top >= drawn.bottom) {
+		return;
+	}
+
+	SVGPixelRect fine_drawn{ drawn.left * scale, drawn.top * scale, drawn.right * scale, drawn.bottom * scale };
+	size_t clear_bytes = static_cast<size_t>(fine_drawn.right - fine_drawn.left) * 4;
+	const SVGBlendKernels& blend = svg_blend_kernels(rasterizer.kernel);
+
+	for (int y = fine_drawn.top; y < fine_drawn.bottom; ++y) {
+		std::memset(fine.row(y) + static_cast<size_t>(fine_drawn.left) * 4, 0, clear_bytes);
+	}
+
+	if (pool) {
+		draw_tiles(fine, *pool);
+
+		pool->parallel_for(drawn.bottom - drawn.top, 16, [&](size_t begin, size_t end) {
+			resolve(fine, target, scale, drawn, drawn.top + static_cast<int>(begin), drawn.top + static_cast<int>(end), blend);
+		});
+	}
+	else {
+		for (const Command& command : commands) {
+			draw(rasterizer, command, fine, fine_drawn);
+		}
+
+		resolve(fine, target, scale, drawn, drawn.top, drawn.bottom, blend);
+	}
+}
+
+std::unique_ptr<SVGRasterizer> SVGSoftwareRenderer::acquire_rasterizer() {
+	std::unique_ptr<SVGRasterizer> raster;
+
+	{
+		std::lock_guard<std::mutex> guard(spare_lock);
+
+		if (!spare_rasterizers.empty()) {
+			raster = std::move(spare_rasterizers.back());
+			spare_rasterizers.pop_back();
+		}
+	}
+
+	if (!raster) {
+		raster = std::make_unique<SVGRasterizer>();
+	}
+
+	raster->kernel = rasterizer.kernel;
+	raster->aliased = rasterizer.aliased;
+
+	return raster;
+}
+
+void SVGSoftwareRenderer::release_rasterizer(std::unique_ptr<SVGRasterizer> raster) {
+	std::lock_guard<std::mutex> guard(spare_lock);
+
+	spare_rasterizers.push_back(std::move(raster));
+}
+
+void SVGSoftwareRenderer::draw(SVGRasterizer& raster, const Command& command, SVGBitmap& target, const SVGPixelRect& clip) const {
+	raster.fill(edges.data() + command.first_edge, command.edge_count, command.bounds, target, command.rgba, command.opacity, command.rule, clip);
+}
+
+//Flattening is measured in the pixels drawn to, scale of them to one of the target
+void SVGSoftwareRenderer::set_quality(SVGRenderQuality quality, int scale) {
+	rasterizer.tolerance = svg_quality_tolerance(quality) * static_cast<float>(scale);
+	rasterizer.aliased = quality == SVGRenderQuality::Aliased;
+}
+
+//Builds the edges of every entry that touches clip
+void SVGSoftwareRenderer::prepare(const SVGDocument& document, const SVGDisplayList& list, const SVGMatrix& device, const SVGPixelRect& clip) {
+	SVGMatrix inverse;
+
+	skipped = 0;
+	edges.clear();
+	commands.clear();
+
+	//The clip in world space, for the display list to skip what is out of it
+	if (svg_invert(device, inverse)) {
+		SVGRect view{ static_cast<float>(clip.left), static_cast<float>(clip.top), static_cast<float>(clip.right), static_cast<float>(clip.bottom) };
+
+		list.cull(svg_transform_rect(inverse, svg_classify_transform(inverse), view), visible);
+	}
+	else {
+		visible.clear();
+	}
+
+	for (uint32_t b : visible) {
+		const SVGDisplayBatch& batch = list.batches[b];
+		const SVGDisplayItem& first = list.items[batch.first];
+		const SVGStyle* style = document.nodes[first.resource].style;
+		uint32_t rgba;
+
+		if (first.op == SVGDrawOp::FillText) {
+			skipped += batch.count;
+			continue;
+		}
+
+		SVGMatrix m = svg_multiply(first.transform, device);
+
+		rasterizer.clear();
+
+		if (is_fill(first.op)) {
+			if (!get_paint_color(style, style->fill, rgba)) {
+				continue;
+			}
+
+			if (batch.count == 1) {
+				add_fill(document, first, m);
+				add_command(rgba, style->fill_opacity, first.op == SVGDrawOp::FillPath ? style->fill_rule : SVGFillRule::NonZero);
+			}
+			else {
+				//Every figure of an outline winds the same way
+				list.batch_outline(batch, outline);
+				rasterizer.add_path(outline.view(), m);
+				add_command(rgba, style->fill_opacity, SVGFillRule::NonZero);
+			}
+		}
+		else {
+			if (!get_paint_color(style, style->stroke, rgba)) {
+				continue;
+			}
+
+			//Outlines are built in user space, with the pixel tolerance scaled to it
+			const SVGPolyline* stroke = stroke_outline(document, list, batch, svg_flatten_tolerance(m, rasterizer.tolerance));
+
+			if (stroke) {
+				rasterizer.add_polyline(*stroke, m);
+				add_command(rgba, style->stroke_opacity, SVGFillRule::NonZero);
+			}
+		}
+	}
+}
+
+//Moves the edges in the rasterizer into a command, unless there are none
+void SVGSoftwareRenderer::add_command(uint32_t rgba, float opacity, SVGFillRule rule) {
+	Command command;
+
+	command.first_edge = static_cast<uint32_t>(edges.size());
+	command.bounds = rasterizer.take_edges(edges);
+	command.edge_count = static_cast<uint32_t>(edges.size()) - command.first_edge;
+	command.rgba = rgba;
+	command.opacity = opacity;
+	command.rule = rule;
+
+	if (command.edge_count > 0) {
+		commands.push_back(command);
+	}
+}
+
+void SVGSoftwareRenderer::add_fill(const SVGDocument& document, const SVGDisplayItem& item, const SVGMatrix& m) {
+	const float* g = item.geometry;
+
+	switch (item.op) {
+	case SVGDrawOp::FillRect:
+		rasterizer.add_rect(g[0], g[1], g[2], g[3], m);
+
+		break;
+	case SVGDrawOp::FillEllipse:
+		rasterizer.add_ellipse(g[0], g[1], g[2], g[3], m);
+
+		break;
+	case SVGDrawOp::FillPath:
+		rasterizer.add_path(document.path(item.payload), m);
+
+		break;
+	default:
+		break;
+	}
+}
+
+//Outline of the stroke of a batch in the space of its first entry, from the cache when it can be
+const SVGPolyline* SVGSoftwareRenderer::stroke_outline(const SVGDocument& document, const SVGDisplayList& list, const SVGDisplayBatch& batch, float tolerance) {
+	const SVGDisplayItem& item = list.items[batch.first];
+	const SVGStyle* style = document.nodes[item.resource].style;
+	const float* g = item.geometry;
+	SVGStrokeKey key;
+
+	key.style.width = item.stroke_width;
+	key.style.cap = style->stroke_linecap;
+	key.style.join = style->stroke_linejoin;
+	key.style.miterlimit = style->stroke_miterlimit;
+	key.tolerance = tolerance;
+
+	if (batch.count > 1) {
+		key.source = SVGStrokeSource::Batch;
+		key.index = batch.first;
+		key.geometry[0] = static_cast<float>(batch.count);
+	}
+	else if (item.op == SVGDrawOp::StrokePath) {
+		key.source = SVGStrokeSource::Path;
+		key.index = item.payload;
+	}
+	else {
+		key.source = item.op == SVGDrawOp::StrokeRect ? SVGStrokeSource::Rect :
+			item.op == SVGDrawOp::StrokeEllipse ? SVGStrokeSource::Ellipse : SVGStrokeSource::Line;
+
+		for (int i = 0; i < 4; ++i) {
+			key.geometry[i] = g[i];
+		}
+	}
+
+	const SVGPolyline* cached = stroke_cache.find(key);
+
+	if (cached) {
+		return cached;
+	}
+
+	stroke_input.clear();
+
+	switch (key.source) {
+	case SVGStrokeSource::Batch:
+		list.batch_outline(batch, outline);
+		svg_flatten_path(outline.view(), SVGMatrix::identity(), tolerance, stroke_input);
+
+		break;
+	case SVGStrokeSource::Path:
+		svg_flatten_path(document.path(item.payload), SVGMatrix::identity(), tolerance, stroke_input);
+
+		break;
+	case SVGStrokeSource::Rect:
+		stroke_input.move_to(SVGPoint{ g[0], g[1] });
+		stroke_input.line_to(SVGPoint{ g[0] + g[2], g[1] });
+		stroke_input.line_to(SVGPoint{ g[0] + g[2], g[1] + g[3] });
+		stroke_input.line_to(SVGPoint{ g[0], g[1] + g[3] });
+		stroke_input.close();
+
+		break;
+	case SVGStrokeSource::Ellipse:
+		svg_flatten_ellipse(g[0], g[1], g[2], g[3], SVGMatrix::identity(), tolerance, stroke_input);
+
+		break;
+	case SVGStrokeSource::Line:
+		stroke_input.move_to(SVGPoint{ g[0], g[1] });
+		stroke_input.line_to(SVGPoint{ g[2], g[3] });
+
+		break;
+	}
+
+	SVGPolyline stroke;
+
+	svg_stroke_polyline(stroke_input, key.style, tolerance, stroke);
+
+	return stroke_cache.insert(key, std::move(stroke));
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "SVGDisplayList.h"
+#include "SVGDocument.h"
+#include "SVGFlatten.h"
+#include "SVGPathData.h"
+#include "SVGRaster.h"
+#include "SVGStroke.h"
+#include "SVGThreadPool.h"
+#include "SVGTransform.h"
+
+//Replays a display list into an SVGBitmap on the CPU, with no graphics API.
+//Fills and strokes of rects, ellipses, lines and paths are drawn. Text is not
+//yet, it is counted in skipped.
+//
+//A frame is drawn in two steps. First every entry is flattened and stroked into
+//device space edges with its paint. Then those are filled, either at once or tile
+//by tile on a thread pool. The rasterizer gives a pixel the same value whatever
+//the clip, so both ways give identical bitmaps.
+//
+//Every call takes the quality to draw with. High quality draws at supersampling
+//times the size into a bitmap of its own and averages that down.
+class SVGSoftwareRenderer {
+public:
+	//Builds the edges. Its kernel is used by every thread. Its tolerance and
+	//aliasing are set by each call from the quality.
+	SVGRasterizer rasterizer;
+	//Outlines of the strokes drawn so far. Clear it when the display list is compiled again.
+	SVGStrokeCache stroke_cache;
+	//Size of the tiles of render_tiled(), in pixels. A tile width of 0 spans the bitmap.
+	//Narrow tiles cost more: every row of a tile adds up the cells of the shape from its
+	//left side on, so a shape split across n columns of tiles walks its rows n times.
+	int tile_width = 0;
+	int tile_height = 32;
+	//Samples per side of a pixel in High quality, up to 16
+	int supersampling = 2;
+	//Entries of the last render that could not be drawn
+	size_t skipped = 0;
+
+	//Draws over what target already holds. device maps world space to pixels.
+	void render(const SVGDocument& document, const SVGDisplayList& list, SVGBitmap& target, const SVGMatrix& device, SVGRenderQuality quality = SVGRenderQuality::Standard);
+
+	//Same as above but only writes the pixels inside clip
+	void render(const SVGDocument& document, const SVGDisplayList& list, SVGBitmap& target, const SVGMatrix& device, const SVGPixelRect& clip, SVGRenderQuality quality = SVGRenderQuality::Standard);
+
+	//Same pixels as render(), with the tiles of target rasterized in parallel on pool.
+	//Each tile only fills the entries whose bounds touch it.
+	void render_tiled(const SVGDocument& document, const SVGDisplayList& list, SVGBitmap& target, const SVGMatrix& device, SVGThreadPool& pool, SVGRenderQuality quality = SVGRenderQuality::Standard);
+
+private:
+	//Edges to fill with one paint
+	struct Command {
+		uint32_t first_edge = 0;
+		uint32_t edge_count = 0;
+		uint32_t rgba = 0;
+		float opacity = 1.0f;
+		SVGFillRule rule = SVGFillRule::NonZero;
+		SVGPixelRect bounds;
+	};
+
+	SVGPathData outline;
+	SVGPolyline stroke_input;
+	//Batches of the display list in view of the frame being drawn
+	std::vector<uint32_t> visible;
+	//Sorted edges of every command of the frame being drawn
+	std::vector<SVGEdge> edges;
+	std::vector<Command> commands;
+	//Commands that touch each tile, in paint order. Tile t has tile_commands[tile_offsets[t]] up to tile_offsets[t + 1].
+	std::vector<uint32_t> tile_offsets;
+	std::vector<uint32_t> tile_commands;
+	//Rasterizers of the pool threads, reused across tiles and frames
+	std::mutex spare_lock;
+	std::vector<std::unique_ptr<SVGRasterizer>> spare_rasterizers;
+	//Target of High quality, supersampling times the size of the real one
+	SVGBitmap fine;
+
+	void set_quality(SVGRenderQuality quality, int scale);
+	void prepare(const SVGDocument& document, const SVGDisplayList& list, const SVGMatrix& device, const SVGPixelRect& clip);
+	void add_command(uint32_t rgba, float opacity, SVGFillRule rule);
+	void add_fill(const SVGDocument& document, const SVGDisplayItem& item, const SVGMatrix& m);
+	const SVGPolyline* stroke_outline(const SVGDocument& document, const SVGDisplayList& list, const SVGDisplayBatch& batch, float tolerance);
+	void draw(SVGRasterizer& raster, const Command& command, SVGBitmap& target, const SVGPixelRect& clip) const;
+	void draw_tiles(SVGBitmap& target, SVGThreadPool& pool);
+	void render_fine(const SVGDocument& document, const SVGDisplayList& list, SVGBitmap& target, const SVGMatrix& device, const SVGPixelRect& clip, SVGThreadPool* pool);
+	std::unique_ptr<SVGRasterizer> acquire_rasterizer();
+	void release_rasterizer(std::unique_ptr<SVGRasterizer> raster);
+};
@@ -0,0 +1,359 @@
+#include "SVGSpatialIndex.h"
+#include "SVGStroke.h"
+#include <algorithm>
+#include <cmath>
+
+static bool contains(const SVGRect& r, SVGPoint p) {
+	return p.x >= r.left && p.x <= r.right && p.y >= r.top && p.y <= r.bottom;
+}
+
+static bool rects_intersect(const SVGRect& a, const SVGRect& b) {
+	return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
+
+static SVGRect union_rect(const SVGRect& a, const SVGRect& b) {
+	return SVGRect{ std::fmin(a.left, b.left), std::fmin(a.top, b.top), std::fmax(a.right, b.right), std::fmax(a.bottom, b.bottom) };
+}
+
+//Order that packs rects into runs of capacity: vertical slices by center x, each slice by center y
+static void pack_order(const std::vector<SVGRect>& rects, uint32_t capacity, std::vector<uint32_t>& order) {
+	struct Center {
+		float x, y;
+		uint32_t index;
+	};
+
+	size_t groups = (rects.size() + capacity - 1) / capacity;
+	size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(groups))));
+	size_t slice_size = slices * capacity;
+	//Sorted by value rather than through the indexes, which would miss the cache on every compare
+	std::vector<Center> centers(rects.size());
+
+	for (uint32_t i = 0; i < rects.size(); ++i) {
+		centers[i] = Center{ rects[i].left + rects[i].right, rects[i].top + rects[i].bottom, i };
+	}
+
+	std::sort(centers.begin(), centers.end(), [](const Center& a, const Center& b) {
+		return a.x < b.x;
+	});
+
+	for (size_t start = 0; start < centers.size(); start += slice_size) {
+		size_t end = std::min(start + slice_size, centers.size());
+
+		std::sort(centers.begin() + start, centers.begin() + end, [](const Center& a, const Center& b) {
+			return a.y < b.y;
+		});
+	}
+
+	order.resize(rects.size());
+
+	for (size_t i = 0; i < centers.size(); ++i) {
+		order[i] = centers[i].index;
+	}
+}
+
+//Winding number of the figures around p, each one closed
+static int winding_number(const SVGPolyline& polyline, SVGPoint p) {
+	int winding = 0;
+
+	for (const SVGPolylineFigure& figure : polyline.figures) {
+		const SVGPoint* points = polyline.points.data() + figure.first;
+
+		for (uint32_t i = 0; i < figure.count; ++i) {
+			SVGPoint a = points[i];
+			SVGPoint b = points[i + 1 < figure.count ? i + 1 : 0];
+			float side = (b.x - a.x) * (p.y - a.y) - (p.x - a.x) * (b.y - a.y);
+
+			if (a.y <= p.y) {
+				if (b.y > p.y && side > 0.0f) {
+					++winding;
+				}
+			}
+			else if (b.y <= p.y && side < 0.0f) {
+				--winding;
+			}
+		}
+	}
+
+	return winding;
+}
+
+void SVGSpatialIndex::clear() {
+	nodes.clear();
+	entries.clear();
+	entry_bounds.clear();
+	entry_slots.clear();
+	leaf_nodes.clear();
+	parents.clear();
+}
+
+void SVGSpatialIndex::build(const SVGDisplayList& list) {
+	std::vector<SVGRect> rects;
+	std::vector<uint32_t> order;
+	std::vector<SVGIndexNode> level;
+
+	clear();
+
+	if (list.items.empty()) {
+		return;
+	}
+
+	rects.reserve(list.items.size());
+
+	for (const SVGDisplayItem& item : list.items) {
+		rects.push_back(item.bounds);
+	}
+
+	pack_order(rects, capacity, order);
+	entries.swap(order);
+	entry_bounds.reserve(entries.size());
+
+	for (uint32_t item : entries) {
+		entry_bounds.push_back(rects[item]);
+	}
+
+	for (uint32_t start = 0; start < entries.size(); start += capacity) {
+		SVGIndexNode leaf;
+
+		leaf.first = start;
+		leaf.count = std::min(capacity, static_cast<uint32_t>(entries.size()) - start);
+		leaf.bounds = entry_bounds[start];
+
+		for (uint32_t i = start + 1; i < start + leaf.count; ++i) {
+			leaf.bounds = union_rect(leaf.bounds, entry_bounds[i]);
+		}
+
+		level.push_back(leaf);
+	}
+
+	//Each level is packed and stored, then its parents made from runs of it
+	while (level.size() > 1) {
+		uint32_t base = static_cast<uint32_t>(nodes.size());
+
+		rects.clear();
+
+		for (const SVGIndexNode& node : level) {
+			rects.push_back(node.bounds);
+		}
+
+		pack_order(rects, capacity, order);
+
+		for (uint32_t i : order) {
+			nodes.push_back(level[i]);
+		}
+
+		level.clear();
+
+		for (uint32_t start = base; start < nodes.size(); start += capacity) {
+			SVGIndexNode parent;
+
+			parent.first = start;
+			parent.count = std::min(capacity, static_cast<uint32_t>(nodes.size()) - start);
+			parent.bounds = nodes[start].bounds;
+			parent.leaf = false;
+
+			for (uint32_t i = start + 1; i < start + parent.count; ++i) {
+				parent.bounds = union_rect(parent.bounds, nodes[i].bounds);
+			}
+
+			level.push_back(parent);
+		}
+	}
+
+	//The root is last
+	nodes.push_back(level[0]);
+
+	//Links back up for update()
+	entry_slots.resize(entries.size());
+	leaf_nodes.resize((entries.size() + capacity - 1) / capacity);
+	parents.assign(nodes.size(), svg_no_item);
+
+	for (uint32_t slot = 0; slot < entries.size(); ++slot) {
+		entry_slots[entries[slot]] = slot;
+	}
+
+	for (uint32_t n = 0; n < nodes.size(); ++n) {
+		const SVGIndexNode& node = nodes[n];
+
+		if (node.leaf) {
+			leaf_nodes[node.first / capacity] = n;
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			parents[i] = n;
+		}
+	}
+}
+
+void SVGSpatialIndex::update(const SVGDisplayList& list, uint32_t item) {
+	uint32_t slot = entry_slots[item];
+
+	entry_bounds[slot] = list.items[item].bounds;
+
+	for (uint32_t n = leaf_nodes[slot / capacity]; n != svg_no_item; n = parents[n]) {
+		SVGIndexNode& node = nodes[n];
+
+		node.bounds = node.leaf ? entry_bounds[node.first] : nodes[node.first].bounds;
+
+		for (uint32_t i = node.first + 1; i < node.first + node.count; ++i) {
+			node.bounds = union_rect(node.bounds, node.leaf ? entry_bounds[i] : nodes[i].bounds);
+		}
+	}
+}
+
+uint32_t SVGSpatialIndex::hit_test(const SVGDocument& document, const SVGDisplayList& list, SVGPoint p) {
+	//Holds at most capacity - 1 nodes per level, plus one
+	uint32_t stack[256];
+	int depth = 0;
+
+	candidates.clear();
+
+	if (nodes.empty()) {
+		return svg_no_item;
+	}
+
+	stack[depth++] = static_cast<uint32_t>(nodes.size() - 1);
+
+	while (depth > 0) {
+		const SVGIndexNode& node = nodes[stack[--depth]];
+
+		if (!contains(node.bounds, p)) {
+			continue;
+		}
+
+		if (node.leaf) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				if (contains(entry_bounds[i], p)) {
+					candidates.push_back(entries[i]);
+				}
+			}
+		}
+		else {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				stack[depth++] = i;
+			}
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), std::greater<uint32_t>());
+
+	for (uint32_t item : candidates) {
+		if (hits(document, list.items[item], p)) {
+			return item;
+		}
+	}
+
+	return svg_no_item;
+}
+
+void SVGSpatialIndex::query(const SVGRect& rect, std::vector<uint32_t>& found) const {
+	uint32_t stack[256];
+	int depth = 0;
+
+	found.clear();
+
+	if (nodes.empty()) {
+		return;
+	}
+
+	stack[depth++] = static_cast<uint32_t>(nodes.size() - 1);
+
+	while (depth > 0) {
+		const SVGIndexNode& node = nodes[stack[--depth]];
+
+		if (!rects_intersect(node.bounds, rect)) {
+			continue;
+		}
+
+		if (node.leaf) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				if (rects_intersect(entry_bounds[i], rect)) {
+					found.push_back(entries[i]);
+				}
+			}
+		}
+		else {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				stack[depth++] = i;
+			}
+		}
+	}
+
+	std::sort(found.begin(), found.end());
+}
+
+//Tests the shape the renderers draw, flattened in local space finely enough for a pointer
+bool SVGSpatialIndex::hits(const SVGDocument& document, const SVGDisplayItem& item, SVGPoint p) {
+	const SVGStyle* style = document.nodes[item.resource].style;
+	const float* g = item.geometry;
+	SVGMatrix inverse;
+	SVGFillRule rule = SVGFillRule::NonZero;
+	bool is_fill = false;
+
+	if (item.op == SVGDrawOp::FillText) {
+		return true;
+	}
+
+	if (!svg_invert(item.transform, inverse)) {
+		return false;
+	}
+
+	SVGPoint local = svg_transform_point(inverse, p);
+	float tolerance = svg_flatten_tolerance(item.transform, 0.25f);
+
+	shape.clear();
+
+	switch (item.op) {
+	case SVGDrawOp::FillRect:
+		is_fill = true;
+		[[fallthrough]];
+	case SVGDrawOp::StrokeRect:
+		shape.move_to(SVGPoint{ g[0], g[1] });
+		shape.line_to(SVGPoint{ g[0] + g[2], g[1] });
+		shape.line_to(SVGPoint{ g[0] + g[2], g[1] + g[3] });
+		shape.line_to(SVGPoint{ g[0], g[1] + g[3] });
+		shape.close();
+
+		break;
+	case SVGDrawOp::FillEllipse:
+		is_fill = true;
+		[[fallthrough]];
+	case SVGDrawOp::StrokeEllipse:
+		svg_flatten_ellipse(g[0], g[1], g[2], g[3], SVGMatrix::identity(), tolerance, shape);
+
+		break;
+	case SVGDrawOp::StrokeLine:
+		shape.move_to(SVGPoint{ g[0], g[1] });
+		shape.line_to(SVGPoint{ g[2], g[3] });
+
+		break;
+	case SVGDrawOp::FillPath:
+		is_fill = true;
+		rule = style->fill_rule;
+		[[fallthrough]];
+	case SVGDrawOp::StrokePath:
+		svg_flatten_path(document.path(item.payload), SVGMatrix::identity(), tolerance, shape);
+
+		break;
+	default:
+		return false;
+	}
+
+	if (is_fill) {
+		int winding = winding_number(shape, local);
+
+		return rule == SVGFillRule::EvenOdd ? (winding & 1) != 0 : winding != 0;
+	}
+
+	SVGStrokeStyle stroke_style;
+
+	stroke_style.width = item.stroke_width;
+	stroke_style.cap = style->stroke_linecap;
+	stroke_style.join = style->stroke_linejoin;
+	stroke_style.miterlimit = style->stroke_miterlimit;
+
+	stroke.clear();
+	svg_stroke_polyline(shape, stroke_style, tolerance, stroke);
+
+	return winding_number(stroke, local) != 0;
+}
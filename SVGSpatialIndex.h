@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SVGDisplayList.h"
+#include "SVGDocument.h"
+#include "SVGFlatten.h"
+#include "SVGTransform.h"
+
+const uint32_t svg_no_item = 0xFFFFFFFFu;
+
+//Node of SVGSpatialIndex. A leaf holds entries, the others hold nodes, in both
+//cases count of them from first.
+struct SVGIndexNode {
+	SVGRect bounds;
+	uint32_t first = 0;
+	uint32_t count = 0;
+	bool leaf = true;
+};
+
+//Bounding volume hierarchy over the entries of a display list, in world space.
+//
+//Built bottom up by sort-tile-recursive packing: the entries are sorted into
+//vertical slices by x, each slice by y, and cut into leaves of capacity entries.
+//The leaves are packed the same way into parents, up to a single root. Nodes
+//live in one array, children before their parent, each node's children together.
+class SVGSpatialIndex {
+public:
+	//Entries or nodes under one node
+	static constexpr uint32_t capacity = 8;
+
+	void clear();
+
+	//Indexes every entry of list
+	void build(const SVGDisplayList& list);
+
+	//Takes the bounds entry item has in list now and fits the nodes above it. The
+	//tree keeps its shape, so queries stay exact, but once many entries moved far
+	//build() gives a faster one. list must have the entries the index was built from.
+	void update(const SVGDisplayList& list, uint32_t item);
+
+	bool empty() const {
+		return nodes.empty();
+	}
+
+	//The topmost entry, last in paint order, that paints the point p, or svg_no_item.
+	//Bounds only pick the candidates, which are then tried from the top down. One is
+	//hit when its fill covers p with its fill rule, or its stroke outline does. Text
+	//is hit anywhere in its bounds.
+	uint32_t hit_test(const SVGDocument& document, const SVGDisplayList& list, SVGPoint p);
+
+	//Writes the entries whose bounds meet rect, in paint order
+	void query(const SVGRect& rect, std::vector<uint32_t>& found) const;
+
+private:
+	std::vector<SVGIndexNode> nodes;
+	//Display list indexes and their bounds, in the order of the leaves
+	std::vector<uint32_t> entries;
+	std::vector<SVGRect> entry_bounds;
+	//Where each display list entry is in entries
+	std::vector<uint32_t> entry_slots;
+	//The leaf of every capacity entries, and the parent of each node
+	std::vector<uint32_t> leaf_nodes;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> candidates;
+	//Shape of the entry being hit tested, in its local space
+	SVGPolyline shape;
+	SVGPolyline stroke;
+
+	bool hits(const SVGDocument& document, const SVGDisplayItem& item, SVGPoint p);
+};
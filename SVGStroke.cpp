@@ -0,0 +1,309 @@
+#include "SVGStroke.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+static const double svg_pi = 3.14159265358979323846;
+
+static void hash_combine(size_t& h, size_t v) {
+	h ^= v + 0x9E3779B9u + (h << 6) + (h >> 2);
+}
+
+static uint32_t float_bits(float f) {
+	uint32_t bits;
+
+	std::memcpy(&bits, &f, sizeof(bits));
+
+	return bits;
+}
+
+//Closes the figure just added to outline. Pieces all wind the same way, with a
+//negative area, so that they add up under the non-zero rule. Flat ones are dropped.
+static void finish_piece(SVGPolyline& outline) {
+	SVGPolylineFigure& figure = outline.figures.back();
+	SVGPoint* p = outline.points.data() + figure.first;
+	float area = 0.0f;
+
+	for (uint32_t i = 0, j = figure.count - 1; i < figure.count; j = i++) {
+		area += p[j].x * p[i].y - p[i].x * p[j].y;
+	}
+
+	if (area == 0.0f || !std::isfinite(area)) {
+		outline.points.resize(figure.first);
+		outline.figures.pop_back();
+		return;
+	}
+
+	if (area > 0.0f) {
+		std::reverse(p, p + figure.count);
+	}
+
+	figure.closed = true;
+}
+
+//Circular sector around c from c + v, turning by sweep radians
+static void add_fan(SVGPolyline& outline, SVGPoint c, SVGPoint v, double sweep, float radius, float tolerance) {
+	int n = svg_arc_segments(radius, sweep, tolerance);
+	double step_cos = std::cos(sweep / n), step_sin = std::sin(sweep / n);
+	double x = v.x, y = v.y;
+
+	outline.move_to(c);
+	outline.line_to(SVGPoint{ c.x + v.x, c.y + v.y });
+
+	for (int i = 1; i <= n; ++i) {
+		double rx = x * step_cos - y * step_sin;
+		double ry = x * step_sin + y * step_cos;
+
+		x = rx;
+		y = ry;
+		outline.line_to(SVGPoint{ c.x + static_cast<float>(x), c.y + static_cast<float>(y) });
+	}
+
+	finish_piece(outline);
+}
+
+//Half turn from v towards d
+static double half_turn(SVGPoint v, SVGPoint d) {
+	//Turning v by a positive quarter gives (-v.y, v.x)
+	return -v.y * d.x + v.x * d.y >= 0.0f ? svg_pi : -svg_pi;
+}
+
+static void add_segment(SVGPolyline& outline, SVGPoint a, SVGPoint b, SVGPoint d, float half_width) {
+	float nx = -d.y * half_width, ny = d.x * half_width;
+
+	outline.move_to(SVGPoint{ a.x + nx, a.y + ny });
+	outline.line_to(SVGPoint{ b.x + nx, b.y + ny });
+	outline.line_to(SVGPoint{ b.x - nx, b.y - ny });
+	outline.line_to(SVGPoint{ a.x - nx, a.y - ny });
+	finish_piece(outline);
+}
+
+//Fills the gap on the outer side of the corner at p, where direction d0 turns into d1.
+//The inner side is already covered twice by the two segments.
+static void add_join(SVGPolyline& outline, SVGPoint p, SVGPoint d0, SVGPoint d1, float half_width, const SVGStrokeStyle& style, float tolerance) {
+	float cross = d0.x * d1.y - d0.y * d1.x;
+	float dot = d0.x * d1.x + d0.y * d1.y;
+
+	if (std::fabs(cross) < 1e-6f && dot > 0.0f) {
+		//Straight on
+		return;
+	}
+
+	float side = cross > 0.0f ? -half_width : half_width;
+	SVGPoint n0{ -d0.y * side, d0.x * side };
+	SVGPoint n1{ -d1.y * side, d1.x * side };
+
+	switch (style.join) {
+	case SVGLineJoin::Round: {
+		double sweep = std::fabs(cross) < 1e-6f ?
+			half_turn(n0, d0) :
+			std::atan2(n0.x * n1.y - n0.y * n1.x, n0.x * n1.x + n0.y * n1.y);
+
+		add_fan(outline, p, n0, sweep, half_width, tolerance);
+
+		break;
+	}
+	case SVGLineJoin::Miter:
+		//Miter length over stroke width is 1 / sin(angle / 2)
+		if (dot > -1.0f && 1.0f <= style.miterlimit * std::sqrt((1.0f + dot) * 0.5f)) {
+			float k = 1.0f / (1.0f + dot);
+
+			outline.move_to(p);
+			outline.line_to(SVGPoint{ p.x + n0.x, p.y + n0.y });
+			outline.line_to(SVGPoint{ p.x + (n0.x + n1.x) * k, p.y + (n0.y + n1.y) * k });
+			outline.line_to(SVGPoint{ p.x + n1.x, p.y + n1.y });
+			finish_piece(outline);
+
+			break;
+		}
+
+		//Over the limit, falls back to bevel
+		[[fallthrough]];
+	case SVGLineJoin::Bevel:
+		outline.move_to(p);
+		outline.line_to(SVGPoint{ p.x + n0.x, p.y + n0.y });
+		outline.line_to(SVGPoint{ p.x + n1.x, p.y + n1.y });
+		finish_piece(outline);
+
+		break;
+	}
+}
+
+//Cap at the open end p of a figure. d points out of the figure.
+static void add_cap(SVGPolyline& outline, SVGPoint p, SVGPoint d, float half_width, const SVGStrokeStyle& style, float tolerance) {
+	SVGPoint n{ -d.y * half_width, d.x * half_width };
+
+	switch (style.cap) {
+	case SVGLineCap::Butt:
+		break;
+	case SVGLineCap::Square: {
+		float ex = d.x * half_width, ey = d.y * half_width;
+
+		outline.move_to(SVGPoint{ p.x + n.x, p.y + n.y });
+		outline.line_to(SVGPoint{ p.x + n.x + ex, p.y + n.y + ey });
+		outline.line_to(SVGPoint{ p.x - n.x + ex, p.y - n.y + ey });
+		outline.line_to(SVGPoint{ p.x - n.x, p.y - n.y });
+		finish_piece(outline);
+
+		break;
+	}
+	case SVGLineCap::Round:
+		add_fan(outline, p, n, half_turn(n, d), half_width, tolerance);
+
+		break;
+	}
+}
+
+static bool direction(SVGPoint a, SVGPoint b, SVGPoint& d) {
+	float dx = b.x - a.x, dy = b.y - a.y;
+	float length = std::sqrt(dx * dx + dy * dy);
+
+	if (!(length > 0.0f) || !std::isfinite(length)) {
+		return false;
+	}
+
+	d = SVGPoint{ dx / length, dy / length };
+
+	return true;
+}
+
+static void stroke_figure(const SVGPoint* p, uint32_t count, bool closed, const SVGStrokeStyle& style, float half_width, float tolerance, SVGPolyline& outline) {
+	//A closed figure that ends where it started doesn't need the closing line
+	while (closed && count > 1 && p[count - 1].x == p[0].x && p[count - 1].y == p[0].y) {
+		--count;
+	}
+
+	//Find the first segment of non-zero length
+	SVGPoint first_dir;
+	uint32_t i = 1;
+
+	while (i < count && !direction(p[0], p[i], first_dir)) {
+		++i;
+	}
+
+	if (i >= count) {
+		//Zero length. Only the caps show, as a dot.
+		if (!closed) {
+			if (style.cap == SVGLineCap::Round) {
+				add_fan(outline, p[0], SVGPoint{ half_width, 0.0f }, 2.0 * svg_pi, half_width, tolerance);
+			}
+			else if (style.cap == SVGLineCap::Square) {
+				add_cap(outline, p[0], SVGPoint{ 1.0f, 0.0f }, half_width, style, tolerance);
+				add_cap(outline, p[0], SVGPoint{ -1.0f, 0.0f }, half_width, style, tolerance);
+			}
+		}
+
+		return;
+	}
+
+	SVGPoint dir = first_dir;
+	uint32_t last = i;
+
+	add_segment(outline, p[0], p[i], dir, half_width);
+
+	for (++i; i < count; ++i) {
+		SVGPoint next_dir;
+
+		if (!direction(p[last], p[i], next_dir)) {
+			continue;
+		}
+
+		add_join(outline, p[last], dir, next_dir, half_width, style, tolerance);
+		add_segment(outline, p[last], p[i], next_dir, half_width);
+		dir = next_dir;
+		last = i;
+	}
+
+	if (closed) {
+		SVGPoint close_dir;
+
+		if (direction(p[last], p[0], close_dir)) {
+			add_join(outline, p[last], dir, close_dir, half_width, style, tolerance);
+			add_segment(outline, p[last], p[0], close_dir, half_width);
+			dir = close_dir;
+		}
+
+		add_join(outline, p[0], dir, first_dir, half_width, style, tolerance);
+	}
+	else {
+		add_cap(outline, p[0], SVGPoint{ -first_dir.x, -first_dir.y }, half_width, style, tolerance);
+		add_cap(outline, p[last], dir, half_width, style, tolerance);
+	}
+}
+
+void svg_stroke_polyline(const SVGPolyline& input, const SVGStrokeStyle& style, float tolerance, SVGPolyline& outline) {
+	float half_width = style.width * 0.5f;
+
+	if (!(half_width > 0.0f)) {
+		return;
+	}
+
+	//A quad per segment plus a join wedge
+	outline.points.reserve(outline.points.size() + input.points.size() * 7);
+	outline.figures.reserve(outline.figures.size() + input.points.size() * 2);
+
+	for (const SVGPolylineFigure& figure : input.figures) {
+		stroke_figure(input.points.data() + figure.first, figure.count, figure.closed, style, half_width, tolerance, outline);
+	}
+}
+
+bool SVGStrokeKey::operator==(const SVGStrokeKey& other) const {
+	return source == other.source &&
+		index == other.index &&
+		geometry[0] == other.geometry[0] && geometry[1] == other.geometry[1] &&
+		geometry[2] == other.geometry[2] && geometry[3] == other.geometry[3] &&
+		style.width == other.style.width &&
+		style.cap == other.style.cap &&
+		style.join == other.style.join &&
+		style.miterlimit == other.style.miterlimit &&
+		tolerance == other.tolerance;
+}
+
+size_t SVGStrokeKey::hash() const {
+	size_t h = static_cast<size_t>(source) | static_cast<size_t>(style.cap) << 8 | static_cast<size_t>(style.join) << 16;
+
+	hash_combine(h, index);
+
+	for (float g : geometry) {
+		//+0 and -0 compare equal so they must hash the same
+		hash_combine(h, g == 0.0f ? 0 : float_bits(g));
+	}
+
+	hash_combine(h, float_bits(style.width));
+	hash_combine(h, float_bits(style.miterlimit));
+	hash_combine(h, float_bits(tolerance));
+
+	return h;
+}
+
+const SVGPolyline* SVGStrokeCache::find(const SVGStrokeKey& key) {
+	auto it = index.find(key);
+
+	if (it == index.end()) {
+		++misses;
+		return nullptr;
+	}
+
+	++hits;
+
+	return &outlines[it->second];
+}
+
+const SVGPolyline* SVGStrokeCache::insert(const SVGStrokeKey& key, SVGPolyline&& outline) {
+	if (points + outline.points.size() > max_points) {
+		clear();
+	}
+
+	points += outline.points.size();
+	outlines.push_back(std::move(outline));
+	index[key] = outlines.size() - 1;
+
+	return &outlines.back();
+}
+
+void SVGStrokeCache::clear() {
+	outlines.clear();
+	index.clear();
+	points = 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include "SVGFlatten.h"
+#include "SVGStyle.h"
+
+struct SVGStrokeStyle {
+	float width = 1.0f;
+	SVGLineCap cap = SVGLineCap::Butt;
+	SVGLineJoin join = SVGLineJoin::Miter;
+	float miterlimit = 4.0f;
+};
+
+//Appends to outline the area that stroking the figures of input covers.
+//
+//Every segment becomes a quad, every corner a join wedge and every open end a cap,
+//all wound the same way. Filling outline with the non-zero rule paints their union,
+//so no piece has to be clipped against another and the work is linear in the number
+//of segments. Round joins and caps are flattened within tolerance.
+void svg_stroke_polyline(const SVGPolyline& input, const SVGStrokeStyle& style, float tolerance, SVGPolyline& outline);
+
+//What a stroke outline was built from
+enum class SVGStrokeSource : uint8_t {
+	Path,		//index: path index
+	Rect,		//geometry
+	Ellipse,
+	Line,
+	Batch		//index: first display list entry, geometry[0]: entry count
+};
+
+struct SVGStrokeKey {
+	SVGStrokeSource source = SVGStrokeSource::Path;
+	uint32_t index = 0;
+	float geometry[4] = {};
+	SVGStrokeStyle style;
+	//Flattening tolerance in user units
+	float tolerance = 0.0f;
+
+	bool operator==(const SVGStrokeKey& other) const;
+	size_t hash() const;
+};
+
+//Stroke outlines in user space, shared by every draw of the same geometry with the
+//same stroke. <use> copies of a path and repeated frames reuse the outline.
+class SVGStrokeCache {
+public:
+	//When the outlines hold more points than this the cache starts over
+	size_t max_points = 8u << 20;
+	size_t hits = 0;
+	size_t misses = 0;
+
+	//Null when the outline isn't cached
+	const SVGPolyline* find(const SVGStrokeKey& key);
+
+	//Takes the outline. The result stays valid until the next insert() or clear().
+	const SVGPolyline* insert(const SVGStrokeKey& key, SVGPolyline&& outline);
+
+	void clear();
+
+	size_t point_count() const {
+		return points;
+	}
+
+private:
+	struct KeyHash {
+		size_t operator()(const SVGStrokeKey& key) const {
+			return key.hash();
+		}
+	};
+
+	std::deque<SVGPolyline> outlines;
+	std::unordered_map<SVGStrokeKey, size_t, KeyHash> index;
+	size_t points = 0;
+};
@@ -0,0 +1,481 @@
+#include "SVGStyle.h"
+#include "SVGColor.h"
+#include "SVGPathLexer.h"
+#include "SVGPerfectHash.h"
+
+static const std::string_view default_font_family = "Arial, sans-serif, Verdana";
+
+bool SVGStyle::operator==(const SVGStyle& other) const {
+	return specified == other.specified &&
+		fill.type == other.fill.type && fill.rgba == other.fill.rgba &&
+		stroke.type == other.stroke.type && stroke.rgba == other.stroke.rgba &&
+		color == other.color &&
+		fill_opacity == other.fill_opacity &&
+		stroke_opacity == other.stroke_opacity &&
+		stroke_width.value == other.stroke_width.value && stroke_width.unit == other.stroke_width.unit &&
+		stroke_miterlimit == other.stroke_miterlimit &&
+		font_size.value == other.font_size.value && font_size.unit == other.font_size.unit &&
+		font_family == other.font_family &&
+		font_weight == other.font_weight &&
+		stroke_linecap == other.stroke_linecap &&
+		stroke_linejoin == other.stroke_linejoin &&
+		font_style == other.font_style &&
+		white_space == other.white_space &&
+		fill_rule == other.fill_rule;
+}
+
+static void hash_combine(size_t& h, size_t v) {
+	h ^= v + 0x9E3779B9u + (h << 6) + (h >> 2);
+}
+
+static size_t hash_float(float f) {
+	//+0 and -0 compare equal so they must hash the same
+	return f == 0.0f ? 0 : std::hash<float>()(f);
+}
+
+size_t SVGStyle::hash() const {
+	size_t h = specified;
+
+	hash_combine(h, static_cast<size_t>(fill.type));
+	hash_combine(h, fill.rgba);
+	hash_combine(h, static_cast<size_t>(stroke.type));
+	hash_combine(h, stroke.rgba);
+	hash_combine(h, color);
+	hash_combine(h, hash_float(fill_opacity));
+	hash_combine(h, hash_float(stroke_opacity));
+	hash_combine(h, hash_float(stroke_width.value) ^ static_cast<size_t>(stroke_width.unit));
+	hash_combine(h, hash_float(stroke_miterlimit));
+	hash_combine(h, hash_float(font_size.value) ^ static_cast<size_t>(font_size.unit));
+	hash_combine(h, std::hash<const void*>()(font_family));
+	hash_combine(h, font_weight);
+	hash_combine(h, static_cast<size_t>(stroke_linecap) | static_cast<size_t>(stroke_linejoin) << 8 |
+		static_cast<size_t>(font_style) << 16 | static_cast<size_t>(white_space) << 24 |
+		static_cast<size_t>(fill_rule) << 28);
+
+	return h;
+}
+
+SVGStyleCache::SVGStyleCache() {
+	clear();
+}
+
+void SVGStyleCache::clear() {
+	resolved.clear();
+	block_set.clear();
+	blocks.clear();
+	string_set.clear();
+	strings.clear();
+
+	SVGStyle initial;
+
+	initial.font_family = intern_string(default_font_family);
+	initial_style = intern(initial);
+}
+
+const SVGStyle* SVGStyleCache::intern(const SVGStyle& style) {
+	auto it = block_set.find(&style);
+
+	if (it != block_set.end()) {
+		return *it;
+	}
+
+	blocks.push_back(style);
+	block_set.insert(&blocks.back());
+
+	return &blocks.back();
+}
+
+const std::string* SVGStyleCache::intern_string(std::string_view s) {
+	auto it = string_set.find(s);
+
+	if (it != string_set.end()) {
+		return it->second;
+	}
+
+	strings.emplace_back(s);
+
+	const std::string* interned = &strings.back();
+
+	//The key views the interned copy, which never moves
+	string_set.emplace(std::string_view(*interned), interned);
+
+	return interned;
+}
+
+static std::string_view trim_style_value(std::string_view s) {
+	while (!s.empty() && (s.front() == ' ' || s.front() == '\t' || s.front() == '\r' || s.front() == '\n')) {
+		s.remove_prefix(1);
+	}
+
+	while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r' || s.back() == '\n')) {
+		s.remove_suffix(1);
+	}
+
+	return s;
+}
+
+static bool parse_paint(std::string_view value, SVGPaint& paint) {
+	uint32_t rgba = 0;
+
+	switch (svg_parse_color(value, rgba)) {
+	case SVGColorType::None:
+		paint = SVGPaint{ SVGPaintType::None, 0 };
+
+		return true;
+	case SVGColorType::Color:
+		paint = SVGPaint{ SVGPaintType::Color, rgba };
+
+		return true;
+	case SVGColorType::CurrentColor:
+		paint = SVGPaint{ SVGPaintType::CurrentColor, 0 };
+
+		return true;
+	default:
+		return false;
+	}
+}
+
+//Opacity is a number or a percentage, clamped to [0, 1]
+static bool parse_opacity(std::string_view value, float& opacity) {
+	SVGLength length;
+
+	if (!svg_parse_length(value, length)) {
+		return false;
+	}
+
+	if (length.unit == SVGLengthUnit::Percent) {
+		length.value /= 100.0f;
+	}
+	else if (length.unit != SVGLengthUnit::None) {
+		return false;
+	}
+
+	opacity = length.value < 0.0f ? 0.0f : (length.value > 1.0f ? 1.0f : length.value);
+
+	return true;
+}
+
+static bool parse_font_weight(std::string_view value, uint16_t& weight) {
+	static const struct {
+		std::string_view name;
+		uint16_t weight;
+	} keywords[] = {
+		{ "normal", 400 },
+		{ "bold", 700 },
+		{ "thin", 100 },
+		{ "light", 300 },
+		{ "medium", 500 },
+		{ "semibold", 600 },
+		{ "black", 900 }
+	};
+
+	for (const auto& k : keywords) {
+		if (svg_equals_ignore_case(value, k.name)) {
+			weight = k.weight;
+
+			return true;
+		}
+	}
+
+	float number;
+
+	if (svg_parse_number(value, number) == value.size() && number >= 1.0f && number <= 1000.0f) {
+		weight = static_cast<uint16_t>(number);
+
+		return true;
+	}
+
+	return false;
+}
+
+bool SVGStyleCache::parse_property(SVGAttr attr, std::string_view value, SVGStyle& declared) {
+	uint32_t bit = svg_style_bit(attr);
+
+	value = trim_style_value(value);
+
+	if (svg_equals_ignore_case(value, "inherit")) {
+		//Every property here is inherited, so this is the same as not setting it
+		declared.specified &= ~bit;
+
+		return true;
+	}
+
+	bool ok = false;
+
+	switch (attr) {
+	case SVGAttr::Color: {
+		uint32_t rgba = 0;
+
+		//currentColor on color itself means inherit
+		if (svg_parse_color(value, rgba) == SVGColorType::Color) {
+			declared.color = rgba;
+			ok = true;
+		}
+
+		break;
+	}
+	case SVGAttr::Fill:
+		ok = parse_paint(value, declared.fill);
+
+		break;
+	case SVGAttr::Stroke:
+		ok = parse_paint(value, declared.stroke);
+
+		break;
+	case SVGAttr::FillOpacity:
+		ok = parse_opacity(value, declared.fill_opacity);
+
+		break;
+	case SVGAttr::StrokeOpacity:
+		ok = parse_opacity(value, declared.stroke_opacity);
+
+		break;
+	case SVGAttr::StrokeWidth: {
+		SVGLength length;
+
+		if (svg_parse_length(value, length) && length.value >= 0.0f) {
+			declared.stroke_width = length;
+			ok = true;
+		}
+
+		break;
+	}
+	case SVGAttr::StrokeMiterlimit: {
+		SVGLength length;
+
+		if (svg_parse_length(value, length) && length.unit == SVGLengthUnit::None && length.value >= 1.0f) {
+			declared.stroke_miterlimit = length.value;
+			ok = true;
+		}
+
+		break;
+	}
+	case SVGAttr::StrokeLinecap:
+		ok = true;
+
+		if (svg_equals_ignore_case(value, "butt")) {
+			declared.stroke_linecap = SVGLineCap::Butt;
+		}
+		else if (svg_equals_ignore_case(value, "round")) {
+			declared.stroke_linecap = SVGLineCap::Round;
+		}
+		else if (svg_equals_ignore_case(value, "square")) {
+			declared.stroke_linecap = SVGLineCap::Square;
+		}
+		else {
+			ok = false;
+		}
+
+		break;
+	case SVGAttr::StrokeLinejoin:
+		ok = true;
+
+		if (svg_equals_ignore_case(value, "miter") || svg_equals_ignore_case(value, "miter-clip")) {
+			declared.stroke_linejoin = SVGLineJoin::Miter;
+		}
+		else if (svg_equals_ignore_case(value, "round")) {
+			declared.stroke_linejoin = SVGLineJoin::Round;
+		}
+		else if (svg_equals_ignore_case(value, "bevel")) {
+			declared.stroke_linejoin = SVGLineJoin::Bevel;
+		}
+		else {
+			ok = false;
+		}
+
+		break;
+	case SVGAttr::FontFamily:
+		if (!value.empty()) {
+			declared.font_family = intern_string(value);
+			ok = true;
+		}
+
+		break;
+	case SVGAttr::FontSize: {
+		SVGLength length;
+
+		if (svg_parse_length(value, length) && length.value >= 0.0f) {
+			declared.font_size = length;
+			ok = true;
+		}
+
+		break;
+	}
+	case SVGAttr::FontWeight:
+		ok = parse_font_weight(value, declared.font_weight);
+
+		break;
+	case SVGAttr::FontStyle:
+		ok = true;
+
+		if (svg_equals_ignore_case(value, "normal")) {
+			declared.font_style = SVGFontStyle::Normal;
+		}
+		else if (svg_equals_ignore_case(value, "italic")) {
+			declared.font_style = SVGFontStyle::Italic;
+		}
+		else if (svg_equals_ignore_case(value, "oblique")) {
+			declared.font_style = SVGFontStyle::Oblique;
+		}
+		else {
+			ok = false;
+		}
+
+		break;
+	case SVGAttr::WhiteSpace:
+		ok = true;
+
+		if (svg_equals_ignore_case(value, "normal")) {
+			declared.white_space = SVGWhiteSpace::Normal;
+		}
+		else if (svg_equals_ignore_case(value, "nowrap")) {
+			declared.white_space = SVGWhiteSpace::NoWrap;
+		}
+		else if (svg_equals_ignore_case(value, "pre")) {
+			declared.white_space = SVGWhiteSpace::Pre;
+		}
+		else if (svg_equals_ignore_case(value, "pre-wrap")) {
+			declared.white_space = SVGWhiteSpace::PreWrap;
+		}
+		else if (svg_equals_ignore_case(value, "pre-line")) {
+			declared.white_space = SVGWhiteSpace::PreLine;
+		}
+		else {
+			ok = false;
+		}
+
+		break;
+	case SVGAttr::FillRule:
+		ok = true;
+
+		if (svg_equals_ignore_case(value, "nonzero")) {
+			declared.fill_rule = SVGFillRule::NonZero;
+		}
+		else if (svg_equals_ignore_case(value, "evenodd")) {
+			declared.fill_rule = SVGFillRule::EvenOdd;
+		}
+		else {
+			ok = false;
+		}
+
+		break;
+	default:
+		break;
+	}
+
+	if (ok) {
+		declared.specified |= bit;
+	}
+
+	return ok;
+}
+
+void SVGStyleCache::parse_style_attribute(std::string_view style, SVGStyle& declared) {
+	while (!style.empty()) {
+		size_t end = style.find(';');
+		std::string_view decl = style.substr(0, end);
+		size_t colon = decl.find(':');
+
+		style = end == std::string_view::npos ? std::string_view() : style.substr(end + 1);
+
+		if (colon == std::string_view::npos) {
+			continue;
+		}
+
+		SVGAttr attr = svg_lookup_attribute(trim_style_value(decl.substr(0, colon)));
+
+		//Only presentation properties can be set from CSS
+		if (attr >= svg_first_presentation_attribute && attr < SVGAttr::Count) {
+			parse_property(attr, decl.substr(colon + 1), declared);
+		}
+	}
+}
+
+const SVGStyle* SVGStyleCache::resolve(const SVGStyle* parent, const SVGStyle* declared) {
+	if (declared == nullptr || declared->specified == 0) {
+		return parent;
+	}
+
+	auto key = std::make_pair(parent, declared);
+	auto it = resolved.find(key);
+
+	if (it != resolved.end()) {
+		return it->second;
+	}
+
+	SVGStyle computed = *parent;
+	uint32_t s = declared->specified;
+
+	computed.specified = 0;
+
+	if (s & svg_style_bit(SVGAttr::Color)) {
+		computed.color = declared->color;
+	}
+
+	if (s & svg_style_bit(SVGAttr::Fill)) {
+		computed.fill = declared->fill;
+	}
+
+	if (s & svg_style_bit(SVGAttr::FillOpacity)) {
+		computed.fill_opacity = declared->fill_opacity;
+	}
+
+	if (s & svg_style_bit(SVGAttr::StrokeOpacity)) {
+		computed.stroke_opacity = declared->stroke_opacity;
+	}
+
+	if (s & svg_style_bit(SVGAttr::StrokeLinecap)) {
+		computed.stroke_linecap = declared->stroke_linecap;
+	}
+
+	if (s & svg_style_bit(SVGAttr::StrokeLinejoin)) {
+		computed.stroke_linejoin = declared->stroke_linejoin;
+	}
+
+	if (s & svg_style_bit(SVGAttr::StrokeMiterlimit)) {
+		computed.stroke_miterlimit = declared->stroke_miterlimit;
+	}
+
+	if (s & svg_style_bit(SVGAttr::Stroke)) {
+		computed.stroke = declared->stroke;
+	}
+
+	if (s & svg_style_bit(SVGAttr::StrokeWidth)) {
+		computed.stroke_width = declared->stroke_width;
+	}
+
+	if (s & svg_style_bit(SVGAttr::FontFamily)) {
+		computed.font_family = declared->font_family;
+	}
+
+	if (s & svg_style_bit(SVGAttr::FontWeight)) {
+		computed.font_weight = declared->font_weight;
+	}
+
+	if (s & svg_style_bit(SVGAttr::FontStyle)) {
+		computed.font_style = declared->font_style;
+	}
+
+	if (s & svg_style_bit(SVGAttr::WhiteSpace)) {
+		computed.white_space = declared->white_space;
+	}
+
+	if (s & svg_style_bit(SVGAttr::FillRule)) {
+		computed.fill_rule = declared->fill_rule;
+	}
+
+	if (s & svg_style_bit(SVGAttr::FontSize)) {
+		//em and % are relative to the parent's font size
+		SVGLengthContext context;
+
+		context.dpi = dpi;
+		context.font_size = parent->font_size.value;
+		computed.font_size = SVGLength{ context.font_size_to_user_units(declared->font_size), SVGLengthUnit::None };
+	}
+
+	const SVGStyle* result = intern(computed);
+
+	resolved.emplace(key, result);
+
+	return result;
+}
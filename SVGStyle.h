@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include "SVGLength.h"
+#include "SVGNames.h"
+
+enum class SVGPaintType : uint8_t {
+	None,
+	Color,
+	CurrentColor
+};
+
+struct SVGPaint {
+	SVGPaintType type = SVGPaintType::None;
+	uint32_t rgba = 0;	//0xRRGGBBAA, used when type is Color
+};
+
+enum class SVGLineCap : uint8_t {
+	Butt,
+	Round,
+	Square
+};
+
+enum class SVGLineJoin : uint8_t {
+	Miter,
+	Round,
+	Bevel
+};
+
+enum class SVGFontStyle : uint8_t {
+	Normal,
+	Italic,
+	Oblique
+};
+
+enum class SVGFillRule : uint8_t {
+	NonZero,
+	EvenOdd
+};
+
+enum class SVGWhiteSpace : uint8_t {
+	Normal,
+	NoWrap,
+	Pre,
+	PreWrap,
+	PreLine
+};
+
+//Bit of a presentation attribute in SVGStyle::specified
+inline uint32_t svg_style_bit(SVGAttr attr) {
+	return 1u << (static_cast<unsigned int>(attr) - static_cast<unsigned int>(svg_first_presentation_attribute));
+}
+
+//Typed values of the presentation properties. All of them are inherited.
+//
+//A declared block holds what one element sets, with a bit in specified for each property.
+//A computed block holds every property for an element, with the font size in user units.
+//
+//Blocks are interned in an SVGStyleCache and shared by every element with the same values,
+//so they must not be changed. To change a style, intern a modified copy.
+struct SVGStyle {
+	uint32_t specified = 0;
+	SVGPaint fill{ SVGPaintType::Color, 0x000000FF };
+	SVGPaint stroke;
+	uint32_t color = 0x000000FF;
+	float fill_opacity = 1.0f;
+	float stroke_opacity = 1.0f;
+	SVGLength stroke_width{ 1.0f, SVGLengthUnit::None };
+	float stroke_miterlimit = 4.0f;
+	SVGLength font_size{ 12.0f, SVGLengthUnit::None };
+	const std::string* font_family = nullptr;	//Interned by the cache
+	uint16_t font_weight = 400;
+	SVGLineCap stroke_linecap = SVGLineCap::Butt;
+	SVGLineJoin stroke_linejoin = SVGLineJoin::Miter;
+	SVGFontStyle font_style = SVGFontStyle::Normal;
+	SVGWhiteSpace white_space = SVGWhiteSpace::Normal;
+	SVGFillRule fill_rule = SVGFillRule::NonZero;
+
+	bool operator==(const SVGStyle& other) const;
+	size_t hash() const;
+};
+
+//Owns the style blocks of one document.
+class SVGStyleCache {
+public:
+	//Used to resolve absolute font sizes like 12pt
+	float dpi = 96.0f;
+
+	SVGStyleCache();
+
+	SVGStyleCache(const SVGStyleCache&) = delete;
+	SVGStyleCache& operator=(const SVGStyleCache&) = delete;
+
+	//Frees all blocks. Nothing may point to them afterwards.
+	void clear();
+
+	//Computed style of the root, with the default value of every property
+	const SVGStyle* initial() const {
+		return initial_style;
+	}
+
+	//Returns the shared block with the same values as style
+	const SVGStyle* intern(const SVGStyle& style);
+	const std::string* intern_string(std::string_view s);
+
+	//Parses the value of one presentation property into declared and marks it specified.
+	//Invalid values are ignored and "inherit" clears the property.
+	bool parse_property(SVGAttr attr, std::string_view value, SVGStyle& declared);
+
+	//Parses an inline style attribute like "fill:red; stroke:blue" into declared
+	void parse_style_attribute(std::string_view style, SVGStyle& declared);
+
+	//Computed style of an element whose parent has the computed style parent.
+	//declared may be null when the element sets nothing, then the parent's block is shared.
+	//Results are memoized, so repeated parent and declared pairs cost one hash lookup.
+	const SVGStyle* resolve(const SVGStyle* parent, const SVGStyle* declared);
+
+	size_t block_count() const {
+		return blocks.size();
+	}
+
+private:
+	struct BlockHash {
+		size_t operator()(const SVGStyle* s) const {
+			return s->hash();
+		}
+	};
+
+	struct BlockEqual {
+		bool operator()(const SVGStyle* a, const SVGStyle* b) const {
+			return *a == *b;
+		}
+	};
+
+	struct PairHash {
+		size_t operator()(const std::pair<const SVGStyle*, const SVGStyle*>& p) const {
+			return std::hash<const void*>()(p.first) * 31 + std::hash<const void*>()(p.second);
+		}
+	};
+
+	//A deque so that block addresses never change
+	std::deque<SVGStyle> blocks;
+	std::unordered_set<const SVGStyle*, BlockHash, BlockEqual> block_set;
+	std::deque<std::string> strings;
+	std::unordered_map<std::string_view, const std::string*> string_set;
+	std::unordered_map<std::pair<const SVGStyle*, const SVGStyle*>, const SVGStyle*, PairHash> resolved;
+	const SVGStyle* initial_style = nullptr;
+};
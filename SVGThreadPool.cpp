@@ -0,0 +1,148 @@
+#include "SVGThreadPool.h"
+
+SVGThreadPool::SVGThreadPool(unsigned int thread_count) {
+	if (thread_count == 0) {
+		unsigned int hw = std::thread::hardware_concurrency();
+
+		thread_count = hw > 1 ? hw - 1 : 0;
+	}
+
+	//One queue per worker plus one for the calling thread
+	for (unsigned int i = 0; i <= thread_count; ++i) {
+		queues.push_back(std::make_unique<TaskQueue>());
+	}
+
+	for (unsigned int i = 0; i < thread_count; ++i) {
+		workers.emplace_back(&SVGThreadPool::worker_loop, this, static_cast<size_t>(i + 1));
+	}
+}
+
+SVGThreadPool::~SVGThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(wake_lock);
+
+		stopping = true;
+	}
+
+	wake.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void SVGThreadPool::push_task(size_t index, std::function<void()> task) {
+	TaskQueue& queue = *queues[index];
+
+	{
+		std::lock_guard<std::mutex> guard(queue.lock);
+
+		queue.tasks.push_back(std::move(task));
+	}
+
+	queued_tasks.fetch_add(1);
+}
+
+//Pops from the back of our own queue, otherwise steals from the front of another one
+bool SVGThreadPool::pop_task(size_t index, std::function<void()>& task) {
+	{
+		TaskQueue& own = *queues[index];
+		std::lock_guard<std::mutex> guard(own.lock);
+
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			queued_tasks.fetch_sub(1);
+
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < queues.size(); ++i) {
+		TaskQueue& victim = *queues[(index + i) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			queued_tasks.fetch_sub(1);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void SVGThreadPool::worker_loop(size_t index) {
+	std::function<void()> task;
+
+	while (true) {
+		if (pop_task(index, task)) {
+			task();
+			task = nullptr;
+
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(wake_lock);
+
+		wake.wait(guard, [this] {
+			return stopping || queued_tasks.load() > 0;
+		});
+
+		if (stopping) {
+			return;
+		}
+	}
+}
+
+void SVGThreadPool::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+	if (count == 0) {
+		return;
+	}
+
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	if (workers.empty() || count <= grain) {
+		//Nothing to gain from going through the queues
+		body(0, count);
+
+		return;
+	}
+
+	std::atomic<size_t> pending{ (count + grain - 1) / grain };
+	size_t chunk = 0;
+
+	//Deal the chunks out round robin so that every worker starts with local work
+	for (size_t begin = 0; begin < count; begin += grain, ++chunk) {
+		size_t end = begin + grain < count ? begin + grain : count;
+
+		push_task(chunk % queues.size(), [&body, &pending, begin, end] {
+			body(begin, end);
+			pending.fetch_sub(1);
+		});
+	}
+
+	{
+		//Taking the lock orders the notify after any worker that is about to wait
+		std::lock_guard<std::mutex> guard(wake_lock);
+	}
+
+	wake.notify_all();
+
+	//Help out until everything we queued has run
+	std::function<void()> task;
+
+	while (pending.load() > 0) {
+		if (pop_task(0, task)) {
+			task();
+			task = nullptr;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//A small work stealing thread pool.
+//
+//Each worker owns a task queue. Workers take work from the back of their own queue
+//and steal from the front of the other queues when they run dry. The thread that
+//calls parallel_for helps run tasks until the whole range is done, so parallel_for
+//is also the join point.
+class SVGThreadPool {
+public:
+	//thread_count of 0 uses one worker per hardware thread, minus the calling thread
+	explicit SVGThreadPool(unsigned int thread_count = 0);
+	~SVGThreadPool();
+
+	SVGThreadPool(const SVGThreadPool&) = delete;
+	SVGThreadPool& operator=(const SVGThreadPool&) = delete;
+
+	//Number of threads that run tasks, including the caller of parallel_for
+	unsigned int concurrency() const {
+		return static_cast<unsigned int>(workers.size()) + 1;
+	}
+
+	//Calls body(begin, end) for consecutive chunks of [0, count) of at most grain items
+	//and returns when all of them have finished
+	void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+	struct TaskQueue {
+		std::mutex lock;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<TaskQueue>> queues;
+	std::mutex wake_lock;
+	std::condition_variable wake;
+	std::atomic<size_t> queued_tasks{ 0 };
+	bool stopping = false;
+
+	void worker_loop(size_t index);
+	bool pop_task(size_t index, std::function<void()>& task);
+	void push_task(size_t index, std::function<void()> task);
+};
@@ -0,0 +1,436 @@
+#include "SVGTileCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static uint64_t tile_key(int level, int x, int y) {
+	return (static_cast<uint64_t>(static_cast<uint16_t>(level)) << 48) |
+		(static_cast<uint64_t>(static_cast<uint32_t>(x) & 0xFFFFFFu) << 24) |
+		(static_cast<uint32_t>(y) & 0xFFFFFFu);
+}
+
+//Rounds toward negative infinity, for pixels left of or above the origin
+static int floor_div(int a, int b) {
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static bool is_empty(const SVGPixelRect& r) {
+	return r.left >= r.right || r.top >= r.bottom;
+}
+
+//Fills rect of to with from scaled bilinearly. Pixel (x, y) of to samples from
+//at (u0 + (x - rect.left) * step, v0 + (y - rect.top) * step), clamped to its edges.
+static void scale_bitmap(const SVGBitmap& from, float u0, float v0, float step, SVGBitmap& to, const SVGPixelRect& rect) {
+	int width = rect.right - rect.left;
+	std::vector<int> columns(width), column_weights(width);
+
+	for (int i = 0; i < width; ++i) {
+		float u = u0 + i * step;
+		int x = static_cast<int>(std::floor(u));
+
+		column_weights[i] = static_cast<int>((u - x) * 256.0f);
+
+		if (x < 0) {
+			x = 0;
+			column_weights[i] = 0;
+		}
+		else if (x >= from.width - 1) {
+			x = from.width - 1;
+			column_weights[i] = 0;
+		}
+
+		columns[i] = x;
+	}
+
+	for (int y = rect.top; y < rect.bottom; ++y) {
+		float v = v0 + (y - rect.top) * step;
+		int row = static_cast<int>(std::floor(v));
+		int wy = static_cast<int>((v - row) * 256.0f);
+
+		if (row < 0) {
+			row = 0;
+			wy = 0;
+		}
+		else if (row >= from.height - 1) {
+			row = from.height - 1;
+			wy = 0;
+		}
+
+		const uint8_t* upper = from.row(row);
+		const uint8_t* lower = from.row(std::min(row + 1, from.height - 1));
+		uint8_t* dst = to.row(y) + static_cast<size_t>(rect.left) * 4;
+
+		for (int i = 0; i < width; ++i, dst += 4) {
+			int x = columns[i] * 4;
+			int next = std::min(columns[i] + 1, from.width - 1) * 4;
+			int wx = column_weights[i];
+
+			//Premultiplied channels stay consistent under a weighted mean
+			for (int k = 0; k < 4; ++k) {
+				int top = upper[x + k] * (256 - wx) + upper[next + k] * wx;
+				int bottom = lower[x + k] * (256 - wx) + lower[next + k] * wx;
+
+				dst[k] = static_cast<uint8_t>((top * (256 - wy) + bottom * wy + 32768) >> 16);
+			}
+		}
+	}
+}
+
+float SVGTileCache::level_scale(int level) {
+	return std::exp2(static_cast<float>(level) / levels_per_octave);
+}
+
+void SVGTileCache::clear() {
+	tiles.clear();
+	free_tiles.clear();
+	lookup.clear();
+	level_tiles.clear();
+	counters.tiles = 0;
+	counters.memory = 0;
+}
+
+SVGMatrix SVGTileCache::level_device(int level) const {
+	float s = level_scale(level);
+
+	return svg_multiply(tile_device, SVGMatrix::scale(s, s));
+}
+
+SVGTileCache::Tile* SVGTileCache::find(int level, int x, int y) {
+	auto found = lookup.find(tile_key(level, x, y));
+
+	return found == lookup.end() ? nullptr : &tiles[found->second];
+}
+
+SVGTileCache::Tile& SVGTileCache::add(int level, int x, int y) {
+	uint32_t index;
+
+	if (!free_tiles.empty()) {
+		index = free_tiles.back();
+		free_tiles.pop_back();
+	}
+	else {
+		index = static_cast<uint32_t>(tiles.size());
+		tiles.emplace_back();
+	}
+
+	Tile& tile = tiles[index];
+
+	tile.level = level;
+	tile.x = x;
+	tile.y = y;
+	tile.used = clock;
+	tile.dirty = SVGPixelRect();
+	tile.live = true;
+	tile.bitmap.resize(tile_size, tile_size);
+
+	lookup[tile_key(level, x, y)] = index;
+	++level_tiles[level];
+	++counters.tiles;
+	counters.memory += tile.bitmap.pixels.size();
+
+	return tile;
+}
+
+void SVGTileCache::remove(uint32_t index) {
+	Tile& tile = tiles[index];
+	auto level = level_tiles.find(tile.level);
+
+	if (--level->second == 0) {
+		level_tiles.erase(level);
+	}
+
+	lookup.erase(tile_key(tile.level, tile.x, tile.y));
+	--counters.tiles;
+	counters.memory -= tile.bitmap.pixels.size();
+	tile.live = false;
+	tile.bitmap = SVGBitmap();
+	free_tiles.push_back(index);
+}
+
+void SVGTileCache::invalidate(const SVGRect& rect) {
+	for (Tile& tile : tiles) {
+		if (!tile.live) {
+			continue;
+		}
+
+		SVGMatrix m = level_device(tile.level);
+		SVGRect r = svg_transform_rect(m, svg_classify_transform(m), rect);
+		int left = tile.x * tile_size, top = tile.y * tile_size;
+		//Antialiasing reaches into the pixels the bounds end in, one more covers rounding
+		SVGPixelRect dirty{
+			std::max(static_cast<int>(std::floor(r.left)) - 1 - left, 0),
+			std::max(static_cast<int>(std::floor(r.top)) - 1 - top, 0),
+			std::min(static_cast<int>(std::ceil(r.right)) + 1 - left, tile_size),
+			std::min(static_cast<int>(std::ceil(r.bottom)) + 1 - top, tile_size)
+		};
+
+		if (is_empty(dirty)) {
+			continue;
+		}
+
+		if (is_empty(tile.dirty)) {
+			tile.dirty = dirty;
+		}
+		else {
+			tile.dirty.left = std::min(tile.dirty.left, dirty.left);
+			tile.dirty.top = std::min(tile.dirty.top, dirty.top);
+			tile.dirty.right = std::max(tile.dirty.right, dirty.right);
+			tile.dirty.bottom = std::max(tile.dirty.bottom, dirty.bottom);
+		}
+	}
+}
+
+size_t SVGTileCache::draw(const SVGDocument& document, const SVGDisplayList& list, SVGSoftwareRenderer& renderer, SVGThreadPool& pool, const SVGMatrix& device, int level, int origin_x, int origin_y, SVGBitmap& frame, const SVGPixelRect& clip, bool placeholders, SVGRenderQuality quality) {
+	if (!svg_matrix_equals(device, tile_device) || quality != tile_quality || tile_size != tile_side) {
+		clear();
+		tile_device = device;
+		tile_quality = quality;
+		tile_side = tile_size;
+	}
+
+	SVGPixelRect area{ std::max(clip.left, 0), std::max(clip.top, 0), std::min(clip.right, frame.width), std::min(clip.bottom, frame.height) };
+
+	if (is_empty(area) || tile_size <= 0) {
+		return 0;
+	}
+
+	++clock;
+
+	int left = floor_div(area.left + origin_x, tile_size);
+	int top = floor_div(area.top + origin_y, tile_size);
+	int right = floor_div(area.right - 1 + origin_x, tile_size) + 1;
+	int bottom = floor_div(area.bottom - 1 + origin_y, tile_size) + 1;
+	int columns = right - left;
+	size_t pending = 0;
+
+	missing.assign(static_cast<size_t>(columns) * (bottom - top), 0);
+
+	for (int y = top; y < bottom; ++y) {
+		for (int x = left; x < right; ++x) {
+			Tile* tile = find(level, x, y);
+
+			if (tile) {
+				++counters.hits;
+				tile->used = clock;
+
+				if (!is_empty(tile->dirty)) {
+					repair(document, list, renderer, *tile, quality);
+				}
+
+				copy(*tile, origin_x, origin_y, frame, area);
+				continue;
+			}
+
+			++counters.misses;
+
+			if (placeholders && draw_placeholder(level, x, y, origin_x, origin_y, frame, area)) {
+				++counters.placeholders;
+				++pending;
+				continue;
+			}
+
+			missing[static_cast<size_t>(y - top) * columns + (x - left)] = 1;
+		}
+	}
+
+	//Each run of missing tiles in a row starts a block, or extends the block of
+	//the same run in the row above
+	blocks.clear();
+
+	for (int y = top; y < bottom; ++y) {
+		const uint8_t* row = missing.data() + static_cast<size_t>(y - top) * columns;
+
+		for (int x = 0; x < columns;) {
+			if (!row[x]) {
+				++x;
+				continue;
+			}
+
+			int end = x;
+
+			while (end < columns && row[end]) {
+				++end;
+			}
+
+			Block run{ left + x, y, left + end, y + 1 };
+			auto above = std::find_if(blocks.begin(), blocks.end(), [&](const Block& b) {
+				return b.left == run.left && b.right == run.right && b.bottom == y;
+			});
+
+			if (above != blocks.end()) {
+				above->bottom = y + 1;
+			}
+			else {
+				blocks.push_back(run);
+			}
+
+			x = end;
+		}
+	}
+
+	for (const Block& block : blocks) {
+		rasterize(document, list, renderer, pool, level, block, origin_x, origin_y, frame, area, quality);
+	}
+
+	trim();
+
+	return pending;
+}
+
+//Draws the block at once, so that shapes across its tiles are flattened once
+//and the rows are filled in parallel, then cuts it into tiles
+void SVGTileCache::rasterize(const SVGDocument& document, const SVGDisplayList& list, SVGSoftwareRenderer& renderer, SVGThreadPool& pool, int level, const Block& block, int origin_x, int origin_y, SVGBitmap& frame, const SVGPixelRect& area, SVGRenderQuality quality) {
+	int width = (block.right - block.left) * tile_size;
+	int height = (block.bottom - block.top) * tile_size;
+	SVGMatrix device = svg_multiply(level_device(level), SVGMatrix::translation(static_cast<float>(-block.left * tile_size), static_cast<float>(-block.top * tile_size)));
+
+	if (scratch.width != width || scratch.height != height) {
+		scratch.resize(width, height);
+	}
+
+	scratch.clear(0xFFFFFFFF);
+	renderer.render_tiled(document, list, scratch, device, pool, quality);
+
+	size_t row_bytes = static_cast<size_t>(tile_size) * 4;
+
+	for (int y = block.top; y < block.bottom; ++y) {
+		for (int x = block.left; x < block.right; ++x) {
+			Tile& tile = add(level, x, y);
+			int from_x = (x - block.left) * tile_size, from_y = (y - block.top) * tile_size;
+
+			for (int row = 0; row < tile_size; ++row) {
+				std::memcpy(tile.bitmap.row(row), scratch.row(from_y + row) + static_cast<size_t>(from_x) * 4, row_bytes);
+			}
+
+			copy(tile, origin_x, origin_y, frame, area);
+		}
+	}
+}
+
+void SVGTileCache::repair(const SVGDocument& document, const SVGDisplayList& list, SVGSoftwareRenderer& renderer, Tile& tile, SVGRenderQuality quality) {
+	const SVGPixelRect& dirty = tile.dirty;
+	SVGMatrix device = svg_multiply(level_device(tile.level), SVGMatrix::translation(static_cast<float>(-tile.x * tile_size), static_cast<float>(-tile.y * tile_size)));
+
+	for (int y = dirty.top; y < dirty.bottom; ++y) {
+		//Opaque white is all ones premultiplied
+		std::fill(tile.bitmap.row(y) + dirty.left * 4, tile.bitmap.row(y) + dirty.right * 4, static_cast<uint8_t>(0xFF));
+	}
+
+	//The rasterizer doesn't depend on the clip, so the pixels match the rest of the tile
+	renderer.render(document, list, tile.bitmap, device, dirty, quality);
+	tile.dirty = SVGPixelRect();
+	++counters.repairs;
+}
+
+//Scales the tiles of the nearest level that has all the ones under tile (x, y)
+//into its part of area. Coarser levels are tried first, they need fewer tiles.
+bool SVGTileCache::draw_placeholder(int level, int x, int y, int origin_x, int origin_y, SVGBitmap& frame, const SVGPixelRect& area) {
+	for (int distance = 1; distance <= placeholder_distance; ++distance) {
+		for (int from : { level - distance, level + distance }) {
+			if (level_tiles.find(from) == level_tiles.end()) {
+				continue;
+			}
+
+			//Pixels of level to pixels of from
+			float factor = level_scale(from) / level_scale(level);
+			int left = static_cast<int>(std::floor(x * factor));
+			int top = static_cast<int>(std::floor(y * factor));
+			int right = static_cast<int>(std::ceil((x + 1) * factor));
+			int bottom = static_cast<int>(std::ceil((y + 1) * factor));
+			bool complete = true;
+
+			sources.clear();
+
+			for (int sy = top; sy < bottom && complete; ++sy) {
+				for (int sx = left; sx < right; ++sx) {
+					Tile* source = find(from, sx, sy);
+
+					//A tile that is out of date would show the document as it was
+					if (!source || !is_empty(source->dirty)) {
+						complete = false;
+						break;
+					}
+
+					sources.push_back(source);
+				}
+			}
+
+			if (!complete) {
+				continue;
+			}
+
+			for (Tile* source : sources) {
+				//Pixels of level whose centers fall in the source, within the tile and area
+				int source_left = static_cast<int>(std::ceil(source->x * tile_size / factor - 0.5f));
+				int source_top = static_cast<int>(std::ceil(source->y * tile_size / factor - 0.5f));
+				int source_right = static_cast<int>(std::ceil((source->x + 1) * tile_size / factor - 0.5f));
+				int source_bottom = static_cast<int>(std::ceil((source->y + 1) * tile_size / factor - 0.5f));
+				SVGPixelRect rect{
+					std::max({ source_left, x * tile_size, area.left + origin_x }) - origin_x,
+					std::max({ source_top, y * tile_size, area.top + origin_y }) - origin_y,
+					std::min({ source_right, (x + 1) * tile_size, area.right + origin_x }) - origin_x,
+					std::min({ source_bottom, (y + 1) * tile_size, area.bottom + origin_y }) - origin_y
+				};
+
+				source->used = clock;
+
+				if (is_empty(rect)) {
+					continue;
+				}
+
+				float u0 = (rect.left + origin_x + 0.5f) * factor - 0.5f - source->x * tile_size;
+				float v0 = (rect.top + origin_y + 0.5f) * factor - 0.5f - source->y * tile_size;
+
+				scale_bitmap(source->bitmap, u0, v0, factor, frame, rect);
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void SVGTileCache::copy(const Tile& tile, int origin_x, int origin_y, SVGBitmap& frame, const SVGPixelRect& area) const {
+	int tile_left = tile.x * tile_size - origin_x;
+	int tile_top = tile.y * tile_size - origin_y;
+	int left = std::max(area.left, tile_left), right = std::min(area.right, tile_left + tile_size);
+	int top = std::max(area.top, tile_top), bottom = std::min(area.bottom, tile_top + tile_size);
+
+	if (left >= right || top >= bottom) {
+		return;
+	}
+
+	for (int y = top; y < bottom; ++y) {
+		std::memcpy(frame.row(y) + static_cast<size_t>(left) * 4, tile.bitmap.row(y - tile_top) + static_cast<size_t>(left - tile_left) * 4, static_cast<size_t>(right - left) * 4);
+	}
+}
+
+//Drops the tiles drawn least recently until the rest fit in the budget. The ones
+//of the frame being drawn stay, even past it.
+void SVGTileCache::trim() {
+	if (counters.memory <= memory_budget) {
+		return;
+	}
+
+	order.clear();
+
+	for (uint32_t i = 0; i < tiles.size(); ++i) {
+		if (tiles[i].live && tiles[i].used != clock) {
+			order.push_back(i);
+		}
+	}
+
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return tiles[a].used < tiles[b].used;
+	});
+
+	for (uint32_t index : order) {
+		if (counters.memory <= memory_budget) {
+			break;
+		}
+
+		remove(index);
+		++counters.evictions;
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "SVGDisplayList.h"
+#include "SVGDocument.h"
+#include "SVGRaster.h"
+#include "SVGSoftwareRenderer.h"
+#include "SVGThreadPool.h"
+#include "SVGTransform.h"
+
+//Counters of an SVGTileCache since it was made. A hit is a tile of a frame that
+//was cached, a miss one that wasn't, whether it was rasterized or replaced by a
+//placeholder.
+struct SVGTileStats {
+	size_t hits = 0;
+	size_t misses = 0;
+	//Missing tiles drawn scaled from the tiles of another level
+	size_t placeholders = 0;
+	//Cached tiles that changes to the document made out of date, drawn again in part
+	size_t repairs = 0;
+	size_t evictions = 0;
+	//Tiles held now and the bytes of their pixels
+	size_t tiles = 0;
+	size_t memory = 0;
+};
+
+//Rasterized squares of a document at several zoom levels, so that panning and
+//zooming copy pixels instead of drawing the vectors again.
+//
+//Level l scales the document by 2^(l / levels_per_octave) on top of the device
+//matrix, and the pixels of each level are cut into tile_size squares. A frame
+//shows the pixels of one level from an integer origin on, so cached tiles are
+//copied to it as they are. Missing tiles are rasterized in blocks with the
+//software renderer. When the memory of the tiles passes memory_budget, the ones
+//drawn least recently are dropped.
+class SVGTileCache {
+public:
+	static constexpr int levels_per_octave = 4;
+	//Side of a tile in pixels
+	int tile_size = 256;
+	size_t memory_budget = 64 * 1024 * 1024;
+	//Levels away from the one drawn that placeholders are looked for in
+	int placeholder_distance = 2 * levels_per_octave;
+
+	//Scale of a level over level 0
+	static float level_scale(int level);
+
+	void clear();
+
+	//Marks the pixels of every level that rect, in world space, covers as out of
+	//date. The tiles keep the rest, and are drawn again in that part when next used.
+	void invalidate(const SVGRect& rect);
+
+	//Fills the pixels of frame inside clip. Pixel (0, 0) of frame is pixel (origin_x,
+	//origin_y) of level, and device maps world space to pixels of level 0. Tiles
+	//cached for another device, quality or tile_size are dropped first.
+	//
+	//With placeholders, a missing tile that the tiles of a nearby level cover is drawn
+	//scaled from them instead, and stays missing. Returns how many were, so that the
+	//caller can draw again without placeholders once it has time.
+	size_t draw(const SVGDocument& document, const SVGDisplayList& list, SVGSoftwareRenderer& renderer, SVGThreadPool& pool, const SVGMatrix& device, int level, int origin_x, int origin_y, SVGBitmap& frame, const SVGPixelRect& clip, bool placeholders, SVGRenderQuality quality = SVGRenderQuality::Standard);
+
+	const SVGTileStats& stats() const {
+		return counters;
+	}
+
+private:
+	struct Tile {
+		int level = 0, x = 0, y = 0;
+		//Value of clock when last drawn
+		uint64_t used = 0;
+		//Pixels of the tile that are out of date, empty when none
+		SVGPixelRect dirty;
+		bool live = false;
+		SVGBitmap bitmap;
+	};
+
+	//Missing tiles of one level, rasterized together. Right and bottom are exclusive.
+	struct Block {
+		int left, top, right, bottom;
+	};
+
+	std::vector<Tile> tiles;
+	std::vector<uint32_t> free_tiles;
+	std::unordered_map<uint64_t, uint32_t> lookup;
+	//Tiles held at each level, to skip empty ones when looking for placeholders
+	std::unordered_map<int, size_t> level_tiles;
+	uint64_t clock = 0;
+	//What the cached tiles were drawn with
+	SVGMatrix tile_device;
+	SVGRenderQuality tile_quality = SVGRenderQuality::Standard;
+	int tile_side = 0;
+	SVGTileStats counters;
+	//Tiles of the frame being drawn that are to be rasterized, row by row
+	std::vector<uint8_t> missing;
+	std::vector<Block> blocks;
+	std::vector<Tile*> sources;
+	std::vector<uint32_t> order;
+	SVGBitmap scratch;
+
+	SVGMatrix level_device(int level) const;
+	Tile* find(int level, int x, int y);
+	Tile& add(int level, int x, int y);
+	void remove(uint32_t index);
+	void rasterize(const SVGDocument& document, const SVGDisplayList& list, SVGSoftwareRenderer& renderer, SVGThreadPool& pool, int level, const Block& block, int origin_x, int origin_y, SVGBitmap& frame, const SVGPixelRect& area, SVGRenderQuality quality);
+	void repair(const SVGDocument& document, const SVGDisplayList& list, SVGSoftwareRenderer& renderer, Tile& tile, SVGRenderQuality quality);
+	bool draw_placeholder(int level, int x, int y, int origin_x, int origin_y, SVGBitmap& frame, const SVGPixelRect& area);
+	void copy(const Tile& tile, int origin_x, int origin_y, SVGBitmap& frame, const SVGPixelRect& area) const;
+	void trim();
+};
@@ -0,0 +1,440 @@
+#include "SVGTokenizer.h"
+#include <cstring>
+
+static bool is_xml_space(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+static bool is_name_char(char ch) {
+	//Anything that can not end a name. Non ASCII UTF-8 bytes are valid name characters.
+	return !is_xml_space(ch) && ch != '=' && ch != '>' && ch != '/' && ch != '<' && ch != '"' && ch != '\'';
+}
+
+static void append_utf8(std::string& result, unsigned long cp) {
+	if (cp < 0x80) {
+		result.push_back(static_cast<char>(cp));
+	}
+	else if (cp < 0x800) {
+		result.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+		result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+	}
+	else if (cp < 0x10000) {
+		result.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+		result.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+		result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+	}
+	else {
+		result.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+		result.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+		result.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+		result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+	}
+}
+
+static bool decode_reference(std::string_view ref, std::string& result) {
+	if (ref == "lt") {
+		result.push_back('<');
+	}
+	else if (ref == "gt") {
+		result.push_back('>');
+	}
+	else if (ref == "amp") {
+		result.push_back('&');
+	}
+	else if (ref == "quot") {
+		result.push_back('"');
+	}
+	else if (ref == "apos") {
+		result.push_back('\'');
+	}
+	else if (ref.size() > 1 && ref[0] == '#') {
+		unsigned long cp = 0;
+		int base = 10;
+		size_t i = 1;
+
+		if (ref[1] == 'x' || ref[1] == 'X') {
+			base = 16;
+			i = 2;
+		}
+
+		if (i >= ref.size()) {
+			return false;
+		}
+
+		for (; i < ref.size(); ++i) {
+			char ch = ref[i];
+			int digit;
+
+			if (ch >= '0' && ch <= '9') {
+				digit = ch - '0';
+			}
+			else if (base == 16 && ch >= 'a' && ch <= 'f') {
+				digit = ch - 'a' + 10;
+			}
+			else if (base == 16 && ch >= 'A' && ch <= 'F') {
+				digit = ch - 'A' + 10;
+			}
+			else {
+				return false;
+			}
+
+			cp = cp * base + digit;
+
+			if (cp > 0x10FFFF) {
+				return false;
+			}
+		}
+
+		append_utf8(result, cp);
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+void svg_decode_entities(std::string_view source, std::string& result) {
+	result.clear();
+
+	size_t start = 0;
+
+	while (true) {
+		size_t amp = source.find('&', start);
+
+		if (amp == std::string_view::npos) {
+			result.append(source.substr(start));
+
+			break;
+		}
+
+		result.append(source.substr(start, amp - start));
+
+		size_t semi = source.find(';', amp + 1);
+
+		if (semi == std::string_view::npos || !decode_reference(source.substr(amp + 1, semi - amp - 1), result)) {
+			//Not a reference we understand, keep the '&' verbatim
+			result.push_back('&');
+			start = amp + 1;
+		}
+		else {
+			start = semi + 1;
+		}
+	}
+}
+
+SVGTokenizer::SVGTokenizer(std::string_view _source) : source(_source) {
+	//Skip UTF-8 byte order mark
+	if (source.size() >= 3 && source.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+		pos = 3;
+	}
+}
+
+bool SVGTokenizer::get_attribute(std::string_view attr_name, std::string_view& attr_value) const {
+	for (const auto& attr : attribute_list) {
+		if (attr.name == attr_name) {
+			attr_value = attr.value;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::string_view SVGTokenizer::decode(std::string_view raw) {
+	if (raw.find('&') == std::string_view::npos) {
+		//Nothing to decode, hand out the source slice
+		return raw;
+	}
+
+	if (decoded_used == decoded.size()) {
+		decoded.emplace_back();
+	}
+
+	std::string& storage = decoded[decoded_used++];
+
+	svg_decode_entities(raw, storage);
+
+	return storage;
+}
+
+void SVGTokenizer::skip_spaces() {
+	while (pos < source.size() && is_xml_space(source[pos])) {
+		++pos;
+	}
+}
+
+bool SVGTokenizer::skip_past(std::string_view terminator) {
+	size_t end = source.find(terminator, pos);
+
+	if (end == std::string_view::npos) {
+		return false;
+	}
+
+	pos = end + terminator.size();
+
+	return true;
+}
+
+bool SVGTokenizer::skip_doctype() {
+	//DOCTYPE may have an internal subset enclosed in []
+	int bracket_depth = 0;
+
+	while (pos < source.size()) {
+		char ch = source[pos++];
+
+		if (ch == '[') {
+			++bracket_depth;
+		}
+		else if (ch == ']') {
+			--bracket_depth;
+		}
+		else if (ch == '>' && bracket_depth <= 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool SVGTokenizer::read_name(std::string_view& result) {
+	size_t start = pos;
+
+	while (pos < source.size() && is_name_char(source[pos])) {
+		++pos;
+	}
+
+	if (pos == start) {
+		return false;
+	}
+
+	result = source.substr(start, pos - start);
+
+	return true;
+}
+
+SVGTokenType SVGTokenizer::next() {
+	element_name = std::string_view();
+	text_value = std::string_view();
+	self_closing = false;
+	attribute_list.clear();
+	decoded_used = 0;
+
+	while (pos < source.size()) {
+		if (source[pos] != '<') {
+			return read_text();
+		}
+
+		SVGTokenType type;
+
+		if (read_markup(type)) {
+			return type;
+		}
+
+		//Markup that produced no token (comment, PI etc.). Keep scanning.
+	}
+
+	return SVGTokenType::EndOfFile;
+}
+
+SVGTokenType SVGTokenizer::read_text() {
+	size_t start = pos;
+	const void* lt = memchr(source.data() + pos, '<', source.size() - pos);
+
+	pos = lt == nullptr ? source.size() : static_cast<const char*>(lt) - source.data();
+
+	std::string_view raw = source.substr(start, pos - start);
+	bool all_spaces = true;
+
+	for (char ch : raw) {
+		if (!is_xml_space(ch)) {
+			all_spaces = false;
+
+			break;
+		}
+	}
+
+	if (all_spaces) {
+		text_value = raw;
+
+		return SVGTokenType::Whitespace;
+	}
+
+	text_value = decode(raw);
+
+	return SVGTokenType::Text;
+}
+
+//Called with pos at '<'. Returns false for markup that
+//should be silently skipped.
+bool SVGTokenizer::read_markup(SVGTokenType& type) {
+	std::string_view rest = source.substr(pos);
+
+	if (rest.compare(0, 4, "<!--") == 0) {
+		pos += 4;
+
+		if (!skip_past("-->")) {
+			type = SVGTokenType::Error;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	if (rest.compare(0, 9, "<![CDATA[") == 0) {
+		pos += 9;
+
+		size_t start = pos;
+
+		if (!skip_past("]]>")) {
+			type = SVGTokenType::Error;
+
+			return true;
+		}
+
+		//CDATA content is never entity decoded
+		text_value = source.substr(start, pos - 3 - start);
+		type = SVGTokenType::Text;
+
+		return true;
+	}
+
+	if (rest.compare(0, 2, "<?") == 0) {
+		pos += 2;
+
+		if (!skip_past("?>")) {
+			type = SVGTokenType::Error;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	if (rest.compare(0, 2, "<!") == 0) {
+		pos += 2;
+
+		if (!skip_doctype()) {
+			type = SVGTokenType::Error;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	if (rest.compare(0, 2, "</") == 0) {
+		pos += 2;
+		type = read_end_element();
+
+		return true;
+	}
+
+	pos += 1;
+	type = read_start_element();
+
+	return true;
+}
+
+static std::string_view local_name(std::string_view qualified_name) {
+	size_t colon = qualified_name.find(':');
+
+	if (colon == std::string_view::npos) {
+		return qualified_name;
+	}
+
+	return qualified_name.substr(colon + 1);
+}
+
+SVGTokenType SVGTokenizer::read_start_element() {
+	std::string_view qname;
+
+	if (!read_name(qname)) {
+		return SVGTokenType::Error;
+	}
+
+	element_name = local_name(qname);
+
+	while (true) {
+		skip_spaces();
+
+		if (pos >= source.size()) {
+			return SVGTokenType::Error;
+		}
+
+		char ch = source[pos];
+
+		if (ch == '>') {
+			++pos;
+
+			return SVGTokenType::StartElement;
+		}
+
+		if (ch == '/') {
+			if (pos + 1 >= source.size() || source[pos + 1] != '>') {
+				return SVGTokenType::Error;
+			}
+
+			pos += 2;
+			self_closing = true;
+
+			return SVGTokenType::StartElement;
+		}
+
+		SVGXmlAttribute attr;
+
+		if (!read_name(attr.name)) {
+			return SVGTokenType::Error;
+		}
+
+		skip_spaces();
+
+		if (pos >= source.size() || source[pos] != '=') {
+			return SVGTokenType::Error;
+		}
+
+		++pos;
+
+		skip_spaces();
+
+		if (pos >= source.size() || (source[pos] != '"' && source[pos] != '\'')) {
+			return SVGTokenType::Error;
+		}
+
+		char quote = source[pos++];
+		const void* end = memchr(source.data() + pos, quote, source.size() - pos);
+
+		if (end == nullptr) {
+			return SVGTokenType::Error;
+		}
+
+		size_t end_pos = static_cast<const char*>(end) - source.data();
+
+		attr.value = decode(source.substr(pos, end_pos - pos));
+		pos = end_pos + 1;
+
+		attribute_list.push_back(attr);
+	}
+}
+
+SVGTokenType SVGTokenizer::read_end_element() {
+	std::string_view qname;
+
+	if (!read_name(qname)) {
+		return SVGTokenType::Error;
+	}
+
+	element_name = local_name(qname);
+
+	skip_spaces();
+
+	if (pos >= source.size() || source[pos] != '>') {
+		return SVGTokenType::Error;
+	}
+
+	++pos;
+
+	return SVGTokenType::EndElement;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+
+enum class SVGTokenType {
+	StartElement,
+	EndElement,
+	Text,
+	Whitespace,
+	EndOfFile,
+	Error
+};
+
+struct SVGXmlAttribute {
+	std::string_view name;
+	std::string_view value;
+};
+
+//A streaming, non validating XML tokenizer that works directly
+//on a UTF-8 buffer (usually a memory mapped file).
+//
+//Names, attribute values and text are handed out as slices of the source buffer.
+//Only values that contain entity references are decoded into storage owned by the tokenizer.
+//All views returned for a token stay valid until the next call to next().
+//
+//Comments, processing instructions and DOCTYPE declarations are skipped.
+//CDATA sections are reported as text. Self closing elements like <circle/>
+//produce a single StartElement token with is_self_closing() set and no EndElement.
+class SVGTokenizer {
+public:
+	explicit SVGTokenizer(std::string_view source);
+
+	SVGTokenType next();
+
+	//Local name (namespace prefix removed) of the current start or end element
+	std::string_view name() const {
+		return element_name;
+	}
+
+	//Content of the current Text or Whitespace token
+	std::string_view text() const {
+		return text_value;
+	}
+
+	bool is_self_closing() const {
+		return self_closing;
+	}
+
+	const std::vector<SVGXmlAttribute>& attributes() const {
+		return attribute_list;
+	}
+
+	//Finds an attribute of the current start element by its qualified name
+	bool get_attribute(std::string_view attr_name, std::string_view& attr_value) const;
+
+	//True if the view points into the source buffer rather than the decoding storage
+	bool is_source_slice(std::string_view view) const {
+		return view.data() >= source.data() && view.data() + view.size() <= source.data() + source.size();
+	}
+
+	//Byte offset of the scanner, useful for error reporting
+	size_t offset() const {
+		return pos;
+	}
+
+private:
+	std::string_view source;
+	size_t pos = 0;
+
+	std::string_view element_name;
+	std::string_view text_value;
+	bool self_closing = false;
+	std::vector<SVGXmlAttribute> attribute_list;
+
+	//Storage for decoded values. A deque is used so that growing it does not
+	//move strings already handed out.
+	std::deque<std::string> decoded;
+	size_t decoded_used = 0;
+
+	bool read_markup(SVGTokenType& type);
+	SVGTokenType read_start_element();
+	SVGTokenType read_end_element();
+	SVGTokenType read_text();
+	bool skip_past(std::string_view terminator);
+	bool skip_doctype();
+	bool read_name(std::string_view& result);
+	void skip_spaces();
+	std::string_view decode(std::string_view raw);
+};
+
+//Replaces XML entity and character references in source.
+//Unknown references are kept verbatim.
+void svg_decode_entities(std::string_view source, std::string& result);
@@ -0,0 +1,269 @@
+#include "SVGTransform.h"
+#include "SVGPathLexer.h"
+#include <cmath>
+
+static const float degrees_to_radians = 3.14159265358979323846f / 180.0f;
+
+SVGTransformClass svg_classify_transform(const SVGMatrix& m) {
+	if (m.m12 != 0.0f || m.m21 != 0.0f) {
+		return SVGTransformClass::Affine;
+	}
+
+	if (m.m11 != 1.0f || m.m22 != 1.0f) {
+		return SVGTransformClass::ScaleTranslate;
+	}
+
+	if (m.dx != 0.0f || m.dy != 0.0f) {
+		return SVGTransformClass::Translate;
+	}
+
+	return SVGTransformClass::Identity;
+}
+
+SVGMatrix svg_multiply(const SVGMatrix& a, const SVGMatrix& b) {
+	SVGMatrix r;
+
+	r.m11 = a.m11 * b.m11 + a.m12 * b.m21;
+	r.m12 = a.m11 * b.m12 + a.m12 * b.m22;
+	r.m21 = a.m21 * b.m11 + a.m22 * b.m21;
+	r.m22 = a.m21 * b.m12 + a.m22 * b.m22;
+	r.dx = a.dx * b.m11 + a.dy * b.m21 + b.dx;
+	r.dy = a.dx * b.m12 + a.dy * b.m22 + b.dy;
+
+	return r;
+}
+
+SVGMatrix svg_multiply(const SVGMatrix& a, SVGTransformClass a_class, const SVGMatrix& b) {
+	SVGMatrix r = b;
+
+	switch (a_class) {
+	case SVGTransformClass::Identity:
+		break;
+	case SVGTransformClass::Translate:
+		r.dx = a.dx * b.m11 + a.dy * b.m21 + b.dx;
+		r.dy = a.dx * b.m12 + a.dy * b.m22 + b.dy;
+
+		break;
+	case SVGTransformClass::ScaleTranslate:
+		r.m11 = a.m11 * b.m11;
+		r.m12 = a.m11 * b.m12;
+		r.m21 = a.m22 * b.m21;
+		r.m22 = a.m22 * b.m22;
+		r.dx = a.dx * b.m11 + a.dy * b.m21 + b.dx;
+		r.dy = a.dx * b.m12 + a.dy * b.m22 + b.dy;
+
+		break;
+	case SVGTransformClass::Affine:
+		r = svg_multiply(a, b);
+
+		break;
+	}
+
+	return r;
+}
+
+SVGPoint svg_transform_point(const SVGMatrix& m, SVGPoint p) {
+	return SVGPoint{
+		p.x * m.m11 + p.y * m.m21 + m.dx,
+		p.x * m.m12 + p.y * m.m22 + m.dy
+	};
+}
+
+bool svg_invert(const SVGMatrix& m, SVGMatrix& inverse) {
+	float det = m.m11 * m.m22 - m.m12 * m.m21;
+
+	if (det == 0.0f || !std::isfinite(det)) {
+		return false;
+	}
+
+	float r = 1.0f / det;
+
+	inverse.m11 = m.m22 * r;
+	inverse.m12 = -m.m12 * r;
+	inverse.m21 = -m.m21 * r;
+	inverse.m22 = m.m11 * r;
+	inverse.dx = (m.m21 * m.dy - m.m22 * m.dx) * r;
+	inverse.dy = (m.m12 * m.dx - m.m11 * m.dy) * r;
+
+	return true;
+}
+
+SVGRect svg_transform_rect(const SVGMatrix& m, SVGTransformClass m_class, const SVGRect& r) {
+	switch (m_class) {
+	case SVGTransformClass::Identity:
+		return r;
+	case SVGTransformClass::Translate:
+		return SVGRect{ r.left + m.dx, r.top + m.dy, r.right + m.dx, r.bottom + m.dy };
+	case SVGTransformClass::ScaleTranslate: {
+		float x0 = r.left * m.m11 + m.dx, x1 = r.right * m.m11 + m.dx;
+		float y0 = r.top * m.m22 + m.dy, y1 = r.bottom * m.m22 + m.dy;
+
+		//Negative scale flips the rect
+		return SVGRect{ std::fmin(x0, x1), std::fmin(y0, y1), std::fmax(x0, x1), std::fmax(y0, y1) };
+	}
+	default:
+		break;
+	}
+
+	SVGPoint corners[4] = {
+		svg_transform_point(m, SVGPoint{ r.left, r.top }),
+		svg_transform_point(m, SVGPoint{ r.right, r.top }),
+		svg_transform_point(m, SVGPoint{ r.left, r.bottom }),
+		svg_transform_point(m, SVGPoint{ r.right, r.bottom })
+	};
+	SVGRect result{ corners[0].x, corners[0].y, corners[0].x, corners[0].y };
+
+	for (int i = 1; i < 4; ++i) {
+		result.left = std::fmin(result.left, corners[i].x);
+		result.top = std::fmin(result.top, corners[i].y);
+		result.right = std::fmax(result.right, corners[i].x);
+		result.bottom = std::fmax(result.bottom, corners[i].y);
+	}
+
+	return result;
+}
+
+static bool is_transform_space(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == ',';
+}
+
+static void skip_transform_spaces(std::string_view source, size_t& pos) {
+	while (pos < source.size() && is_transform_space(source[pos])) {
+		++pos;
+	}
+}
+
+//Builds the matrix for one transform function.
+//Unknown functions and wrong argument counts are ignored, leaving m as identity.
+static void build_function_matrix(std::string_view name, const float* v, int count, SVGMatrix& m) {
+	m = SVGMatrix::identity();
+
+	if (name == "translate") {
+		if (count == 1) {
+			m = SVGMatrix::translation(v[0], 0.0f);
+		}
+		else if (count == 2) {
+			m = SVGMatrix::translation(v[0], v[1]);
+		}
+	}
+	else if (name == "scale") {
+		if (count == 1) {
+			m = SVGMatrix::scale(v[0], v[0]);
+		}
+		else if (count == 2) {
+			m = SVGMatrix::scale(v[0], v[1]);
+		}
+	}
+	else if (name == "rotate") {
+		if (count == 1 || count == 3) {
+			float angle = v[0] * degrees_to_radians;
+			float cos_a = std::cos(angle), sin_a = std::sin(angle);
+			float cx = count == 3 ? v[1] : 0.0f;
+			float cy = count == 3 ? v[2] : 0.0f;
+
+			//Rotation about (cx, cy)
+			m = SVGMatrix{ cos_a, sin_a, -sin_a, cos_a,
+				cx - cx * cos_a + cy * sin_a,
+				cy - cx * sin_a - cy * cos_a };
+		}
+	}
+	else if (name == "matrix") {
+		if (count == 6) {
+			m = SVGMatrix{ v[0], v[1], v[2], v[3], v[4], v[5] };
+		}
+	}
+	else if (name == "skewX") {
+		if (count == 1) {
+			m.m21 = std::tan(v[0] * degrees_to_radians);
+		}
+	}
+	else if (name == "skewY") {
+		if (count == 1) {
+			m.m12 = std::tan(v[0] * degrees_to_radians);
+		}
+	}
+	else if (name == "skew") {
+		//Not in SVG but accepted for compatibility
+		if (count == 2) {
+			m.m21 = std::tan(v[0] * degrees_to_radians);
+			m.m12 = std::tan(v[1] * degrees_to_radians);
+		}
+	}
+}
+
+bool svg_parse_transform(std::string_view source, SVGMatrix& matrix) {
+	//For "f1 f2 ... fn" a point goes through fn first and f1 last.
+	//Going left to right we accumulate combined = fk * combined.
+	SVGMatrix combined;
+	size_t pos = 0;
+
+	skip_transform_spaces(source, pos);
+
+	while (pos < source.size()) {
+		size_t name_start = pos;
+
+		while (pos < source.size() && ((source[pos] >= 'a' && source[pos] <= 'z') || (source[pos] >= 'A' && source[pos] <= 'Z'))) {
+			++pos;
+		}
+
+		std::string_view name = source.substr(name_start, pos - name_start);
+
+		if (name.empty()) {
+			return false;
+		}
+
+		while (pos < source.size() && is_transform_space(source[pos]) && source[pos] != ',') {
+			++pos;
+		}
+
+		if (pos >= source.size() || source[pos] != '(') {
+			return false;
+		}
+
+		++pos;
+
+		float values[6];
+		int count = 0;
+
+		while (true) {
+			skip_transform_spaces(source, pos);
+
+			if (pos >= source.size()) {
+				return false;
+			}
+
+			if (source[pos] == ')') {
+				++pos;
+
+				break;
+			}
+
+			float v;
+			size_t consumed = svg_parse_number(source.substr(pos), v);
+
+			if (consumed == 0) {
+				return false;
+			}
+
+			pos += consumed;
+
+			if (count < 6) {
+				values[count] = v;
+			}
+
+			//Keep counting so that too many arguments is detected
+			++count;
+		}
+
+		SVGMatrix f;
+
+		build_function_matrix(name, values, count, f);
+		combined = svg_multiply(f, combined);
+
+		skip_transform_spaces(source, pos);
+	}
+
+	matrix = svg_multiply(matrix, combined);
+
+	return true;
+}
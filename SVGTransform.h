@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+//2D affine matrix with the same layout and row vector convention as D2D1_MATRIX_3X2_F.
+//A point is transformed as [x y 1] * M.
+struct SVGMatrix {
+	float m11 = 1.0f, m12 = 0.0f;
+	float m21 = 0.0f, m22 = 1.0f;
+	float dx = 0.0f, dy = 0.0f;
+
+	static SVGMatrix identity() {
+		return SVGMatrix();
+	}
+
+	static SVGMatrix translation(float x, float y) {
+		return SVGMatrix{ 1.0f, 0.0f, 0.0f, 1.0f, x, y };
+	}
+
+	static SVGMatrix scale(float x, float y) {
+		return SVGMatrix{ x, 0.0f, 0.0f, y, 0.0f, 0.0f };
+	}
+};
+
+struct SVGPoint {
+	float x = 0.0f, y = 0.0f;
+};
+
+struct SVGRect {
+	float left = 0.0f, top = 0.0f, right = 0.0f, bottom = 0.0f;
+};
+
+//Transforms are classified once so that render and bounds code can
+//skip full matrix math for the common simple cases.
+enum class SVGTransformClass : uint8_t {
+	Identity,
+	Translate,		//Only dx, dy
+	ScaleTranslate,	//Axis aligned: m12 == m21 == 0
+	Affine			//Rotation or skew
+};
+
+SVGTransformClass svg_classify_transform(const SVGMatrix& m);
+
+inline bool svg_matrix_equals(const SVGMatrix& a, const SVGMatrix& b) {
+	return a.m11 == b.m11 && a.m12 == b.m12 && a.m21 == b.m21 && a.m22 == b.m22 && a.dx == b.dx && a.dy == b.dy;
+}
+
+//Returns a * b, that is a applied first then b
+SVGMatrix svg_multiply(const SVGMatrix& a, const SVGMatrix& b);
+
+//Same as svg_multiply but uses the classification of a to avoid the full multiply
+SVGMatrix svg_multiply(const SVGMatrix& a, SVGTransformClass a_class, const SVGMatrix& b);
+
+SVGPoint svg_transform_point(const SVGMatrix& m, SVGPoint p);
+
+//Inverse of m. Returns false and leaves inverse unchanged when m collapses the plane.
+bool svg_invert(const SVGMatrix& m, SVGMatrix& inverse);
+
+//Bounding box of the transformed rect. Axis aligned transforms map the two
+//corners directly, only Affine needs all four.
+SVGRect svg_transform_rect(const SVGMatrix& m, SVGTransformClass m_class, const SVGRect& r);
+
+//Parses the value of a transform attribute.
+//The functions are combined into matrix, which is used as the starting transform.
+//Does not allocate. On a syntax error returns false and leaves matrix unchanged.
+bool svg_parse_transform(std::string_view source, SVGMatrix& matrix);
@@ -1,715 +1,174 @@
 #include "SVGUtil.h"
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <string_view>
-#include <stack>
-#include <xmllite.h>
+#include "SVGFlatten.h"
+#include "SVGMappedFile.h"
 
-struct TransformFunction {
-	std::wstring name;
-	std::vector<float> values;
-};
-
-static void ltrim_str(std::wstring_view& source) {
-	size_t pos = source.find_first_not_of(L" \t\r\n");
-
-	if (pos == std::wstring_view::npos) {
-		source.remove_prefix(source.length());
-	}
-	else {
-		source.remove_prefix(pos);
-	}
+//SVGMatrix has the same layout as D2D1_MATRIX_3X2_F
+static D2D1_MATRIX_3X2_F to_d2d_matrix(const SVGMatrix& m) {
+	return D2D1::Matrix3x2F(m.m11, m.m12, m.m21, m.m22, m.dx, m.dy);
 }
 
-static void rtrim_str(std::wstring_view& source) {
-	size_t pos = source.find_last_not_of(L" \t\r\n");
-
-	if (pos == std::wstring_view::npos) {
-		//Empty out the string
-		source.remove_suffix(source.length());
-	}
-	else {
-		source.remove_suffix(source.length() - pos - 1);
-	}
+static SVGMatrix to_svg_matrix(const D2D1_MATRIX_3X2_F& m) {
+	return SVGMatrix{ m._11, m._12, m._21, m._22, m._31, m._32 };
 }
 
-//Collapse white spaces as per CSS and HTML spec
-static void collapse_whitespace(std::wstring_view& source, std::wstring& result) {
-	result.clear();
-
-	ltrim_str(source);
-
-	wchar_t last_ch = 0;
-	std::wstring_view white_spaces(L" \t\r\n");
-
-	for (wchar_t ch : source) {
-		if (white_spaces.find(ch) != std::wstring_view::npos) {
-			//Normalize all white spaces
-			ch = L' ';
-		}
-
-		if (ch == last_ch) {
-			//Skip consecutive what spaces
-			continue;
-		}
-
-		result.push_back(ch);
-		last_ch = ch;
-	}
-}
-
-std::vector<std::wstring_view>
-static split_string(std::wstring_view source, std::wstring_view separator) {
-	std::vector<std::wstring_view> list;
-	size_t pos, start = 0;
-
-	while ((pos = source.find(separator, start)) != std::string_view::npos) {
-		list.push_back(source.substr(start, (pos - start)));
-
-		start = pos + separator.length();
-	}
-
-	list.push_back(source.substr(start));
-
-	return list;
+static SVGRect union_rect(const SVGRect& a, const SVGRect& b) {
+	return SVGRect{ std::fmin(a.left, b.left), std::fmin(a.top, b.top), std::fmax(a.right, b.right), std::fmax(a.bottom, b.bottom) };
 }
 
-bool get_rgba(std::wstring_view source, float& r, float& g, float& b, float& a) {
-	//Initialize named colors
-	static std::map<std::wstring, UINT32> namedColors = {
-		{L"black", D2D1::ColorF::Black},
-		{L"white", D2D1::ColorF::White},
-		{L"red", D2D1::ColorF::Red},
-		{L"green", D2D1::ColorF::Green},
-		{L"blue", D2D1::ColorF::Blue},
-		{L"orange", D2D1::ColorF::Orange},
-		{L"pink", D2D1::ColorF::Pink},
-		{L"yellow", D2D1::ColorF::Yellow},
-		{L"brown", D2D1::ColorF::Brown},
-		{L"grey", D2D1::ColorF::Gray},
-		{L"gray", D2D1::ColorF::Gray},
-		{L"teal", D2D1::ColorF::Teal},
-	};
-
-	if (source.empty()) {
-		return false;
-	}
-
-	// Trim leading whitespace
-	ltrim_str(source);
-
-	if (source == L"none") {
-		return false;
-	}
-
-	//See if it is a named color
-	if (source[0] != L'#') {
-		auto iter = namedColors.find(std::wstring(source));
-		if (iter != namedColors.end()) {
-			UINT32 color = iter->second;
-
-			r = ((color >> 16) & 0xFF) / 255.0f;
-			g = ((color >> 8) & 0xFF) / 255.0f;
-			b = (color & 0xFF) / 255.0f;
-			a = 1.0f;
-
-			return true;
-		}
-	}
-
-	//Parse #RRGGBBAA color from the source
-	if (source.length() < 7 || source[0] != L'#') {
-		return false;
-	}
-
-	std::wstring rStr(source.substr(1, 2));
-	std::wstring gStr(source.substr(3, 2));
-	std::wstring bStr(source.substr(5, 2));
-
-	r = static_cast<float>(std::stoul(rStr, nullptr, 16)) / 255.0f;
-	g = static_cast<float>(std::stoul(gStr, nullptr, 16)) / 255.0f;
-	b = static_cast<float>(std::stoul(bStr, nullptr, 16)) / 255.0f;
-
-	if (source.length() == 9) {
-		std::wstring aStr(source.substr(7, 2));
-
-		a = static_cast<float>(std::stoul(aStr, nullptr, 16)) / 255.0f;
-	}
-	else {
-		a = 1.0f;
-	}
-
-	return true;
+static bool rects_intersect(const SVGRect& a, const SVGRect& b) {
+	return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
 }
 
-static bool get_transform_functions(const std::wstring_view& source, std::vector<TransformFunction>& functions) {
-	size_t start = 0;
-
-	while (true) {
-		TransformFunction f;
-		size_t pos = source.find(L'(', start);
-
-		if (pos == std::wstring::npos) {
-			//No more functions left
-			return true;
-		}
-
-		std::wstring_view function_name = source.substr(start, pos - start);
-
-		ltrim_str(function_name);
-
-		if (function_name.empty()) {
-			return false;
-		}
-
-		f.name = function_name;
-
-		start = pos + 1;
-
-		pos = source.find(L')', start);
-
-		if (pos == std::wstring::npos) {
-			return false;
-		}
-
-		std::wstring_view values = source.substr(start, pos - start);
-		std::wstringstream ws;
-
-		//Replace comma with spaces
-		for (wchar_t ch : values) {
-			if (ch == L',') {
-				ws << L' ';
-			} else {
-				ws << ch;
-			}
-		}
-
-		float v;
-
-		while (ws >> v) {
-			f.values.push_back(v);
-		}
-
-		functions.push_back(f);
-
-		start = pos + 1;
-
-		if (start >= source.length()) {
-			break;
-		}
-	}
-
-	return true;
+static float rect_area(const SVGRect& r) {
+	return (r.right - r.left) * (r.bottom - r.top);
 }
 
-//Defs tree doesn't render
-void SVGDefsElement::render_tree(ID2D1DeviceContext* pContext) {
+static bool same_rect(const SVGRect& a, const SVGRect& b) {
+	return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
 }
 
-void SVGGraphicsElement::render_tree(ID2D1DeviceContext* pContext) {
-	OutputDebugStringW(L"Rendering element: ");
-	OutputDebugStringW(tag_name.c_str());
-	OutputDebugStringW(L"\n");
-
-	//Save the old transform
-	D2D1_MATRIX_3X2_F oldTransform;
-
-	if (combined_transform) {
-		OutputDebugStringW(L"Applying transform\n");
-		pContext->GetTransform(&oldTransform);
-
-		auto totalTransform = combined_transform.value() * oldTransform;
-
-		pContext->SetTransform(totalTransform);
-	}
-
-	render(pContext);
-
-	//Render all child elements
-	for (const auto& child : children) {
-		child->render_tree(pContext);
-	}
-
-	if (combined_transform) {
-		OutputDebugStringW(L"Restoring transform\n");
-		pContext->SetTransform(oldTransform);
+//Elements that put entries in the display list themselves
+static bool draws_itself(SVGTag tag) {
+	switch (tag) {
+	case SVGTag::Rect:
+	case SVGTag::Circle:
+	case SVGTag::Ellipse:
+	case SVGTag::Line:
+	case SVGTag::Path:
+	case SVGTag::Text:
+		return true;
+	default:
+		return false;
 	}
 }
 
-CComPtr<IDWriteTextFormat> build_text_format(IDWriteFactory* pDWriteFactory, std::wstring_view family, std::wstring_view weight, std::wstring_view style, float size) {
-	CComPtr<IDWriteTextFormat> tfmt;
-	//Split the family string by commas and try to find the first installed font
-	auto families = split_string(family, L",");
-	DWRITE_FONT_WEIGHT fontWeight = DWRITE_FONT_WEIGHT_NORMAL;
-	DWRITE_FONT_STYLE fontStyle = DWRITE_FONT_STYLE_NORMAL;
-
-	if (weight == L"bold") {
-		fontWeight = DWRITE_FONT_WEIGHT_BOLD;
-	} else if (weight == L"normal") {
-		fontWeight = DWRITE_FONT_WEIGHT_NORMAL;
-	} else if (weight == L"light") {
-		fontWeight = DWRITE_FONT_WEIGHT_LIGHT;
-	} else if (weight == L"semibold") {
-		fontWeight = DWRITE_FONT_WEIGHT_SEMI_BOLD;
-	} else if (weight == L"medium") {
-		fontWeight = DWRITE_FONT_WEIGHT_MEDIUM;
-	} else if (weight == L"black") {
-		fontWeight = DWRITE_FONT_WEIGHT_BLACK;
-	} else if (weight == L"thin") {
-		fontWeight = DWRITE_FONT_WEIGHT_THIN;
-	}
-	else {
-		std::wstringstream ws;
-
-		ws << weight;
-
-		float wValue = 0.0f;
-
-		if (ws >> wValue) {
-			if (wValue >= 1.0f && wValue <= 1000.0f) {
-				fontWeight = static_cast<DWRITE_FONT_WEIGHT>(static_cast<UINT32>(wValue));
-			}
-		}
+//Resolves a fill or stroke paint to a color. currentColor takes the computed color property.
+//Returns false for none.
+static bool get_paint_color(const SVGStyle* style, const SVGPaint& paint, uint32_t& rgba) {
+	if (paint.type == SVGPaintType::Color) {
+		rgba = paint.rgba;
 	}
-
-	if (style == L"italic") {
-		fontStyle = DWRITE_FONT_STYLE_ITALIC;
-	} else if (style == L"normal") {
-		fontStyle = DWRITE_FONT_STYLE_NORMAL;
-	} else if (style == L"oblique") {
-		fontStyle = DWRITE_FONT_STYLE_OBLIQUE;
+	else if (paint.type == SVGPaintType::CurrentColor) {
+		rgba = style->color;
 	}
-
-	for (auto& fam : families) {
-		ltrim_str(fam);
-
-		std::wstring trimmedFamily(fam);
-
-		HRESULT hr = pDWriteFactory->CreateTextFormat(
-				trimmedFamily.c_str(),
-				nullptr,
-				fontWeight,
-				fontStyle,
-				DWRITE_FONT_STRETCH_NORMAL,
-				size,
-				L"",
-				&tfmt);
-
-		if (SUCCEEDED(hr)) {
-			return tfmt;
-		}
-	}
-
-	return nullptr;
-}
-
-bool build_transform_matrix(const std::wstring_view& transformStr, D2D1_MATRIX_3X2_F& outMatrix) {
-	std::vector<TransformFunction> functions;
-
-	if (!get_transform_functions(transformStr, functions)) {
+	else {
 		return false;
 	}
 
-	//Transformation functions are applied in reverse order
-	for (auto it = functions.rbegin(); it != functions.rend(); ++it) {
-		const auto& f = *it;
-
-		if (f.name == L"translate") {
-			if (f.values.size() == 1) {
-				outMatrix = outMatrix * D2D1::Matrix3x2F::Translation(f.values[0], 0.0f);
-			}
-			else if (f.values.size() == 2) {
-				outMatrix = outMatrix * D2D1::Matrix3x2F::Translation(f.values[0], f.values[1]);
-			}
-		}
-		else if (f.name == L"scale") {
-			if (f.values.size() == 1) {
-				outMatrix = outMatrix * D2D1::Matrix3x2F::Scale(f.values[0], f.values[0]);
-			}
-			else if (f.values.size() == 2) {
-				outMatrix = outMatrix * D2D1::Matrix3x2F::Scale(f.values[0], f.values[1]);
-			}
-		}
-		else if (f.name == L"rotate") {
-			if (f.values.size() == 1) {
-				outMatrix = outMatrix * D2D1::Matrix3x2F::Rotation(f.values[0]);
-			}
-			else if (f.values.size() == 3) {
-				outMatrix = outMatrix * D2D1::Matrix3x2F::Rotation(f.values[0], D2D1::Point2F(f.values[1], f.values[2]));
-			}
-		} else if (f.name == L"matrix") {
-			if (f.values.size() == 6) {
-				D2D1_MATRIX_3X2_F m = D2D1::Matrix3x2F(
-					f.values[0], f.values[1],
-					f.values[2], f.values[3],
-					f.values[4], f.values[5]
-				);
-
-				outMatrix = outMatrix * m;
-			}
-		}
-		else if (f.name == L"skew") {
-			//Apply skew transform
-			if (f.values.size() == 2) {
-				outMatrix = outMatrix * D2D1::Matrix3x2F::Skew(f.values[0], f.values[1]);
-			}
-		}
-	}
-
 	return true;
 }
 
-bool char_is_number(wchar_t ch) {
-	return (ch >= 48 && ch <= 57) || (ch == L'.') || (ch == L'-');
-}
+//Creates the Direct2D geometry from the path data
+static CComPtr<ID2D1PathGeometry> build_path_geometry(ID2D1Factory* pD2DFactory, const SVGPathView& path_data, D2D1_FILL_MODE fill_mode = D2D1_FILL_MODE_ALTERNATE) {
+	CComPtr<ID2D1PathGeometry> geometry;
+	HRESULT hr = pD2DFactory->CreatePathGeometry(&geometry);
 
-void SVGPathElement::buildPath(ID2D1Factory* pD2DFactory, const std::wstring_view& pathData) {
-	pD2DFactory->CreatePathGeometry(&path_geometry);
+	if (!SUCCEEDED(hr)) {
+		return nullptr;
+	}
 
 	CComPtr<ID2D1GeometrySink> pSink;
 
-	path_geometry->Open(&pSink);
-
-	//SVG spec is very leinent on path syntax. White spaces are
-	//entirely optional. Numbers can either be separated by comma or spaces.
-	//Here we normalize the path by properly separating commands and numbers by spaces.
-	std::wstringstream ws;
-	std::wstring_view spaces(L", \t\r\n");
-
-	for (wchar_t ch : pathData) {
-		if (spaces.find_first_of(ch) != std::wstring_view::npos) {
-			//Normalize all spaces to single space
-			ws << L' ';
-		} else if (ch == L'-') {
-			//Insert space before negative sign
-			ws << L' ';
-			ws << ch;
-		}
-		else if (ch == L',') {
-			ws << L' ';
-		}
-		else {
-			ws << ch;
-		}
+	hr = geometry->Open(&pSink);
+
+	if (!SUCCEEDED(hr)) {
+		return nullptr;
 	}
 
-	wchar_t cmd = 0, last_cmd = 0;
+	pSink->SetFillMode(fill_mode);
+
 	bool is_in_figure = false;
-	std::wstring_view supported_cmds(L"MmLlHhVvQqTtCcSsAaZz");
-	float current_x = 0.0, current_y = 0.0;
-	float last_ctrl_x = 0.0, last_ctrl_y = 0.0;
-
-	while (!ws.eof()) {
-		//Read command letter
-		if (!(ws >> cmd)) {
-			//End of stream
-			break;
-		}
+	//Arcs need the current point, and drawing after a close starts at the last move
+	SVGPoint pen, start;
 
-		if (supported_cmds.find_first_of(cmd) == std::wstring_view::npos) {
-			//We did not find a command. Put it back.
-			ws.unget();
-
-			//As per the SVG spec deduce the command from the last command
-			if (last_cmd == L'M') {
-				//Subsequent moveto pairs are treated as lineto commands
-				cmd = L'L';
-			} else if (last_cmd == L'm') {
-				//Subsequent moveto pairs are treated as lineto commands
-				cmd = L'l';
-			}
-			else {
-				//Continue with the last command
-				cmd = last_cmd;
-			}
+	path_data.for_each([&](SVGPathVerb verb, const float* c) {
+		if (verb != SVGPathVerb::Move && verb != SVGPathVerb::Close && !is_in_figure) {
+			pSink->BeginFigure(D2D1::Point2F(start.x, start.y), D2D1_FIGURE_BEGIN_FILLED);
+			is_in_figure = true;
 		}
 
-		if (cmd == L'M' || cmd == L'm') {
-			float x = 0.0, y = 0.0;
-
+		switch (verb) {
+		case SVGPathVerb::Move:
 			//If we are already in a figure, end it first
 			if (is_in_figure) {
 				pSink->EndFigure(D2D1_FIGURE_END_OPEN);
 			}
 
-			ws >> x >> y;
-			
-			if (cmd == L'm') {
-				x += current_x;
-				y += current_y;
-			}
-
-			pSink->BeginFigure(D2D1::Point2F(x, y), D2D1_FIGURE_BEGIN_FILLED);
+			pSink->BeginFigure(D2D1::Point2F(c[0], c[1]), D2D1_FIGURE_BEGIN_FILLED);
 			is_in_figure = true;
-			//Update current point
-			current_x = x;
-			current_y = y;
-		}
-		else if (cmd == L'L' || cmd == L'l') {
-			float x = 0.0, y = 0.0;
-
-			ws >> x >> y;
-
-			if (cmd == L'l') {
-				x += current_x;
-				y += current_y;
-			}
-
-			pSink->AddLine(D2D1::Point2F(x, y));
-
-			//Update current point
-			current_x = x;
-			current_y = y;
-		}
-		else if (cmd == L'H' || cmd == L'h') {
-			float x = 0.0;
-
-			ws >> x;
-
-			if (cmd == L'h') {
-				x += current_x;
-			}
-
-			pSink->AddLine(D2D1::Point2F(x, current_y));
-
-			//Update current point
-			current_x = x;
-		}
-		else if (cmd == L'V' || cmd == L'v') {
-			float y = 0.0;
-
-			ws >> y;
-
-			if (cmd == L'v') {
-				y += current_y;
-			}
-
-			pSink->AddLine(D2D1::Point2F(current_x, y));
-
-			//Update current point
-			current_y = y;
-		}
-		else if (cmd == L'Q' || cmd == L'q') {
-			float x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
-
-			ws >> x1 >> y1 >> x2 >> y2;
-			
-			if (cmd == L'q') {
-				x1 += current_x;
-				y1 += current_y;
-				x2 += current_x;
-				y2 += current_y;
-			}
-
-			pSink->AddQuadraticBezier(D2D1::QuadraticBezierSegment(D2D1::Point2F(x1, y1), D2D1::Point2F(x2, y2)));
+			pen = start = SVGPoint{ c[0], c[1] };
 
-			//Update current point
-			current_x = x2;
-			current_y = y2;
-			last_ctrl_x = x1;
-			last_ctrl_y = y1;
-		}
-		else if (cmd == L'T' || cmd == L't') {
-			float x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
-
-			ws >> x2 >> y2;
-			
-			if (cmd == L't') {
-				x2 += current_x;
-				y2 += current_y;
-			}
-
-			//Calculate the control point by reflecting the last control point
-			if (last_cmd == L'Q' || last_cmd == L'T' || last_cmd == L'q' || last_cmd == L't') {
-				x1 = 2 * current_x - last_ctrl_x;
-				y1 = 2 * current_y - last_ctrl_y;
-			} else {
-				x1 = current_x;
-				y1 = current_y;
-			}
-
-			pSink->AddQuadraticBezier(D2D1::QuadraticBezierSegment(D2D1::Point2F(x1, y1), D2D1::Point2F(x2, y2)));
-
-			//Update current point
-			current_x = x2;
-			current_y = y2;
-			last_ctrl_x = x1;
-			last_ctrl_y = y1;
-		} 
-		else if (cmd == L'C' || cmd == L'c') {
-			float x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0, x3 = 0.0, y3 = 0.0;
-
-			ws >> x1 >> y1 >> x2 >> y2 >> x3 >> y3;
-
-			if (cmd == L'c') {
-				x1 += current_x;
-				y1 += current_y;
-				x2 += current_x;
-				y2 += current_y;
-				x3 += current_x;
-				y3 += current_y;
-			}
-
-			pSink->AddBezier(D2D1::BezierSegment(D2D1::Point2F(x1, y1), D2D1::Point2F(x2, y2), D2D1::Point2F(x3, y3)));
-
-			//Update current point
-			current_x = x3;
-			current_y = y3;
-			last_ctrl_x = x2;
-			last_ctrl_y = y2;
-		}
-		else if (cmd == L'S' || cmd == L's') {
-			float x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0, x3 = 0.0, y3 = 0.0;
+			break;
+		case SVGPathVerb::Line:
+			pSink->AddLine(D2D1::Point2F(c[0], c[1]));
+			pen = SVGPoint{ c[0], c[1] };
 
-			ws >> x2 >> y2 >> x3 >> y3;
+			break;
+		case SVGPathVerb::Quad:
+			pSink->AddQuadraticBezier(D2D1::QuadraticBezierSegment(D2D1::Point2F(c[0], c[1]), D2D1::Point2F(c[2], c[3])));
+			pen = SVGPoint{ c[2], c[3] };
 
-			if (cmd == L's') {
-				x2 += current_x;
-				y2 += current_y;
-				x3 += current_x;
-				y3 += current_y;
-			}
+			break;
+		case SVGPathVerb::Cubic:
+			pSink->AddBezier(D2D1::BezierSegment(D2D1::Point2F(c[0], c[1]), D2D1::Point2F(c[2], c[3]), D2D1::Point2F(c[4], c[5])));
+			pen = SVGPoint{ c[4], c[5] };
 
-			//Calculate the first control point by reflecting the last control point
-			if (last_cmd == L'C' || last_cmd == L'S' || last_cmd == L'c' || last_cmd == L's') {
-				x1 = 2 * current_x - last_ctrl_x;
-				y1 = 2 * current_y - last_ctrl_y;
+			break;
+		case SVGPathVerb::Arc: {
+			//SVG arcs become cubics, so out of range radii are corrected the way the spec says
+			//and the geometry is the same one the CPU renderer flattens
+			SVGArcCenter arc;
+
+			if (svg_arc_center(pen, c, arc)) {
+				SVGPoint p[12];
+				int count = svg_arc_to_cubics(arc, p);
+
+				//Exactly where the next command starts
+				p[count * 3 - 1] = SVGPoint{ c[5], c[6] };
+
+				for (int i = 0; i < count; ++i) {
+					pSink->AddBezier(D2D1::BezierSegment(
+						D2D1::Point2F(p[i * 3].x, p[i * 3].y),
+						D2D1::Point2F(p[i * 3 + 1].x, p[i * 3 + 1].y),
+						D2D1::Point2F(p[i * 3 + 2].x, p[i * 3 + 2].y)));
+				}
 			}
 			else {
-				x1 = current_x;
-				y1 = current_y;
+				pSink->AddLine(D2D1::Point2F(c[5], c[6]));
 			}
 
-			pSink->AddBezier(D2D1::BezierSegment(D2D1::Point2F(x1, y1), D2D1::Point2F(x2, y2), D2D1::Point2F(x3, y3)));
-
-			//Update current point
-			current_x = x3;
-			current_y = y3;
-			last_ctrl_x = x2;
-			last_ctrl_y = y2;
-		} else if (cmd == L'A' || cmd == L'a') {
-			// TODO: Handle elliptical arc commands
-			float rx = 0.0, ry = 0.0, x_axis_rotation = 0.0, x = 0.0, y = 0.0;
-			int large_arc_flag = 0, sweep_flag = 0;
-
-			ws >> rx >> ry >> x_axis_rotation >> large_arc_flag >> sweep_flag >> x >> y;
-			
-			if (cmd == L'a') {
-				x += current_x;
-				y += current_y;
-			}
+			pen = SVGPoint{ c[5], c[6] };
 
-			pSink->AddArc(D2D1::ArcSegment(
-				D2D1::Point2F(x, y),
-				D2D1::SizeF(rx, ry),
-				x_axis_rotation,
-				(sweep_flag != 0) ? D2D1_SWEEP_DIRECTION_CLOCKWISE : D2D1_SWEEP_DIRECTION_COUNTER_CLOCKWISE,
-				(large_arc_flag != 0) ? D2D1_ARC_SIZE_LARGE : D2D1_ARC_SIZE_SMALL
-			));
-
-			//Update current point
-			current_x = x;
-			current_y = y;
-		} else if (cmd == L'Z' || cmd == L'z') {
-			//Close the current figure
+			break;
+		}
+		case SVGPathVerb::Close:
 			if (is_in_figure) {
 				pSink->EndFigure(D2D1_FIGURE_END_CLOSED);
-				is_in_figure = false;
 			}
-		}
 
-		last_cmd = cmd;
-	}
+			is_in_figure = false;
+			pen = start;
+
+			break;
+		}
+	});
 
 	//End of path
 	if (is_in_figure) {
 		pSink->EndFigure(D2D1_FIGURE_END_OPEN);
-
-		is_in_figure = false;
 	}
 
-	pSink->Close();
-}
-
-void SVGPathElement::render(ID2D1DeviceContext* pContext) {
-	if (fill_brush) {
-		pContext->FillGeometry(path_geometry, fill_brush);
-	}
-	if (stroke_brush) {
-		pContext->DrawGeometry(path_geometry, stroke_brush, stroke_width, stroke_style);
-	}
-}
+	hr = pSink->Close();
 
-void SVGRectElement::render(ID2D1DeviceContext* pContext) {
-	if (fill_brush) {
-		pContext->FillRectangle(
-			D2D1::RectF(points[0], points[1], points[0] + points[2], points[1] + points[3]),
-			fill_brush
-		);
-	}
-	if (stroke_brush) {
-		pContext->DrawRectangle(
-			D2D1::RectF(points[0], points[1], points[0] + points[2], points[1] + points[3]),
-			stroke_brush,
-			stroke_width,
-			stroke_style
-		);
-	}
-}
-
-void SVGCircleElement::render(ID2D1DeviceContext* pContext) {
-	if (fill_brush) {
-		pContext->FillEllipse(
-			D2D1::Ellipse(D2D1::Point2F(points[0], points[1]), points[2], points[2]),
-			fill_brush
-		);
-	}
-	if (stroke_brush) {
-		pContext->DrawEllipse(
-			D2D1::Ellipse(D2D1::Point2F(points[0], points[1]), points[2], points[2]),
-			stroke_brush,
-			stroke_width
-		);
-	}
-}
-
-//Render SVGEllipseElement
-void SVGEllipseElement::render(ID2D1DeviceContext* pContext) {
-	if (fill_brush) {
-		pContext->FillEllipse(
-			D2D1::Ellipse(D2D1::Point2F(points[0], points[1]), points[2], points[3]),
-			fill_brush
-		);
-	}
-	if (stroke_brush) {
-		pContext->DrawEllipse(
-			D2D1::Ellipse(D2D1::Point2F(points[0], points[1]), points[2], points[3]),
-			stroke_brush,
-			stroke_width
-		);
-	}
-}
-
-void SVGLineElement::render(ID2D1DeviceContext* pContext) {
-	if (stroke_brush) {
-		pContext->DrawLine(
-			D2D1::Point2F(points[0], points[1]),
-			D2D1::Point2F(points[2], points[3]),
-			stroke_brush,
-			stroke_width,
-			stroke_style
-		);
+	if (!SUCCEEDED(hr)) {
+		return nullptr;
 	}
-}
 
-void SVGTextElement::render(ID2D1DeviceContext* pContext) {
-	if (fill_brush && text_format && text_layout) {
-		//SVG spec requires x and y to specify the position of the text baseline
-		D2D1_POINT_2F  origin = D2D1::Point2F(
-			points[0], 
-			points[1] - baseline);
-
-		pContext->DrawTextLayout(origin, text_layout, fill_brush);
-	}
+	return geometry;
 }
 
 bool SVGUtil::init(HWND _wnd)
@@ -739,9 +198,11 @@ bool SVGUtil::init(HWND _wnd)
 
 	hr = pD2DFactory->CreateHwndRenderTarget(
 		D2D1::RenderTargetProperties(),
+		//Partial repaints draw over the last frame, so it must survive presenting
 		D2D1::HwndRenderTargetProperties(
 			_wnd,
-			D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top)
+			D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top),
+			D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS
 		),
 		&pRenderTarget
 	);
@@ -780,9 +241,9 @@ bool SVGUtil::init(HWND _wnd)
 	//Create default text format
 	defaultTextFormat = build_text_format(
 		pDWriteFactory,
-		L"Arial, sans-serif, Verdana",
-		L"normal",
-		L"normal",
+		"Arial, sans-serif, Verdana",
+		400,
+		SVGFontStyle::Normal,
 		12.0f
 	);
 
@@ -800,795 +261,782 @@ void SVGUtil::resize()
 
 	GetClientRect(wnd, &rc);
 	pRenderTarget->Resize(D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top));
+
+	D2D1_SIZE_F size = pDeviceContext->GetSize();
+
+	//Layouts are sized to the window, only the ones laid out for another size change
+	resource_cache.resize_text_layouts(size.width, size.height);
+
+	//The target lost the last frame
+	InvalidateRect(wnd, NULL, FALSE);
 }
 
 // Render the loaded bitmap onto the window
-void SVGUtil::render()
+void SVGUtil::render(SVGRenderQuality quality)
 {
-	pDeviceContext->BeginDraw();
-	pDeviceContext->Clear(D2D1::ColorF(D2D1::ColorF::White));
-
-	if (root_element) {
-		//Render the SVG element tree
-		root_element->render_tree(pDeviceContext);
-	}
+	RECT rc;
 
-	pDeviceContext->EndDraw();
+	GetClientRect(wnd, &rc);
+	render_rects(std::vector<RECT>{ rc }, quality);
 }
 
-bool get_element_name(IXmlReader *pReader, std::wstring_view& name) {
-	const wchar_t* pwszLocalName = NULL;
-	UINT len;
-
-	HRESULT hr = pReader->GetLocalName(&pwszLocalName, &len);
+void SVGUtil::render(HRGN update, SVGRenderQuality quality)
+{
+	DWORD size = GetRegionData(update, 0, nullptr);
+	std::vector<uint8_t> buffer(size);
+	RGNDATA* data = reinterpret_cast<RGNDATA*>(buffer.data());
 
-	if (!SUCCEEDED(hr)) {
-		return false;
+	if (size == 0 || GetRegionData(update, size, data) != size) {
+		render(quality);
+		return;
 	}
 
-	name = std::wstring_view(pwszLocalName, len);
+	const RECT* rects = reinterpret_cast<const RECT*>(data->Buffer);
 
-	return true;
+	render_rects(std::vector<RECT>(rects, rects + data->rdh.nCount), quality);
 }
 
-bool get_attribute(IXmlReader* pReader, const wchar_t* attr_name, std::wstring_view& attr_value) {
-	const wchar_t* pwszValue = NULL;
-	UINT len;
-
-	HRESULT hr = pReader->MoveToAttributeByName(attr_name, NULL);
-
-	if (hr == S_FALSE) {
-		return false; //Attribute not found
-	}
-
-	if (!SUCCEEDED(hr)) {
-		return false;
+void SVGUtil::render_rects(const std::vector<RECT>& rects, SVGRenderQuality quality)
+{
+	if (software_rendering) {
+		render_software(rects, quality);
+		return;
 	}
 
-	hr = pReader->GetValue(&pwszValue, &len);
+	auto start = std::chrono::steady_clock::now();
+	bool aliased = quality == SVGRenderQuality::Aliased;
+	D2D1_SIZE_F size = pDeviceContext->GetSize();
+	float dpi_x, dpi_y;
+	float area = 0.0f;
 
-	if (!SUCCEEDED(hr)) {
-		return false;
-	}
+	pDeviceContext->GetDpi(&dpi_x, &dpi_y);
 
-	attr_value = std::wstring_view(pwszValue, len);
+	SVGMatrix to_window = view_transform();
+	SVGMatrix to_world;
 
-	return true;
-}
+	svg_invert(to_window, to_world);
 
-//Gets the id reference from the href or xlink:href attribute.
-//Only reference by ID values like href="#someId" or href="url(#someId)"
-//are supported
-static bool get_href_id(IXmlReader* pReader, std::wstring_view& ref_id) {
-	std::wstring_view source;
+	render_stats = SVGRenderStats();
 
-	if (!get_attribute(pReader, L"href", source)) {
-		return false;
-	}
+	pDeviceContext->BeginDraw();
+	pDeviceContext->SetAntialiasMode(aliased ? D2D1_ANTIALIAS_MODE_ALIASED : D2D1_ANTIALIAS_MODE_PER_PRIMITIVE);
+	pDeviceContext->SetTextAntialiasMode(aliased ? D2D1_TEXT_ANTIALIAS_MODE_ALIASED : D2D1_TEXT_ANTIALIAS_MODE_DEFAULT);
+
+	for (const RECT& rect : rects) {
+		//The rect is in pixels, the display list and the window in DIPs
+		SVGRect view{ rect.left * 96.0f / dpi_x, rect.top * 96.0f / dpi_y, rect.right * 96.0f / dpi_x, rect.bottom * 96.0f / dpi_y };
+		//What the rect shows of the document
+		SVGRect world = svg_transform_rect(to_world, SVGTransformClass::ScaleTranslate, view);
+
+		//Clear is clipped too
+		pDeviceContext->SetTransform(D2D1::Matrix3x2F::Identity());
+		pDeviceContext->PushAxisAlignedClip(D2D1::RectF(view.left, view.top, view.right, view.bottom), D2D1_ANTIALIAS_MODE_ALIASED);
+		pDeviceContext->Clear(D2D1::ColorF(D2D1::ColorF::White));
+
+		if (view.left <= 0.0f && view.top <= 0.0f && view.right >= size.width && view.bottom >= size.height) {
+			//Subtrees out of the window are skipped whole
+			display_list.cull(world, visible_batches);
+		}
+		else {
+			//Everything that meets a part of the window, in paint order, from the spatial index
+			spatial_index.query(world, visible_items);
+			visible_batches.clear();
 
-	if (source.find(L"url") != std::wstring_view::npos) {
-		size_t start = source.find(L"(");
-		size_t end = source.rfind(L")");
+			for (uint32_t item : visible_items) {
+				uint32_t batch = display_list.items[item].batch;
 
-		if (start == std::wstring_view::npos || end == std::wstring_view::npos) {
-			return false;
+				if (visible_batches.empty() || visible_batches.back() != batch) {
+					visible_batches.push_back(batch);
+				}
+			}
 		}
 
-		source = source.substr(start + 1, end - start - 1);
-	}
+		render_stats.culled += display_list.draw_calls() - visible_batches.size();
 
-	ltrim_str(source);
-	rtrim_str(source);
+		//Replay the display list. The transform is only set when it changes,
+		//which for siblings under one group is once for the whole run.
+		const SVGMatrix* current_transform = nullptr;
 
-	if (source.empty()) {
-		return false;
-	}
+		for (uint32_t b : visible_batches) {
+			const SVGDisplayBatch& batch = display_list.batches[b];
+			const SVGDisplayItem& item = display_list.items[batch.first];
 
-	if (source[0] == L'#') {
-		source = source.substr(1);
+			if (!current_transform || !svg_matrix_equals(*current_transform, item.transform)) {
+				pDeviceContext->SetTransform(to_d2d_matrix(svg_multiply(item.transform, item.transform_class, to_window)));
+				current_transform = &item.transform;
+				++render_stats.transform_changes;
+			}
 
-		if (source.empty()) {
-			return false;
-		}
+			if (batch.count == 1) {
+				draw_item(item);
+			}
+			else {
+				draw_batch(b);
+			}
 
-		ref_id = source;
+			++render_stats.draw_calls;
+		}
 
-		return true;
+		pDeviceContext->SetTransform(D2D1::Matrix3x2F::Identity());
+		pDeviceContext->PopAxisAlignedClip();
+		area += (view.right - view.left) * (view.bottom - view.top);
 	}
 
+	pDeviceContext->EndDraw();
 
-	return false;
+	render_stats.items = display_list.size();
+	render_stats.quality = quality;
+	render_stats.repainted = size.width > 0.0f && size.height > 0.0f ? std::fmin(1.0f, area / (size.width * size.height)) : 1.0f;
+	render_stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
-bool get_size_value(ID2D1DeviceContext *pContext, const std::wstring_view& source, float& size) {
+//Rasterizes the display list on the CPU into a bitmap the size of the window
+//and only uses Direct2D to put it on screen. The bitmap keeps the last frame, so
+//only the pixels in rects are drawn again. With tile_caching they are copied from
+//tile_cache, which only rasterizes the tiles it doesn't have.
+void SVGUtil::render_software(const std::vector<RECT>& rects, SVGRenderQuality quality)
+{
+	auto start = std::chrono::steady_clock::now();
+	D2D1_SIZE_U size = pRenderTarget->GetPixelSize();
+	float dpi_x, dpi_y;
+	float area = 0.0f;
 
-	try {
-		size_t len;
-		std::wstring_view unit;
+	pDeviceContext->GetDpi(&dpi_x, &dpi_y);
 
-		size = std::stof(std::wstring(source), &len);
+	if (software_target.width != static_cast<int>(size.width) || software_target.height != static_cast<int>(size.height)) {
+		software_target.resize(size.width, size.height);
+		software_bitmap.Release();
+	}
 
-		if (len < source.length()) {
-			unit = std::wstring_view(source).substr(len);
-		}
-		else {
-			return true; //No unit specified, assume pixels
-		}
+	//The display list is in DIPs
+	SVGMatrix device = SVGMatrix::scale(dpi_x / 96.0f, dpi_y / 96.0f);
+	std::vector<SVGPixelRect> clips;
+	SVGTileStats tiles_before = tile_cache.stats();
+	size_t pending = 0;
 
-		float dpiX, dpiY;
-		
-		pContext->GetDpi(&dpiX, &dpiY);
+	for (const RECT& rect : rects) {
+		SVGPixelRect clip;
 
-		//Take an average of the horizontal and vertical DPI for unit conversion
-		float dpi = (dpiX + dpiY) / 2.0f;
+		clip.left = std::max(0, static_cast<int>(rect.left));
+		clip.top = std::max(0, static_cast<int>(rect.top));
+		clip.right = std::min(software_target.width, static_cast<int>(rect.right));
+		clip.bottom = std::min(software_target.height, static_cast<int>(rect.bottom));
 
-		if (unit == L"px") {
-			//Pixels, do nothing
-		}
-		else if (unit == L"in") {
-			size *= dpi; //Inches to pixels
-		}
-		else if (unit == L"cm") {
-			size *= dpi / 2.54f; //Centimeters to pixels
+		if (clip.left < clip.right && clip.top < clip.bottom) {
+			clips.push_back(clip);
 		}
-		else if (unit == L"mm") {
-			size *= dpi / 25.4f; //Millimeters to pixels
-		}
-		else if (unit == L"pt") {
-			size *= dpi / 72.0f; //Points to pixels
-		}
-		else if (unit == L"pc") {
-			size *= dpi / 6.0f; //Picas to pixels
-		}
-
-		return true;
-	}
-	catch (const std::exception& e) {
-		return false;
 	}
-}
 
-bool get_size_attribute(IXmlReader* pReader, ID2D1DeviceContext* pContext, const wchar_t* attr_name, float& size) {
-	std::wstring_view attr_value;
+	//A new bitmap holds no frame yet
+	bool whole = !software_bitmap || (clips.size() == 1 && clips[0].left == 0 && clips[0].top == 0 &&
+		clips[0].right == software_target.width && clips[0].bottom == software_target.height);
 
-	if (!get_attribute(pReader, attr_name, attr_value)) {
-		return false;
+	if (whole) {
+		clips.assign(1, SVGPixelRect{ 0, 0, software_target.width, software_target.height });
 	}
 
-	return get_size_value(pContext, attr_value, size);
-}
-
-//A simple parser for inline CSS styles.
-void parse_css_style_string(std::wstring_view styleStr, std::map<std::wstring, std::wstring>& styles) {
-	std::vector<std::wstring_view> declarations = split_string(styleStr, L";");
-
-	for (const auto& decl : declarations) {
-		size_t colonPos = decl.find(L':');
-		if (colonPos != std::wstring_view::npos) {
-			std::wstring_view property = decl.substr(0, colonPos);
-			std::wstring_view value = decl.substr(colonPos + 1);
-			
-			ltrim_str(property);
-			ltrim_str(value);
-
-			if (!property.empty() && !value.empty()) {
-				styles[std::wstring(property)] = std::wstring(value);
-			}
+	if (tile_caching) {
+		//Tiles are opaque, they cover what the bitmap held
+		for (const SVGPixelRect& clip : clips) {
+			pending += tile_cache.draw(document, display_list, software_renderer, thread_pool, device, zoom_level, pan_x, pan_y, software_target, clip, zooming, quality);
 		}
-	}
-}
-
-//Normalizes style from both the "style" attribute and presentation attributes like "fill", "stroke", etc.
-void collect_styles(IXmlReader* pReader, std::shared_ptr<SVGGraphicsElement>& new_element) {
-	std::wstring_view style_str;
 
-	if (get_attribute(pReader, L"style", style_str)) {
-		parse_css_style_string(style_str, new_element->styles);
+		zooming = false;
 	}
+	else if (whole) {
+		device = svg_multiply(view_transform(), device);
+		software_target.clear(0xFFFFFFFF);
+		software_renderer.render_tiled(document, display_list, software_target, device, thread_pool, quality);
+	}
+	else {
+		device = svg_multiply(view_transform(), device);
+
+		for (const SVGPixelRect& clip : clips) {
+			for (int y = clip.top; y < clip.bottom; ++y) {
+				//Opaque white is all ones premultiplied
+				std::fill(software_target.row(y) + clip.left * 4, software_target.row(y) + clip.right * 4, static_cast<uint8_t>(0xFF));
+			}
 
-	const wchar_t* presentation_attributes[] = {
-		L"fill", 
-		L"fill-opacity", 
-		L"stroke-opacity",
-		L"stroke-linecap",
-		L"stroke-linejoin",
-		L"stroke-miterlimit",
-		L"stroke", 
-		L"stroke-width", 
-		L"font-family", 
-		L"font-size", 
-		L"font-weight", 
-		L"font-style"
-	};
-
-	for (const wchar_t* attr_name : presentation_attributes) {
-		std::wstring_view attr_value;
-
-		if (get_attribute(pReader, attr_name, attr_value)) {
-			new_element->styles[std::wstring(attr_name)] = std::wstring(attr_value);
+			software_renderer.render(document, display_list, software_target, device, clip, quality);
 		}
 	}
-}
 
-bool SVGGraphicsElement::get_style_computed(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, const std::wstring& style_name, std::wstring& style_value) {
-	auto it = styles.find(style_name);
-
-	if (it != styles.end()) {
-		style_value = it->second;
+	if (!software_bitmap) {
+		HRESULT hr = pDeviceContext->CreateBitmap(
+			size,
+			nullptr,
+			0,
+			D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_R8G8B8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED), dpi_x, dpi_y),
+			&software_bitmap
+		);
 
-		return true;
+		if (!SUCCEEDED(hr)) {
+			return;
+		}
 	}
 
-	//If the style is not defined on the current element, check the parent elements
-	//Loop through parent stack from top to bottom (for a vector: back to front)
-	for (auto it = parent_stack.rbegin(); it != parent_stack.rend(); ++it) {
-		const auto& parent = *it;
-		auto styleIt = parent->styles.find(style_name);
+	pDeviceContext->BeginDraw();
 
-		if (styleIt != parent->styles.end()) {
-			style_value = styleIt->second;
+	for (const SVGPixelRect& clip : clips) {
+		D2D1_RECT_U copy = D2D1::RectU(clip.left, clip.top, clip.right, clip.bottom);
 
-return true;
-		}
+		software_bitmap->CopyFromMemory(&copy, software_target.row(clip.top) + clip.left * 4, size.width * 4);
+		pDeviceContext->PushAxisAlignedClip(D2D1::RectF(clip.left * 96.0f / dpi_x, clip.top * 96.0f / dpi_y, clip.right * 96.0f / dpi_x, clip.bottom * 96.0f / dpi_y), D2D1_ANTIALIAS_MODE_ALIASED);
+		pDeviceContext->DrawBitmap(software_bitmap);
+		pDeviceContext->PopAxisAlignedClip();
+		area += static_cast<float>(clip.right - clip.left) * (clip.bottom - clip.top);
 	}
 
-	return false;
-}
+	pDeviceContext->EndDraw();
 
-void SVGGraphicsElement::get_style_computed(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, const std::wstring& style_name, std::wstring& style_value, const std::wstring& default_value) {
-	if (!get_style_computed(parent_stack, style_name, style_value)) {
-		style_value = default_value;
+	render_stats = SVGRenderStats();
+	render_stats.items = display_list.size();
+	render_stats.draw_calls = display_list.draw_calls();
+	render_stats.quality = quality;
+	render_stats.repainted = size.width > 0 && size.height > 0 ? area / (static_cast<float>(size.width) * size.height) : 1.0f;
+	render_stats.tile_hits = tile_cache.stats().hits - tiles_before.hits;
+	render_stats.tile_misses = tile_cache.stats().misses - tiles_before.misses;
+	render_stats.tile_placeholders = tile_cache.stats().placeholders - tiles_before.placeholders;
+	render_stats.tile_memory = tile_cache.stats().memory;
+	render_stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (pending > 0) {
+		//Placeholders are replaced once the messages waiting, like more zooming, are handled
+		InvalidateRect(wnd, NULL, FALSE);
 	}
 }
 
-bool apply_viewbox(ID2D1DeviceContext* pContext, std::shared_ptr<SVGGraphicsElement> e, IXmlReader* pReader) {
-	//Default viewport width and height
-	float width = 300.0f, height = 150.0f;
-	float vb_x = 0.0f, vb_y = 0.0f, vb_width = width, vb_height = height;
+//Draws a run of entries that paint the same way as one geometry,
+//with the brushes of the first entry
+void SVGUtil::draw_batch(size_t index) {
+	const SVGDisplayBatch& batch = display_list.batches[index];
+	const SVGDisplayItem& item = display_list.items[batch.first];
+	const SVGNodeResources& res = node_resources[item.resource];
+	CComPtr<ID2D1PathGeometry>& geometry = batch_geometries[index];
 
-	//Read width and height attributes
-	get_size_attribute(pReader, pContext, L"width", width);
-	get_size_attribute(pReader, pContext, L"height", height);
+	if (!geometry) {
+		SVGPathData outline;
 
-	std::wstring_view viewBoxStr;
-	std::wstringstream ws;
-
-	if (get_attribute(pReader, L"viewBox", viewBoxStr)) {
-		//Replace comma with spaces
-		for (wchar_t ch : viewBoxStr) {
-			if (ch == L',') {
-				ch = L' ';
-			}
+		display_list.batch_outline(batch, outline);
+		geometry = build_path_geometry(pD2DFactory, outline.view(), D2D1_FILL_MODE_WINDING);
 
-			ws << ch;
+		if (!geometry) {
+			return;
 		}
+	}
 
-		//Parse viewBox attribute.
-		//For now expect all four values to be present.
-		if (!(ws >> vb_x >> vb_y >> vb_width >> vb_height)) {
-			return false;
+	switch (item.op) {
+	case SVGDrawOp::FillRect:
+	case SVGDrawOp::FillEllipse:
+		if (res.fill_brush) {
+			pDeviceContext->FillGeometry(geometry, res.fill_brush);
 		}
 
-		if (vb_width <= 0.0f || vb_height <= 0.0f) {
-			return false;
+		break;
+	case SVGDrawOp::StrokeEllipse:
+		if (res.stroke_brush) {
+			pDeviceContext->DrawGeometry(geometry, res.stroke_brush, item.stroke_width);
 		}
 
-		//Calculate scale factors
-		float scale_x = width / vb_width;
-		float scale_y = height / vb_height;
-		float scale = scale_x < scale_y ? scale_x : scale_y;
-
-		//Create transform matrix
-		D2D1_MATRIX_3X2_F viewboxTransform = D2D1::Matrix3x2F::Translation(-vb_x, -vb_y) *
-			D2D1::Matrix3x2F::Scale(scale, scale);
-		e->combined_transform = viewboxTransform;
+		break;
+	default:
+		if (res.stroke_brush) {
+			pDeviceContext->DrawGeometry(geometry, res.stroke_brush, item.stroke_width, res.stroke_style);
+		}
 
-		return true;
-	}
-	else {
-		return false;
+		break;
 	}
 }
 
-void SVGGraphicsElement::configure_presentation_style(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, ID2D1DeviceContext* pDeviceContext, ID2D1Factory* pD2DFactory) {
-	std::wstring style_value;
-	HRESULT hr = S_OK;
+void SVGUtil::draw_item(const SVGDisplayItem& item) {
+	const SVGNodeResources& res = node_resources[item.resource];
+	const float* g = item.geometry;
 
-	//Set brushes
-	float stroke_opacity = 1.0f;
-
-	if (get_style_computed(parent_stack, L"stroke-opacity", style_value) &&
-		get_size_value(pDeviceContext, style_value, stroke_opacity)) {
-	}
-
-	get_style_computed(parent_stack, L"stroke", style_value, L"none");
+	switch (item.op) {
+	case SVGDrawOp::FillRect:
+		if (res.fill_brush) {
+			pDeviceContext->FillRectangle(
+				D2D1::RectF(g[0], g[1], g[0] + g[2], g[1] + g[3]),
+				res.fill_brush
+			);
+		}
 
-	if (style_value == L"none") {
-		this->stroke_brush = nullptr;
-	}
-	else {
-		float r, g, b, a;
+		break;
+	case SVGDrawOp::StrokeRect:
+		if (res.stroke_brush) {
+			pDeviceContext->DrawRectangle(
+				D2D1::RectF(g[0], g[1], g[0] + g[2], g[1] + g[3]),
+				res.stroke_brush,
+				item.stroke_width,
+				res.stroke_style
+			);
+		}
 
-		if (get_rgba(style_value, r, g, b, a)) {
-			CComPtr<ID2D1SolidColorBrush> brush;
+		break;
+	case SVGDrawOp::FillEllipse:
+		if (res.fill_brush) {
+			pDeviceContext->FillEllipse(
+				D2D1::Ellipse(D2D1::Point2F(g[0], g[1]), g[2], g[3]),
+				res.fill_brush
+			);
+		}
 
-			hr = pDeviceContext->CreateSolidColorBrush(
-				D2D1::ColorF(r, g, b, a * stroke_opacity),
-				&brush
+		break;
+	case SVGDrawOp::StrokeEllipse:
+		if (res.stroke_brush) {
+			pDeviceContext->DrawEllipse(
+				D2D1::Ellipse(D2D1::Point2F(g[0], g[1]), g[2], g[3]),
+				res.stroke_brush,
+				item.stroke_width
 			);
+		}
 
-			if (SUCCEEDED(hr)) {
-				this->stroke_brush = brush;
-			}
+		break;
+	case SVGDrawOp::StrokeLine:
+		if (res.stroke_brush) {
+			pDeviceContext->DrawLine(
+				D2D1::Point2F(g[0], g[1]),
+				D2D1::Point2F(g[2], g[3]),
+				res.stroke_brush,
+				item.stroke_width,
+				res.stroke_style
+			);
 		}
 
-		D2D1_CAP_STYLE cap_style = D2D1_CAP_STYLE_FLAT;
+		break;
+	case SVGDrawOp::FillPath:
+	case SVGDrawOp::StrokePath: {
+		CComPtr<ID2D1PathGeometry>& path_geometry = path_geometries[item.payload];
 
-		if (get_style_computed(parent_stack, L"stroke-linecap", style_value)) {
-			if (style_value == L"round") {
-				cap_style = D2D1_CAP_STYLE_ROUND;
-			}
-			else if (style_value == L"square") {
-				cap_style = D2D1_CAP_STYLE_SQUARE;
-			}
-		}
+		if (!path_geometry) {
+			//Geometry is built on first render. Paths that are never drawn
+			//(like the ones in <defs>) never pay for it.
+			D2D1_FILL_MODE fill_mode = document.nodes[item.resource].style->fill_rule == SVGFillRule::EvenOdd ?
+				D2D1_FILL_MODE_ALTERNATE : D2D1_FILL_MODE_WINDING;
 
-		D2D1_LINE_JOIN line_join = D2D1_LINE_JOIN_MITER;
+			path_geometry = build_path_geometry(pD2DFactory, document.path(item.payload), fill_mode);
 
-		if (get_style_computed(parent_stack, L"stroke-linejoin", style_value)) {
-			if (style_value == L"bevel") {
-				line_join = D2D1_LINE_JOIN_BEVEL;
-			}
-			else if (style_value == L"round") {
-				line_join = D2D1_LINE_JOIN_ROUND;
+			if (!path_geometry) {
+				break;
 			}
 		}
 
-		float miter_limit = 4.0f;
-
-		if (get_style_computed(parent_stack, L"stroke-miterlimit", style_value) &&
-			get_size_value(pDeviceContext, style_value, miter_limit)) {
+		if (item.op == SVGDrawOp::FillPath && res.fill_brush) {
+			pDeviceContext->FillGeometry(path_geometry, res.fill_brush);
+		}
+		else if (item.op == SVGDrawOp::StrokePath && res.stroke_brush) {
+			pDeviceContext->DrawGeometry(path_geometry, res.stroke_brush, item.stroke_width, res.stroke_style);
 		}
 
-		D2D1_STROKE_STYLE_PROPERTIES stroke_properties = D2D1::StrokeStyleProperties(
-			cap_style,     // Start cap
-			cap_style,     // End cap
-			D2D1_CAP_STYLE_ROUND,    // Dash cap
-			line_join,    // Line join
-			miter_limit//,                   // Miter limit
-			//D2D1_DASH_STYLE_CUSTOM,  // Dash style
-			//0.0f                     // Dash offset
-		);
+		break;
+	}
+	case SVGDrawOp::FillText: {
+		SVGTextResources& text = text_resources[item.payload];
 
-		CComPtr<ID2D1StrokeStyle> ss;
+		if (!res.fill_brush || !text.text_format) {
+			break;
+		}
 
-		hr = pD2DFactory->CreateStrokeStyle(
-			&stroke_properties,
-			nullptr,
-			0,
-			&ss
-		);
+		if (!text.layout) {
+			//Laid out on first render and shared by every text with the same content and format
+			D2D1_SIZE_F size = pDeviceContext->GetSize();
 
-		if (SUCCEEDED(hr)) {
-			this->stroke_style = ss;
+			text.layout = resource_cache.text_layout(pDWriteFactory, text.text_format, document.text(item.payload), size.width, size.height);
 		}
-	}
-
-	//Get fill opacity
-	//TBD: We read this as a size, even though only % and plain numbers are allowed.
-	float fill_opacity = 1.0f;
 
-	if (get_style_computed(parent_stack, L"fill-opacity", style_value) &&
-		get_size_value(pDeviceContext, style_value, fill_opacity)) {
-	}
+		if (text.layout && text.layout->update_metrics()) {
+			//SVG spec requires x and y to specify the position of the text baseline
+			D2D1_POINT_2F  origin = D2D1::Point2F(
+				g[0],
+				g[1] - text.layout->baseline);
 
-	//Get fill
-	get_style_computed(parent_stack, L"fill", style_value, L"black");
+			pDeviceContext->DrawTextLayout(origin, text.layout->layout, res.fill_brush);
+		}
 
-	if (style_value == L"none") {
-		this->fill_brush = nullptr;
+		break;
 	}
-	else {
-		float r, g, b, a;
-
-		if (get_rgba(style_value, r, g, b, a)) {
-			CComPtr<ID2D1SolidColorBrush> brush;
-
-			hr = pDeviceContext->CreateSolidColorBrush(
-				D2D1::ColorF(r, g, b, a * fill_opacity),
-				&brush
-			);
-			if (SUCCEEDED(hr)) {
-				this->fill_brush = brush;
-			}
-		}
 	}
+}
 
-	//Get stroke width
-	float w;
+static void create_paint_resources(SVGResourceCache& cache, ID2D1DeviceContext* pDeviceContext, ID2D1Factory* pD2DFactory, const SVGStyle* style, SVGNodeResources& res) {
+	uint32_t rgba;
 
-	if (get_style_computed(parent_stack, L"stroke-width", style_value) &&
-		get_size_value(pDeviceContext, style_value, w)) {
-		this->stroke_width = w;
+	//Set brushes
+	if (get_paint_color(style, style->stroke, rgba)) {
+		res.stroke_brush = cache.brush(pDeviceContext, rgba, style->stroke_opacity);
+		res.stroke_style = cache.stroke_style(pD2DFactory, style->stroke_linecap, style->stroke_linejoin, style->stroke_miterlimit);
 	}
-}
 
-void SVGGElement::configure_presentation_style(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, ID2D1DeviceContext* pDeviceContext, ID2D1Factory* pD2DFactory) {
-	//Group element doesn't need to create any brushes.
+	//Get fill
+	if (get_paint_color(style, style->fill, rgba)) {
+		res.fill_brush = cache.brush(pDeviceContext, rgba, style->fill_opacity);
+	}
 }
 
-void SVGTextElement::configure_presentation_style(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, ID2D1DeviceContext* pDeviceContext, ID2D1Factory* pD2DFactory) {
-	SVGGraphicsElement::configure_presentation_style(parent_stack, pDeviceContext, pD2DFactory);
+//Creates the brushes, stroke styles and text formats of the document's nodes.
+//Text layouts are created on first render.
+//Containers draw nothing, so they get no resources.
+bool SVGUtil::create_resources() {
+	node_resources.assign(document.nodes.size(), SVGNodeResources());
+	text_resources.assign(document.texts.size(), SVGTextResources());
+	path_geometries.assign(document.paths.size(), nullptr);
+	batch_geometries.assign(display_list.batches.size(), nullptr);
 
-	std::wstring fontFamily;
-	std::wstring fontWeight;
-	std::wstring fontStyle;
-	std::wstring fontSizeStr;
-	float fontSize = 12.0f;
+	for (size_t i = 0; i < document.nodes.size(); ++i) {
+		create_node_resources(static_cast<SVGNodeId>(i));
+	}
 
-	get_style_computed(parent_stack, L"font-family", fontFamily, L"Arial, sans-serif, Verdana");
-	get_style_computed(parent_stack, L"font-weight", fontWeight, L"normal");
-	get_style_computed(parent_stack, L"font-style", fontStyle, L"normal");
-	get_style_computed(parent_stack, L"font-size", fontSizeStr, L"12");
+	return true;
+}
 
-	get_size_value(pDeviceContext, fontSizeStr, fontSize);
+void SVGUtil::create_node_resources(SVGNodeId id) {
+	const SVGNode& node = document.nodes[id];
+
+	switch (node.tag) {
+	case SVGTag::Rect:
+	case SVGTag::Circle:
+	case SVGTag::Ellipse:
+	case SVGTag::Line:
+	case SVGTag::Path:
+		create_paint_resources(resource_cache, pDeviceContext, pD2DFactory, node.style, node_resources[id]);
+
+		break;
+	case SVGTag::Text:
+		create_paint_resources(resource_cache, pDeviceContext, pD2DFactory, node.style, node_resources[id]);
+
+		text_resources[node.payload].text_format = resource_cache.text_format(
+			pDWriteFactory,
+			node.style->font_family,
+			node.style->font_weight,
+			node.style->font_style,
+			node.style->font_size.value
+		);
 
-	this->text_format = build_text_format(
-		pDWriteFactory,
-		fontFamily,
-		fontWeight,
-		fontStyle,
-		fontSize
-	);
+		break;
+	default:
+		break;
+	}
 }
 
 bool SVGUtil::parse(const wchar_t* fileName) {
-	CComPtr<IXmlReader> pReader;
-
-	HRESULT hr = ::CreateXmlReader(__uuidof(IXmlReader), (void**)&pReader, NULL);
+	SVGMappedFile file;
 
-	if (!SUCCEEDED(hr)) {
+	if (!file.open(fileName)) {
 		return false;
 	}
 
-	CComPtr<IStream> pFileStream;
+	std::string_view source = file.data();
+	std::string converted;
 
-	hr = SHCreateStreamOnFileEx(fileName, STGM_READ | STGM_SHARE_DENY_WRITE, FILE_ATTRIBUTE_NORMAL, FALSE, NULL, &pFileStream);
-	
-	if (!SUCCEEDED(hr)) {
-		return false;
-	}
+	if (source.size() >= 2 && static_cast<unsigned char>(source[0]) == 0xFF && static_cast<unsigned char>(source[1]) == 0xFE) {
+		//UTF-16 little endian file. Convert it to UTF-8 up front so the
+		//tokenizer only ever deals with one encoding.
+		const wchar_t* wide = reinterpret_cast<const wchar_t*>(source.data() + 2);
+		int wide_len = static_cast<int>((source.size() - 2) / sizeof(wchar_t));
+		int len = WideCharToMultiByte(CP_UTF8, 0, wide, wide_len, nullptr, 0, nullptr, nullptr);
 
-	hr = pReader->SetInput(pFileStream);
+		if (len > 0) {
+			converted.resize(len);
 
-	if (!SUCCEEDED(hr)) {
-		return false;
+			WideCharToMultiByte(CP_UTF8, 0, wide, wide_len, &converted[0], len, nullptr, nullptr);
+		}
+
+		source = converted;
 	}
 
-	//Clear any existing root element
-	root_element = nullptr;
+	SVGLengthContext root_context;
+	float dpiX, dpiY;
 
-	std::vector<std::shared_ptr<SVGGraphicsElement>> parent_stack;
+	//Take an average of the horizontal and vertical DPI for unit conversion
+	pDeviceContext->GetDpi(&dpiX, &dpiY);
+	root_context.dpi = (dpiX + dpiY) / 2.0f;
+	root_context.viewport_width = pDeviceContext->GetSize().width;
+	root_context.viewport_height = pDeviceContext->GetSize().height;
 
-	while (true) {
-		XmlNodeType nodeType;
+	//Resources of the previous document point into it, release them first
+	node_resources.clear();
+	resource_cache.clear();
+	text_resources.clear();
+	path_geometries.clear();
 
-		hr = pReader->Read(&nodeType);
+	display_list.clear();
+	spatial_index.clear();
+	software_renderer.stroke_cache.clear();
+	tile_cache.clear();
+	dirty_rects.clear();
+	zoom_level = 0;
+	pan_x = 0;
+	pan_y = 0;
 
-		if (hr == S_FALSE) {
-			break; //End of file
-		}
+	if (!document.parse(source, root_context, parallel_path_parsing ? &thread_pool : nullptr)) {
+		return false;
+	}
 
-		if (!SUCCEEDED(hr)) {
-			return false;
-		}
+	display_list.compile(document);
+	spatial_index.build(display_list);
 
-		if (nodeType == XmlNodeType_Element) {
-			//We must call IsEmptyElement before reading
-			//any attributes!!!
-			bool is_self_closing = pReader->IsEmptyElement();
+	return create_resources();
+}
 
-			std::wstring_view element_name, attr_value;
+SVGNodeId SVGUtil::hit_test(float x, float y) {
+	SVGMatrix to_world;
 
-			if (!get_element_name(pReader, element_name)) {
-				return false;
-			}
+	apply_changes();
+	svg_invert(view_transform(), to_world);
 
-			std::shared_ptr<SVGGraphicsElement> parent_element;
-			std::shared_ptr<SVGGraphicsElement> new_element;
+	uint32_t item = spatial_index.hit_test(document, display_list, svg_transform_point(to_world, SVGPoint{ x, y }));
 
-			if (!parent_stack.empty()) {
-				parent_element = parent_stack.back();
-			}
+	return item == svg_no_item ? svg_no_node : display_list.items[item].resource;
+}
 
-			if (element_name == L"svg") {
-				new_element = std::make_shared<SVGGraphicsElement>();
+void SVGUtil::query(const SVGRect& rect, std::vector<SVGNodeId>& found) {
+	std::vector<uint32_t> items;
+	//Node then paint order, to keep the first entry of each node
+	std::vector<std::pair<SVGNodeId, uint32_t>> nodes;
+	SVGMatrix to_world;
 
-				//Set up default brushes
-				new_element->fill_brush = defaultFillBrush;
-				new_element->stroke_brush = nullptr;
+	apply_changes();
+	svg_invert(view_transform(), to_world);
+	spatial_index.query(svg_transform_rect(to_world, SVGTransformClass::ScaleTranslate, rect), items);
 
-				if (!root_element)
-				{
-					//This is the root <svg> element
-					root_element = new_element;
-				}
-				else {
-					//Inner svg elements have some special treatment
-					float x = 0.0f, y = 0.0f, width = 100.0f, height = 100.0f;
-
-					if (get_size_attribute(pReader, pDeviceContext, L"x", x) &&
-						get_size_attribute(pReader, pDeviceContext, L"y", y)) {
-						//Position the inner SVG element
-						new_element->combined_transform = D2D1::Matrix3x2F::Translation(x, y);
-					}
-				}
+	for (uint32_t item : items) {
+		nodes.emplace_back(display_list.items[item].resource, item);
+	}
 
-				apply_viewbox(pDeviceContext, new_element, pReader);
-			}
-			else if (element_name == L"rect") {
-				float x, y, width, height;
-				if (get_size_attribute(pReader, pDeviceContext, L"x", x) &&
-					get_size_attribute(pReader, pDeviceContext, L"y", y) &&
-					get_size_attribute(pReader, pDeviceContext, L"width", width) &&
-					get_size_attribute(pReader, pDeviceContext, L"height", height)) {
-					new_element = std::make_shared<SVGRectElement>();
-
-					new_element->points.push_back(x);
-					new_element->points.push_back(y);
-					new_element->points.push_back(width);
-					new_element->points.push_back(height);
-				}
-			}
-			else if (element_name == L"circle") {
-				float cx, cy, r;
+	std::sort(nodes.begin(), nodes.end());
+	nodes.erase(std::unique(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) {
+		return a.first == b.first;
+	}), nodes.end());
+	std::sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) {
+		return a.second < b.second;
+	});
 
-				if (get_size_attribute(pReader, pDeviceContext, L"cx", cx) &&
-					get_size_attribute(pReader, pDeviceContext, L"cy", cy) &&
-					get_size_attribute(pReader, pDeviceContext, L"r", r)) {
-					
-					auto circle_element = std::make_shared<SVGCircleElement>();
+	found.clear();
 
-					circle_element->points.push_back(cx);
-					circle_element->points.push_back(cy);
-					circle_element->points.push_back(r);
+	for (const auto& node : nodes) {
+		found.push_back(node.first);
+	}
+}
 
-					new_element = circle_element;
-				}
-			}
-			else if (element_name == L"ellipse") {
-				float cx, cy, rx, ry;
-
-				if (get_size_attribute(pReader, pDeviceContext, L"cx", cx) &&
-					get_size_attribute(pReader, pDeviceContext, L"cy", cy) &&
-					get_size_attribute(pReader, pDeviceContext, L"rx", rx) &&
-					get_size_attribute(pReader, pDeviceContext, L"ry", ry)) {
-					
-					auto ellipse_element = std::make_shared<SVGEllipseElement>();
-
-					ellipse_element->points.push_back(cx);
-					ellipse_element->points.push_back(cy);
-					ellipse_element->points.push_back(rx);
-					ellipse_element->points.push_back(ry);
-
-					new_element = ellipse_element;
-				}
-			}
-			else if (element_name == L"path") {
-				if (get_attribute(pReader, L"d", attr_value)) {
-					auto path_element = std::make_shared<SVGPathElement>();
+void SVGUtil::apply_changes() {
+	if (document.changes.empty()) {
+		return;
+	}
 
-					path_element->buildPath(pD2DFactory, attr_value);
-					new_element = path_element;
-				}
-			} else if (element_name == L"group" || element_name == L"g") {
-				new_element = std::make_shared<SVGGElement>();
-			} else if (element_name == L"line") {
-				float x1, y1, x2, y2;
-
-				if (get_size_attribute(pReader, pDeviceContext, L"x1", x1) &&
-					get_size_attribute(pReader, pDeviceContext, L"y1", y1) &&
-					get_size_attribute(pReader, pDeviceContext, L"x2", x2) &&
-					get_size_attribute(pReader, pDeviceContext, L"y2", y2)) {
-					
-					auto line_element = std::make_shared<SVGLineElement>();
-
-					line_element->points.push_back(x1);
-					line_element->points.push_back(y1);
-					line_element->points.push_back(x2);
-					line_element->points.push_back(y2);
-
-					new_element = line_element;
-				}
-			}
-			else if (element_name == L"text") {
-				auto text_element = std::make_shared<SVGTextElement>();
-				float x = 0, y = 0;
+	//Old bounds of what changed. A container's style change is also
+	//recorded for every element below it whose style changed.
+	std::vector<std::pair<bool, SVGRect>> old_bounds(document.changes.size());
+	bool recompile = false;
+	bool path_changed = false;
 
-				get_size_attribute(pReader, pDeviceContext, L"x", x);
-				get_size_attribute(pReader, pDeviceContext, L"y", y);
+	for (size_t i = 0; i < document.changes.size(); ++i) {
+		const SVGNodeChange& change = document.changes[i];
 
-				text_element->points.push_back(x);
-				text_element->points.push_back(y);
+		if (change.change != SVGChange::Style || draws_itself(document.nodes[change.node].tag)) {
+			old_bounds[i].first = display_list.node_bounds(document, change.node, old_bounds[i].second);
+		}
+	}
 
-				text_element->pDWriteFactory = pDWriteFactory;
+	for (const SVGNodeChange& change : document.changes) {
+		const SVGNode& node = document.nodes[change.node];
 
-				new_element = text_element;
-			}
-			else if (element_name == L"defs") {
-				new_element = std::make_shared<SVGDefsElement>();
-			}
-			else if (element_name == L"use") {
-				if (get_href_id(pReader, attr_value)) {
-					auto it = defs_map.find(std::wstring(attr_value));
-
-					if (it != defs_map.end()) {
-						//TBD: Clone the referred element
-						new_element = it->second;
-					}
-				}
-			}
-			else {
-				//Unknown element
-				new_element = std::make_shared<SVGGraphicsElement>();
-			}
+		if (change.change == SVGChange::Structure || (change.change == SVGChange::Geometry && !draws_itself(node.tag))) {
+			recompile = true;
+		}
 
-			if (new_element) {
-				new_element->tag_name = element_name;
+		if (recompile || !draws_itself(node.tag)) {
+			continue;
+		}
 
-				if (get_attribute(pReader, L"id", attr_value)) {
-					std::wstring id(attr_value);
+		if (!display_list.update_node(document, change.node)) {
+			recompile = true;
+		}
 
-					id_map[id] = new_element;
+		path_changed = path_changed || (node.tag == SVGTag::Path && change.change == SVGChange::Geometry);
+	}
 
-					if (parent_element && parent_element->tag_name == L"defs") {
-						defs_map[id] = new_element;
-					}
-				}
+	//Inserted nodes get empty resources first
+	node_resources.resize(document.nodes.size());
+	text_resources.resize(document.texts.size());
+	path_geometries.resize(document.paths.size());
 
-				//Transform is not inherited
-				if (get_attribute(pReader, L"transform", attr_value)) {
-					D2D1_MATRIX_3X2_F trans = D2D1::Matrix3x2F::Identity();
+	if (recompile) {
+		display_list.compile(document);
+		spatial_index.build(display_list);
+		batch_geometries.assign(display_list.batches.size(), nullptr);
+		software_renderer.stroke_cache.clear();
+	}
+	else {
+		std::vector<uint32_t> kept;
 
-					//If the element already has a transform (like inner <svg>), combine them
-					if (new_element->combined_transform)
-					{
-						trans = new_element->combined_transform.value();
-					}
+		if (display_list.refresh(document, kept)) {
+			std::vector<CComPtr<ID2D1PathGeometry>> geometries(kept.size());
 
-					if (build_transform_matrix(attr_value, trans)) {
-						new_element->combined_transform = trans;
-					}
+			for (size_t b = 0; b < kept.size(); ++b) {
+				if (kept[b] != 0xFFFFFFFFu) {
+					geometries[b] = batch_geometries[kept[b]];
 				}
+			}
 
-				collect_styles(pReader, new_element);
+			batch_geometries.swap(geometries);
+			//Outlines of merged entries are cached by their first entry and count
+			path_changed = true;
+		}
 
-				new_element->configure_presentation_style(parent_stack, pDeviceContext, pD2DFactory);
+		if (path_changed) {
+			//And outlines of paths by their index
+			software_renderer.stroke_cache.clear();
+		}
+	}
 
-				if (parent_element) {
-					//Add the new element to its parent
-					OutputDebugStringW(L"Parent::Child: ");
-					OutputDebugStringW(parent_element->tag_name.c_str());
-					OutputDebugStringW(L"::");
-					OutputDebugStringW(element_name.data());
-					OutputDebugStringW(L"\n");
+	for (size_t i = 0; i < document.changes.size(); ++i) {
+		const SVGNodeChange& change = document.changes[i];
+		const SVGNode& node = document.nodes[change.node];
+		SVGRect bounds;
+		bool found = false;
 
-					parent_element->children.push_back(new_element);
-				}
-			}
+		if (draws_itself(node.tag)) {
+			node_resources[change.node] = SVGNodeResources();
+			create_node_resources(change.node);
 
-			//Do not add self closing elements like <circle .../> to the parent stack
-			if (!is_self_closing)
-			{
-				//Push the new element onto the stack
-				//This may be null if the element is not supported
-				parent_stack.push_back(new_element);
+			if (node.tag == SVGTag::Path) {
+				//The fill rule is part of the geometry
+				path_geometries[node.payload].Release();
 			}
-		}
-		else if (nodeType == XmlNodeType_Text) {
-			if (parent_stack.empty()) {
-				return false;
+			else if (node.tag == SVGTag::Text) {
+				text_resources[node.payload].layout = nullptr;
 			}
+		}
 
-			std::shared_ptr<SVGGraphicsElement> parent_element = parent_stack.back();
+		if (change.change != SVGChange::Style || draws_itself(node.tag)) {
+			found = display_list.node_bounds(document, change.node, bounds);
+		}
 
-			//If the parent is a text then cast it to SVGTextElement
-			if (!parent_element || parent_element->tag_name != L"text") {
-				continue; //Text nodes are only valid inside <text> elements
+		if (!recompile && found && old_bounds[i].first && !same_rect(bounds, old_bounds[i].second)) {
+			//The entries were updated in place
+			for (uint32_t k = display_list.node_offsets[change.node]; k < display_list.node_offsets[change.node + 1]; ++k) {
+				spatial_index.update(display_list, display_list.node_items[k]);
 			}
+		}
 
-			auto text_element = std::dynamic_pointer_cast<SVGTextElement>(parent_element);
-
-			if (!text_element) {
-				return false;
-			}
+		//Both where it was and where it is now have to be painted again
+		if (old_bounds[i].first) {
+			add_dirty(old_bounds[i].second);
+		}
+		if (found) {
+			add_dirty(bounds);
+		}
+	}
 
-			const wchar_t* pwszValue = NULL;
-			UINT32 len;
+	document.changes.clear();
+}
 
-			hr = pReader->GetValue(&pwszValue, &len);
+void SVGUtil::add_dirty(const SVGRect& rect) {
+	SVGRect joined = rect;
 
-			if (!SUCCEEDED(hr) || pwszValue == nullptr) {
-				return false;
-			}
+	//Cached tiles keep the pixels around it
+	tile_cache.invalidate(rect);
 
-			//Collapse white space if needed.
-			std::wstring style_value;
+	//Joining may make the rect meet one that it didn't before
+	for (size_t i = 0; i < dirty_rects.size();) {
+		if (rects_intersect(dirty_rects[i], joined)) {
+			joined = union_rect(joined, dirty_rects[i]);
+			dirty_rects[i] = dirty_rects.back();
+			dirty_rects.pop_back();
+			i = 0;
+		}
+		else {
+			++i;
+		}
+	}
 
-			text_element->get_style_computed(parent_stack, L"white-space", style_value, L"normal");
+	if (dirty_rects.size() < max_dirty_rects) {
+		dirty_rects.push_back(joined);
+		return;
+	}
 
-			if (style_value == L"normal") {
-				std::wstring_view source(pwszValue, len);
+	size_t best = 0;
+	float best_growth = 0.0f;
 
-				collapse_whitespace(source, text_element->text_content);
-			}
-			else {
-				text_element->text_content.assign(pwszValue, len);
-			}
+	for (size_t i = 0; i < dirty_rects.size(); ++i) {
+		float growth = rect_area(union_rect(dirty_rects[i], joined)) - rect_area(dirty_rects[i]);
 
-			hr = pDWriteFactory->CreateTextLayout(
-				text_element->text_content.c_str(),           // The string to be laid out
-				text_element->text_content.size(),     // The length of the string
-				text_element->text_format,    // The initial format (font, size, etc.)
-				pDeviceContext->GetSize().width,       // Maximum width of the layout box
-				pDeviceContext->GetSize().height,      // Maximum height of the layout box
-				&text_element->text_layout    // Output: the resulting IDWriteTextLayout
-			);
+		if (i == 0 || growth < best_growth) {
+			best = i;
+			best_growth = growth;
+		}
+	}
 
-			if (!SUCCEEDED(hr)) {
-				return false;
-			}
+	dirty_rects[best] = union_rect(dirty_rects[best], joined);
+}
 
-			// To prevent wrapping and force it to stay on one line:
-			text_element->text_layout->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP);
+void SVGUtil::redraw()
+{
+	if (document.changes.empty() && dirty_rects.empty()) {
+		InvalidateRect(wnd, NULL, FALSE);
+		return;
+	}
 
-			//Get the font baseline
-			UINT32 lineCount = 0;
+	apply_changes();
 
-			//First get the line count
-			hr = text_element->text_layout->GetLineMetrics(nullptr, 0, &lineCount);
+	float dpi_x, dpi_y;
+	SVGMatrix to_window = view_transform();
 
-			if (!SUCCEEDED(hr) && hr != HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER)) {
-				return false;
-			}
+	pDeviceContext->GetDpi(&dpi_x, &dpi_y);
 
-			if (lineCount == 0) {
-				//Nothing there
-				return false;
-			}
+	//Windows joins the rects into the update region of the next WM_PAINT
+	for (const SVGRect& dirty : dirty_rects) {
+		SVGRect r = svg_transform_rect(to_window, SVGTransformClass::ScaleTranslate, dirty);
+		RECT rc;
 
-			//Allocate memory for metrics
-			std::vector<DWRITE_LINE_METRICS> lineMetrics(lineCount);
+		//Antialiasing reaches into the pixels the bounds end in, one more covers rounding
+		rc.left = static_cast<LONG>(std::floor(r.left * dpi_x / 96.0f)) - 1;
+		rc.top = static_cast<LONG>(std::floor(r.top * dpi_y / 96.0f)) - 1;
+		rc.right = static_cast<LONG>(std::ceil(r.right * dpi_x / 96.0f)) + 1;
+		rc.bottom = static_cast<LONG>(std::ceil(r.bottom * dpi_y / 96.0f)) + 1;
 
-			hr = text_element->text_layout->GetLineMetrics(lineMetrics.data(), lineMetrics.size(), &lineCount);
+		InvalidateRect(wnd, &rc, FALSE);
+	}
 
-			if (!SUCCEEDED(hr)) {
-				return false;
-			}
+	dirty_rects.clear();
+}
 
-			text_element->baseline = lineMetrics[0].baseline;
-		}
-		else if (nodeType == XmlNodeType_EndElement) {
-			std::wstring_view element_name;
+SVGMatrix SVGUtil::view_transform()
+{
+	float dpi_x, dpi_y;
+	float scale = SVGTileCache::level_scale(zoom_level);
 
-			if (!get_element_name(pReader, element_name)) {
-				return false;
-			}
+	pDeviceContext->GetDpi(&dpi_x, &dpi_y);
 
-			OutputDebugStringW(L"End Element: ");
-			OutputDebugStringW(element_name.data());
-			OutputDebugStringW(L"\n");
+	//The pan is in pixels of the zoomed document
+	return svg_multiply(SVGMatrix::scale(scale, scale), SVGMatrix::translation(-pan_x * 96.0f / dpi_x, -pan_y * 96.0f / dpi_y));
+}
 
-			if (!parent_stack.empty()) {
-				parent_stack.pop_back();
-			}
-		}
-	}
+void SVGUtil::pan(int dx, int dy)
+{
+	pan_x -= dx;
+	pan_y -= dy;
 
-	return true;
+	InvalidateRect(wnd, NULL, FALSE);
 }
 
-void SVGUtil::redraw()
+void SVGUtil::zoom(int steps, int x, int y)
 {
+	//Up to 64 times in or out
+	const int max_level = 6 * SVGTileCache::levels_per_octave;
+	int level = std::max(-max_level, std::min(max_level, zoom_level + steps));
+
+	if (level == zoom_level) {
+		return;
+	}
+
+	float factor = SVGTileCache::level_scale(level) / SVGTileCache::level_scale(zoom_level);
+
+	//The pixel of the document under x, y scales to a pixel that is there too
+	pan_x = static_cast<int>(std::lround((pan_x + x) * factor)) - x;
+	pan_y = static_cast<int>(std::lround((pan_y + y) * factor)) - y;
+	zoom_level = level;
+	zooming = true;
+
 	InvalidateRect(wnd, NULL, FALSE);
-}
\ No newline at end of file
+}
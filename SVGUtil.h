@@ -5,69 +5,49 @@
 #include <atlbase.h>
 #include <vector>
 #include <string>
-#include <memory>
-#include <optional>
-#include <map>
+#include <string_view>
 #include <dwrite.h>
-
-struct SVGGraphicsElement {
-	std::wstring tag_name;
-	float stroke_width = 1.0f;
-	CComPtr<ID2D1SolidColorBrush> fill_brush;
-	CComPtr<ID2D1SolidColorBrush> stroke_brush;
-	CComPtr<ID2D1StrokeStyle> stroke_style;
-	std::vector<std::shared_ptr<SVGGraphicsElement>> children;
-	std::optional<D2D1_MATRIX_3X2_F> combined_transform;
-	std::vector<float> points;
-	std::map<std::wstring, std::wstring> styles;
-
-	virtual void render_tree(ID2D1DeviceContext* pContext);
-	virtual void render(ID2D1DeviceContext* pContext) {};
-	virtual void configure_presentation_style(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, ID2D1DeviceContext* pDeviceContext, ID2D1Factory* pD2DFactory);
-	bool get_style_computed(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, const std::wstring& style_name, std::wstring& style_value);
-	void get_style_computed(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, const std::wstring& style_name, std::wstring& style_value, const std::wstring& default_value);
-};
-
-struct SVGDefsElement : public SVGGraphicsElement {
-	void render_tree(ID2D1DeviceContext* pContext) override;
-};
-
-struct SVGGElement : public SVGGraphicsElement {
-	void configure_presentation_style(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, ID2D1DeviceContext* pDeviceContext, ID2D1Factory* pD2DFactory) override;
-};
-
-struct SVGRectElement : public SVGGraphicsElement {
-	void render(ID2D1DeviceContext* pContext) override;
-};
-
-struct SVGCircleElement : public SVGGraphicsElement {
-	void render(ID2D1DeviceContext* pContext) override;
+#include "SVGDisplayList.h"
+#include "SVGDocument.h"
+#include "SVGRaster.h"
+#include "SVGResourceCache.h"
+#include "SVGSoftwareRenderer.h"
+#include "SVGSpatialIndex.h"
+#include "SVGThreadPool.h"
+#include "SVGTileCache.h"
+
+//Direct2D resources of one node, parallel to SVGDocument::nodes.
+//Owned by SVGUtil::resource_cache and shared with every node that paints the same way.
+struct SVGNodeResources {
+	ID2D1SolidColorBrush* fill_brush = nullptr;
+	ID2D1SolidColorBrush* stroke_brush = nullptr;
+	ID2D1StrokeStyle* stroke_style = nullptr;
 };
 
-struct SVGEllipseElement : public SVGGraphicsElement {
-	void render(ID2D1DeviceContext* pContext) override;
+//DirectWrite resources of one text, parallel to SVGDocument::texts.
+//Both are owned by SVGUtil::resource_cache. The layout is null until the text is first drawn.
+struct SVGTextResources {
+	IDWriteTextFormat* text_format = nullptr;
+	SVGTextLayout* layout = nullptr;
 };
 
-struct SVGLineElement : public SVGGraphicsElement {
-	void render(ID2D1DeviceContext* pContext) override;
-};
-
-struct SVGPathElement : public SVGGraphicsElement {
-	CComPtr<ID2D1PathGeometry> path_geometry;
-
-	void buildPath(ID2D1Factory* pD2DFactory, const std::wstring_view& pathData);
-	void render(ID2D1DeviceContext* pContext) override;
-};
-
-struct SVGTextElement : public SVGGraphicsElement {
-	std::wstring text_content;
-	CComPtr<IDWriteFactory> pDWriteFactory;
-	CComPtr<IDWriteTextFormat> text_format;
-	CComPtr<IDWriteTextLayout> text_layout;
-	float baseline = 0.0f;
-
-	void configure_presentation_style(const std::vector<std::shared_ptr<SVGGraphicsElement>>& parent_stack, ID2D1DeviceContext* pDeviceContext, ID2D1Factory* pD2DFactory) override;
-	void render(ID2D1DeviceContext* pContext) override;
+//Counters of the last render() call
+struct SVGRenderStats {
+	size_t items = 0;
+	size_t draw_calls = 0;
+	size_t transform_changes = 0;
+	//Batches skipped because they were out of view, added up over the updated rects
+	size_t culled = 0;
+	double milliseconds = 0.0;
+	SVGRenderQuality quality = SVGRenderQuality::Standard;
+	//Share of the window that was painted, 1 for a full repaint
+	float repainted = 1.0f;
+	//Tiles of the software renderer's cache that were found, rasterized or shown
+	//scaled from another zoom level, and the memory of all of them after the frame
+	size_t tile_hits = 0;
+	size_t tile_misses = 0;
+	size_t tile_placeholders = 0;
+	size_t tile_memory = 0;
 };
 
 struct SVGUtil
@@ -80,15 +60,75 @@ struct SVGUtil
 	CComPtr<ID2D1SolidColorBrush> defaultFillBrush;
 	CComPtr<ID2D1SolidColorBrush> defaultStrokeBrush;
 	CComPtr<IDWriteTextFormat> defaultTextFormat;
-	std::shared_ptr<SVGGraphicsElement> root_element;
-	std::map<std::wstring, std::shared_ptr<SVGGraphicsElement>> id_map;
-	std::map<std::wstring, std::shared_ptr<SVGGraphicsElement>> defs_map;
-
+	SVGDocument document;
+	//Compiled from document after parsing, replayed by render()
+	SVGDisplayList display_list;
+	SVGResourceCache resource_cache;
+	//Bounds of every display list entry, built after parsing
+	SVGSpatialIndex spatial_index;
+	std::vector<SVGNodeResources> node_resources;
+	std::vector<SVGTextResources> text_resources;
+	//Parallel to SVGDocument::paths. Built on first render.
+	std::vector<CComPtr<ID2D1PathGeometry>> path_geometries;
+	//Parallel to SVGDisplayList::batches. Built on first render.
+	std::vector<CComPtr<ID2D1PathGeometry>> batch_geometries;
+	//Batches in the window, found again by each render()
+	std::vector<uint32_t> visible_batches;
+	std::vector<uint32_t> visible_items;
+	//Area in world space that changes to the document have made out of date, repainted by redraw().
+	//Rects that overlap are joined, and past max_dirty_rects each new one joins the rect it grows least.
+	std::vector<SVGRect> dirty_rects;
+	size_t max_dirty_rects = 32;
+	SVGRenderStats render_stats;
+	SVGThreadPool thread_pool;
+	//Parse path data on the thread pool after the element tree is built
+	bool parallel_path_parsing = true;
+	//Rasterize on the CPU instead of drawing with Direct2D
+	bool software_rendering = false;
+	SVGSoftwareRenderer software_renderer;
+	SVGBitmap software_target;
+	CComPtr<ID2D1Bitmap> software_bitmap;
+	//Software rendering copies the tiles it rasterized before instead of drawing each frame again
+	bool tile_caching = true;
+	SVGTileCache tile_cache;
+	//Zoom level as SVGTileCache counts them, and the pixel of that level at the top left of the window
+	int zoom_level = 0;
+	int pan_x = 0, pan_y = 0;
+	//Set by zoom() until the next frame, which shows tiles of other levels scaled where the new one has none
+	bool zooming = false;
 
 	bool init(HWND wnd);
 	void resize();
-	void render();
+	//The quality is only for this call. Direct2D has no supersampling, High draws like Standard there.
+	void render(SVGRenderQuality quality = SVGRenderQuality::Standard);
+	//Only paints the pixels in the update region, one rect of it at a time, from the entries
+	//that meet the rect. The rest of the window keeps the last frame.
+	void render(HRGN update, SVGRenderQuality quality = SVGRenderQuality::Standard);
+	void render_rects(const std::vector<RECT>& rects, SVGRenderQuality quality);
+	void render_software(const std::vector<RECT>& rects, SVGRenderQuality quality);
+	//Repaints what changed in document since the last call, or the whole window when nothing did
 	void redraw();
+	//Maps world space to the window in DIPs, by zoom_level and the pan
+	SVGMatrix view_transform();
+	//Moves the document dx, dy pixels across the window
+	void pan(int dx, int dy);
+	//Zooms in by steps levels, out when negative, keeping the point x, y of the window in pixels in place
+	void zoom(int steps, int x, int y);
 	bool parse(const wchar_t* fileName);
+	bool create_resources();
+	void create_node_resources(SVGNodeId id);
+	//Brings the display list, the spatial index and the resources up to date with the
+	//changes made to document by its mutation methods, and adds to the dirty area.
+	//Elements that draw are updated in place. Anything else that changed the tree, or
+	//a transform on a container, compiles the display list again.
+	void apply_changes();
+	void add_dirty(const SVGRect& rect);
+	//Topmost element painted at a point of the window in DIPs, or svg_no_node.
+	//What a <use> draws is reported as the element it references.
+	SVGNodeId hit_test(float x, float y);
+	//Elements whose bounds meet a rect of the window in DIPs, each once, in paint order
+	void query(const SVGRect& rect, std::vector<SVGNodeId>& found);
+	void draw_item(const SVGDisplayItem& item);
+	void draw_batch(size_t index);
 };
 
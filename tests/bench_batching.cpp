@@ -0,0 +1,158 @@
+//Draw calls and frame time of a dashboard of thousands of rects, circles and
+//lines in a few paints, with the display list compiled without batching and with
+//it. Batched frames must give the pixels of unbatched ones up to antialiasing:
+//where shapes of one paint overlap or touch, a batch covers the seam once where
+//single draws blend twice.
+//
+//Batching is for the Direct2D backend, where each draw call has a fixed cost. The
+//software renderer spends its time on edges and pixels, which batching doesn't
+//reduce, so its frame time should stay about the same.
+//
+//  bench_batching [panels]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "SVGSoftwareRenderer.h"
+#include "bench_util.h"
+
+//A grid of chart panels, each with a frame, grid lines, bars and a scatter of
+//points, over 1600x1000. Every panel is a translated group.
+static std::string dashboard(int panels) {
+	static const char* bar_fills[] = { "#4e79a7", "#f28e2b", "#59a14f" };
+	static const char* point_fills[] = { "#e15759", "#76b7b2" };
+	int columns = 1;
+
+	while (columns * columns < panels) {
+		++columns;
+	}
+
+	int rows = (panels + columns - 1) / columns;
+	float panel_width = 1600.0f / columns, panel_height = 1000.0f / rows;
+	std::string source = "<svg xmlns='http://www.w3.org/2000/svg' width='1600' height='1000'>";
+	unsigned int seed = 7;
+	char buffer[256];
+
+	auto random = [&](int n) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % n);
+	};
+
+	for (int p = 0; p < panels; ++p) {
+		float w = panel_width - 10, h = panel_height - 10;
+
+		snprintf(buffer, sizeof(buffer), "<g transform='translate(%g %g)'>", (p % columns) * panel_width + 5, (p / columns) * panel_height + 5);
+		source += buffer;
+		snprintf(buffer, sizeof(buffer), "<rect x='0' y='0' width='%g' height='%g' fill='white' stroke='#bbbbbb'/>", w, h);
+		source += buffer;
+
+		for (int i = 1; i < 5; ++i) {
+			snprintf(buffer, sizeof(buffer), "<line x1='0' y1='%g' x2='%g' y2='%g' stroke='#dddddd' stroke-width='0.5'/>", h * i / 5, w, h * i / 5);
+			source += buffer;
+		}
+
+		//Stacked bars, one series after the other as charting code writes them
+		int bars = 24;
+		float step = w / bars;
+		float tops[24];
+
+		std::fill(tops, tops + bars, h);
+
+		for (const char* fill : bar_fills) {
+			for (int b = 0; b < bars; ++b) {
+				float size = 2.0f + random(static_cast<int>(h / 4));
+
+				tops[b] -= size;
+				snprintf(buffer, sizeof(buffer), "<rect x='%g' y='%g' width='%g' height='%g' fill='%s'/>", b * step + 1, tops[b], step - 2, size, fill);
+				source += buffer;
+			}
+		}
+
+		for (const char* fill : point_fills) {
+			for (int i = 0; i < 15; ++i) {
+				snprintf(buffer, sizeof(buffer), "<circle cx='%d' cy='%d' r='2.5' fill='%s'/>", random(static_cast<int>(w)), random(static_cast<int>(h)), fill);
+				source += buffer;
+			}
+		}
+
+		source += "</g>";
+	}
+
+	return source + "</svg>";
+}
+
+int main(int argc, char** argv) {
+	int panels = argc > 1 ? std::atoi(argv[1]) : 64;
+	auto bench = load_document("dashboard", dashboard(panels), 1600, 1000);
+	SVGMatrix device = SVGMatrix::identity();
+	SVGBitmap bitmaps[2];
+	double ms[2] = {};
+	const int runs = 5;
+
+	if (!bench) {
+		printf("dashboard: does not parse\n");
+		return 1;
+	}
+
+	printf("%d panels, %zu entries, 1600x1000, best of %d\n", panels, bench->list.size(), runs);
+
+	for (int batching = 0; batching < 2; ++batching) {
+		SVGSoftwareRenderer renderer;
+		SVGBitmap& bitmap = bitmaps[batching];
+
+		bench->list.batching = batching != 0;
+		bench->list.compile(bench->document);
+		bitmap.resize(1600, 1000);
+
+		ms[batching] = best_of(runs, [&]() {
+			bitmap.clear(0xFFFFFFFF);
+			renderer.render(bench->document, bench->list, bitmap, device);
+		});
+
+		printf("  batching %-5s %6zu draw calls  %7.2f ms per frame", batching ? "true" : "false", bench->list.draw_calls(), ms[batching]);
+
+		if (batching) {
+			printf("  %.2fx", ms[0] / ms[1]);
+		}
+
+		printf("\n");
+	}
+
+	//Channels that differ by more than rounding, and the ones of those inside a
+	//shape, away from any edge of the unbatched frame, where nothing may differ
+	const SVGBitmap& single = bitmaps[0];
+	int largest = 0;
+	size_t differ = 0, inside = 0;
+
+	for (int y = 0; y < single.height; ++y) {
+		for (int x = 0; x < single.width * 4; ++x) {
+			int d = std::abs(single.row(y)[x] - bitmaps[1].row(y)[x]);
+
+			if (d <= 1) {
+				continue;
+			}
+
+			bool edge = false;
+
+			for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, single.height - 1); ++ny) {
+				for (int nx = std::max(x - 4, x % 4); nx <= std::min(x + 4, single.width * 4 - 1); nx += 4) {
+					edge = edge || single.row(ny)[nx] != single.row(y)[x];
+				}
+			}
+
+			largest = std::max(largest, d);
+			++differ;
+			inside += !edge;
+		}
+	}
+
+	printf("  %zu channels differ by more than 1, by up to %d, %zu of them inside shapes\n", differ, largest, inside);
+
+	if (inside) {
+		printf("MISMATCH: batched frames differ from unbatched ones away from edges\n");
+		return 1;
+	}
+
+	return 0;
+}
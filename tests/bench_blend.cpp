@@ -0,0 +1,81 @@
+//Throughput of each blend kernel the CPU supports, in GB/s of destination pixels,
+//on spans from 64 pixels to 16 MB. The source and coverage have partial alpha
+//everywhere, so no kernel can skip a pixel.
+//
+//  bench_blend
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "SVGBlend.h"
+#include "SVGCpu.h"
+
+static const char* kernel_names[] = { "scalar", "sse2", "avx2", "avx512" };
+
+static double now_seconds() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main() {
+	const int sizes[] = { 64, 1024, 16384, 4 << 20 };
+	const uint8_t color[4] = { 60, 40, 20, 128 };
+	std::mt19937 rng(1);
+
+	for (int size : sizes) {
+		std::vector<uint8_t> dst(static_cast<size_t>(size) * 4), src(static_cast<size_t>(size) * 4), coverage(size);
+
+		for (int i = 0; i < size; ++i) {
+			int alpha = 1 + static_cast<int>(rng() % 254);
+
+			for (int k = 0; k < 3; ++k) {
+				dst[i * 4 + k] = static_cast<uint8_t>(rng() % 256);
+				src[i * 4 + k] = static_cast<uint8_t>(rng() % (alpha + 1));
+			}
+
+			dst[i * 4 + 3] = 255;
+			src[i * 4 + 3] = static_cast<uint8_t>(alpha);
+			coverage[i] = static_cast<uint8_t>(1 + rng() % 254);
+		}
+
+		for (int operation = 0; operation < 3; ++operation) {
+			printf("%-5s %8d px:", operation == 0 ? "over" : operation == 1 ? "solid" : "mask", size);
+
+			for (int k = 0; k < 4; ++k) {
+				if (svg_supported_kernel(static_cast<SVGKernel>(k)) != static_cast<SVGKernel>(k)) {
+					continue;
+				}
+
+				const SVGBlendKernels& kernels = svg_blend_kernels(static_cast<SVGKernel>(k));
+				double start = now_seconds(), elapsed = 0.0;
+				double bytes = 0.0;
+
+				//Repeat for at least 0.3 s
+				do {
+					for (int r = 0; r < 16; ++r) {
+						if (operation == 0) {
+							kernels.over(dst.data(), src.data(), size);
+						}
+						else if (operation == 1) {
+							kernels.solid(dst.data(), size, color);
+						}
+						else {
+							kernels.mask(dst.data(), coverage.data(), size, color);
+						}
+
+						bytes += size * 4.0;
+					}
+
+					elapsed = now_seconds() - start;
+				} while (elapsed < 0.3);
+
+				printf("  %s %6.2f", kernel_names[k], bytes / elapsed / 1e9);
+			}
+
+			printf("  GB/s\n");
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,219 @@
+//Time per color of svg_parse_color against the std::map and std::stoul parsing
+//that get_rgba did before it, on names and hex values both accept. Then the time
+//per color of svg_parse_color on the formats only it reads: #rgb, #rgba, rgb(),
+//rgba(), hsl(), hsla() and the names get_rgba did not have.
+//
+//  bench_color [colors]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SVGColor.h"
+#include "bench_util.h"
+
+//get_rgba as it was, with the D2D1::ColorF values written out
+static bool get_rgba(std::string_view source, float& r, float& g, float& b, float& a) {
+	static std::map<std::string, uint32_t> namedColors = {
+		{"black", 0x000000},
+		{"white", 0xFFFFFF},
+		{"red", 0xFF0000},
+		{"green", 0x008000},
+		{"blue", 0x0000FF},
+		{"orange", 0xFFA500},
+		{"pink", 0xFFC0CB},
+		{"yellow", 0xFFFF00},
+		{"brown", 0xA52A2A},
+		{"grey", 0x808080},
+		{"gray", 0x808080},
+		{"teal", 0x008080},
+	};
+
+	if (source.empty()) {
+		return false;
+	}
+
+	while (!source.empty() && source[0] == ' ') {
+		source.remove_prefix(1);
+	}
+
+	if (source == "none") {
+		return false;
+	}
+
+	if (source[0] != '#') {
+		auto iter = namedColors.find(std::string(source));
+
+		if (iter != namedColors.end()) {
+			uint32_t color = iter->second;
+
+			r = ((color >> 16) & 0xFF) / 255.0f;
+			g = ((color >> 8) & 0xFF) / 255.0f;
+			b = (color & 0xFF) / 255.0f;
+			a = 1.0f;
+
+			return true;
+		}
+	}
+
+	if (source.length() < 7 || source[0] != '#') {
+		return false;
+	}
+
+	std::string rStr(source.substr(1, 2));
+	std::string gStr(source.substr(3, 2));
+	std::string bStr(source.substr(5, 2));
+
+	r = static_cast<float>(std::stoul(rStr, nullptr, 16)) / 255.0f;
+	g = static_cast<float>(std::stoul(gStr, nullptr, 16)) / 255.0f;
+	b = static_cast<float>(std::stoul(bStr, nullptr, 16)) / 255.0f;
+	a = 1.0f;
+
+	if (source.length() == 9) {
+		std::string aStr(source.substr(7, 2));
+
+		a = static_cast<float>(std::stoul(aStr, nullptr, 16)) / 255.0f;
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv) {
+	int count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	const char* names[] = { "black", "white", "red", "green", "blue", "orange", "pink", "yellow", "brown", "grey", "gray", "teal" };
+	std::mt19937 rng(3);
+	std::vector<std::string> colors;
+	char buffer[16];
+
+	//Half names, half #rrggbb and #rrggbbaa, as fill and stroke values tend to be
+	for (int i = 0; i < count; ++i) {
+		switch (rng() % 4) {
+		case 0:
+		case 1:
+			colors.push_back(names[rng() % 12]);
+
+			break;
+		case 2:
+			snprintf(buffer, sizeof(buffer), "#%06x", static_cast<unsigned>(rng() & 0xFFFFFF));
+			colors.push_back(buffer);
+
+			break;
+		default:
+			snprintf(buffer, sizeof(buffer), "#%08x", static_cast<unsigned>(rng()));
+			colors.push_back(buffer);
+
+			break;
+		}
+	}
+
+	uint32_t old_sum = 0, new_sum = 0;
+	const int runs = 5;
+
+	double old_ms = best_of(runs, [&]() {
+		old_sum = 0;
+
+		for (const std::string& color : colors) {
+			float r, g, b, a;
+
+			if (get_rgba(color, r, g, b, a)) {
+				old_sum += static_cast<uint32_t>(r * 255.0f + 0.5f) << 24 | static_cast<uint32_t>(g * 255.0f + 0.5f) << 16 |
+					static_cast<uint32_t>(b * 255.0f + 0.5f) << 8 | static_cast<uint32_t>(a * 255.0f + 0.5f);
+			}
+		}
+	});
+	double new_ms = best_of(runs, [&]() {
+		new_sum = 0;
+
+		for (const std::string& color : colors) {
+			uint32_t rgba;
+
+			if (svg_parse_color(color, rgba) == SVGColorType::Color) {
+				new_sum += rgba;
+			}
+		}
+	});
+
+	//The formats get_rgba rejects
+	const char* extended_names[] = { "aliceblue", "cornflowerblue", "darkslategray", "lightgoldenrodyellow", "mediumseagreen",
+		"papayawhip", "olivedrab", "steelblue", "transparent", "currentColor", "WhiteSmoke", "none" };
+	std::vector<std::string> modern;
+
+	for (int i = 0; i < count; ++i) {
+		unsigned value = static_cast<unsigned>(rng());
+
+		switch (i % 6) {
+		case 0:
+			snprintf(buffer, sizeof(buffer), "#%03x", value & 0xFFF);
+			modern.push_back(buffer);
+
+			break;
+		case 1:
+			snprintf(buffer, sizeof(buffer), "#%04x", value & 0xFFFF);
+			modern.push_back(buffer);
+
+			break;
+		case 2:
+			modern.push_back("rgb(" + std::to_string(value & 0xFF) + ", " + std::to_string(value >> 8 & 0xFF) + ", " +
+				std::to_string(value >> 16 & 0xFF) + ")");
+
+			break;
+		case 3:
+			modern.push_back("rgba(" + std::to_string(value % 101) + "%, 50%, 0%, 0." + std::to_string(value >> 8 & 7) + ")");
+
+			break;
+		case 4:
+			modern.push_back("hsl(" + std::to_string(value % 360) + " " + std::to_string(value >> 9 & 63) + "% 40% / 75%)");
+
+			break;
+		default:
+			modern.push_back(extended_names[value % 12]);
+
+			break;
+		}
+	}
+
+	int old_accepted = 0, rejected = 0;
+
+	for (const std::string& color : modern) {
+		float r, g, b, a;
+		uint32_t rgba;
+
+		old_accepted += get_rgba(color, r, g, b, a);
+		rejected += svg_parse_color(color, rgba) == SVGColorType::Invalid;
+	}
+
+	uint32_t modern_sum = 0;
+	double modern_ms = best_of(runs, [&]() {
+		modern_sum = 0;
+
+		for (const std::string& color : modern) {
+			uint32_t rgba;
+
+			if (svg_parse_color(color, rgba) == SVGColorType::Color) {
+				modern_sum += rgba;
+			}
+		}
+	});
+
+	printf("%d colors, best of %d\n", count, runs);
+	printf("  map + stoul      %6.1f ns per color\n", old_ms * 1e6 / count);
+	printf("  svg_parse_color  %6.1f ns per color  %.1fx\n", new_ms * 1e6 / count, old_ms / new_ms);
+	printf("%d colors in the other formats, %d of them read by get_rgba\n", count, old_accepted);
+	printf("  svg_parse_color  %6.1f ns per color  (sum %08X)\n", modern_ms * 1e6 / count, modern_sum);
+
+	if (old_sum != new_sum) {
+		printf("MISMATCH: the two parsers gave different colors\n");
+		return 1;
+	}
+
+	if (rejected) {
+		printf("MISMATCH: svg_parse_color rejected %d colors\n", rejected);
+		return 1;
+	}
+
+	return 0;
+}
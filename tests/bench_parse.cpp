@@ -0,0 +1,50 @@
+//Parse time of a document of many paths, serially and on pools of 2, 4 and 8
+//threads and one per core.
+//
+//  bench_parse [paths]
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "SVGDocument.h"
+#include "SVGThreadPool.h"
+#include "bench_util.h"
+
+int main(int argc, char** argv) {
+	int count = argc > 1 ? std::atoi(argv[1]) : 200000;
+	std::string source = path_document(count);
+	std::vector<std::unique_ptr<SVGThreadPool>> pools;
+	SVGLengthContext context;
+	const int runs = 5;
+
+	context.viewport_width = 1000.0f;
+	context.viewport_height = 1000.0f;
+	pools.push_back(nullptr);
+	pools.push_back(std::make_unique<SVGThreadPool>(1));
+	pools.push_back(std::make_unique<SVGThreadPool>(3));
+	pools.push_back(std::make_unique<SVGThreadPool>(7));
+	pools.push_back(std::make_unique<SVGThreadPool>(0));
+
+	printf("%d paths, %.1f MB, best of %d\n", count, source.size() / 1e6, runs);
+
+	double serial = 0.0;
+
+	for (const auto& pool : pools) {
+		double ms = best_of(runs, [&]() {
+			SVGDocument document;
+
+			document.parse(source, context, pool.get());
+		});
+
+		if (!pool) {
+			serial = ms;
+			printf("  serial     %8.1f ms\n", ms);
+		}
+		else {
+			printf("  %2u threads %8.1f ms  %.2fx\n", pool->concurrency(), ms, serial / ms);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,178 @@
+//Throughput of path data parsing: SVGPathLexer and SVGPathData::parse against
+//the stream based parsing that buildPath did before them.
+//
+//  bench_path [segments]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include "SVGPathData.h"
+#include "SVGPathLexer.h"
+#include "bench_util.h"
+
+//Lines, cubics, quadratics and H/V, relative and absolute, with both separators
+static std::string make_path(int segments) {
+	std::mt19937 rng(7);
+	std::string d = "M0,0";
+	char buffer[160];
+
+	auto coord = [&]() {
+		return static_cast<float>(static_cast<int>(rng() % 200000) - 100000) / 7.0f;
+	};
+
+	for (int i = 0; i < segments; ++i) {
+		switch (rng() % 5) {
+		case 0:
+			snprintf(buffer, sizeof(buffer), " L%.3f,%.3f", coord(), coord());
+
+			break;
+		case 1:
+			snprintf(buffer, sizeof(buffer), " c%.3f %.3f %.3f %.3f %.3f %.3f", coord(), coord(), coord(), coord(), coord(), coord());
+
+			break;
+		case 2:
+			snprintf(buffer, sizeof(buffer), " Q%.3f,%.3f %.3f,%.3f", coord(), coord(), coord(), coord());
+
+			break;
+		case 3:
+			snprintf(buffer, sizeof(buffer), " h%.3f", coord());
+
+			break;
+		default:
+			snprintf(buffer, sizeof(buffer), " V%.3f", coord());
+
+			break;
+		}
+
+		d += buffer;
+	}
+
+	return d;
+}
+
+static int operand_count(wchar_t cmd) {
+	switch (cmd) {
+	case L'M': case L'm': case L'L': case L'l': case L'T': case L't':
+		return 2;
+	case L'H': case L'h': case L'V': case L'v':
+		return 1;
+	case L'Q': case L'q': case L'S': case L's':
+		return 4;
+	case L'C': case L'c':
+		return 6;
+	case L'A': case L'a':
+		return 7;
+	default:
+		return 0;
+	}
+}
+
+//What buildPath did before the lexer: copy the data into a wide stream with
+//spaces around the separators and signs, then read it with operator>>
+static size_t parse_with_stream(const std::wstring& source, double& sum) {
+	std::wstringstream ws;
+	std::wstring_view spaces(L", \t\r\n");
+	std::wstring_view commands(L"MmLlHhVvQqTtCcSsAaZz");
+	wchar_t cmd = 0, last_cmd = 0;
+	size_t count = 0;
+
+	for (wchar_t ch : source) {
+		if (spaces.find_first_of(ch) != std::wstring_view::npos) {
+			ws << L' ';
+		}
+		else if (ch == L'-') {
+			ws << L' ' << ch;
+		}
+		else {
+			ws << ch;
+		}
+	}
+
+	while (ws >> cmd) {
+		if (commands.find_first_of(cmd) == std::wstring_view::npos) {
+			ws.unget();
+			cmd = last_cmd == L'M' ? L'L' : last_cmd == L'm' ? L'l' : last_cmd;
+		}
+
+		for (int i = operand_count(cmd); i > 0; --i) {
+			float value;
+
+			if (!(ws >> value)) {
+				return count;
+			}
+
+			sum += value;
+			++count;
+		}
+
+		last_cmd = cmd;
+	}
+
+	return count;
+}
+
+static size_t parse_with_lexer(const std::string& source, double& sum) {
+	SVGPathLexer lexer(source);
+	char cmd = 0;
+	size_t count = 0;
+
+	while (!lexer.at_end()) {
+		lexer.read_command(cmd);
+
+		for (int i = operand_count(static_cast<wchar_t>(cmd)); i > 0; --i) {
+			float value;
+
+			if (!lexer.read_number(value)) {
+				return count;
+			}
+
+			sum += value;
+			++count;
+		}
+	}
+
+	return count;
+}
+
+int main(int argc, char** argv) {
+	int segments = argc > 1 ? std::atoi(argv[1]) : 200000;
+	std::string source = make_path(segments);
+	std::wstring wide(source.begin(), source.end());
+	double stream_sum = 0.0, lexer_sum = 0.0;
+	size_t stream_count = 0, lexer_count = 0, verbs = 0;
+	const int runs = 5;
+
+	double stream_ms = best_of(runs, [&]() {
+		stream_sum = 0.0;
+		stream_count = parse_with_stream(wide, stream_sum);
+	});
+	double lexer_ms = best_of(runs, [&]() {
+		lexer_sum = 0.0;
+		lexer_count = parse_with_lexer(source, lexer_sum);
+	});
+	double data_ms = best_of(runs, [&]() {
+		SVGPathData data;
+
+		data.parse(source);
+		verbs = data.verbs.size();
+	});
+	double mb = source.size() / 1e6;
+
+	printf("%.1f MB of path data, %zu numbers, best of %d\n", mb, lexer_count, runs);
+	printf("  wstringstream      %8.1f ms %8.1f MB/s\n", stream_ms, mb / (stream_ms / 1000.0));
+	printf("  SVGPathLexer       %8.1f ms %8.1f MB/s  %.1fx\n", lexer_ms, mb / (lexer_ms / 1000.0), stream_ms / lexer_ms);
+	printf("  SVGPathData::parse %8.1f ms %8.1f MB/s  %.1fx, %zu verbs\n", data_ms, mb / (data_ms / 1000.0), stream_ms / data_ms, verbs);
+
+	//Both read every number. Rounding may differ in the last bit, the sums barely.
+	if (stream_count != lexer_count || std::abs(stream_sum - lexer_sum) > 1e-6 * std::max(1.0, std::abs(stream_sum))) {
+		printf("MISMATCH: stream read %zu numbers, sum %g, lexer %zu, sum %g\n", stream_count, stream_sum, lexer_count, lexer_sum);
+		return 1;
+	}
+
+	return 0;
+}
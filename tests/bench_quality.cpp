@@ -0,0 +1,120 @@
+//Frame time and quality of each SVGRenderQuality on SVG files at 1000x1000. Quality
+//is the PSNR of the RGB channels against High quality at 16x16 supersampling,
+//capped at 99 dB. Tiled and clipped frames must give the
+//pixels of a whole one.
+//
+//  bench_quality [file.svg ...]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "SVGSoftwareRenderer.h"
+#include "SVGThreadPool.h"
+#include "bench_util.h"
+
+struct Mode {
+	const char* name;
+	SVGRenderQuality quality;
+	int supersampling;
+};
+
+static const Mode modes[] = {
+	{ "aliased", SVGRenderQuality::Aliased, 2 },
+	{ "standard", SVGRenderQuality::Standard, 2 },
+	{ "high 2x2", SVGRenderQuality::High, 2 },
+	{ "high 3x3", SVGRenderQuality::High, 3 },
+	{ "high 4x4", SVGRenderQuality::High, 4 },
+};
+static const int mode_count = 5;
+
+static double psnr(const SVGBitmap& a, const SVGBitmap& b) {
+	double error = 0.0;
+	size_t count = 0;
+
+	for (size_t i = 0; i < a.pixels.size(); ++i) {
+		if (i % 4 != 3) {
+			double d = static_cast<double>(a.pixels[i]) - b.pixels[i];
+
+			error += d * d;
+			++count;
+		}
+	}
+
+	if (error == 0.0) {
+		return 99.0;
+	}
+
+	return std::min(99.0, 10.0 * std::log10(255.0 * 255.0 / (error / count)));
+}
+
+int main(int argc, char** argv) {
+	const int width = 1000, height = 1000;
+	auto documents = load_documents(argc, argv, width, height);
+	SVGThreadPool pool(0);
+	SVGMatrix device = SVGMatrix::identity();
+	double total_ms[mode_count] = {}, total_psnr[mode_count] = {};
+	size_t mismatches = 0;
+
+	for (const auto& bench : documents) {
+		SVGSoftwareRenderer renderer;
+		SVGBitmap reference, bitmap, pieces;
+
+		reference.resize(width, height);
+		reference.clear(0xFFFFFFFF);
+		renderer.supersampling = 16;
+		renderer.render(bench->document, bench->list, reference, device, SVGRenderQuality::High);
+
+		bitmap.resize(width, height);
+		pieces.resize(width, height);
+		printf("%-12s", bench->name.c_str());
+
+		for (int m = 0; m < mode_count; ++m) {
+			const Mode& mode = modes[m];
+
+			renderer.supersampling = mode.supersampling;
+
+			double ms = best_of(5, [&]() {
+				bitmap.clear(0xFFFFFFFF);
+				renderer.render_tiled(bench->document, bench->list, bitmap, device, pool, mode.quality);
+			});
+			double quality = psnr(bitmap, reference);
+
+			total_ms[m] += ms;
+			total_psnr[m] += quality;
+			printf("  %s %6.2f ms %4.1f dB", mode.name, ms, quality);
+
+			//128 pixel clips of a whole frame
+			pieces.clear(0xFFFFFFFF);
+
+			for (int y = 0; y < height; y += 128) {
+				for (int x = 0; x < width; x += 128) {
+					renderer.render(bench->document, bench->list, pieces, device, SVGPixelRect{ x, y, std::min(x + 128, width), std::min(y + 128, height) }, mode.quality);
+				}
+			}
+
+			if (pieces.pixels != bitmap.pixels) {
+				printf(" CLIPS DIFFER");
+				++mismatches;
+			}
+		}
+
+		printf("\n");
+	}
+
+	if (documents.empty()) {
+		return 1;
+	}
+
+	printf("%zu files at %dx%d on %u threads\n", documents.size(), width, height, pool.concurrency());
+
+	for (int m = 0; m < mode_count; ++m) {
+		printf("  %-9s %8.2f ms for all  mean %4.1f dB\n", modes[m].name, total_ms[m], total_psnr[m] / documents.size());
+	}
+
+	if (mismatches) {
+		printf("MISMATCH: clipped frames differ from whole ones\n");
+		return 1;
+	}
+
+	return 0;
+}
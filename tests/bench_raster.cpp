@@ -0,0 +1,114 @@
+//Frame time of the software renderer with each span kernel the CPU supports, on
+//SVG files and on a large translucent rectangle. Every kernel and every clip of
+//the frame into tiles must give the pixels of the scalar kernel.
+//
+//  bench_raster [file.svg ...]
+
+#include <cstdio>
+#include <string>
+#include "SVGCpu.h"
+#include "SVGSoftwareRenderer.h"
+#include "bench_util.h"
+
+static const char* kernel_names[] = { "scalar", "sse2", "avx2", "avx512" };
+static const int kernel_count = 4;
+
+//Renders bench with every kernel. Adds the ms of a frame to total and returns
+//false if a kernel or a tiled frame gave other pixels than the scalar kernel.
+static bool run(const BenchDocument& bench, int width, int height, double total[]) {
+	SVGSoftwareRenderer renderer;
+	SVGMatrix device = SVGMatrix::identity();
+	SVGBitmap reference, bitmap;
+	bool same = true;
+
+	printf("%-14s %6zu items", bench.name.c_str(), bench.list.size());
+
+	for (int k = 0; k < kernel_count; ++k) {
+		SVGKernel kernel = static_cast<SVGKernel>(k);
+
+		if (svg_supported_kernel(kernel) != kernel) {
+			printf("  %s      -    ", kernel_names[k]);
+			continue;
+		}
+
+		renderer.rasterizer.kernel = kernel;
+		bitmap.resize(width, height);
+
+		double ms = best_of(10, [&]() {
+			bitmap.clear(0xFFFFFFFF);
+			renderer.render(bench.document, bench.list, bitmap, device);
+		});
+
+		total[k] += ms;
+		printf("  %s %7.3f ms", kernel_names[k], ms);
+
+		if (k == 0) {
+			reference = bitmap;
+		}
+		else if (bitmap.pixels != reference.pixels) {
+			printf(" DIFFERS");
+			same = false;
+		}
+	}
+
+	//64 pixel tiles, with the best kernel
+	renderer.rasterizer.kernel = svg_best_kernel();
+	bitmap.clear(0xFFFFFFFF);
+
+	for (int y = 0; y < height; y += 64) {
+		for (int x = 0; x < width; x += 64) {
+			renderer.render(bench.document, bench.list, bitmap, device, SVGPixelRect{ x, y, std::min(x + 64, width), std::min(y + 64, height) });
+		}
+	}
+
+	if (bitmap.pixels != reference.pixels) {
+		printf("  TILES DIFFER");
+		same = false;
+	}
+
+	printf("\n");
+
+	return same;
+}
+
+int main(int argc, char** argv) {
+	const int width = 1000, height = 1000;
+	auto documents = load_documents(argc, argv, width, height);
+	double total[kernel_count] = {};
+	bool same = true;
+
+	for (const auto& bench : documents) {
+		same = run(*bench, width, height, total) && same;
+	}
+
+	printf("%zu files at %dx%d, ms per frame of all of them\n", documents.size(), width, height);
+
+	for (int k = 0; k < kernel_count; ++k) {
+		if (total[k] > 0.0) {
+			printf("  %-7s %8.2f ms  %.2fx\n", kernel_names[k], total[k], total[0] / total[k]);
+		}
+	}
+
+	//Long spans of partial alpha, where the blend kernels do all the work
+	const int side = 2000;
+	auto rect = load_document("translucent", "<svg xmlns='http://www.w3.org/2000/svg' width='2000' height='2000'>"
+		"<rect x='0.5' y='0.5' width='1999' height='1999' fill='#3366cc' fill-opacity='0.5'/></svg>", side, side);
+	double rect_total[kernel_count] = {};
+
+	if (rect) {
+		same = run(*rect, side, side, rect_total) && same;
+
+		for (int k = 0; k < kernel_count; ++k) {
+			if (rect_total[k] > 0.0) {
+				printf("  %-7s %8.1f Mpixel/s\n", kernel_names[k], side * side / 1e3 / rect_total[k]);
+			}
+		}
+	}
+
+	if (!same) {
+		printf("MISMATCH: pixels differ from the scalar kernel\n");
+		return 1;
+	}
+
+	return 0;
+}
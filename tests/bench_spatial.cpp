@@ -0,0 +1,144 @@
+//Time of SVGSpatialIndex on a display list of 1M rects and circles over
+//10000x10000: building the index, hit_test at random points and query of 100x100
+//rects, against scanning the bounds of every entry. Query results are checked
+//against the scan.
+//
+//  bench_spatial [entries]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "SVGSpatialIndex.h"
+#include "bench_util.h"
+
+static std::string scatter(int count) {
+	std::string source = "<svg xmlns='http://www.w3.org/2000/svg' width='10000' height='10000'>";
+	unsigned int seed = 13;
+	char buffer[256];
+
+	auto random = [&](int n) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % n);
+	};
+
+	for (int i = 0; i < count; ++i) {
+		int x = random(10000), y = random(10000), size = 2 + random(30);
+
+		if (i % 2) {
+			snprintf(buffer, sizeof(buffer), "<rect x='%d' y='%d' width='%d' height='%d' fill='#%06x'/>", x, y, size, size, random(0xFFFFFF));
+		}
+		else {
+			snprintf(buffer, sizeof(buffer), "<circle cx='%d' cy='%d' r='%d' fill='#%06x'/>", x, y, size / 2, random(0xFFFFFF));
+		}
+
+		source += buffer;
+	}
+
+	return source + "</svg>";
+}
+
+int main(int argc, char** argv) {
+	int count = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	double start = now_ms();
+	auto bench = load_document("scatter", scatter(count), 10000, 10000);
+
+	if (!bench) {
+		printf("scatter: does not parse\n");
+		return 1;
+	}
+
+	const SVGDisplayList& list = bench->list;
+	SVGSpatialIndex index;
+
+	printf("%zu entries, parsed and compiled in %.0f ms\n", list.size(), now_ms() - start);
+
+	double build_ms = best_of(3, [&]() {
+		index.build(list);
+	});
+
+	printf("  build            %9.1f ms\n", build_ms);
+
+	const int points = 100000, scans = 200;
+	std::vector<SVGPoint> probes;
+	unsigned int seed = 17;
+
+	for (int i = 0; i < points; ++i) {
+		seed = seed * 1103515245 + 12345;
+		float x = static_cast<float>((seed >> 8) % 1000000) / 100.0f;
+
+		seed = seed * 1103515245 + 12345;
+		probes.push_back(SVGPoint{ x, static_cast<float>((seed >> 8) % 1000000) / 100.0f });
+	}
+
+	size_t hits = 0;
+	double hit_ms = best_of(3, [&]() {
+		hits = 0;
+
+		for (SVGPoint p : probes) {
+			hits += index.hit_test(bench->document, list, p) != svg_no_item;
+		}
+	});
+
+	//Only finding the topmost entry whose bounds hold the point, without testing its shape
+	size_t scan_hits = 0;
+	double scan_ms = best_of(3, [&]() {
+		scan_hits = 0;
+
+		for (int i = 0; i < scans; ++i) {
+			SVGPoint p = probes[i];
+
+			for (size_t k = list.items.size(); k-- > 0;) {
+				const SVGRect& b = list.items[k].bounds;
+
+				if (p.x >= b.left && p.x <= b.right && p.y >= b.top && p.y <= b.bottom) {
+					++scan_hits;
+					break;
+				}
+			}
+		}
+	});
+
+	printf("  hit_test         %9.3f us per point, %zu of %d hit\n", hit_ms * 1e3 / points, hits, points);
+	printf("  scan of bounds   %9.3f us per point, %zu of %d in some bounds, %.0fx\n", scan_ms * 1e3 / scans, scan_hits, scans,
+		(scan_ms / scans) / (hit_ms / points));
+
+	std::vector<uint32_t> found, expected;
+	size_t total = 0, mismatches = 0;
+	double query_ms = best_of(3, [&]() {
+		total = 0;
+
+		for (int i = 0; i < points; i += 10) {
+			SVGRect rect{ probes[i].x, probes[i].y, probes[i].x + 100, probes[i].y + 100 };
+
+			index.query(rect, found);
+			total += found.size();
+		}
+	});
+
+	for (int i = 0; i < scans * 10; i += 10) {
+		SVGRect rect{ probes[i].x, probes[i].y, probes[i].x + 100, probes[i].y + 100 };
+
+		index.query(rect, found);
+		expected.clear();
+
+		for (uint32_t k = 0; k < list.items.size(); ++k) {
+			const SVGRect& b = list.items[k].bounds;
+
+			if (b.left <= rect.right && rect.left <= b.right && b.top <= rect.bottom && rect.top <= b.bottom) {
+				expected.push_back(k);
+			}
+		}
+
+		mismatches += found != expected;
+	}
+
+	printf("  query 100x100    %9.3f us per rect, %.1f entries each\n", query_ms * 1e3 / (points / 10), static_cast<double>(total) / (points / 10));
+
+	if (mismatches) {
+		printf("MISMATCH: %zu queries differ from the scan\n", mismatches);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+//Time of svg_stroke_polyline on open polylines of 10k, 100k and 1M segments
+//turning at random angles, for each join, with round caps.
+//
+//  bench_stroke [segments ...]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "SVGStroke.h"
+#include "bench_util.h"
+
+//A random walk of segments 2 to 12 units long, each turning up to 150 degrees
+static SVGPolyline walk(int segments) {
+	SVGPolyline polyline;
+	unsigned int seed = 11;
+	double x = 500, y = 500, heading = 0;
+
+	auto random = [&](int n) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % n);
+	};
+
+	polyline.move_to(SVGPoint{ static_cast<float>(x), static_cast<float>(y) });
+
+	for (int i = 0; i < segments; ++i) {
+		double step = 2 + random(11);
+
+		heading += (random(301) - 150) * 3.14159265358979323846 / 180;
+		x += step * std::cos(heading);
+		y += step * std::sin(heading);
+		polyline.line_to(SVGPoint{ static_cast<float>(x), static_cast<float>(y) });
+	}
+
+	return polyline;
+}
+
+int main(int argc, char** argv) {
+	std::vector<int> counts;
+	const char* join_names[] = { "miter", "round", "bevel" };
+	const SVGLineJoin joins[] = { SVGLineJoin::Miter, SVGLineJoin::Round, SVGLineJoin::Bevel };
+
+	for (int i = 1; i < argc; ++i) {
+		counts.push_back(std::atoi(argv[i]));
+	}
+
+	if (counts.empty()) {
+		counts = { 10000, 100000, 1000000 };
+	}
+
+	printf("width 3, round caps, tolerance 0.1, best of 5\n");
+
+	for (int count : counts) {
+		SVGPolyline input = walk(count);
+
+		for (int j = 0; j < 3; ++j) {
+			SVGStrokeStyle style;
+			SVGPolyline outline;
+
+			style.width = 3.0f;
+			style.cap = SVGLineCap::Round;
+			style.join = joins[j];
+
+			double ms = best_of(5, [&]() {
+				outline.clear();
+				svg_stroke_polyline(input, style, 0.1f, outline);
+			});
+
+			printf("  %8d segments  %-5s %9.2f ms  %6.1f ns per segment  %9zu points out\n", count, join_names[j], ms, ms * 1e6 / count,
+				outline.points.size());
+		}
+	}
+
+	return 0;
+}
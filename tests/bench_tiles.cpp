@@ -0,0 +1,138 @@
+//Frame time of render_tiled against render on a poster of 3000 translucent and
+//stroked shapes, at 4K and 16K, with pools of 2, 4 and 8 threads and one per core.
+//First checks that render_tiled gives the pixels of render on SVG files, with
+//tiles of several shapes.
+//
+//  bench_tiles [file.svg ...]
+
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "SVGSoftwareRenderer.h"
+#include "SVGThreadPool.h"
+#include "bench_util.h"
+
+//Overlapping rectangles, circles and closed curves over 1000x562
+static std::string poster() {
+	std::string source = "<svg xmlns='http://www.w3.org/2000/svg' width='1000' height='562'>";
+	unsigned int seed = 1;
+	char buffer[512];
+
+	auto random = [&](int n) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % n);
+	};
+
+	for (int i = 0; i < 3000; ++i) {
+		int kind = random(3), x = random(1000), y = random(562), w = 5 + random(80), h = 5 + random(80);
+		unsigned int color = random(0xFFFFFF);
+
+		if (kind == 0) {
+			snprintf(buffer, sizeof(buffer), "<rect x='%d' y='%d' width='%d' height='%d' fill='#%06x' fill-opacity='0.6'/>", x, y, w, h, color);
+		}
+		else if (kind == 1) {
+			snprintf(buffer, sizeof(buffer), "<circle cx='%d' cy='%d' r='%d' fill='#%06x' stroke='black' stroke-width='1.5'/>", x, y, w / 2, color);
+		}
+		else {
+			snprintf(buffer, sizeof(buffer), "<path d='M%d %d C %d %d %d %d %d %d Q %d %d %d %d Z' fill='#%06x' stroke='#%06x' stroke-width='2' stroke-linejoin='round'/>",
+				x, y, x + w, y - h, x + 2 * w, y + h, x + w, y + 2 * h, x - w, y + h, x, y, color, color ^ 0xFFFFFF);
+		}
+
+		source += buffer;
+	}
+
+	return source + "</svg>";
+}
+
+int main(int argc, char** argv) {
+	const int width = 3840, height = 2160;
+	std::vector<std::unique_ptr<SVGThreadPool>> pools;
+
+	pools.push_back(std::make_unique<SVGThreadPool>(1));
+	pools.push_back(std::make_unique<SVGThreadPool>(3));
+	pools.push_back(std::make_unique<SVGThreadPool>(7));
+	pools.push_back(std::make_unique<SVGThreadPool>(0));
+
+	//Tile width and height. A width of 0 spans the bitmap.
+	const int shapes[][2] = { { 0, 32 }, { 128, 128 }, { 100, 37 }, { 0, 1 }, { 3000, 500 } };
+	auto documents = load_documents(argc, argv, 1000, 562);
+	SVGMatrix device = SVGMatrix::scale(width / 1000.0f, width / 1000.0f);
+	size_t mismatches = 0;
+
+	for (const auto& bench : documents) {
+		SVGSoftwareRenderer renderer;
+		SVGBitmap reference, bitmap;
+
+		reference.resize(width, height);
+		reference.clear(0xFFFFFFFF);
+		renderer.render(bench->document, bench->list, reference, device);
+		bitmap.resize(width, height);
+
+		for (const auto& shape : shapes) {
+			renderer.tile_width = shape[0];
+			renderer.tile_height = shape[1];
+
+			for (size_t p = 0; p < pools.size(); p += 2) {
+				bitmap.clear(0xFFFFFFFF);
+				renderer.render_tiled(bench->document, bench->list, bitmap, device, *pools[p]);
+
+				if (bitmap.pixels != reference.pixels) {
+					printf("%s: %dx%d tiles on %u threads differ\n", bench->name.c_str(), shape[0], shape[1], pools[p]->concurrency());
+					++mismatches;
+				}
+			}
+		}
+	}
+
+	printf("%zu files at %dx%d in %zu tile shapes, %zu differ\n", documents.size(), width, height, std::size(shapes), mismatches);
+
+	auto bench = load_document("poster", poster(), 1000, 562);
+	const int sizes[][2] = { { 3840, 2160 }, { 15360, 8640 } };
+
+	if (!bench) {
+		printf("poster: does not parse\n");
+		return 1;
+	}
+
+	for (const auto& size : sizes) {
+		SVGSoftwareRenderer renderer;
+		SVGBitmap reference, bitmap;
+		SVGMatrix poster_device = SVGMatrix::scale(size[0] / 1000.0f, size[0] / 1000.0f);
+		int runs = size[0] > 4000 ? 1 : 3;
+
+		reference.resize(size[0], size[1]);
+		bitmap.resize(size[0], size[1]);
+
+		double single = best_of(runs, [&]() {
+			reference.clear(0xFFFFFFFF);
+			renderer.render(bench->document, bench->list, reference, poster_device);
+		});
+
+		printf("poster %5dx%-5d render %7.0f ms", size[0], size[1], single);
+
+		for (const auto& pool : pools) {
+			double ms = best_of(runs, [&]() {
+				bitmap.clear(0xFFFFFFFF);
+				renderer.render_tiled(bench->document, bench->list, bitmap, poster_device, *pool);
+			});
+
+			printf(" | %u threads %7.0f ms %.2fx", pool->concurrency(), ms, single / ms);
+
+			if (bitmap.pixels != reference.pixels) {
+				printf(" DIFFERS");
+				++mismatches;
+			}
+		}
+
+		printf("\n");
+	}
+
+	if (mismatches) {
+		printf("MISMATCH: render_tiled differs from render\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+//Helpers of the benchmarks: timing, and loading and compiling SVG files
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "SVGDisplayList.h"
+#include "SVGDocument.h"
+
+struct BenchDocument {
+	std::string name;
+	SVGDocument document;
+	SVGDisplayList list;
+};
+
+inline double now_ms() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Best time of runs calls
+template <typename Function>
+double best_of(int runs, Function&& function) {
+	double best = 1e30;
+
+	for (int i = 0; i < runs; ++i) {
+		double start = now_ms();
+
+		function();
+		best = std::min(best, now_ms() - start);
+	}
+
+	return best;
+}
+
+//Parses source with a width x height viewport and compiles it. Returns null when
+//it doesn't parse.
+inline std::unique_ptr<BenchDocument> load_document(const std::string& name, const std::string& source, int width, int height) {
+	auto bench = std::make_unique<BenchDocument>();
+	SVGLengthContext context;
+
+	context.viewport_width = static_cast<float>(width);
+	context.viewport_height = static_cast<float>(height);
+
+	if (!bench->document.parse(source, context, nullptr)) {
+		return nullptr;
+	}
+
+	bench->name = name;
+	bench->list.compile(bench->document);
+
+	return bench;
+}
+
+//The files named by the arguments, or every .svg file of the tests directory
+//when there are none
+inline std::vector<std::unique_ptr<BenchDocument>> load_documents(int argc, char** argv, int width, int height) {
+	std::vector<std::string> files(argv + 1, argv + argc);
+	std::vector<std::unique_ptr<BenchDocument>> documents;
+
+	if (files.empty()) {
+		for (const auto& entry : std::filesystem::directory_iterator(SVG_TESTS_DIR)) {
+			if (entry.path().extension() == ".svg") {
+				files.push_back(entry.path().string());
+			}
+		}
+
+		//Natural order, so test2 comes before test10
+		std::sort(files.begin(), files.end(), [](const std::string& a, const std::string& b) {
+			return a.size() != b.size() ? a.size() < b.size() : a < b;
+		});
+	}
+
+	for (const std::string& file : files) {
+		std::ifstream in(file, std::ios::binary);
+		std::stringstream source;
+
+		source << in.rdbuf();
+
+		std::string name = std::filesystem::path(file).filename().string();
+		auto bench = load_document(name, source.str(), width, height);
+
+		if (bench) {
+			documents.push_back(std::move(bench));
+		}
+		else {
+			printf("%s: does not parse, skipped\n", name.c_str());
+		}
+	}
+
+	return documents;
+}
+
+//An SVG file of count paths of lines, curves and arcs, a few of them with errors
+//part way, which keep what comes before
+inline std::string path_document(int count) {
+	std::string source = "<svg xmlns='http://www.w3.org/2000/svg' width='1000' height='1000'>";
+	unsigned int seed = 5;
+	char buffer[512];
+
+	auto random = [&](int n) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % n);
+	};
+
+	for (int i = 0; i < count; ++i) {
+		int x = random(1000), y = random(1000), w = 1 + random(40), h = 1 + random(40);
+
+		snprintf(buffer, sizeof(buffer), "<path fill='#%06x' d='M%d.%d %d L%d,%d c%d-%d %d.5 %d,-.%d%d %d Q%d %d %d %d a%d %d %d 01%d %d%s z'/>",
+			random(0xFFFFFF), x, random(10), y, x + w, y, w, h, w, h, random(10), random(10), h, x, y + h, x - w, y, w, h, random(90),
+			random(20), random(20), random(50) == 0 ? " L1 x 2" : "");
+		source += buffer;
+	}
+
+	return source + "</svg>";
+}
@@ -0,0 +1,117 @@
+//Checks that every blend kernel the CPU supports gives the bytes of the scalar
+//ones, on random premultiplied pixels. Spans of every length up to 89 start at
+//every byte offset up to 63, four times each, so the vector loops, their tails
+//and unaligned loads and stores are all run. Bytes around a span must stay as they were.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "SVGBlend.h"
+#include "SVGCpu.h"
+
+static const char* kernel_names[] = { "scalar", "sse2", "avx2", "avx512" };
+static const char* operation_names[] = { "over", "solid", "mask" };
+static const int guard = 64;
+
+//A premultiplied pixel. A quarter are opaque and a quarter of the rest clear,
+//as in drawings, so that the shortcuts kernels take for them are covered.
+static void random_pixel(std::mt19937& rng, uint8_t* pixel) {
+	int alpha = rng() % 4 == 0 ? 255 : rng() % 4 == 0 ? 0 : static_cast<int>(rng() % 256);
+
+	for (int k = 0; k < 3; ++k) {
+		pixel[k] = static_cast<uint8_t>(alpha ? rng() % (alpha + 1) : 0);
+	}
+
+	pixel[3] = static_cast<uint8_t>(alpha);
+}
+
+static void blend(const SVGBlendKernels& kernels, int operation, uint8_t* dst, const uint8_t* src, const uint8_t* coverage, int count, const uint8_t color[4]) {
+	switch (operation) {
+	case 0:
+		kernels.over(dst, src, count);
+
+		break;
+	case 1:
+		kernels.solid(dst, count, color);
+
+		break;
+	default:
+		kernels.mask(dst, coverage, count, color);
+
+		break;
+	}
+}
+
+int main() {
+	std::mt19937 rng(1);
+	size_t cases = 0, failures = 0;
+
+	printf("kernels:");
+
+	for (int k = 0; k < 4; ++k) {
+		if (svg_supported_kernel(static_cast<SVGKernel>(k)) == static_cast<SVGKernel>(k)) {
+			printf(" %s", kernel_names[k]);
+		}
+	}
+
+	printf("\n");
+
+	for (int round = 0; round < 4 * 90 * 64; ++round) {
+		int count = round / 4 % 90;
+		int offset = round / 4 / 90;
+		size_t size = static_cast<size_t>(guard + offset + count * 4 + guard);
+		std::vector<uint8_t> dst(size), src(size), coverage(size);
+		uint8_t color[4];
+
+		for (size_t i = 0; i + 4 <= size; i += 4) {
+			random_pixel(rng, &dst[i]);
+			random_pixel(rng, &src[i]);
+		}
+
+		//Runs of clear, full and partial coverage, like the edges of shapes
+		for (size_t i = 0; i < size;) {
+			int run = 1 + static_cast<int>(rng() % 20);
+			int mode = static_cast<int>(rng() % 3);
+
+			for (int j = 0; j < run && i < size; ++j, ++i) {
+				coverage[i] = static_cast<uint8_t>(mode == 0 ? 0 : mode == 1 ? 255 : rng() % 256);
+			}
+		}
+
+		random_pixel(rng, color);
+
+		size_t start = guard + offset;
+
+		for (int operation = 0; operation < 3; ++operation) {
+			std::vector<uint8_t> reference = dst;
+
+			blend(svg_blend_kernels(SVGKernel::Scalar), operation, reference.data() + start, src.data() + start, coverage.data() + start, count, color);
+
+			if (!std::equal(dst.begin(), dst.begin() + start, reference.begin()) || !std::equal(dst.begin() + start + count * 4, dst.end(), reference.begin() + start + count * 4)) {
+				printf("scalar %s writes outside %d pixels at byte offset %d\n", operation_names[operation], count, offset);
+				++failures;
+			}
+
+			for (int k = 1; k < 4; ++k) {
+				std::vector<uint8_t> result = dst;
+
+				blend(svg_blend_kernels(static_cast<SVGKernel>(k)), operation, result.data() + start, src.data() + start, coverage.data() + start, count, color);
+				++cases;
+
+				if (result != reference) {
+					if (failures < 10) {
+						printf("%s %s differs from scalar: %d pixels at byte offset %d\n", kernel_names[k], operation_names[operation], count, offset);
+					}
+
+					++failures;
+				}
+			}
+		}
+	}
+
+	printf("%zu cases, %zu differ\n", cases, failures);
+
+	return failures ? 1 : 0;
+}
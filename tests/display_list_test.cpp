@@ -0,0 +1,195 @@
+//Replaying the display list must paint what walking the document paints. Every
+//sample SVG is drawn both ways, with batching off so that the list issues one
+//draw per entry like the walk does, and the bitmaps must be identical.
+//
+//  display_list_test [file.svg ...]
+
+#include <cstdio>
+#include <cstring>
+#include "SVGSoftwareRenderer.h"
+#include "bench_util.h"
+#include "test_util.h"
+
+//Draws the document the way render_tree did before there was a display list:
+//element by element down the tree, the fill then the stroke, multiplying each
+//transform into the one of the parent as it goes
+class TreeWalk {
+public:
+	SVGRasterizer rasterizer;
+
+	void render(const SVGDocument& document, SVGBitmap& target, const SVGMatrix& device) {
+		rasterizer.tolerance = svg_quality_tolerance(SVGRenderQuality::Standard);
+		rasterizer.aliased = false;
+
+		if (!document.empty()) {
+			render_node(document, document.root, target, device, 0);
+		}
+	}
+
+private:
+	SVGPolyline input;
+	SVGPolyline stroke;
+
+	static bool paint_color(const SVGStyle* style, const SVGPaint& paint, uint32_t& rgba) {
+		if (paint.type == SVGPaintType::Color) {
+			rgba = paint.rgba;
+		}
+		else if (paint.type == SVGPaintType::CurrentColor) {
+			rgba = style->color;
+		}
+		else {
+			return false;
+		}
+
+		return true;
+	}
+
+	void render_node(const SVGDocument& document, SVGNodeId id, SVGBitmap& target, const SVGMatrix& parent, int use_depth) {
+		const SVGNode& node = document.nodes[id];
+
+		if (node.tag == SVGTag::Defs) {
+			return;
+		}
+
+		SVGMatrix m = parent;
+
+		if (node.transform_class != SVGTransformClass::Identity) {
+			m = svg_multiply(node.transform, node.transform_class, parent);
+		}
+
+		if (node.tag == SVGTag::Use) {
+			if (node.payload != svg_no_node && use_depth < svg_max_use_depth) {
+				render_node(document, node.payload, target, m, use_depth + 1);
+			}
+		}
+		else if (node.style) {
+			render_shape(document, node, target, m);
+		}
+
+		for (SVGNodeId child = node.first_child; child != svg_no_node; child = document.nodes[child].next_sibling) {
+			render_node(document, child, target, m, use_depth);
+		}
+	}
+
+	void render_shape(const SVGDocument& document, const SVGNode& node, SVGBitmap& target, const SVGMatrix& m) {
+		const SVGStyle* style = node.style;
+		const float* g = node.geometry;
+		float ry = node.tag == SVGTag::Circle ? g[2] : g[3];
+		float tolerance = svg_flatten_tolerance(m, rasterizer.tolerance);
+		uint32_t rgba;
+
+		if (node.tag == SVGTag::Path && document.path(node.payload).verb_count == 0) {
+			return;
+		}
+
+		if (node.tag != SVGTag::Line && paint_color(style, style->fill, rgba)) {
+			rasterizer.clear();
+
+			switch (node.tag) {
+			case SVGTag::Rect:
+				rasterizer.add_rect(g[0], g[1], g[2], g[3], m);
+
+				break;
+			case SVGTag::Circle:
+			case SVGTag::Ellipse:
+				rasterizer.add_ellipse(g[0], g[1], g[2], ry, m);
+
+				break;
+			case SVGTag::Path:
+				rasterizer.add_path(document.path(node.payload), m);
+
+				break;
+			default:
+				break;
+			}
+
+			rasterizer.fill(target, rgba, style->fill_opacity, node.tag == SVGTag::Path ? style->fill_rule : SVGFillRule::NonZero);
+		}
+
+		if (!paint_color(style, style->stroke, rgba)) {
+			return;
+		}
+
+		input.clear();
+
+		switch (node.tag) {
+		case SVGTag::Rect:
+			input.move_to(SVGPoint{ g[0], g[1] });
+			input.line_to(SVGPoint{ g[0] + g[2], g[1] });
+			input.line_to(SVGPoint{ g[0] + g[2], g[1] + g[3] });
+			input.line_to(SVGPoint{ g[0], g[1] + g[3] });
+			input.close();
+
+			break;
+		case SVGTag::Circle:
+		case SVGTag::Ellipse:
+			svg_flatten_ellipse(g[0], g[1], g[2], ry, SVGMatrix::identity(), tolerance, input);
+
+			break;
+		case SVGTag::Line:
+			input.move_to(SVGPoint{ g[0], g[1] });
+			input.line_to(SVGPoint{ g[2], g[3] });
+
+			break;
+		case SVGTag::Path:
+			svg_flatten_path(document.path(node.payload), SVGMatrix::identity(), tolerance, input);
+
+			break;
+		default:
+			return;
+		}
+
+		SVGStrokeStyle stroke_style;
+
+		stroke_style.width = node.stroke_width;
+		stroke_style.cap = style->stroke_linecap;
+		stroke_style.join = style->stroke_linejoin;
+		stroke_style.miterlimit = style->stroke_miterlimit;
+		stroke.clear();
+		svg_stroke_polyline(input, stroke_style, tolerance, stroke);
+		rasterizer.clear();
+		rasterizer.add_polyline(stroke, m);
+		rasterizer.fill(target, rgba, style->stroke_opacity, SVGFillRule::NonZero);
+	}
+};
+
+int main(int argc, char** argv) {
+	const int width = 800, height = 600;
+	auto documents = load_documents(argc, argv, width, height);
+	//At the size of the viewport, and twice it, which scales exactly
+	const SVGMatrix devices[] = { SVGMatrix::identity(), SVGMatrix::scale(2, 2) };
+
+	SVG_CHECK(!documents.empty());
+
+	for (const auto& bench : documents) {
+		bench->list.batching = false;
+		bench->list.compile(bench->document);
+
+		for (const SVGMatrix& device : devices) {
+			SVGSoftwareRenderer renderer;
+			TreeWalk walk;
+			SVGBitmap replayed, walked;
+			int w = static_cast<int>(width * device.m11), h = static_cast<int>(height * device.m22);
+
+			replayed.resize(w, h);
+			replayed.clear(0xFFFFFFFF);
+			walked.resize(w, h);
+			walked.clear(0xFFFFFFFF);
+			renderer.render(bench->document, bench->list, replayed, device);
+			walk.render(bench->document, walked, device);
+
+			size_t differ = 0;
+
+			for (size_t i = 0; i < replayed.pixels.size(); i += 4) {
+				differ += memcmp(&replayed.pixels[i], &walked.pixels[i], 4) != 0;
+			}
+
+			if (differ) {
+				printf("%s at %dx%d: %zu of %d pixels differ from the tree walk\n", bench->name.c_str(), w, h, differ, w * h);
+				++svg_test_failures();
+			}
+		}
+	}
+
+	return svg_test_result();
+}
@@ -0,0 +1,238 @@
+//Lines and error of svg_flatten_path on the curves of test6.svg, test7.svg and
+//test13.svg, drawn at several zoom levels. The error is the largest distance from
+//the exact curve, sampled finely, to the lines that replace it. It must stay within
+//the tolerance. Also checks the cubics that svg_arc_to_cubics gives for arcs.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "SVGFlatten.h"
+#include "SVGPathData.h"
+
+struct Curve {
+	const char* name;
+	const char* data;
+};
+
+static const Curve curves[] = {
+	{ "Q T, test6", "M200,300 Q400,50 600,300 T1000,300" },
+	{ "C S, test7", "M100,200 C100,100 250,100 250,200 S400,300 400,200" },
+	{ "arcs, test13", "M300,200 h-150 a150,150 0 1,0 150,-150 z M275,175 v-150 a150,150 0 0,0 -150,150 z" },
+	{ "ellipses, test13", "M600,350 l 50,-25 a25,25 -30 0,1 50,-25 l 50,-25 a25,50 -30 0,1 50,-25 l 50,-25 "
+		"a25,75 -30 0,1 50,-25 l 50,-25 a25,100 -30 0,1 50,-25 l 50,-25" },
+	//Radii too small to reach the end point, scaled up
+	{ "small radii", "M100,100 a10,20 30 0,1 300,100 A5,5 0 1,1 100,100" },
+};
+
+static const int samples = 4000;
+static const float tolerance = 0.1f;
+
+static SVGPoint bezier(const SVGPoint* p, int degree, double t) {
+	double s = 1.0 - t;
+
+	if (degree == 2) {
+		return SVGPoint{ static_cast<float>(s * s * p[0].x + 2.0 * s * t * p[1].x + t * t * p[2].x),
+			static_cast<float>(s * s * p[0].y + 2.0 * s * t * p[1].y + t * t * p[2].y) };
+	}
+
+	return SVGPoint{ static_cast<float>(s * s * s * p[0].x + 3.0 * s * s * t * p[1].x + 3.0 * s * t * t * p[2].x + t * t * t * p[3].x),
+		static_cast<float>(s * s * s * p[0].y + 3.0 * s * s * t * p[1].y + 3.0 * s * t * t * p[2].y + t * t * t * p[3].y) };
+}
+
+static double segment_distance(SVGPoint p, SVGPoint a, SVGPoint b) {
+	double dx = b.x - a.x, dy = b.y - a.y;
+	double length = dx * dx + dy * dy;
+	double t = length > 0.0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length : 0.0;
+
+	t = std::min(std::max(t, 0.0), 1.0);
+
+	return std::hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy));
+}
+
+//Distance from p to the nearest line of polyline
+static double polyline_distance(SVGPoint p, const SVGPolyline& polyline) {
+	double best = 1e30;
+
+	for (const SVGPolylineFigure& figure : polyline.figures) {
+		const SVGPoint* points = polyline.points.data() + figure.first;
+
+		for (uint32_t i = 1; i < figure.count; ++i) {
+			best = std::min(best, segment_distance(p, points[i - 1], points[i]));
+		}
+
+		if (figure.closed || figure.count == 1) {
+			best = std::min(best, segment_distance(p, points[figure.count - 1], points[0]));
+		}
+	}
+
+	return best;
+}
+
+//Calls visitor(point) for samples + 1 points of each command of path, in user space
+template <typename Visitor>
+static void sample_path(const SVGPathData& path, Visitor&& visitor) {
+	SVGPathView view{ path.verbs.data(), path.verbs.size(), path.coords.data() };
+	SVGPoint pen, start;
+
+	view.for_each([&](SVGPathVerb verb, const float* c) {
+		SVGPoint to = pen;
+
+		switch (verb) {
+		case SVGPathVerb::Move:
+			to = start = SVGPoint{ c[0], c[1] };
+
+			break;
+		case SVGPathVerb::Line:
+		case SVGPathVerb::Close:
+			to = verb == SVGPathVerb::Line ? SVGPoint{ c[0], c[1] } : start;
+
+			for (int i = 0; i <= samples; ++i) {
+				double t = static_cast<double>(i) / samples;
+
+				visitor(SVGPoint{ static_cast<float>(pen.x + (to.x - pen.x) * t), static_cast<float>(pen.y + (to.y - pen.y) * t) });
+			}
+
+			break;
+		case SVGPathVerb::Quad:
+		case SVGPathVerb::Cubic: {
+			int degree = verb == SVGPathVerb::Quad ? 2 : 3;
+			SVGPoint p[4] = { pen, { c[0], c[1] }, { c[2], c[3] }, { c[4], c[5] } };
+
+			for (int i = 0; i <= samples; ++i) {
+				visitor(bezier(p, degree, static_cast<double>(i) / samples));
+			}
+
+			to = p[degree];
+
+			break;
+		}
+		case SVGPathVerb::Arc: {
+			SVGArcCenter arc;
+
+			to = SVGPoint{ c[5], c[6] };
+
+			if (svg_arc_center(pen, c, arc)) {
+				for (int i = 0; i <= samples; ++i) {
+					visitor(arc.point_at(arc.start_angle + arc.sweep * i / samples));
+				}
+			}
+
+			break;
+		}
+		}
+
+		pen = to;
+	});
+}
+
+//Largest distance, relative to the radii, of the cubics of svg_arc_to_cubics from
+//the ellipse of each arc of path. Returns -1 when an arc doesn't end at its end point.
+static double arc_cubic_error(const SVGPathData& path) {
+	SVGPathView view{ path.verbs.data(), path.verbs.size(), path.coords.data() };
+	SVGPoint pen, start;
+	double error = 0.0;
+
+	view.for_each([&](SVGPathVerb verb, const float* c) {
+		size_t count = svg_path_coord_count(verb);
+		SVGArcCenter arc;
+
+		if (verb == SVGPathVerb::Arc && svg_arc_center(pen, c, arc)) {
+			SVGPoint end = arc.point_at(arc.start_angle + arc.sweep);
+			SVGPoint points[13];
+			int curves = svg_arc_to_cubics(arc, points + 1);
+
+			if (std::hypot(end.x - c[5], end.y - c[6]) > 1e-3 * std::max(arc.rx, arc.ry)) {
+				error = -1.0;
+			}
+
+			points[0] = pen;
+
+			for (int k = 0; k < curves && error >= 0.0; ++k) {
+				for (int i = 0; i <= samples; ++i) {
+					SVGPoint p = bezier(points + 3 * k, 3, static_cast<double>(i) / samples);
+					double dx = p.x - arc.cx, dy = p.y - arc.cy;
+					double u = (dx * arc.cos_phi + dy * arc.sin_phi) / arc.rx;
+					double v = (dy * arc.cos_phi - dx * arc.sin_phi) / arc.ry;
+
+					error = std::max(error, std::fabs(std::hypot(u, v) - 1.0));
+				}
+			}
+		}
+
+		if (verb == SVGPathVerb::Move) {
+			start = SVGPoint{ c[0], c[1] };
+		}
+
+		pen = verb == SVGPathVerb::Close ? start : count ? SVGPoint{ c[count - 2], c[count - 1] } : pen;
+	});
+
+	return error;
+}
+
+int main() {
+	const float scales[] = { 0.1f, 1.0f, 10.0f };
+	bool passed = true;
+
+	printf("lines and max error in device pixels at a tolerance of %.2f\n", tolerance);
+	printf("%-18s", "");
+
+	for (float scale : scales) {
+		printf("   scale %-5g      ", scale);
+	}
+
+	printf(" arc cubics\n");
+
+	for (const Curve& curve : curves) {
+		SVGPathData path;
+
+		if (!path.parse(curve.data)) {
+			printf("%s: does not parse\n", curve.name);
+			return 1;
+		}
+
+		printf("%-18s", curve.name);
+
+		for (float scale : scales) {
+			SVGMatrix m = SVGMatrix::scale(scale, scale);
+			SVGPolyline polyline;
+			double error = 0.0;
+
+			svg_flatten_path(SVGPathView{ path.verbs.data(), path.verbs.size(), path.coords.data() }, m, tolerance, polyline);
+			sample_path(path, [&](SVGPoint p) {
+				error = std::max(error, polyline_distance(svg_transform_point(m, p), polyline));
+			});
+
+			size_t lines = 0;
+
+			for (const SVGPolylineFigure& figure : polyline.figures) {
+				lines += figure.count - 1 + (figure.closed ? 1 : 0);
+			}
+
+			//With room for the float rounding of points up to 10000 pixels out
+			bool within = error <= tolerance * 1.01;
+
+			printf("  %5zu lines %.4f%s", lines, error, within ? " " : "!");
+			passed = passed && within;
+		}
+
+		double arc_error = arc_cubic_error(path);
+
+		if (arc_error < 0.0) {
+			printf("  ARC MISSES ITS END POINT\n");
+			passed = false;
+		}
+		else {
+			//A cubic per quarter turn is at most 2.7e-4 of the radius off
+			printf("  %.2e\n", arc_error);
+			passed = passed && arc_error < 3e-4;
+		}
+	}
+
+	if (!passed) {
+		printf("FAILED: error over the tolerance\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+//Lengths in every unit, resolved on each axis, and what is rejected
+
+#include <cmath>
+#include <cstdio>
+#include "SVGDocument.h"
+#include "SVGLength.h"
+#include "test_util.h"
+
+struct LengthCase {
+	const char* source;
+	//In user units on the horizontal, vertical and diagonal axes
+	float horizontal, vertical, diagonal;
+};
+
+//At 96 dpi, a 400x300 viewport and a 20 user unit font. The normalized diagonal
+//is sqrt((400^2 + 300^2) / 2).
+static const LengthCase length_cases[] = {
+	{ "10", 10, 10, 10 },
+	{ "-3.5", -3.5f, -3.5f, -3.5f },
+	{ "10px", 10, 10, 10 },
+	{ " 5PX ", 5, 5, 5 },
+	{ "1e1px", 10, 10, 10 },
+	{ "1in", 96, 96, 96 },
+	{ "2.54cm", 96, 96, 96 },
+	{ "25.4mm", 96, 96, 96 },
+	{ "72pt", 96, 96, 96 },
+	{ "6pc", 96, 96, 96 },
+	{ "2em", 40, 40, 40 },
+	{ "1EM", 20, 20, 20 },
+	{ "2ex", 20, 20, 20 },
+	{ "50%", 200, 150, 176.776695f },
+	{ "-10%", -40, -30, -35.3553391f },
+};
+
+//Not lengths. Before svg_parse_length, get_size_value read any unit it did not
+//know, and anything after the number, as pixels.
+static const char* invalid_lengths[] = {
+	"",
+	" ",
+	"px",
+	"%",
+	"10foo",
+	"10 px",
+	"10p",
+	"10%%",
+	"1e",
+	"10px5",
+	"auto",
+};
+
+static bool near(float a, float b) {
+	return std::fabs(a - b) <= 1e-4f * std::fmax(1.0f, std::fabs(b));
+}
+
+int main() {
+	SVGLengthContext context;
+
+	context.viewport_width = 400;
+	context.viewport_height = 300;
+	context.font_size = 20;
+
+	for (const LengthCase& test : length_cases) {
+		float horizontal = 0, vertical = 0, diagonal = 0;
+		bool valid = context.resolve(test.source, SVGLengthAxis::Horizontal, horizontal) &&
+			context.resolve(test.source, SVGLengthAxis::Vertical, vertical) &&
+			context.resolve(test.source, SVGLengthAxis::Diagonal, diagonal);
+
+		if (!valid || !near(horizontal, test.horizontal) || !near(vertical, test.vertical) || !near(diagonal, test.diagonal)) {
+			printf("\"%s\" resolves to %g %g %g\n", test.source, horizontal, vertical, diagonal);
+			++svg_test_failures();
+		}
+	}
+
+	for (const char* source : invalid_lengths) {
+		SVGLength length;
+		float size = 7;
+
+		if (svg_parse_length(source, length) || context.resolve(source, SVGLengthAxis::Horizontal, size) || size != 7) {
+			printf("\"%s\" is not rejected\n", source);
+			++svg_test_failures();
+		}
+	}
+
+	//Font sizes: em and % are relative to the parent's font
+	float size = 0;
+
+	SVG_CHECK(context.resolve_font_size("150%", size) && near(size, 30));
+	SVG_CHECK(context.resolve_font_size("2em", size) && near(size, 40));
+	SVG_CHECK(context.resolve_font_size("12pt", size) && near(size, 16));
+	SVG_CHECK(!context.resolve_font_size("big", size) && near(size, 16));
+
+	//In a document, percentages resolve against the nearest viewport and em against
+	//the element's font size. An element whose required length is invalid is dropped.
+	SVGDocument document;
+	SVGLengthContext root;
+
+	root.viewport_width = 1000;
+	root.viewport_height = 1000;
+	SVG_CHECK(document.parse("<svg xmlns='http://www.w3.org/2000/svg' width='400' height='300'>"
+		"<g font-size='20'><rect x='2em' y='1ex' width='50%' height='50%'/></g>"
+		"<circle cx='0' cy='0' r='10%'/>"
+		"<circle cx='10foo' cy='0' r='5'/>"
+		"<svg x='0' y='0' width='100' height='50'><rect x='0' y='0' width='50%' height='50%'/></svg></svg>", root, nullptr));
+
+	const SVGTag tags[] = { SVGTag::Svg, SVGTag::G, SVGTag::Rect, SVGTag::Circle, SVGTag::Svg, SVGTag::Rect };
+	const float geometry[][4] = { { 0, 0, 400, 300 }, { 0, 0, 0, 0 }, { 40, 10, 200, 150 }, { 0, 0, 35.3553391f, 0 }, { 0, 0, 100, 50 }, { 0, 0, 50, 25 } };
+
+	SVG_CHECK(document.nodes.size() == 6);
+
+	for (size_t i = 0; i < document.nodes.size() && i < 6; ++i) {
+		const SVGNode& node = document.nodes[i];
+
+		SVG_CHECK(node.tag == tags[i]);
+
+		for (int k = 0; k < 4; ++k) {
+			if (!near(node.geometry[k], geometry[i][k])) {
+				printf("node %zu geometry %d is %g, expected %g\n", i, k, node.geometry[k], geometry[i][k]);
+				++svg_test_failures();
+			}
+		}
+	}
+
+	return svg_test_result();
+}
@@ -0,0 +1,244 @@
+//Editing a parsed document: what each mutation records in changes, what it
+//rejects, that replaced path data doesn't pile up, and that a display list
+//updated in place with update_node() and refresh() is the list compile() builds.
+
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include "SVGDisplayList.h"
+#include "SVGDocument.h"
+#include "test_util.h"
+
+static const char* source =
+	"<svg xmlns='http://www.w3.org/2000/svg' width='400' height='300'>"
+	"<defs><rect id='shared' x='0' y='0' width='5' height='5'/></defs>"
+	"<g id='bars' fill='red' transform='translate(10 20)'>"
+	"<rect id='a' x='0' y='0' width='10' height='50'/>"
+	"<rect id='b' x='20' y='0' width='10' height='60'/>"
+	"<rect id='c' x='40' y='0' width='10' height='70'/>"
+	"</g>"
+	"<g id='dots' transform='scale(2)'>"
+	"<circle id='d' cx='100' cy='100' r='5' fill='blue'/>"
+	"<circle id='e' cx='120' cy='100' r='5' fill='blue'/>"
+	"<path id='p' d='M0 0L10 0L10 10Z' stroke='black'/>"
+	"<line id='l' x1='0' y1='50' x2='40' y2='50' stroke='green'/>"
+	"</g>"
+	"<text id='t' x='5' y='200'>first run<!-- split -->text</text>"
+	"<use id='u' href='#shared'/>"
+	"<rect id='other' x='300' y='200' width='20' height='20'/>"
+	"</svg>";
+
+//Compares the changes recorded since the last call with expected, then clears them
+static void expect_changes(SVGDocument& document, std::initializer_list<SVGNodeChange> expected, int line) {
+	bool same = document.changes.size() == expected.size();
+
+	for (size_t i = 0; same && i < expected.size(); ++i) {
+		same = document.changes[i].node == expected.begin()[i].node && document.changes[i].change == expected.begin()[i].change;
+	}
+
+	if (!same) {
+		printf("line %d: changes are", line);
+
+		for (const SVGNodeChange& change : document.changes) {
+			printf(" (%u %d)", change.node, static_cast<int>(change.change));
+		}
+
+		printf("\n");
+		++svg_test_failures();
+	}
+
+	document.changes.clear();
+}
+
+static bool same_rect(const SVGRect& a, const SVGRect& b) {
+	return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+static bool same_item(const SVGDisplayItem& a, const SVGDisplayItem& b) {
+	return a.op == b.op && a.transform_class == b.transform_class && a.resource == b.resource && a.payload == b.payload &&
+		svg_matrix_equals(a.transform, b.transform) && memcmp(a.geometry, b.geometry, sizeof(a.geometry)) == 0 &&
+		a.stroke_width == b.stroke_width && same_rect(a.bounds, b.bounds) && a.batch == b.batch;
+}
+
+//What update_node() and refresh() left against what compile() builds now
+static bool same_list(const SVGDisplayList& updated, const SVGDisplayList& compiled) {
+	if (updated.items.size() != compiled.items.size() || updated.batches.size() != compiled.batches.size() ||
+		updated.subtrees.size() != compiled.subtrees.size() || updated.node_offsets != compiled.node_offsets ||
+		updated.node_items != compiled.node_items) {
+		return false;
+	}
+
+	for (size_t i = 0; i < updated.items.size(); ++i) {
+		if (!same_item(updated.items[i], compiled.items[i])) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < updated.batches.size(); ++i) {
+		if (updated.batches[i].first != compiled.batches[i].first || updated.batches[i].count != compiled.batches[i].count) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < updated.subtrees.size(); ++i) {
+		const SVGDisplaySubtree& a = updated.subtrees[i];
+		const SVGDisplaySubtree& b = compiled.subtrees[i];
+
+		if (a.first_item != b.first_item || a.end_item != b.end_item || a.end_subtree != b.end_subtree || !same_rect(a.bounds, b.bounds)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool draws_itself(SVGTag tag) {
+	return tag != SVGTag::Svg && tag != SVGTag::G && tag != SVGTag::Defs && tag != SVGTag::Use;
+}
+
+int main() {
+	SVGLengthContext context;
+	SVGDocument document;
+
+	context.viewport_width = 400;
+	context.viewport_height = 300;
+	SVG_CHECK(document.parse(source, context, nullptr));
+	SVG_CHECK(document.changes.empty());
+
+	SVGNodeId shared = document.find("shared"), bars = document.find("bars"), a = document.find("a"), b = document.find("b");
+	SVGNodeId c = document.find("c"), d = document.find("d"), p = document.find("p"), l = document.find("l");
+	SVGNodeId t = document.find("t"), u = document.find("u"), other = document.find("other");
+
+	//A later text run replaces the earlier one, and the pool keeps only what is used
+	SVG_CHECK(document.text(document.nodes[t].payload) == "text");
+	SVG_CHECK(document.text_pool == "text");
+
+	//The display list follows each edit of a leaf in place
+	SVGDisplayList list, compiled;
+
+	list.compile(document);
+
+	struct Edit {
+		SVGNodeId node;
+		const char* name;
+		const char* value;
+	};
+
+	const Edit edits[] = {
+		//Bounds of the entry and of its group grow
+		{ a, "width", "30" },
+		//Splits the batch of the three bars, then merges it again
+		{ b, "fill", "green" },
+		{ b, "fill", "red" },
+		{ d, "cx", "300" },
+		{ p, "d", "M0 0L50 0L50 50Z" },
+		{ l, "stroke-width", "4" },
+		//Restyles a and c, not b which sets its own fill
+		{ bars, "fill", "purple" },
+		{ a, "transform", "rotate(30)" },
+		{ other, "style", "fill:teal;stroke-width:3" },
+	};
+
+	for (const Edit& edit : edits) {
+		bool updated = true;
+		std::vector<uint32_t> kept;
+
+		SVG_CHECK(document.set_attribute(edit.node, edit.name, edit.value));
+
+		for (const SVGNodeChange& change : document.changes) {
+			if (draws_itself(document.nodes[change.node].tag)) {
+				updated = list.update_node(document, change.node) && updated;
+			}
+		}
+
+		list.refresh(document, kept);
+		document.changes.clear();
+		compiled.compile(document);
+
+		if (!updated || !same_list(list, compiled)) {
+			printf("%s=\"%s\": the updated list differs from a compiled one\n", edit.name, edit.value);
+			++svg_test_failures();
+		}
+	}
+
+	//What each mutation records
+	SVG_CHECK(document.set_attribute(b, "x", "25"));
+	expect_changes(document, { { b, SVGChange::Geometry } }, __LINE__);
+	SVG_CHECK(document.set_attribute(b, "fill", "blue"));
+	expect_changes(document, { { b, SVGChange::Style } }, __LINE__);
+	SVG_CHECK(document.set_style(bars, "fill", "orange"));
+	expect_changes(document, { { bars, SVGChange::Style }, { a, SVGChange::Style }, { c, SVGChange::Style } }, __LINE__);
+	//Setting what is already computed restyles nothing
+	SVG_CHECK(document.set_style(bars, "fill", "orange"));
+	expect_changes(document, {}, __LINE__);
+	SVG_CHECK(document.set_attribute(u, "href", "#other"));
+	expect_changes(document, { { shared, SVGChange::Structure }, { u, SVGChange::Structure } }, __LINE__);
+	SVG_CHECK(document.nodes[u].payload == other);
+
+	SVGNodeId last = document.insert(bars, svg_no_node, "rect");
+	SVGNodeId first = document.insert(bars, a, "circle");
+
+	SVG_CHECK(last == document.nodes.size() - 2 && first == document.nodes.size() - 1);
+	expect_changes(document, { { last, SVGChange::Structure }, { first, SVGChange::Structure } }, __LINE__);
+	SVG_CHECK(document.nodes[bars].first_child == first && document.nodes[first].next_sibling == a);
+	SVG_CHECK(document.nodes[c].next_sibling == last && document.nodes[last].next_sibling == svg_no_node);
+	//It inherits the group's fill
+	SVG_CHECK(document.nodes[last].style == document.nodes[a].style);
+
+	SVG_CHECK(document.remove(b));
+	expect_changes(document, { { b, SVGChange::Structure } }, __LINE__);
+	SVG_CHECK(document.nodes[a].next_sibling == c && !document.attached(b));
+	SVG_CHECK(document.remove(bars));
+	expect_changes(document, { { bars, SVGChange::Structure } }, __LINE__);
+	SVG_CHECK(!document.attached(a) && document.attached(d) && document.attached(shared));
+
+	//What is rejected changes nothing
+	SVG_CHECK(!document.set_attribute(svg_no_node, "x", "1"));
+	SVG_CHECK(!document.set_attribute(svg_no_node, "fill", "red"));
+	SVG_CHECK(!document.set_style(svg_no_node, "fill", "red"));
+	SVG_CHECK(document.insert(svg_no_node, svg_no_node, "rect") == svg_no_node);
+	SVG_CHECK(!document.remove(svg_no_node));
+	SVG_CHECK(!document.set_attribute(d, "d", "M0 0"));
+	SVG_CHECK(!document.set_attribute(d, "cx", "wide"));
+	SVG_CHECK(!document.set_style(d, "fill", "nocolor"));
+	SVG_CHECK(!document.set_attribute(document.root, "transform", "scale(2)"));
+	SVG_CHECK(!document.remove(document.root));
+	//Removed nodes and what is below them
+	SVG_CHECK(!document.set_attribute(b, "x", "1"));
+	SVG_CHECK(!document.set_style(a, "fill", "red"));
+	SVG_CHECK(!document.remove(b));
+	SVG_CHECK(!document.remove(a));
+	SVG_CHECK(document.insert(bars, svg_no_node, "rect") == svg_no_node);
+	//Parents that can't have children, a before of another parent and unknown tags
+	SVG_CHECK(document.insert(d, svg_no_node, "rect") == svg_no_node);
+	SVG_CHECK(document.insert(t, svg_no_node, "rect") == svg_no_node);
+	SVG_CHECK(document.insert(u, svg_no_node, "rect") == svg_no_node);
+	SVG_CHECK(document.insert(document.root, d, "rect") == svg_no_node);
+	SVG_CHECK(document.insert(document.root, svg_no_node, "blink") == svg_no_node);
+	expect_changes(document, {}, __LINE__);
+
+	//Path data written again and again. Data that fits goes in place, and the
+	//arrays are compacted before half of them is unused.
+	SVGNodeId q = document.insert(document.root, svg_no_node, "path");
+	const char* shapes[] = { "M0 0L10 0L10 10Z", "M0 0L5 5", "M0 0C1 1 2 2 3 3S4 4 5 5L6 6Z", "M0 0H100V100H0Z" };
+
+	for (int i = 0; i < 1000; ++i) {
+		SVG_CHECK(document.set_attribute(i % 2 ? p : q, "d", shapes[i % 4]));
+	}
+
+	for (SVGNodeId n : { p, q }) {
+		SVGPathData data;
+		SVGPathView view = document.path(document.nodes[n].payload);
+
+		data.parse(n == p ? shapes[3] : shapes[2]);
+		SVG_CHECK(view.verb_count == data.verbs.size() && memcmp(view.verbs, data.verbs.data(), data.verbs.size()) == 0);
+		SVG_CHECK(memcmp(view.coords, data.coords.data(), data.coords.size() * sizeof(float)) == 0);
+	}
+
+	if (document.path_verbs.size() > 40 || document.path_coords.size() > 80) {
+		printf("%zu verbs and %zu coordinates after 1000 edits\n", document.path_verbs.size(), document.path_coords.size());
+		++svg_test_failures();
+	}
+
+	return svg_test_result();
+}
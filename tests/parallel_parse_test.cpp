@@ -0,0 +1,57 @@
+//Parsing path data on a thread pool must give the arrays of a serial parse, byte
+//for byte, on a document of 120000 paths, some of which have errors.
+
+#include <cstdio>
+#include <cstring>
+#include "SVGDocument.h"
+#include "SVGThreadPool.h"
+#include "bench_util.h"
+#include "test_util.h"
+
+static bool same_paths(const SVGDocument& a, const SVGDocument& b) {
+	if (a.paths.size() != b.paths.size() || a.path_verbs != b.path_verbs || a.path_coords.size() != b.path_coords.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < a.paths.size(); ++i) {
+		if (a.paths[i].first_verb != b.paths[i].first_verb || a.paths[i].verb_count != b.paths[i].verb_count ||
+			a.paths[i].first_coord != b.paths[i].first_coord) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < a.nodes.size(); ++i) {
+		if (a.nodes[i].payload != b.nodes[i].payload) {
+			return false;
+		}
+	}
+
+	return a.path_coords.empty() || memcmp(a.path_coords.data(), b.path_coords.data(), a.path_coords.size() * sizeof(float)) == 0;
+}
+
+int main() {
+	std::string source = path_document(120000);
+	SVGLengthContext context;
+	SVGDocument serial;
+
+	context.viewport_width = 1000.0f;
+	context.viewport_height = 1000.0f;
+	SVG_CHECK(serial.parse(source, context, nullptr));
+	SVG_CHECK(serial.paths.size() == 120000);
+	SVG_CHECK(serial.nodes.size() == serial.paths.size() + 1);
+
+	for (unsigned int workers : { 1u, 3u, 7u, 0u }) {
+		SVGThreadPool pool(workers);
+		SVGDocument parallel;
+
+		SVG_CHECK(parallel.parse(source, context, &pool));
+		SVG_CHECK(parallel.nodes.size() == serial.nodes.size());
+
+		if (!same_paths(serial, parallel)) {
+			printf("parse on %u threads differs from the serial parse\n", pool.concurrency());
+			++svg_test_failures();
+		}
+	}
+
+	return svg_test_result();
+}
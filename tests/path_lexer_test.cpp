@@ -0,0 +1,165 @@
+//The number grammar of SVGPathLexer and what SVGPathData::parse makes of path
+//data, including the short forms and what is kept up to the first error
+
+#include <cfloat>
+#include <cstdio>
+#include <string>
+#include "SVGPathData.h"
+#include "SVGPathLexer.h"
+#include "test_util.h"
+
+struct NumberCase {
+	const char* source;
+	//Bytes read, 0 when there is no number
+	size_t consumed;
+	float value;
+};
+
+static const NumberCase number_cases[] = {
+	{ "0", 1, 0.0f },
+	{ "00012", 5, 12.0f },
+	{ "-.5", 3, -0.5f },
+	{ "+.5", 3, 0.5f },
+	{ "1.", 2, 1.0f },
+	{ "1.5.5", 3, 1.5f },
+	{ "10-20", 2, 10.0f },
+	{ "-.5+.5", 3, -0.5f },
+	//Exponents
+	{ "1e3", 3, 1000.0f },
+	{ "1E-2", 4, 0.01f },
+	{ "1e+2", 4, 100.0f },
+	{ ".5e-1", 5, 0.05f },
+	{ "1.e2", 4, 100.0f },
+	{ "2.5e-3,", 6, 0.0025f },
+	//An exponent needs digits, else the number ends before the e
+	{ "1e", 1, 1.0f },
+	{ "1e-", 1, 1.0f },
+	{ "1e+x", 1, 1.0f },
+	{ "1ex", 1, 1.0f },
+	//Out of range values saturate, more digits than fit are rounded
+	{ "1e40", 4, FLT_MAX },
+	{ "-1e40", 5, -FLT_MAX },
+	{ "1e-50", 5, 0.0f },
+	{ "123456789012345678901234", 24, 123456789012345678901234.0f },
+	{ "0.000000000000000000000123456789", 32, 1.23456789e-22f },
+	//Not numbers
+	{ "", 0, 0.0f },
+	{ ".", 0, 0.0f },
+	{ "-", 0, 0.0f },
+	{ "+-1", 0, 0.0f },
+	{ "-.e1", 0, 0.0f },
+	{ "e5", 0, 0.0f },
+	{ " 1", 0, 0.0f },
+};
+
+struct PathCase {
+	const char* source;
+	bool valid;
+	//What was kept, written out with absolute coordinates
+	const char* path;
+};
+
+static const PathCase path_cases[] = {
+	{ "M1 2L3 4", true, "M1 2 L3 4" },
+	{ "M1,2,3,4", true, "M1 2 L3 4" },
+	{ "m1 2 3 4 l1 1", true, "M1 2 L4 6 L5 7" },
+	{ "M0 0 10-20-.5+.5", true, "M0 0 L10 -20 L-0.5 0.5" },
+	{ "M0 0 L1.5.5.5.5", true, "M0 0 L1.5 0.5 L0.5 0.5" },
+	{ "M1e1 2E-1", true, "M10 0.2" },
+	{ "M0 0 h5 v5 H1 V2 z", true, "M0 0 L5 0 L5 5 L1 5 L1 2 Z" },
+	{ "M0 0 Q1 1 2 0 T4 0", true, "M0 0 Q1 1 2 0 Q3 -1 4 0" },
+	{ "M0 0 C0 1 1 1 1 0 S2 -1 2 0", true, "M0 0 C0 1 1 1 1 0 C1 -1 2 -1 2 0" },
+	{ "M0 0 z l1 1", true, "M0 0 Z M0 0 L1 1" },
+	//Arc flags need no separators
+	{ "M0 0 a1 1 0 00 1 1", true, "M0 0 A1 1 0 0 0 1 1" },
+	{ "M0 0 a1 1 0 1101 5", true, "M0 0 A1 1 0 1 1 1 5" },
+	{ "M0 0 a25 25 -30 1150 50", true, "M0 0 A25 25 -30 1 1 50 50" },
+	{ "M0 0 a1 1 0 2 1 1 1", false, "M0 0" },
+	//Everything up to the first error is kept
+	{ "M10 20 L30 40 L50 x L60 70", false, "M10 20 L30 40" },
+	{ "M1 2 3", false, "M1 2" },
+	{ "M1e 2", false, "" },
+	{ "M0 0 L1 1e", false, "M0 0 L1 1" },
+	{ "M0 0 L1.5.5.5", false, "M0 0 L1.5 0.5" },
+	{ "M1 2 Z 3 4", false, "M1 2 Z" },
+	{ "L1 2", false, "" },
+	{ "1 2", false, "" },
+	{ "M0 0 C1 1 2 2", false, "M0 0" },
+	{ "", true, "" },
+	{ " \t\r\n,", true, "" },
+};
+
+//path in the notation of PathCase
+static std::string describe(const SVGPathData& path) {
+	static const char letters[] = "MLQCAZ";
+	std::string text;
+
+	path.for_each([&](SVGPathVerb verb, const float* coords) {
+		if (!text.empty()) {
+			text += ' ';
+		}
+
+		text += letters[static_cast<size_t>(verb)];
+
+		for (size_t i = 0; i < svg_path_coord_count(verb); ++i) {
+			char buffer[32];
+
+			snprintf(buffer, sizeof(buffer), i ? " %g" : "%g", coords[i]);
+			text += buffer;
+		}
+	});
+
+	return text;
+}
+
+int main() {
+	for (const NumberCase& test : number_cases) {
+		float value = 0.0f;
+		size_t consumed = svg_parse_number(test.source, value);
+
+		if (consumed != test.consumed || (consumed && value != test.value)) {
+			printf("svg_parse_number(\"%s\") read %zu bytes, %.9g, expected %zu, %.9g\n", test.source, consumed, value, test.consumed, test.value);
+			++svg_test_failures();
+		}
+	}
+
+	for (const PathCase& test : path_cases) {
+		SVGPathData path;
+		bool valid = path.parse(test.source);
+		std::string text = describe(path);
+
+		if (valid != test.valid || text != test.path) {
+			printf("parse(\"%s\") gave %s \"%s\", expected %s \"%s\"\n", test.source, valid ? "valid" : "invalid", text.c_str(),
+				test.valid ? "valid" : "invalid", test.path);
+			++svg_test_failures();
+		}
+	}
+
+	//The lexer reads numbers, flags and commands back to back
+	SVGPathLexer lexer(" M-.5+.5 110.5e1e2,A");
+	char cmd = 0;
+	float value = 0.0f;
+	bool flag = false;
+
+	SVG_CHECK(lexer.read_command(cmd) && cmd == 'M');
+	SVG_CHECK(!lexer.read_command(cmd));
+	SVG_CHECK(lexer.read_number(value) && value == -0.5f);
+	SVG_CHECK(lexer.read_number(value) && value == 0.5f);
+	SVG_CHECK(lexer.read_flag(flag) && flag);
+	SVG_CHECK(lexer.read_flag(flag) && flag);
+	SVG_CHECK(lexer.read_number(value) && value == 5.0f);
+	//A bare e is neither a number nor a command
+	SVG_CHECK(!lexer.read_number(value));
+	SVG_CHECK(!lexer.read_command(cmd));
+	SVG_CHECK(lexer.offset() == 16);
+
+	SVGPathLexer flags("2 .1");
+
+	SVG_CHECK(!flags.read_flag(flag));
+	SVG_CHECK(flags.read_number(value) && value == 2.0f);
+	SVG_CHECK(!flags.read_flag(flag));
+	SVG_CHECK(flags.read_number(value) && value == 0.1f);
+	SVG_CHECK(flags.at_end());
+
+	return svg_test_result();
+}
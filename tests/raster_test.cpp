@@ -0,0 +1,88 @@
+//SVGRasterizer on geometry far outside the bitmap. Device coordinates past the
+//guard band of +-2^24 pixels are clipped to it, so that pixel indices fit an int,
+//and the pixels inside come out as if nothing had been clipped.
+
+#include <cstdlib>
+#include <cstdio>
+#include <initializer_list>
+#include "SVGRaster.h"
+#include "test_util.h"
+
+static const int size = 64;
+static const uint32_t color = 0x3060C0FF;
+
+//Fills the figure of the points on a white bitmap
+static SVGBitmap fill_polygon(std::initializer_list<SVGPoint> points) {
+	SVGRasterizer raster;
+	SVGPolyline polyline;
+	SVGBitmap bitmap;
+
+	for (SVGPoint p : points) {
+		if (polyline.empty()) {
+			polyline.move_to(p);
+		}
+		else {
+			polyline.line_to(p);
+		}
+	}
+
+	polyline.close();
+	raster.add_polyline(polyline, SVGMatrix::identity());
+	bitmap.resize(size, size);
+	bitmap.clear(0xFFFFFFFF);
+	raster.fill(bitmap, color, 1.0f, SVGFillRule::NonZero);
+
+	return bitmap;
+}
+
+static SVGBitmap fill_rect(float x, float y, float width, float height) {
+	return fill_polygon({ { x, y }, { x + width, y }, { x + width, y + height }, { x, y + height } });
+}
+
+//Largest difference of a channel
+static int difference(const SVGBitmap& a, const SVGBitmap& b) {
+	int largest = 0;
+
+	for (size_t i = 0; i < a.pixels.size(); ++i) {
+		largest = std::max(largest, std::abs(a.pixels[i] - b.pixels[i]));
+	}
+
+	return largest;
+}
+
+int main() {
+	SVGBitmap solid;
+
+	solid.resize(size, size);
+	solid.clear(color);
+
+	//Covers everything
+	SVG_CHECK(fill_rect(-1e30f, -1e30f, 2e30f, 2e30f).pixels == solid.pixels);
+	SVG_CHECK(fill_rect(-1e9f, -1e9f, 2e9f, 2e9f).pixels == solid.pixels);
+
+	//Sides far out on each side give the pixels of sides just off the bitmap
+	SVG_CHECK(fill_rect(10, 5, 1e12f, 20).pixels == fill_rect(10, 5, 100, 20).pixels);
+	SVG_CHECK(fill_polygon({ { -1e20f, 5 }, { 30, 5 }, { 30, 25 }, { -1e20f, 25 } }).pixels == fill_rect(-5, 5, 35, 20).pixels);
+	SVG_CHECK(fill_polygon({ { 10, -1e15f }, { 30, -1e15f }, { 30, 30 }, { 10, 30 } }).pixels == fill_rect(10, -5, 20, 35).pixels);
+	SVG_CHECK(fill_rect(10, 30, 20, 1e15f).pixels == fill_rect(10, 30, 20, 100).pixels);
+
+	//Edges that cross the guard band on a slant keep their slope inside it. Clamping
+	//the far corner instead would bend both long sides.
+	SVGBitmap far = fill_polygon({ { 0, 0 }, { 1e12f, 1e12f }, { 0, 40 } });
+	SVGBitmap near = fill_polygon({ { 0, 0 }, { 1e7f, 1e7f }, { 0, 40 } });
+	SVGBitmap sheared = fill_polygon({ { 0, 0 }, { -3e9f, 1e10f }, { 50, 0 } });
+
+	SVG_CHECK(difference(far, near) <= 1);
+	SVG_CHECK(difference(far, solid) > 0);
+	SVG_CHECK(difference(sheared, fill_polygon({ { 0, 0 }, { -3e6f, 1e7f }, { 50, 0 } })) <= 1);
+
+	//Nothing left to draw is nothing drawn
+	SVGBitmap white;
+
+	white.resize(size, size);
+	white.clear(0xFFFFFFFF);
+	SVG_CHECK(fill_rect(1e20f, 1e20f, 1e20f, 1e20f).pixels == white.pixels);
+	SVG_CHECK(fill_rect(-1e20f, 100, 2e20f, 1e20f).pixels == white.pixels);
+
+	return svg_test_result();
+}
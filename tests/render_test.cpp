@@ -0,0 +1,131 @@
+//The software renderer must give the same pixels however a frame is drawn:
+//- with every span kernel the CPU supports, as with the scalar one;
+//- clipped into pieces, as whole;
+//- in tiles on a thread pool, as on one thread.
+//bench_raster, bench_quality and bench_tiles check the same at full size. This
+//runs the checks on the sample SVGs and a poster of overlapping shapes at sizes
+//that keep it quick, for every quality.
+//
+//  render_test [file.svg ...]
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "SVGCpu.h"
+#include "SVGSoftwareRenderer.h"
+#include "SVGThreadPool.h"
+#include "bench_util.h"
+#include "test_util.h"
+
+static const int width = 400, height = 300;
+static const char* kernel_names[] = { "scalar", "sse2", "avx2", "avx512" };
+
+//Translucent, stroked and curved shapes over 400x300, many of them across tiles
+static std::string poster() {
+	std::string source = "<svg xmlns='http://www.w3.org/2000/svg' width='400' height='300'>";
+	unsigned int seed = 3;
+	char buffer[512];
+
+	auto random = [&](int n) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % n);
+	};
+
+	for (int i = 0; i < 300; ++i) {
+		int kind = random(3), x = random(400), y = random(300), w = 3 + random(60), h = 3 + random(60);
+		unsigned int color = random(0xFFFFFF);
+
+		if (kind == 0) {
+			snprintf(buffer, sizeof(buffer), "<rect x='%d.5' y='%d' width='%d' height='%d' fill='#%06x' fill-opacity='0.6'/>", x, y, w, h, color);
+		}
+		else if (kind == 1) {
+			snprintf(buffer, sizeof(buffer), "<circle cx='%d' cy='%d.3' r='%d' fill='#%06x' stroke='black' stroke-width='1.5'/>", x, y, w / 2, color);
+		}
+		else {
+			snprintf(buffer, sizeof(buffer), "<path d='M%d %d C %d %d %d %d %d %d Q %d %d %d %d Z' fill='#%06x' stroke='#%06x' stroke-width='2' stroke-linejoin='round'/>",
+				x, y, x + w, y - h, x + 2 * w, y + h, x + w, y + 2 * h, x - w, y + h, x, y, color, color ^ 0xFFFFFF);
+		}
+
+		source += buffer;
+	}
+
+	return source + "</svg>";
+}
+
+static void check_same(const SVGBitmap& bitmap, const SVGBitmap& reference, const std::string& name, const char* what, int quality) {
+	if (bitmap.pixels != reference.pixels) {
+		printf("%s, quality %d: %s differs\n", name.c_str(), quality, what);
+		++svg_test_failures();
+	}
+}
+
+static void check_document(const BenchDocument& bench, SVGThreadPool& pool) {
+	const SVGRenderQuality qualities[] = { SVGRenderQuality::Aliased, SVGRenderQuality::Standard, SVGRenderQuality::High };
+	//Tile width and height. A width of 0 spans the bitmap.
+	const int shapes[][2] = { { 0, 32 }, { 64, 64 }, { 50, 17 }, { 0, 1 }, { 1000, 500 } };
+	//Slightly tilted and zoomed, so that edges fall between pixels
+	SVGMatrix device = svg_multiply(SVGMatrix{ 0.998f, 0.05f, -0.05f, 0.998f, 0, 0 }, SVGMatrix::scale(1.25f, 1.25f));
+	SVGSoftwareRenderer renderer;
+	SVGBitmap reference, bitmap;
+
+	renderer.supersampling = 3;
+	reference.resize(width, height);
+	bitmap.resize(width, height);
+
+	for (SVGRenderQuality quality : qualities) {
+		int q = static_cast<int>(quality);
+
+		renderer.rasterizer.kernel = SVGKernel::Scalar;
+		reference.clear(0xFFFFFFFF);
+		renderer.render(bench.document, bench.list, reference, device, quality);
+
+		for (int k = 1; k <= static_cast<int>(SVGKernel::AVX512); ++k) {
+			SVGKernel kernel = static_cast<SVGKernel>(k);
+
+			if (svg_supported_kernel(kernel) == kernel) {
+				renderer.rasterizer.kernel = kernel;
+				bitmap.clear(0xFFFFFFFF);
+				renderer.render(bench.document, bench.list, bitmap, device, quality);
+				check_same(bitmap, reference, bench.name, kernel_names[k], q);
+			}
+		}
+
+		//Clipped into 48 pixel pieces, which don't line up with any tile shape
+		bitmap.clear(0xFFFFFFFF);
+
+		for (int y = 0; y < height; y += 48) {
+			for (int x = 0; x < width; x += 48) {
+				renderer.render(bench.document, bench.list, bitmap, device, SVGPixelRect{ x, y, std::min(x + 48, width), std::min(y + 48, height) }, quality);
+			}
+		}
+
+		check_same(bitmap, reference, bench.name, "clipped frame", q);
+
+		for (const auto& shape : shapes) {
+			renderer.tile_width = shape[0];
+			renderer.tile_height = shape[1];
+			bitmap.clear(0xFFFFFFFF);
+			renderer.render_tiled(bench.document, bench.list, bitmap, device, pool, quality);
+			check_same(bitmap, reference, bench.name, "tiled frame", q);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	auto documents = load_documents(argc, argv, width, height);
+	//More threads than this machine may have cores, to interleave the tiles
+	SVGThreadPool pool(3);
+
+	SVG_CHECK(!documents.empty());
+	documents.push_back(load_document("poster", poster(), width, height));
+	SVG_CHECK(documents.back() != nullptr);
+
+	for (const auto& bench : documents) {
+		if (bench) {
+			check_document(*bench, pool);
+		}
+	}
+
+	return svg_test_result();
+}
@@ -0,0 +1,237 @@
+//SVGSpatialIndex against a linear scan of the display list. query() must find the
+//entries whose bounds meet a rect, in paint order, and hit_test() the topmost
+//entry whose shape covers a point, on thousands of overlapping fills, strokes and
+//paths with holes under scaled groups.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "SVGSpatialIndex.h"
+#include "bench_util.h"
+#include "test_util.h"
+
+//Points closer than this to the edge of a circle, in world units, may fall either
+//way once hit_test flattens it, so the scan does not decide them. Other shapes are
+//polygons, which only round.
+static const float curve_margin = 0.3f, margin = 0.001f;
+
+struct Random {
+	unsigned int seed = 9;
+
+	int operator()(int n) {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<int>((seed >> 8) % n);
+	}
+};
+
+//Groups of 10 shapes, each group translated and scaled by 0.5, 1 or 2, over 1000x1000
+static std::string shapes(int groups) {
+	static const char* scales[] = { "0.5", "1", "2" };
+	std::string source = "<svg xmlns='http://www.w3.org/2000/svg' width='1000' height='1000'>";
+	Random random;
+	char buffer[512];
+
+	for (int g = 0; g < groups; ++g) {
+		snprintf(buffer, sizeof(buffer), "<g transform='translate(%d %d) scale(%s)'>", random(900), random(900), scales[random(3)]);
+		source += buffer;
+
+		for (int i = 0; i < 10; ++i) {
+			int x = random(80), y = random(80), w = 12 + random(40), h = 12 + random(40), width = 1 + random(4);
+
+			switch (random(5)) {
+			case 0:
+				snprintf(buffer, sizeof(buffer), "<rect x='%d' y='%d' width='%d' height='%d' fill='#%06x'/>", x, y, w, h, random(0xFFFFFF));
+
+				break;
+			case 1:
+				snprintf(buffer, sizeof(buffer), "<circle cx='%d' cy='%d' r='%d' fill='#%06x'/>", x, y, w / 2, random(0xFFFFFF));
+
+				break;
+			case 2:
+				snprintf(buffer, sizeof(buffer), "<line x1='%d' y1='%d' x2='%d' y2='%d' stroke='black' stroke-width='%d'/>", x, y, x + w, y + h - 32, width);
+
+				break;
+			case 3:
+				snprintf(buffer, sizeof(buffer), "<rect x='%d' y='%d' width='%d' height='%d' fill='none' stroke='red' stroke-width='%d'/>", x, y, w, h, width);
+
+				break;
+			default:
+				//A square with a square hole
+				w /= 4;
+				snprintf(buffer, sizeof(buffer), "<path fill-rule='evenodd' fill='blue' d='M%d %d h%d v%d h-%d z M%d %d h%d v%d h-%d z'/>",
+					x, y, 4 * w, 4 * w, 4 * w, x + w, y + w, 2 * w, 2 * w, 2 * w);
+
+				break;
+			}
+
+			source += buffer;
+		}
+
+		source += "</g>";
+	}
+
+	return source + "</svg>";
+}
+
+//Signed distance from p to the box, negative inside
+static float box_distance(SVGPoint p, float left, float top, float right, float bottom) {
+	float dx = std::fmax(left - p.x, p.x - right), dy = std::fmax(top - p.y, p.y - bottom);
+
+	return std::hypot(std::fmax(dx, 0.0f), std::fmax(dy, 0.0f)) + std::fmin(std::fmax(dx, dy), 0.0f);
+}
+
+//Signed distance in world units from p to the shape item paints, negative inside
+static float shape_distance(const SVGDocument& document, const SVGDisplayItem& item, SVGPoint p) {
+	SVGMatrix inverse;
+
+	svg_invert(item.transform, inverse);
+
+	SVGPoint l = svg_transform_point(inverse, p);
+	const float* g = item.geometry;
+	float half = item.stroke_width * 0.5f;
+	float distance = 1e9f;
+
+	switch (item.op) {
+	case SVGDrawOp::FillRect:
+		distance = box_distance(l, g[0], g[1], g[0] + g[2], g[1] + g[3]);
+
+		break;
+	case SVGDrawOp::StrokeRect:
+		//Miter joins make square corners
+		distance = std::fmax(box_distance(l, g[0] - half, g[1] - half, g[0] + g[2] + half, g[1] + g[3] + half),
+			-box_distance(l, g[0] + half, g[1] + half, g[0] + g[2] - half, g[1] + g[3] - half));
+
+		break;
+	case SVGDrawOp::FillEllipse:
+		distance = std::hypot(l.x - g[0], l.y - g[1]) - g[2];
+
+		break;
+	case SVGDrawOp::StrokeLine: {
+		//Butt caps: a box along the line
+		float dx = g[2] - g[0], dy = g[3] - g[1], length = std::hypot(dx, dy);
+		SVGPoint along{ ((l.x - g[0]) * dx + (l.y - g[1]) * dy) / length, ((l.y - g[1]) * dx - (l.x - g[0]) * dy) / length };
+
+		distance = box_distance(along, 0.0f, -half, length, half);
+
+		break;
+	}
+	case SVGDrawOp::FillPath: {
+		const float* c = document.path(item.payload).coords;
+		float outer = c[2] - c[0], x = c[0], y = c[1];
+
+		distance = std::fmax(box_distance(l, x, y, x + outer, y + outer),
+			-box_distance(l, x + outer / 4, y + outer / 4, x + outer * 3 / 4, y + outer * 3 / 4));
+
+		break;
+	}
+	default:
+		break;
+	}
+
+	return distance * svg_max_scale(item.transform);
+}
+
+static bool rects_meet(const SVGRect& a, const SVGRect& b) {
+	return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
+
+int main() {
+	auto bench = load_document("shapes", shapes(400), 1000, 1000);
+	SVGSpatialIndex index;
+	Random random;
+	size_t hits = 0, decided = 0;
+
+	SVG_CHECK(bench != nullptr);
+
+	if (!bench) {
+		return svg_test_result();
+	}
+
+	const SVGDisplayList& list = bench->list;
+
+	index.build(list);
+	SVG_CHECK(list.size() > 3000);
+
+	//Rects of every size, in and out of the document, down to a point
+	std::vector<uint32_t> found, expected;
+
+	for (int i = 0; i < 500; ++i) {
+		float x = static_cast<float>(random(1400) - 200), y = static_cast<float>(random(1400) - 200);
+		float side = i % 5 == 0 ? 0.0f : static_cast<float>(random(i % 3 ? 50 : 600));
+		SVGRect rect{ x, y, x + side, y + side };
+
+		index.query(rect, found);
+		expected.clear();
+
+		for (uint32_t k = 0; k < list.items.size(); ++k) {
+			if (rects_meet(list.items[k].bounds, rect)) {
+				expected.push_back(k);
+			}
+		}
+
+		if (found != expected) {
+			printf("query(%g %g %g %g) found %zu entries, the scan %zu\n", rect.left, rect.top, rect.right, rect.bottom, found.size(), expected.size());
+			++svg_test_failures();
+		}
+	}
+
+	//The topmost entry that covers the point, found by trying every entry from the
+	//last down. Points on the edge of the entry that decides are skipped.
+	for (int i = 0; i < 5000; ++i) {
+		SVGPoint p{ random(100000) / 100.0f, random(100000) / 100.0f };
+		uint32_t top = svg_no_item;
+		bool clear = true;
+
+		for (uint32_t k = static_cast<uint32_t>(list.items.size()); k-- > 0;) {
+			float distance = shape_distance(bench->document, list.items[k], p);
+
+			if (std::fabs(distance) < (list.items[k].op == SVGDrawOp::FillEllipse ? curve_margin : margin)) {
+				clear = false;
+				break;
+			}
+
+			if (distance < 0.0f) {
+				top = k;
+				break;
+			}
+		}
+
+		if (!clear) {
+			continue;
+		}
+
+		uint32_t item = index.hit_test(bench->document, list, p);
+
+		++decided;
+		hits += top != svg_no_item;
+
+		if (item != top) {
+			printf("hit_test(%g %g) gave entry %d, the scan %d\n", p.x, p.y, static_cast<int>(item), static_cast<int>(top));
+			++svg_test_failures();
+		}
+	}
+
+	//Most points decide, and a good share of them hit something
+	SVG_CHECK(decided > 4500 && hits > decided / 4 && hits < decided);
+
+	//Of two overlapping shapes the later one is on top
+	auto pair = load_document("pair", "<svg xmlns='http://www.w3.org/2000/svg' width='100' height='100'>"
+		"<rect x='10' y='10' width='50' height='50' fill='red'/><circle cx='60' cy='60' r='20' fill='blue'/></svg>", 100, 100);
+
+	SVG_CHECK(pair != nullptr);
+
+	if (pair) {
+		SVGSpatialIndex pair_index;
+
+		pair_index.build(pair->list);
+		SVG_CHECK(pair_index.hit_test(pair->document, pair->list, SVGPoint{ 55, 55 }) == 1);
+		SVG_CHECK(pair_index.hit_test(pair->document, pair->list, SVGPoint{ 20, 20 }) == 0);
+		SVG_CHECK(pair_index.hit_test(pair->document, pair->list, SVGPoint{ 72, 72 }) == 1);
+		//In the bounds of the circle but outside it
+		SVG_CHECK(pair_index.hit_test(pair->document, pair->list, SVGPoint{ 78, 78 }) == svg_no_item);
+	}
+
+	return svg_test_result();
+}
@@ -0,0 +1,150 @@
+//Area that svg_stroke_polyline covers for each cap and join, against the exact
+//area of the stroke. The outline is filled with the non-zero rule and its
+//coverage added up, so overlapping pieces must count once.
+
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+#include "SVGRaster.h"
+#include "SVGStroke.h"
+#include "test_util.h"
+
+static const double pi = 3.14159265358979323846;
+//Stroke width, and the length of the lines and sides stroked
+static const float width = 20.0f, half = 10.0f, length = 100.0f;
+
+struct StrokeCase {
+	const char* name;
+	//The points, offset by (50, 50)
+	std::initializer_list<SVGPoint> points;
+	bool closed;
+	SVGLineCap cap;
+	SVGLineJoin join;
+	float miterlimit;
+	double area;
+};
+
+static const StrokeCase stroke_cases[] = {
+	//Caps of a straight line
+	{ "butt cap", { { 0, 0 }, { length, 0 } }, false, SVGLineCap::Butt, SVGLineJoin::Miter, 4, length * width },
+	{ "square cap", { { 0, 0 }, { length, 0 } }, false, SVGLineCap::Square, SVGLineJoin::Miter, 4, (length + width) * width },
+	{ "round cap", { { 0, 0 }, { length, 0 } }, false, SVGLineCap::Round, SVGLineJoin::Miter, 4, length * width + pi * half * half },
+	//Joins of a right angle. The inner corner of the two segments overlaps by half
+	//squared, the outer one is filled with a square, a triangle or a quarter circle.
+	{ "miter join", { { 0, 0 }, { length, 0 }, { length, length } }, false, SVGLineCap::Butt, SVGLineJoin::Miter, 4,
+		2 * length * width },
+	{ "bevel join", { { 0, 0 }, { length, 0 }, { length, length } }, false, SVGLineCap::Butt, SVGLineJoin::Bevel, 4,
+		2 * length * width - half * half / 2 },
+	{ "round join", { { 0, 0 }, { length, 0 }, { length, length } }, false, SVGLineCap::Butt, SVGLineJoin::Round, 4,
+		2 * length * width - half * half + pi * half * half / 4 },
+	//A right angle has a miter of sqrt(2) stroke widths
+	{ "miter under the limit", { { 0, 0 }, { length, 0 }, { length, length } }, false, SVGLineCap::Butt, SVGLineJoin::Miter, 1.42f,
+		2 * length * width },
+	{ "miter over the limit", { { 0, 0 }, { length, 0 }, { length, length } }, false, SVGLineCap::Butt, SVGLineJoin::Miter, 1.41f,
+		2 * length * width - half * half / 2 },
+	//Joins of a closed square, at all four corners
+	{ "closed miter", { { 0, 0 }, { length, 0 }, { length, length }, { 0, length } }, true, SVGLineCap::Round, SVGLineJoin::Miter, 4,
+		4 * length * width },
+	{ "closed bevel", { { 0, 0 }, { length, 0 }, { length, length }, { 0, length } }, true, SVGLineCap::Round, SVGLineJoin::Bevel, 4,
+		4 * length * width - 2 * half * half },
+	{ "closed round", { { 0, 0 }, { length, 0 }, { length, length }, { 0, length } }, true, SVGLineCap::Square, SVGLineJoin::Round, 4,
+		4 * length * width - 4 * half * half + pi * half * half },
+	//A figure of zero length shows its caps as a dot, or nothing
+	{ "round dot", { { 0, 0 }, { 0, 0 } }, false, SVGLineCap::Round, SVGLineJoin::Miter, 4, pi * half * half },
+	{ "square dot", { { 0, 0 }, { 0, 0 } }, false, SVGLineCap::Square, SVGLineJoin::Miter, 4, width * width },
+	{ "butt dot", { { 0, 0 }, { 0, 0 } }, false, SVGLineCap::Butt, SVGLineJoin::Miter, 4, 0 },
+	//Turning back on itself, the miter is infinitely long and always bevels,
+	//which adds nothing
+	{ "reversal", { { 0, 0 }, { length, 0 }, { length / 2, 0 } }, false, SVGLineCap::Butt, SVGLineJoin::Miter, 100, length * width },
+	{ "round reversal", { { 0, 0 }, { length, 0 }, { length / 2, 0 } }, false, SVGLineCap::Butt, SVGLineJoin::Round, 4,
+		length * width + pi * half * half / 2 },
+};
+
+//Area in pixels covered by the stroke outline
+static double stroke_area(const StrokeCase& test) {
+	SVGPolyline input, outline;
+	SVGStrokeStyle style;
+	SVGRasterizer raster;
+	SVGBitmap bitmap;
+
+	for (SVGPoint p : test.points) {
+		SVGPoint q{ p.x + 50, p.y + 50 };
+
+		if (input.empty()) {
+			input.move_to(q);
+		}
+		else {
+			input.line_to(q);
+		}
+	}
+
+	if (test.closed) {
+		input.close();
+	}
+
+	style.width = width;
+	style.cap = test.cap;
+	style.join = test.join;
+	style.miterlimit = test.miterlimit;
+	svg_stroke_polyline(input, style, 0.01f, outline);
+
+	//Opaque black on transparent leaves the coverage in alpha
+	raster.add_polyline(outline, SVGMatrix::identity());
+	bitmap.resize(250, 250);
+	bitmap.clear(0);
+	raster.fill(bitmap, 0x000000FF, 1.0f, SVGFillRule::NonZero);
+
+	double area = 0.0;
+
+	for (size_t i = 3; i < bitmap.pixels.size(); i += 4) {
+		area += bitmap.pixels[i] / 255.0;
+	}
+
+	return area;
+}
+
+int main() {
+	for (const StrokeCase& test : stroke_cases) {
+		double area = stroke_area(test);
+
+		//Each edge pixel rounds its coverage to a byte, and round pieces are flattened
+		//inside the circle, which loses about 2/3 of their length times the tolerance
+		if (std::fabs(area - test.area) > 0.5 + 0.0002 * test.area) {
+			printf("%s covers %.2f, expected %.2f\n", test.name, area, test.area);
+			++svg_test_failures();
+		}
+	}
+
+	//No width, no stroke
+	SVGPolyline line, outline;
+	SVGStrokeStyle none;
+
+	line.move_to(SVGPoint{ 0, 0 });
+	line.line_to(SVGPoint{ 10, 0 });
+	none.width = 0.0f;
+	svg_stroke_polyline(line, none, 0.1f, outline);
+	SVG_CHECK(outline.empty());
+
+	//Every piece winds the same way, so the union never counts twice
+	SVGStrokeStyle style;
+
+	style.join = SVGLineJoin::Round;
+	style.cap = SVGLineCap::Round;
+	line.line_to(SVGPoint{ 10, 10 });
+	line.line_to(SVGPoint{ 0, 5 });
+	svg_stroke_polyline(line, style, 0.1f, outline);
+	SVG_CHECK(!outline.empty());
+
+	for (const SVGPolylineFigure& figure : outline.figures) {
+		const SVGPoint* p = outline.points.data() + figure.first;
+		float area = 0.0f;
+
+		for (uint32_t i = 0, j = figure.count - 1; i < figure.count; j = i++) {
+			area += p[j].x * p[i].y - p[i].x * p[j].y;
+		}
+
+		SVG_CHECK(figure.closed && area < 0.0f);
+	}
+
+	return svg_test_result();
+}
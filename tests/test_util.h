@@ -0,0 +1,32 @@
+#pragma once
+
+//Checks of the test programs. A check that fails prints where it is and what
+//failed, and main returns svg_test_result() to fail the test.
+
+#include <cstdio>
+
+inline int& svg_test_failures() {
+	static int failures = 0;
+
+	return failures;
+}
+
+#define SVG_CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			++svg_test_failures(); \
+		} \
+	} while (false)
+
+inline int svg_test_result() {
+	if (svg_test_failures()) {
+		printf("%d checks failed\n", svg_test_failures());
+
+		return 1;
+	}
+
+	printf("passed\n");
+
+	return 0;
+}
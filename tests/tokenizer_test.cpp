@@ -0,0 +1,146 @@
+//Token streams of SVGTokenizer on well formed and malformed XML
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "SVGTokenizer.h"
+#include "test_util.h"
+
+struct TokenCase {
+	const char* source;
+	//Tokens separated by |. <name a=v> is a start element, <name/> a self closing
+	//one, </name> an end element, "..." text, _ whitespace, ! an error and $ the end.
+	const char* tokens;
+};
+
+static const TokenCase cases[] = {
+	//Elements and attributes
+	{ "<svg width=\"10\" height='20'><rect/></svg>", "<svg width=10 height=20>|<rect/>|</svg>|$" },
+	{ "<a x = \"1\"\t\ny='2' />", "<a x=1 y=2/>|$" },
+	{ "<a x='say \"hi\"' y=\"it's\"/>", "<a x=say \"hi\" y=it's/>|$" },
+	{ "<a x=''/>", "<a x=/>|$" },
+	{ "<svg:rect xlink:href=\"#a\"/>", "<rect xlink:href=#a/>|$" },
+	{ "<a></svg:a >", "<a>|</a>|$" },
+	//Text, whitespace and entities
+	{ "<a>\n  <b/>\n</a>", "<a>|_|<b/>|_|</a>|$" },
+	{ "<t>a &lt; b &amp;&amp; c&#65;&#x42;</t>", "<t>|\"a < b && cAB\"|</t>|$" },
+	{ "<a v=\"&quot;x&apos;&gt;\"/>", "<a v=\"x'>/>|$" },
+	{ "<t>&#x20AC;&#128512;</t>", "<t>|\"\xE2\x82\xAC\xF0\x9F\x98\x80\"|</t>|$" },
+	//Unknown and unterminated references stay as they are
+	{ "<t>&foo; & &#xZZ; &#;</t>", "<t>|\"&foo; & &#xZZ; &#;\"|</t>|$" },
+	{ "<t>a &amp b</t>", "<t>|\"a &amp b\"|</t>|$" },
+	//CDATA is text, never decoded
+	{ "<t><![CDATA[a < &amp; b]]></t>", "<t>|\"a < &amp; b\"|</t>|$" },
+	{ "<t><![CDATA[]]></t>", "<t>|\"\"|</t>|$" },
+	//Comments, processing instructions and DOCTYPE are skipped
+	{ "<a><!-- <b> -- --></a>", "<a>|</a>|$" },
+	{ "<?xml version=\"1.0\"?><!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"x.dtd\"><svg/>", "<svg/>|$" },
+	{ "<!DOCTYPE svg [ <!ENTITY e \"<y>\"> ]><svg/>", "<svg/>|$" },
+	{ "\xEF\xBB\xBF<svg/>", "<svg/>|$" },
+	{ "", "$" },
+	//Malformed input ends in an error
+	{ "<a><!-- x", "<a>|!" },
+	{ "<a><![CDATA[x", "<a>|!" },
+	{ "<?xml", "!" },
+	{ "<!DOCTYPE svg [ >", "!" },
+	{ "<a x=1>", "!" },
+	{ "<a x=\"1>", "!" },
+	{ "<a x>", "!" },
+	{ "<a x=>", "!" },
+	{ "< a>", "!" },
+	{ "<a/ >", "!" },
+	{ "<a", "!" },
+	{ "<a></a", "<a>|!" },
+	{ "<a></>", "<a>|!" },
+};
+
+//The tokens of source in the notation of TokenCase
+static std::string describe(std::string_view source) {
+	SVGTokenizer tokenizer(source);
+	std::string result;
+
+	while (true) {
+		SVGTokenType type = tokenizer.next();
+
+		if (!result.empty()) {
+			result += '|';
+		}
+
+		switch (type) {
+		case SVGTokenType::StartElement:
+			result += '<';
+			result += tokenizer.name();
+
+			for (const SVGXmlAttribute& attr : tokenizer.attributes()) {
+				result += ' ';
+				result += attr.name;
+				result += '=';
+				result += attr.value;
+			}
+
+			result += tokenizer.is_self_closing() ? "/>" : ">";
+
+			break;
+		case SVGTokenType::EndElement:
+			result += "</";
+			result += tokenizer.name();
+			result += '>';
+
+			break;
+		case SVGTokenType::Text:
+			result += '"';
+			result += tokenizer.text();
+			result += '"';
+
+			break;
+		case SVGTokenType::Whitespace:
+			result += '_';
+
+			break;
+		case SVGTokenType::EndOfFile:
+			result += '$';
+
+			return result;
+		case SVGTokenType::Error:
+			result += '!';
+
+			return result;
+		}
+	}
+}
+
+int main() {
+	for (const TokenCase& test : cases) {
+		std::string tokens = describe(test.source);
+
+		if (tokens != test.tokens) {
+			printf("%s\n  expected %s\n  got      %s\n", test.source, test.tokens, tokens.c_str());
+			++svg_test_failures();
+		}
+	}
+
+	//Values without references are slices of the source, decoded ones are not, and
+	//decoded values stay valid while later ones are decoded
+	std::string_view source = "<a x=\"1\" y=\"&lt;\" z=\"&gt;\" w=\"&amp;\"/>";
+	SVGTokenizer tokenizer(source);
+
+	SVG_CHECK(tokenizer.next() == SVGTokenType::StartElement);
+	SVG_CHECK(tokenizer.attributes().size() == 4);
+
+	if (tokenizer.attributes().size() == 4) {
+		std::string_view value;
+
+		SVG_CHECK(tokenizer.is_source_slice(tokenizer.attributes()[0].value));
+		SVG_CHECK(!tokenizer.is_source_slice(tokenizer.attributes()[1].value));
+		SVG_CHECK(tokenizer.attributes()[1].value == "<");
+		SVG_CHECK(tokenizer.attributes()[2].value == ">");
+		SVG_CHECK(tokenizer.attributes()[3].value == "&");
+		SVG_CHECK(tokenizer.get_attribute("z", value) && value == ">");
+		SVG_CHECK(!tokenizer.get_attribute("v", value));
+	}
+
+	SVG_CHECK(tokenizer.next() == SVGTokenType::EndOfFile);
+	SVG_CHECK(tokenizer.offset() == source.size());
+
+	return svg_test_result();
+}
@@ -0,0 +1,125 @@
+//Transform attribute parsing and the classification of matrices
+
+#include <cmath>
+#include <cstdio>
+#include "SVGTransform.h"
+#include "test_util.h"
+
+struct TransformCase {
+	const char* source;
+	//Where the points (0, 0), (1, 0) and (0, 1) end up
+	SVGPoint origin, x, y;
+	SVGTransformClass kind;
+};
+
+static const TransformCase transform_cases[] = {
+	{ "", { 0, 0 }, { 1, 0 }, { 0, 1 }, SVGTransformClass::Identity },
+	{ "translate(10 20)", { 10, 20 }, { 11, 20 }, { 10, 21 }, SVGTransformClass::Translate },
+	{ "translate(5)", { 5, 0 }, { 6, 0 }, { 5, 1 }, SVGTransformClass::Translate },
+	{ "translate(10-5)", { 10, -5 }, { 11, -5 }, { 10, -4 }, SVGTransformClass::Translate },
+	{ "scale(2)", { 0, 0 }, { 2, 0 }, { 0, 2 }, SVGTransformClass::ScaleTranslate },
+	{ "scale(2,3)", { 0, 0 }, { 2, 0 }, { 0, 3 }, SVGTransformClass::ScaleTranslate },
+	{ "scale(-1 1)", { 0, 0 }, { -1, 0 }, { 0, 1 }, SVGTransformClass::ScaleTranslate },
+	//The last function applies first
+	{ "translate(10 20) scale(2)", { 10, 20 }, { 12, 20 }, { 10, 22 }, SVGTransformClass::ScaleTranslate },
+	{ "scale(2) translate(10 20)", { 20, 40 }, { 22, 40 }, { 20, 42 }, SVGTransformClass::ScaleTranslate },
+	{ "translate(1,2)scale(2)", { 1, 2 }, { 3, 2 }, { 1, 4 }, SVGTransformClass::ScaleTranslate },
+	{ "scale(1) translate(0)", { 0, 0 }, { 1, 0 }, { 0, 1 }, SVGTransformClass::Identity },
+	{ "rotate(90)", { 0, 0 }, { 0, 1 }, { -1, 0 }, SVGTransformClass::Affine },
+	{ "rotate(90 10 10)", { 20, 0 }, { 20, 1 }, { 19, 0 }, SVGTransformClass::Affine },
+	{ "rotate(-90,10,10)", { 0, 20 }, { 0, 19 }, { 1, 20 }, SVGTransformClass::Affine },
+	{ "rotate(0)", { 0, 0 }, { 1, 0 }, { 0, 1 }, SVGTransformClass::Identity },
+	{ "skewX(45)", { 0, 0 }, { 1, 0 }, { 1, 1 }, SVGTransformClass::Affine },
+	{ "skewY(45)", { 0, 0 }, { 1, 1 }, { 0, 1 }, SVGTransformClass::Affine },
+	{ "matrix(1 2 3 4 5 6)", { 5, 6 }, { 6, 8 }, { 8, 10 }, SVGTransformClass::Affine },
+	{ "translate(100 0) rotate(90) scale(2 1)", { 100, 0 }, { 100, 2 }, { 99, 0 }, SVGTransformClass::Affine },
+	//A wrong number of arguments or an unknown function is ignored
+	{ "rotate(1 2)", { 0, 0 }, { 1, 0 }, { 0, 1 }, SVGTransformClass::Identity },
+	{ "translate(1 2 3) scale(2)", { 0, 0 }, { 2, 0 }, { 0, 2 }, SVGTransformClass::ScaleTranslate },
+	{ "spin(30) translate(3)", { 3, 0 }, { 4, 0 }, { 3, 1 }, SVGTransformClass::Translate },
+};
+
+//Syntax errors, which leave the matrix as it was
+static const char* invalid_transforms[] = {
+	"translate(1 2",
+	"translate 1 2",
+	"(1)",
+	"translate(1 x)",
+	"translate(1) )",
+	"translate(,1)x",
+	"1",
+};
+
+static bool near(SVGPoint a, SVGPoint b) {
+	return std::fabs(a.x - b.x) < 1e-4f && std::fabs(a.y - b.y) < 1e-4f;
+}
+
+static bool near(const SVGMatrix& a, const SVGMatrix& b) {
+	return std::fabs(a.m11 - b.m11) < 1e-5f && std::fabs(a.m12 - b.m12) < 1e-5f && std::fabs(a.m21 - b.m21) < 1e-5f &&
+		std::fabs(a.m22 - b.m22) < 1e-5f && std::fabs(a.dx - b.dx) < 1e-4f && std::fabs(a.dy - b.dy) < 1e-4f;
+}
+
+int main() {
+	const SVGMatrix samples[] = {
+		SVGMatrix::identity(),
+		SVGMatrix::translation(3, -4),
+		SVGMatrix{ 2, 0, 0, -3, 5, 6 },
+		SVGMatrix{ 0.5f, 0.25f, -1, 2, 7, -8 },
+	};
+
+	for (const TransformCase& test : transform_cases) {
+		SVGMatrix m;
+
+		if (!svg_parse_transform(test.source, m)) {
+			printf("\"%s\" does not parse\n", test.source);
+			++svg_test_failures();
+			continue;
+		}
+
+		SVGPoint origin = svg_transform_point(m, SVGPoint{ 0, 0 });
+		SVGPoint x = svg_transform_point(m, SVGPoint{ 1, 0 });
+		SVGPoint y = svg_transform_point(m, SVGPoint{ 0, 1 });
+
+		//Exact zeros make the simple classes, so rotate(90) stays Affine with its
+		//cosine a rounding error off zero
+		if (!near(origin, test.origin) || !near(x, test.x) || !near(y, test.y) || svg_classify_transform(m) != test.kind) {
+			printf("\"%s\" maps to (%g %g) (%g %g) (%g %g), class %d\n", test.source, origin.x, origin.y, x.x, x.y, y.x, y.y,
+				static_cast<int>(svg_classify_transform(m)));
+			++svg_test_failures();
+		}
+
+		//The shortcuts of each class give the full product
+		for (const SVGMatrix& b : samples) {
+			SVG_CHECK(near(svg_multiply(m, svg_classify_transform(m), b), svg_multiply(m, b)));
+		}
+	}
+
+	for (const char* source : invalid_transforms) {
+		SVGMatrix m = SVGMatrix::translation(1, 2);
+
+		if (svg_parse_transform(source, m) || !svg_matrix_equals(m, SVGMatrix::translation(1, 2))) {
+			printf("\"%s\" is not rejected\n", source);
+			++svg_test_failures();
+		}
+	}
+
+	//Inverse and bounds
+	for (const SVGMatrix& m : samples) {
+		SVGMatrix inverse;
+
+		SVG_CHECK(svg_invert(m, inverse));
+		SVG_CHECK(near(svg_multiply(m, inverse), SVGMatrix::identity()));
+	}
+
+	SVGMatrix singular = SVGMatrix::scale(0, 1), unchanged = SVGMatrix::translation(9, 9);
+
+	SVG_CHECK(!svg_invert(singular, unchanged) && svg_matrix_equals(unchanged, SVGMatrix::translation(9, 9)));
+
+	SVGRect flipped = svg_transform_rect(samples[2], SVGTransformClass::ScaleTranslate, SVGRect{ 0, 0, 1, 1 });
+	SVGRect rotated = svg_transform_rect(SVGMatrix{ 0, 1, -1, 0, 0, 0 }, SVGTransformClass::Affine, SVGRect{ 0, 0, 2, 1 });
+
+	SVG_CHECK(flipped.left == 5 && flipped.right == 7 && flipped.top == 3 && flipped.bottom == 6);
+	SVG_CHECK(rotated.left == -1 && rotated.right == 0 && rotated.top == 0 && rotated.bottom == 2);
+
+	return svg_test_result();
+}
@@ -7,14 +7,12 @@
 #include <mgui.h>
 #include "SVGUtil.h"
 #include <shobjidl.h>
-#include <xmllite.h>
 
 #pragma comment(lib, "D3D11.lib")
 #pragma comment(lib, "d2d1.lib")
 #pragma comment(lib, "windowscodecs.lib")
 //We need dxguid.lib for some of the CLSID and IID definitions
 #pragma comment(lib, "dxguid.lib")
-#pragma comment(lib, "xmllite.lib")
 #pragma comment(lib, "dwrite.lib")
 
 void check_throw(HRESULT hr) {
@@ -25,6 +23,9 @@ void check_throw(HRESULT hr) {
 
 class MainWindow : public CFrame {
 	SVGUtil svgUtil;
+    //Last mouse position while dragging the document
+    POINT dragFrom = { 0, 0 };
+    bool dragging = false;
 public:
     
     void create() {
@@ -59,19 +60,52 @@ public:
 
     bool handleEvent(UINT message, WPARAM wParam, LPARAM lParam) {
         switch (message) {
-        case WM_PAINT:
+        case WM_PAINT: {
             PAINTSTRUCT ps;
+            //Only what was invalidated is painted again. BeginPaint
+            //empties the update region, so take it first.
+            HRGN update = CreateRectRgn(0, 0, 0, 0);
+
+            GetUpdateRgn(m_wnd, update, FALSE);
 
             //We must call BeginPaint and EndPaint to validate the
             //invalidated region, or else we will get continuous
             //WM_PAINT messages.
             BeginPaint(m_wnd, &ps);
-            svgUtil.render();
+            svgUtil.render(update);
             EndPaint(m_wnd, &ps);
+            DeleteObject(update);
             break;
+        }
         case WM_SIZE:
             svgUtil.resize();
             break;
+        case WM_MOUSEWHEEL: {
+            //The wheel reports the cursor in screen coordinates
+            POINT pt = { static_cast<short>(LOWORD(lParam)), static_cast<short>(HIWORD(lParam)) };
+
+            ScreenToClient(m_wnd, &pt);
+            svgUtil.zoom(GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA, pt.x, pt.y);
+            break;
+        }
+        case WM_LBUTTONDOWN:
+            dragFrom = { static_cast<short>(LOWORD(lParam)), static_cast<short>(HIWORD(lParam)) };
+            dragging = true;
+            SetCapture(m_wnd);
+            break;
+        case WM_MOUSEMOVE:
+            if (dragging && (wParam & MK_LBUTTON)) {
+                POINT pt = { static_cast<short>(LOWORD(lParam)), static_cast<short>(HIWORD(lParam)) };
+
+                svgUtil.pan(pt.x - dragFrom.x, pt.y - dragFrom.y);
+                dragFrom = pt;
+            }
+
+            break;
+        case WM_LBUTTONUP:
+            dragging = false;
+            ReleaseCapture();
+            break;
         case WM_ERASEBKGND:
 			//Handle background erase to avoid flickering 
             //during resizing and move